@@ -0,0 +1,206 @@
+/*
+  Copyright (C) 2020  The Blosc Developers
+  http://blosc.org
+  License: BSD 3-Clause (see LICENSE.txt)
+
+  Benchmark for the serialization of super-chunks into frames, either in-memory or on-disk.
+
+  The chunks are copied into in-memory frames with as many threads as the compression
+  context has, and written to file frames in large batches (with pwritev() where available).
+  These are compared against a chunk-by-chunk copy (or fwrite()), which is what the
+  serialization used to do.
+
+  To compile this program:
+
+  $ gcc -O3 frame_serialize.c -o frame_serialize -lblosc2
+
+  To run:
+
+  $ ./frame_serialize [nchunks] [nthreads]
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <blosc2.h>
+
+#define KB  1024.
+#define MB  (1024*KB)
+#define GB  (1024*MB)
+
+#define CHUNKSIZE (8 * 1000)
+#define NCHUNKS (20 * 1000)
+#define NTHREADS 4
+#define NREPS 5
+
+char* filename = "frame_serialize.b2frame";
+
+
+/* The chunk-by-chunk serialization of the data chunks (in-memory if fp is NULL) */
+static void serial_copy(blosc2_schunk* schunk, uint8_t* dest, FILE* fp) {
+  int64_t offset = 0;
+  for (int nchunk = 0; nchunk < schunk->nchunks; nchunk++) {
+    uint8_t* chunk;
+    bool needs_free;
+    int cbytes = blosc2_schunk_get_chunk(schunk, nchunk, &chunk, &needs_free);
+    if (fp == NULL) {
+      memcpy(dest + offset, chunk, (size_t)cbytes);
+    }
+    else {
+      fwrite(chunk, (size_t)cbytes, 1, fp);
+    }
+    offset += cbytes;
+    if (needs_free) {
+      free(chunk);
+    }
+  }
+}
+
+
+static double best_of(double times[NREPS]) {
+  double best = times[0];
+  for (int i = 1; i < NREPS; i++) {
+    if (times[i] < best) {
+      best = times[i];
+    }
+  }
+  return best;
+}
+
+
+int main(int argc, char* argv[]) {
+  int nchunks = NCHUNKS;
+  int nthreads = NTHREADS;
+  if (argc > 1) {
+    nchunks = (int)strtol(argv[1], NULL, 10);
+  }
+  if (argc > 2) {
+    nthreads = (int)strtol(argv[2], NULL, 10);
+  }
+  blosc_timestamp_t last, current;
+  double times[NREPS];
+
+  printf("Blosc version info: %s (%s)\n", BLOSC_VERSION_STRING, BLOSC_VERSION_DATE);
+  blosc_init();
+
+  // Data that does not compress too much, so that there are plenty of bytes to be moved
+  int32_t* data = malloc(CHUNKSIZE * sizeof(int32_t));
+  uint32_t seed = 1;
+  for (int i = 0; i < CHUNKSIZE; i++) {
+    seed = seed * 1103515245U + 12345U;
+    data[i] = (int32_t)(seed >> 20U);
+  }
+
+  // A super-chunk for the serial copy, and another one for the parallel copy
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  cparams.clevel = 1;
+  cparams.nthreads = 1;
+  blosc2_storage storage = {.cparams=&cparams};
+  blosc2_schunk* schunk1 = blosc2_schunk_new(storage);
+  cparams.nthreads = (int16_t)nthreads;
+  blosc2_schunk* schunkn = blosc2_schunk_new(storage);
+  for (int nchunk = 0; nchunk < nchunks; nchunk++) {
+    data[0] = nchunk;
+    if (blosc2_schunk_append_buffer(schunk1, data, CHUNKSIZE * sizeof(int32_t)) < 0) {
+      printf("Error appending a chunk\n");
+      return 1;
+    }
+    uint8_t* chunk;
+    bool needs_free;
+    blosc2_schunk_get_chunk(schunk1, nchunk, &chunk, &needs_free);
+    blosc2_schunk_append_chunk(schunkn, chunk, true);
+  }
+  double cbytes = (double)schunk1->cbytes;
+  printf("Super-chunk with %d chunks: %.1f MB -> %.1f MB (%.1fx)\n", nchunks,
+         schunk1->nbytes / MB, cbytes / MB, schunk1->nbytes / cbytes);
+
+  // In-memory frames
+  for (int i = 0; i < NREPS; i++) {
+    blosc_set_timestamp(&last);
+    uint8_t* dest = malloc((size_t)schunk1->cbytes);
+    serial_copy(schunk1, dest, NULL);
+    blosc_set_timestamp(&current);
+    times[i] = blosc_elapsed_secs(last, current);
+    free(dest);
+  }
+  printf("[Memory] chunk by chunk:\t %6.4f s, %.1f GB/s\n",
+         best_of(times), cbytes / (GB * best_of(times)));
+  blosc2_schunk* schunks[2] = {schunk1, schunkn};
+  uint8_t* sframes[2];
+  int64_t sframe_lens[2];
+  for (int n = 0; n < 2; n++) {
+    for (int i = 0; i < NREPS; i++) {
+      blosc_set_timestamp(&last);
+      sframe_lens[n] = blosc2_schunk_to_sframe(schunks[n], &sframes[n]);
+      blosc_set_timestamp(&current);
+      times[i] = blosc_elapsed_secs(last, current);
+      if (sframe_lens[n] < schunk1->cbytes) {
+        printf("Error serializing the super-chunk\n");
+        return 1;
+      }
+      if (i < NREPS - 1) {
+        free(sframes[n]);
+      }
+    }
+    printf("[Memory] to_sframe (%d threads):\t %6.4f s, %.1f GB/s\n", n == 0 ? 1 : nthreads,
+           best_of(times), cbytes / (GB * best_of(times)));
+  }
+  // Both frames should be the same, except for the number of threads in the header
+  if (sframe_lens[0] != sframe_lens[1] ||
+      memcmp(sframes[0] + 0x40, sframes[1] + 0x40, (size_t)(sframe_lens[0] - 0x40)) != 0) {
+    printf("Error: the frames serialized in parallel are different\n");
+    return 1;
+  }
+  free(sframes[0]);
+  free(sframes[1]);
+
+  // File frames
+  for (int i = 0; i < NREPS; i++) {
+    blosc_set_timestamp(&last);
+    FILE* fp = fopen(filename, "wb");
+    serial_copy(schunk1, NULL, fp);
+    fclose(fp);
+    blosc_set_timestamp(&current);
+    times[i] = blosc_elapsed_secs(last, current);
+  }
+  printf("[File] chunk by chunk:\t\t %6.4f s, %.1f GB/s\n",
+         best_of(times), cbytes / (GB * best_of(times)));
+  for (int i = 0; i < NREPS; i++) {
+    blosc2_frame* frame = blosc2_frame_new(filename);
+    blosc_set_timestamp(&last);
+    int64_t frame_len = blosc2_frame_from_schunk(schunk1, frame);
+    blosc_set_timestamp(&current);
+    times[i] = blosc_elapsed_secs(last, current);
+    blosc2_frame_free(frame);
+    if (frame_len < schunk1->cbytes) {
+      printf("Error serializing the super-chunk\n");
+      return 1;
+    }
+  }
+  printf("[File] frame_from_schunk:\t %6.4f s, %.1f GB/s\n",
+         best_of(times), cbytes / (GB * best_of(times)));
+
+  // Check that the frame on-disk is fine
+  blosc2_storage fstorage = {.sequential=true, .path=filename};
+  blosc2_schunk* schunk = blosc2_schunk_open(fstorage);
+  int32_t* data_dest = malloc(CHUNKSIZE * sizeof(int32_t));
+  for (int nchunk = 0; nchunk < nchunks; nchunk++) {
+    int dsize = blosc2_schunk_decompress_chunk(schunk, nchunk, data_dest, CHUNKSIZE * sizeof(int32_t));
+    if (dsize != CHUNKSIZE * sizeof(int32_t) || data_dest[0] != nchunk || data_dest[1] != data[1]) {
+      printf("Error in the frame on-disk\n");
+      return 1;
+    }
+  }
+  remove(filename);
+
+  free(data);
+  free(data_dest);
+  blosc2_schunk_free(schunk);
+  blosc2_schunk_free(schunk1);
+  blosc2_schunk_free(schunkn);
+  blosc_destroy();
+
+  return 0;
+}
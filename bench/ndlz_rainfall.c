@@ -0,0 +1,151 @@
+/*
+  Copyright (C) 2020  The Blosc Developers
+  http://blosc.org
+  License: BSD 3-Clause (see LICENSE.txt)
+
+  Benchmark for the NDLZ codec on a grid of rainfall data.
+
+  The grid (150x150 float32 items, stored as a Blosc1 buffer in rainfall-grid-150x150.bin)
+  goes into an n-dimensional super-chunk with blocks of 50x50 items, and it is compressed
+  with NDLZ (with and without shuffle), and with BloscLZ and LZ4 (with shuffle) as the
+  baselines.  The compression ratios and speeds are reported, and the roundtrip is checked.
+
+  To compile this program:
+
+  $ gcc -O3 ndlz_rainfall.c -o ndlz_rainfall -lblosc2
+
+  To run:
+
+  $ ./ndlz_rainfall [rainfall-grid-150x150.bin] [blockshape]
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <blosc2.h>
+
+#define KB  1024.
+#define MB  (1024*KB)
+#define GB  (1024*MB)
+
+#define NROWS 150
+#define NCOLS 150
+#define BLOCKSHAPE 50
+#define NITER 20
+
+
+static int bench_codec(const char* what, int compcode, uint8_t filter, int32_t blockshape,
+                       const float* grid, float* grid_out) {
+  blosc_timestamp_t last, current;
+  double ctotal = 1e10, dtotal = 1e10, itotal;
+  int64_t nbytes = NROWS * NCOLS * sizeof(float);
+  int64_t cbytes = 0;
+  int64_t start[2] = {0, 0};
+  int64_t stop[2] = {NROWS, NCOLS};
+
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(float);
+  cparams.compcode = (uint8_t)compcode;
+  cparams.clevel = 5;
+  cparams.filters[BLOSC2_MAX_FILTERS - 1] = filter;
+  cparams.nthreads = 1;
+  cparams.ndim = 2;
+  cparams.shape[0] = NROWS;
+  cparams.shape[1] = NCOLS;
+  cparams.chunkshape[0] = NROWS;
+  cparams.chunkshape[1] = NCOLS;
+  cparams.blockshape[0] = blockshape;
+  cparams.blockshape[1] = blockshape;
+  blosc2_storage storage = {.cparams=&cparams};
+
+  for (int n = 0; n < NITER; n++) {
+    blosc2_schunk* schunk = blosc2_schunk_new(storage);
+    if (schunk == NULL) {
+      printf("Error creating the super-chunk\n");
+      return -1;
+    }
+    blosc_set_timestamp(&last);
+    if (blosc2_schunk_set_ndarray(schunk, grid, nbytes) < 0) {
+      printf("Error compressing the grid\n");
+      return -1;
+    }
+    blosc_set_timestamp(&current);
+    itotal = blosc_elapsed_secs(last, current);
+    if (itotal < ctotal) ctotal = itotal;
+    cbytes = schunk->cbytes;
+
+    blosc_set_timestamp(&last);
+    if (blosc2_schunk_get_hyperslab(schunk, start, stop, grid_out) != nbytes) {
+      printf("Error decompressing the grid\n");
+      return -1;
+    }
+    blosc_set_timestamp(&current);
+    itotal = blosc_elapsed_secs(last, current);
+    if (itotal < dtotal) dtotal = itotal;
+    blosc2_schunk_free(schunk);
+  }
+  if (memcmp(grid, grid_out, (size_t)nbytes) != 0) {
+    printf("The roundtrip of %s is not exact!\n", what);
+    return -1;
+  }
+
+  printf("%-22s %8lld -> %6lld (%5.2fx)\t comp: %7.1f MB/s\t decomp: %7.1f MB/s\n", what,
+         (long long)nbytes, (long long)cbytes, (double)nbytes / (double)cbytes,
+         (double)nbytes / (MB * ctotal), (double)nbytes / (MB * dtotal));
+  return 0;
+}
+
+
+int main(int argc, char* argv[]) {
+  const char* filename = "rainfall-grid-150x150.bin";
+  int32_t blockshape = BLOCKSHAPE;
+  if (argc > 1) {
+    filename = argv[1];
+  }
+  if (argc > 2) {
+    blockshape = (int32_t)strtol(argv[2], NULL, 10);
+  }
+
+  printf("Blosc version info: %s (%s)\n", BLOSC_VERSION_STRING, BLOSC_VERSION_DATE);
+  blosc_init();
+
+  // The grid is stored as a Blosc1 buffer
+  FILE* finput = fopen(filename, "rb");
+  if (finput == NULL) {
+    printf("Cannot open %s\n", filename);
+    return 1;
+  }
+  fseek(finput, 0, SEEK_END);
+  long csize = ftell(finput);
+  fseek(finput, 0, SEEK_SET);
+  uint8_t* cgrid = malloc((size_t)csize);
+  if (fread(cgrid, 1, (size_t)csize, finput) != (size_t)csize) {
+    printf("Cannot read %s\n", filename);
+    return 1;
+  }
+  fclose(finput);
+  float* grid = malloc(NROWS * NCOLS * sizeof(float));
+  float* grid_out = malloc(NROWS * NCOLS * sizeof(float));
+  if (blosc_decompress(cgrid, grid, NROWS * NCOLS * sizeof(float)) != NROWS * NCOLS * sizeof(float)) {
+    printf("Cannot decompress the grid in %s\n", filename);
+    return 1;
+  }
+  free(cgrid);
+
+  printf("Compressing a grid of %dx%d floats with blocks of %dx%d items\n",
+         NROWS, NCOLS, blockshape, blockshape);
+  int rc = 0;
+  rc |= bench_codec("NDLZ:", BLOSC_NDLZ, BLOSC_NOFILTER, blockshape, grid, grid_out);
+  rc |= bench_codec("NDLZ + shuffle:", BLOSC_NDLZ, BLOSC_SHUFFLE, blockshape, grid, grid_out);
+  rc |= bench_codec("BloscLZ + shuffle:", BLOSC_BLOSCLZ, BLOSC_SHUFFLE, blockshape, grid, grid_out);
+  if (blosc_compname_to_compcode(BLOSC_LZ4_COMPNAME) == BLOSC_LZ4) {
+    rc |= bench_codec("LZ4 + shuffle:", BLOSC_LZ4, BLOSC_SHUFFLE, blockshape, grid, grid_out);
+  }
+
+  free(grid);
+  free(grid_out);
+  blosc_destroy();
+
+  return rc != 0;
+}
@@ -0,0 +1,128 @@
+/*
+  Copyright (C) 2020  The Blosc Developers
+  http://blosc.org
+  License: BSD 3-Clause (see LICENSE.txt)
+
+  Benchmark for the ingestion of (small) chunks into super-chunks.
+
+  Buffers are appended with blosc2_schunk_append_buffer(), where the caller compresses each
+  buffer with the threads of the context of the super-chunk, and with an appender, where a pool
+  of threads compresses the buffers in the background while the caller keeps handing them in.
+
+  To compile this program:
+
+  $ gcc -O3 schunk_appender.c -o schunk_appender -lblosc2
+
+  To run:
+
+  $ ./schunk_appender [nchunks] [nthreads]
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <blosc2.h>
+
+#define KB  1024.
+#define MB  (1024*KB)
+#define GB  (1024*MB)
+
+#define CHUNKSIZE (16 * 1000)
+#define NCHUNKS (10 * 1000)
+#define NTHREADS 4
+#define NQUEUED 64
+
+char* filename = "schunk_appender.b2frame";
+
+
+static blosc2_schunk* new_schunk(int nthreads, bool sequential) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  cparams.clevel = 5;
+  cparams.nthreads = (int16_t)nthreads;
+  blosc2_storage storage = {.cparams=&cparams, .sequential=sequential,
+                            .path=sequential ? filename : NULL};
+  return blosc2_schunk_new(storage);
+}
+
+
+int main(int argc, char* argv[]) {
+  int nchunks = NCHUNKS;
+  int nthreads = NTHREADS;
+  if (argc > 1) {
+    nchunks = (int)strtol(argv[1], NULL, 10);
+  }
+  if (argc > 2) {
+    nthreads = (int)strtol(argv[2], NULL, 10);
+  }
+  blosc_timestamp_t last, current;
+  double ttotal;
+
+  printf("Blosc version info: %s (%s)\n", BLOSC_VERSION_STRING, BLOSC_VERSION_DATE);
+  blosc_init();
+
+  int32_t* data = malloc(CHUNKSIZE * sizeof(int32_t));
+  int32_t* data_dest = malloc(CHUNKSIZE * sizeof(int32_t));
+  double nbytes = (double)nchunks * CHUNKSIZE * sizeof(int32_t);
+  printf("Appending %d chunks of %.1f KB with %d threads\n", nchunks,
+         CHUNKSIZE * sizeof(int32_t) / KB, nthreads);
+
+  for (int n = 0; n < 2; n++) {
+    bool sequential = n == 1;
+    const char* where = sequential ? "[File]" : "[Memory]";
+
+    blosc2_schunk* schunk = new_schunk(nthreads, sequential);
+    blosc_set_timestamp(&last);
+    for (int nchunk = 0; nchunk < nchunks; nchunk++) {
+      for (int i = 0; i < CHUNKSIZE; i++) {
+        data[i] = i * nchunk;
+      }
+      if (blosc2_schunk_append_buffer(schunk, data, CHUNKSIZE * sizeof(int32_t)) < 0) {
+        printf("Error appending a chunk\n");
+        return 1;
+      }
+    }
+    blosc_set_timestamp(&current);
+    ttotal = blosc_elapsed_secs(last, current);
+    printf("%s append_buffer:\t %6.4f s, %.1f GB/s\n", where, ttotal, nbytes / (GB * ttotal));
+    blosc2_schunk_free(schunk);
+
+    schunk = new_schunk(nthreads, sequential);
+    blosc_set_timestamp(&last);
+    blosc2_schunk_appender* appender = blosc2_schunk_appender_new(schunk, nthreads, NQUEUED);
+    for (int nchunk = 0; nchunk < nchunks; nchunk++) {
+      for (int i = 0; i < CHUNKSIZE; i++) {
+        data[i] = i * nchunk;
+      }
+      if (blosc2_schunk_appender_push(appender, data, CHUNKSIZE * sizeof(int32_t)) < 0) {
+        printf("Error appending a chunk\n");
+        return 1;
+      }
+    }
+    if (blosc2_schunk_appender_free(appender) != nchunks) {
+      printf("Error appending the chunks\n");
+      return 1;
+    }
+    blosc_set_timestamp(&current);
+    ttotal = blosc_elapsed_secs(last, current);
+    printf("%s appender:\t\t %6.4f s, %.1f GB/s\n", where, ttotal, nbytes / (GB * ttotal));
+
+    // Check that the chunks are in order
+    for (int nchunk = 0; nchunk < nchunks; nchunk++) {
+      int dsize = blosc2_schunk_decompress_chunk(schunk, nchunk, data_dest,
+                                                 CHUNKSIZE * sizeof(int32_t));
+      if (dsize != CHUNKSIZE * sizeof(int32_t) || data_dest[1] != nchunk) {
+        printf("Error in the appended chunks\n");
+        return 1;
+      }
+    }
+    blosc2_schunk_free(schunk);
+  }
+  remove(filename);
+
+  free(data);
+  free(data_dest);
+  blosc_destroy();
+
+  return 0;
+}
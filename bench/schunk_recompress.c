@@ -0,0 +1,114 @@
+/*
+  Copyright (C) 2020  The Blosc Developers
+  http://blosc.org
+  License: BSD 3-Clause (see LICENSE.txt)
+
+  Benchmark for recompressing super-chunks with different compression parameters.
+
+  A super-chunk compressed with LZ4 is recompressed with ZSTD (as it is done with cold data) with
+  blosc2_schunk_recompress(), both in memory and into a frame file.  Then it is recompressed with
+  its own parameters, so that the chunks are just copied.
+
+  To compile this program:
+
+  $ gcc -O3 schunk_recompress.c -o schunk_recompress -lblosc2
+
+  To run:
+
+  $ ./schunk_recompress [nchunks] [nthreads]
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <blosc2.h>
+
+#define KB  1024.
+#define MB  (1024*KB)
+#define GB  (1024*MB)
+
+#define CHUNKSIZE (250 * 1000)
+#define NCHUNKS (400)
+#define NTHREADS 4
+
+char* filename = "schunk_recompress.b2frame";
+
+
+static int recompress(blosc2_schunk* src, int compcode, int clevel, int nthreads, bool sequential,
+                      const char* what) {
+  blosc_timestamp_t last, current;
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  cparams.compcode = (uint8_t)compcode;
+  cparams.clevel = (uint8_t)clevel;
+  cparams.nthreads = (int16_t)nthreads;
+  blosc2_storage storage = {.sequential=sequential, .path=sequential ? filename : NULL};
+
+  blosc_set_timestamp(&last);
+  blosc2_schunk* dest = blosc2_schunk_recompress(src, cparams, storage);
+  blosc_set_timestamp(&current);
+  if (dest == NULL) {
+    printf("Error recompressing the super-chunk\n");
+    return -1;
+  }
+  double ttotal = blosc_elapsed_secs(last, current);
+  printf("%s %s:\t %6.4f s, %.1f GB/s (ratio: %.1fx -> %.1fx)\n",
+         sequential ? "[File]" : "[Memory]", what, ttotal, (double)src->nbytes / (GB * ttotal),
+         (double)src->nbytes / (double)src->cbytes, (double)dest->nbytes / (double)dest->cbytes);
+  blosc2_schunk_free(dest);
+  if (sequential) {
+    remove(filename);
+  }
+  return 0;
+}
+
+
+int main(int argc, char* argv[]) {
+  int nchunks = NCHUNKS;
+  int nthreads = NTHREADS;
+  if (argc > 1) {
+    nchunks = (int)strtol(argv[1], NULL, 10);
+  }
+  if (argc > 2) {
+    nthreads = (int)strtol(argv[2], NULL, 10);
+  }
+
+  printf("Blosc version info: %s (%s)\n", BLOSC_VERSION_STRING, BLOSC_VERSION_DATE);
+  blosc_init();
+
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  cparams.compcode = BLOSC_LZ4;
+  cparams.clevel = 5;
+  cparams.nthreads = (int16_t)nthreads;
+  blosc2_storage storage = {.cparams=&cparams};
+  blosc2_schunk* src = blosc2_schunk_new(storage);
+  int32_t* data = malloc(CHUNKSIZE * sizeof(int32_t));
+  for (int nchunk = 0; nchunk < nchunks; nchunk++) {
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      data[i] = i * nchunk + (i % 17);
+    }
+    if (blosc2_schunk_append_buffer(src, data, CHUNKSIZE * sizeof(int32_t)) < 0) {
+      printf("Error appending a chunk\n");
+      return 1;
+    }
+  }
+  free(data);
+  printf("Recompressing %d chunks of %.1f KB with %d threads\n", nchunks,
+         CHUNKSIZE * sizeof(int32_t) / KB, nthreads);
+
+  for (int n = 0; n < 2; n++) {
+    bool sequential = n == 1;
+    if (recompress(src, BLOSC_ZSTD, 5, nthreads, sequential, "lz4 -> zstd") < 0) {
+      return 1;
+    }
+    if (recompress(src, BLOSC_LZ4, 5, nthreads, sequential, "lz4 -> lz4 (copy)") < 0) {
+      return 1;
+    }
+  }
+
+  blosc2_schunk_free(src);
+  blosc_destroy();
+
+  return 0;
+}
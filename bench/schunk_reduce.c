@@ -0,0 +1,180 @@
+/*
+  Copyright (C) 2020  The Blosc Developers
+  http://blosc.org
+  License: BSD 3-Clause (see LICENSE.txt)
+
+  Benchmark for reducing super-chunks.
+
+  The sum of a super-chunk is computed with blosc2_schunk_reduce(), which reduces every block
+  right after decompressing it in the decompression threads, and it is compared with the
+  baselines that decompress the data first (the whole super-chunk, or chunk by chunk, as
+  sum_openmp.c does) and sum it in a second pass.  The maximum is computed from the zone maps
+  of the chunks too.
+
+  To compile this program:
+
+  $ gcc -O3 schunk_reduce.c -o schunk_reduce -lblosc2
+
+  To run:
+
+  $ ./schunk_reduce [nchunks] [nthreads]
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <blosc2.h>
+
+#define KB  1024.
+#define MB  (1024*KB)
+#define GB  (1024*MB)
+
+#define CHUNKSIZE (250 * 1000)
+#define NCHUNKS (400)
+#define NTHREADS 4
+#define NITER 5
+
+
+static int64_t sum_items(const int64_t* items, int64_t nitems) {
+  int64_t sum = 0;
+  for (int64_t i = 0; i < nitems; i++) {
+    sum += items[i];
+  }
+  return sum;
+}
+
+
+static void report(const char* what, double ttotal, int64_t nbytes, int64_t sum) {
+  printf("%-34s %14lld\t %6.4f s, %.1f GB/s\n", what, (long long)sum, ttotal,
+         (double)nbytes / (GB * ttotal));
+}
+
+
+int main(int argc, char* argv[]) {
+  int nchunks = NCHUNKS;
+  int nthreads = NTHREADS;
+  if (argc > 1) {
+    nchunks = (int)strtol(argv[1], NULL, 10);
+  }
+  if (argc > 2) {
+    nthreads = (int)strtol(argv[2], NULL, 10);
+  }
+  blosc_timestamp_t last, current;
+  double ttotal, itotal;
+
+  printf("Blosc version info: %s (%s)\n", BLOSC_VERSION_STRING, BLOSC_VERSION_DATE);
+  blosc_init();
+
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int64_t);
+  cparams.compcode = BLOSC_BLOSCLZ;
+  cparams.clevel = 3;
+  cparams.nthreads = (int16_t)nthreads;
+  cparams.zonemap_type = BLOSC2_ZONEMAP_INT64;
+  blosc2_dparams dparams = BLOSC2_DPARAMS_DEFAULTS;
+  dparams.nthreads = nthreads;
+  blosc2_storage storage = {.cparams=&cparams, .dparams=&dparams};
+  blosc2_schunk* schunk = blosc2_schunk_new(storage);
+  int64_t nitems = (int64_t)nchunks * CHUNKSIZE;
+  int64_t* data = malloc(nitems * sizeof(int64_t));
+  for (int64_t i = 0; i < nitems; i++) {
+    data[i] = i % CHUNKSIZE + i / (CHUNKSIZE * 10);
+  }
+  for (int nchunk = 0; nchunk < nchunks; nchunk++) {
+    if (blosc2_schunk_append_buffer(schunk, data + (int64_t)nchunk * CHUNKSIZE,
+                                    CHUNKSIZE * sizeof(int64_t)) < 0) {
+      printf("Error appending a chunk\n");
+      return 1;
+    }
+  }
+  int64_t nbytes = schunk->nbytes;
+  printf("Reducing %d chunks of %.1f KB (%.1f MB -> %.1f MB, %.1fx) with %d threads\n",
+         nchunks, CHUNKSIZE * sizeof(int64_t) / KB, nbytes / MB, schunk->cbytes / MB,
+         (double)nbytes / (double)schunk->cbytes, nthreads);
+
+  // Reference: the uncompressed data
+  int64_t sum = 0;
+  ttotal = 1e10;
+  for (int n = 0; n < NITER; n++) {
+    blosc_set_timestamp(&last);
+    sum = sum_items(data, nitems);
+    blosc_set_timestamp(&current);
+    itotal = blosc_elapsed_secs(last, current);
+    if (itotal < ttotal) ttotal = itotal;
+  }
+  report("Sum (uncompressed):", ttotal, nbytes, sum);
+  int64_t expected = sum;
+
+  // Baseline: decompress the whole super-chunk and sum it
+  ttotal = 1e10;
+  for (int n = 0; n < NITER; n++) {
+    blosc_set_timestamp(&last);
+    if (blosc2_schunk_get_slice(schunk, 0, nitems, data) < 0) {
+      printf("Error decompressing the super-chunk\n");
+      return 1;
+    }
+    sum = sum_items(data, nitems);
+    blosc_set_timestamp(&current);
+    itotal = blosc_elapsed_secs(last, current);
+    if (itotal < ttotal) ttotal = itotal;
+  }
+  report("Sum (decompress all, then sum):", ttotal, nbytes, sum);
+  free(data);
+
+  // Baseline: decompress chunk by chunk and sum it
+  int64_t* chunk = malloc(CHUNKSIZE * sizeof(int64_t));
+  ttotal = 1e10;
+  for (int n = 0; n < NITER; n++) {
+    blosc_set_timestamp(&last);
+    sum = 0;
+    for (int nchunk = 0; nchunk < nchunks; nchunk++) {
+      if (blosc2_schunk_decompress_chunk(schunk, nchunk, chunk, CHUNKSIZE * sizeof(int64_t)) < 0) {
+        printf("Error decompressing a chunk\n");
+        return 1;
+      }
+      sum += sum_items(chunk, CHUNKSIZE);
+    }
+    blosc_set_timestamp(&current);
+    itotal = blosc_elapsed_secs(last, current);
+    if (itotal < ttotal) ttotal = itotal;
+  }
+  report("Sum (decompress chunk, then sum):", ttotal, nbytes, sum);
+  free(chunk);
+
+  // Reductions fused with decompression
+  blosc2_zonemap_value result;
+  ttotal = 1e10;
+  for (int n = 0; n < NITER; n++) {
+    blosc_set_timestamp(&last);
+    if (blosc2_schunk_reduce(schunk, BLOSC2_REDUCE_SUM, BLOSC2_ZONEMAP_INT64, &result) < 0) {
+      printf("Error reducing the super-chunk\n");
+      return 1;
+    }
+    blosc_set_timestamp(&current);
+    itotal = blosc_elapsed_secs(last, current);
+    if (itotal < ttotal) ttotal = itotal;
+  }
+  report("Sum (blosc2_schunk_reduce):", ttotal, nbytes, result.i);
+  if (result.i != expected) {
+    printf("The sums do not match!\n");
+    return 1;
+  }
+
+  ttotal = 1e10;
+  for (int n = 0; n < NITER; n++) {
+    blosc_set_timestamp(&last);
+    if (blosc2_schunk_reduce(schunk, BLOSC2_REDUCE_MAX, BLOSC2_ZONEMAP_INT64, &result) < 0) {
+      printf("Error reducing the super-chunk\n");
+      return 1;
+    }
+    blosc_set_timestamp(&current);
+    itotal = blosc_elapsed_secs(last, current);
+    if (itotal < ttotal) ttotal = itotal;
+  }
+  report("Max (zone maps):", ttotal, nbytes, result.i);
+
+  blosc2_schunk_free(schunk);
+  blosc_destroy();
+
+  return 0;
+}
@@ -14,6 +14,7 @@
 #include <string.h>
 #include <sys/types.h>
 #include <assert.h>
+#include <math.h>
 
 #include "blosc2.h"
 #include "blosc-private.h"
@@ -28,7 +29,9 @@
 #include "delta.h"
 #include "trunc-prec.h"
 #include "blosclz.h"
+#include "ndlz.h"
 #include "btune.h"
+#include "xxhash64.h"
 
 #if defined(HAVE_LZ4)
   #include "lz4.h"
@@ -86,6 +89,8 @@
 /* Global context for non-contextual API */
 static blosc2_context* g_global_context;
 static pthread_mutex_t global_comp_mutex;
+/* For publishing the dicts shared by the chunks of super-chunks */
+static pthread_mutex_t dict_mutex;
 static int g_compressor = BLOSC_BLOSCLZ;
 static int g_delta = 0;
 /* the compressor to use by default */
@@ -215,6 +220,8 @@ static int compname_to_clibcode(const char* compname) {
     return BLOSC_ZLIB_LIB;
   if (strcmp(compname, BLOSC_ZSTD_COMPNAME) == 0)
     return BLOSC_ZSTD_LIB;
+  if (strcmp(compname, BLOSC_NDLZ_COMPNAME) == 0)
+    return BLOSC_NDLZ_LIB;
   return -1;
 }
 
@@ -226,6 +233,7 @@ static const char* clibcode_to_clibname(int clibcode) {
   if (clibcode == BLOSC_SNAPPY_LIB) return BLOSC_SNAPPY_LIBNAME;
   if (clibcode == BLOSC_ZLIB_LIB) return BLOSC_ZLIB_LIBNAME;
   if (clibcode == BLOSC_ZSTD_LIB) return BLOSC_ZSTD_LIBNAME;
+  if (clibcode == BLOSC_NDLZ_LIB) return BLOSC_NDLZ_LIBNAME;
   return NULL;                  /* should never happen */
 }
 
@@ -254,12 +262,16 @@ int blosc_compcode_to_compname(int compcode, const char** compname) {
     name = BLOSC_ZLIB_COMPNAME;
   else if (compcode == BLOSC_ZSTD)
     name = BLOSC_ZSTD_COMPNAME;
+  else if (compcode == BLOSC_NDLZ)
+    name = BLOSC_NDLZ_COMPNAME;
 
   *compname = name;
 
   /* Guess if there is support for this code */
   if (compcode == BLOSC_BLOSCLZ)
     code = BLOSC_BLOSCLZ;
+  else if (compcode == BLOSC_NDLZ)
+    code = BLOSC_NDLZ;
 #if defined(HAVE_LZ4)
   else if (compcode == BLOSC_LZ4)
     code = BLOSC_LZ4;
@@ -293,6 +305,9 @@ int blosc_compname_to_compcode(const char* compname) {
   if (strcmp(compname, BLOSC_BLOSCLZ_COMPNAME) == 0) {
     code = BLOSC_BLOSCLZ;
   }
+  else if (strcmp(compname, BLOSC_NDLZ_COMPNAME) == 0) {
+    code = BLOSC_NDLZ;
+  }
 #if defined(HAVE_LZ4)
   else if (strcmp(compname, BLOSC_LZ4_COMPNAME) == 0) {
     code = BLOSC_LZ4;
@@ -327,11 +342,25 @@ int blosc_compname_to_compcode(const char* compname) {
 
 
 #if defined(HAVE_LZ4)
-static int lz4_wrap_compress(const char* input, size_t input_length,
-                             char* output, size_t maxout, int accel, void* hash_table) {
+static int lz4_wrap_compress(struct thread_context* thread_context,
+                             const char* input, size_t input_length,
+                             char* output, size_t maxout, int accel) {
   BLOSC_UNUSED_PARAM(accel);
+  blosc2_context* context = thread_context->parent_context;
   int cbytes;
+
+  if (context->use_dict) {
+    assert(context->dict_cdict != NULL);
+    if (thread_context->lz4_cstream == NULL) {
+      thread_context->lz4_cstream = LZ4_createStream();
+    }
+    // Copying the stream with the loaded dict is much cheaper than loading the dict again
+    memcpy(thread_context->lz4_cstream, context->dict_cdict, sizeof(LZ4_stream_t));
+    return LZ4_compress_fast_continue(thread_context->lz4_cstream, input, output,
+                                      (int)input_length, (int)maxout, 1);
+  }
 #ifdef HAVE_IPP
+  void* hash_table = (void*)thread_context->lz4_hash_table;
   if (hash_table == NULL) {
     return -1;  // the hash table should always be initialized
   }
@@ -349,7 +378,6 @@ static int lz4_wrap_compress(const char* input, size_t input_length,
   }
   cbytes = outlen;
 #else
-  BLOSC_UNUSED_PARAM(hash_table);
   accel = 1;  // deactivate acceleration to match IPP behaviour
   cbytes = LZ4_compress_fast(input, output, (int)input_length, (int)maxout, accel);
 #endif
@@ -357,11 +385,23 @@ static int lz4_wrap_compress(const char* input, size_t input_length,
 }
 
 
-static int lz4hc_wrap_compress(const char* input, size_t input_length,
+static int lz4hc_wrap_compress(struct thread_context* thread_context,
+                               const char* input, size_t input_length,
                                char* output, size_t maxout, int clevel) {
+  blosc2_context* context = thread_context->parent_context;
   int cbytes;
   if (input_length > (size_t)(UINT32_C(2) << 30))
     return -1;   /* input larger than 2 GB is not supported */
+  if (context->use_dict) {
+    assert(context->dict_cdict != NULL);
+    if (thread_context->lz4hc_cstream == NULL) {
+      thread_context->lz4hc_cstream = LZ4_createStreamHC();
+    }
+    // The stream with the loaded dict carries the clevel too
+    memcpy(thread_context->lz4hc_cstream, context->dict_cdict, sizeof(LZ4_streamHC_t));
+    return LZ4_compress_HC_continue(thread_context->lz4hc_cstream, input, output,
+                                    (int)input_length, (int)maxout);
+  }
   /* clevel for lz4hc goes up to 12, at least in LZ4 1.7.5
    * but levels larger than 9 do not buy much compression. */
   cbytes = LZ4_compress_HC(input, output, (int)input_length, (int)maxout,
@@ -370,9 +410,17 @@ static int lz4hc_wrap_compress(const char* input, size_t input_length,
 }
 
 
-static int lz4_wrap_decompress(const char* input, size_t compressed_length,
+static int lz4_wrap_decompress(struct thread_context* thread_context,
+                               const char* input, size_t compressed_length,
                                char* output, size_t maxout) {
+  blosc2_context* context = thread_context->parent_context;
   int nbytes;
+  if (context->use_dict) {
+    assert(context->dict_buffer != NULL);
+    nbytes = LZ4_decompress_safe_usingDict(input, output, (int)compressed_length, (int)maxout,
+                                           context->dict_buffer, (int)context->dict_size);
+    return nbytes == (int)maxout ? nbytes : 0;
+  }
 #ifdef HAVE_IPP
   int outlen = (int)maxout;
   int inlen = (int)compressed_length;
@@ -598,6 +646,72 @@ int last_filter(const uint8_t* filters, char cmode) {
 }
 
 
+#define INT_ZONEMAP(type)                                \
+  {                                                      \
+    const type* items = (const type*)block;              \
+    int32_t nitems = bsize / (int32_t)sizeof(type);      \
+    int64_t min = INT64_MAX;                             \
+    int64_t max = INT64_MIN;                             \
+    for (int32_t i = 0; i < nitems; i++) {               \
+      if (items[i] < min) min = items[i];                \
+      if (items[i] > max) max = items[i];                \
+    }                                                    \
+    zonemap->min.i = min;                                \
+    zonemap->max.i = max;                                \
+    zonemap->nitems = nitems;                            \
+    zonemap->nnulls = 0;                                 \
+  }
+
+#define FLOAT_ZONEMAP(type)                              \
+  {                                                      \
+    const type* items = (const type*)block;              \
+    int32_t nitems = bsize / (int32_t)sizeof(type);      \
+    double min = INFINITY;                               \
+    double max = -INFINITY;                              \
+    int32_t nnulls = 0;                                  \
+    for (int32_t i = 0; i < nitems; i++) {               \
+      if (isnan(items[i])) {                             \
+        nnulls++;                                        \
+        continue;                                        \
+      }                                                  \
+      if (items[i] < min) min = items[i];                \
+      if (items[i] > max) max = items[i];                \
+    }                                                    \
+    zonemap->min.f = min;                                \
+    zonemap->max.f = max;                                \
+    zonemap->nitems = nitems;                            \
+    zonemap->nnulls = nnulls;                            \
+  }
+
+/* Compute the zone map of block `nblock` out of its (unfiltered) contents */
+static void block_zonemap(blosc2_context* context, const uint8_t* block, int32_t bsize,
+                          int32_t nblock) {
+  blosc2_zonemap* zonemap = &context->zonemaps[nblock];
+  switch (context->zonemap_type) {
+    case BLOSC2_ZONEMAP_INT8:
+      INT_ZONEMAP(int8_t);
+      break;
+    case BLOSC2_ZONEMAP_INT16:
+      INT_ZONEMAP(int16_t);
+      break;
+    case BLOSC2_ZONEMAP_INT32:
+      INT_ZONEMAP(int32_t);
+      break;
+    case BLOSC2_ZONEMAP_INT64:
+      INT_ZONEMAP(int64_t);
+      break;
+    case BLOSC2_ZONEMAP_FLOAT32:
+      FLOAT_ZONEMAP(float);
+      break;
+    case BLOSC2_ZONEMAP_FLOAT64:
+      FLOAT_ZONEMAP(double);
+      break;
+    default:
+      break;
+  }
+}
+
+
 uint8_t* pipeline_c(struct thread_context* thread_context, const int32_t bsize,
                     const uint8_t* src, const int32_t offset,
                     uint8_t* dest, uint8_t* tmp, uint8_t* tmp2) {
@@ -628,6 +742,10 @@ uint8_t* pipeline_c(struct thread_context* thread_context, const int32_t bsize,
       BLOSC_TRACE_ERROR("Execution of prefilter function failed");
       return NULL;
     }
+    if (context->zonemap_type != BLOSC2_ZONEMAP_NONE) {
+      // The zone map is about the output of the prefilter, which is what gets stored
+      block_zonemap(context, _dest, bsize, offset / context->blocksize);
+    }
 
     if (memcpyed) {
       // No more filters are required
@@ -726,6 +844,11 @@ static int blosc_c(struct thread_context* thread_context, int32_t bsize,
   int last_filter_index = last_filter(context->filters, 'c');
   bool memcpyed = context->header_flags & (uint8_t)BLOSC_MEMCPYED;
 
+  if (context->zonemap_type != BLOSC2_ZONEMAP_NONE && context->prefilter == NULL) {
+    // Compute it while the block is hot in cache
+    block_zonemap(context, src + offset, bsize, offset / context->blocksize);
+  }
+
   if (last_filter_index >= 0 || context->prefilter != NULL) {
     /* Apply the filter pipeline just for the prefilter */
     if (memcpyed && context->prefilter != NULL) {
@@ -802,19 +925,21 @@ static int blosc_c(struct thread_context* thread_context, int32_t bsize,
     }
     else if (context->compcode == BLOSC_BLOSCLZ) {
       cbytes = blosclz_compress(context->clevel, _src + j * neblock,
-                                (int)neblock, dest, (int)maxout);
+                                (int)neblock, dest, (int)maxout,
+                                context->use_dict ? context->dict_cdict : NULL);
+    }
+    else if (context->compcode == BLOSC_NDLZ) {
+      cbytes = ndlz_compress(context, _src + j * neblock, (int)neblock, dest, (int)maxout);
     }
   #if defined(HAVE_LZ4)
     else if (context->compcode == BLOSC_LZ4) {
-      void *hash_table = NULL;
-    #ifdef HAVE_IPP
-      hash_table = (void*)thread_context->lz4_hash_table;
-    #endif
-      cbytes = lz4_wrap_compress((char*)_src + j * neblock, (size_t)neblock,
-                                 (char*)dest, (size_t)maxout, accel, hash_table);
+      cbytes = lz4_wrap_compress(thread_context,
+                                 (char*)_src + j * neblock, (size_t)neblock,
+                                 (char*)dest, (size_t)maxout, accel);
     }
     else if (context->compcode == BLOSC_LZ4HC) {
-      cbytes = lz4hc_wrap_compress((char*)_src + j * neblock, (size_t)neblock,
+      cbytes = lz4hc_wrap_compress(thread_context,
+                                   (char*)_src + j * neblock, (size_t)neblock,
                                    (char*)dest, (size_t)maxout, context->clevel);
     }
   #endif /* HAVE_LZ4 */
@@ -967,6 +1092,86 @@ int pipeline_d(blosc2_context* context, const int32_t bsize, uint8_t* dest,
 }
 
 
+struct lazy_extent {
+  int32_t start;
+  int32_t stop;
+};
+
+
+static int compare_lazy_extents(const void* a, const void* b) {
+  int32_t start_a = ((const struct lazy_extent*)a)->start;
+  int32_t start_b = ((const struct lazy_extent*)b)->start;
+  return (start_a > start_b) - (start_a < start_b);
+}
+
+
+/* Read the compressed bytes of blocks [first, last] of the lazy chunk in `src` out of its frame,
+ * in their place in `src`.  Blocks that are contiguous on disk are read all at once. */
+static int read_lazy_blocks(blosc2_context* context, const uint8_t* src, int32_t srcsize,
+                            int32_t first, int32_t last) {
+  if (context->schunk == NULL || context->schunk->frame == NULL) {
+    BLOSC_TRACE_ERROR("Lazy chunk needs an associated frame.");
+    return -12;
+  }
+  int32_t nblocks = context->nblocks;
+  int32_t trailer_len = sizeof(int32_t) + sizeof(int64_t) + nblocks * sizeof(int32_t);
+  int32_t non_lazy_chunklen = srcsize - trailer_len;
+  if (first < 0 || last >= nblocks || non_lazy_chunklen < BLOSC_EXTENDED_HEADER_LENGTH) {
+    return -1;
+  }
+  // The offset of the actual chunk and the csizes of the blocks are in the trailer
+  int64_t chunk_offset = *(int64_t*)(src + non_lazy_chunklen + sizeof(int32_t));
+  int32_t *block_csizes = (int32_t *)(src + non_lazy_chunklen + sizeof(int32_t) + sizeof(int64_t));
+  bool memcpyed = src[BLOSC2_CHUNK_FLAGS] & (uint8_t)BLOSC_MEMCPYED;
+  int32_t* bstarts = (int32_t*)(src + BLOSC_EXTENDED_HEADER_LENGTH);
+
+  int32_t nextents = last - first + 1;
+  struct lazy_extent* extents = malloc(nextents * sizeof(struct lazy_extent));
+  for (int32_t j = first; j <= last; j++) {
+    struct lazy_extent* extent = &extents[j - first];
+    extent->start = memcpyed ? BLOSC_MAX_OVERHEAD + j * context->blocksize : sw32_(bstarts + j);
+    extent->stop = extent->start + block_csizes[j];
+    if (extent->stop > non_lazy_chunklen) {
+      // The csize of a memcpyed leftover block is the whole blocksize
+      extent->stop = non_lazy_chunklen;
+    }
+    if (extent->start < BLOSC_EXTENDED_HEADER_LENGTH || extent->start > extent->stop) {
+      free(extents);
+      return -1;
+    }
+  }
+  // Blocks can be stored out of order when compressed with several threads
+  qsort(extents, nextents, sizeof(struct lazy_extent), compare_lazy_extents);
+
+  FILE* fp = fopen(context->schunk->frame->fname, "rb");
+  if (fp == NULL) {
+    free(extents);
+    BLOSC_TRACE_ERROR("Cannot open the fileframe.");
+    return -13;
+  }
+  int rc = 0;
+  for (int32_t i = 0; i < nextents && rc == 0;) {
+    int32_t start = extents[i].start;
+    int32_t stop = extents[i].stop;
+    for (i++; i < nextents && extents[i].start <= stop; i++) {
+      if (extents[i].stop > stop) {
+        stop = extents[i].stop;
+      }
+    }
+    fseek(fp, chunk_offset + start, SEEK_SET);
+    size_t rbytes = fread((void*)(src + start), 1, (size_t)(stop - start), fp);
+    if (rbytes != (size_t)(stop - start)) {
+      BLOSC_TRACE_ERROR("Cannot read the (lazy) blocks out of the fileframe.");
+      rc = -13;
+    }
+  }
+  fclose(fp);
+  free(extents);
+
+  return rc;
+}
+
+
 /* Decompress & unshuffle a single block */
 static int blosc_d(
     struct thread_context* thread_context, int32_t bsize,
@@ -994,33 +1199,15 @@ static int blosc_d(
   }
 
   bool is_lazy = context->blosc2_flags & 0x08u;
-  if (is_lazy) {
+  if (is_lazy && !context->lazy_blocks_read) {
     // The chunk is on disk, so just lazily load the block
     if (context->schunk == NULL) {
       BLOSC_TRACE_ERROR("Lazy chunk needs an associated super-chunk.");
       return -11;
     }
-    if (context->schunk->frame == NULL) {
-      BLOSC_TRACE_ERROR("Lazy chunk needs an associated frame.");
-      return -12;
-    }
-    char *fname = context->schunk->frame->fname;
-    int32_t trailer_len = sizeof(int32_t) + sizeof(int64_t) + context->nblocks * sizeof(int32_t);
-    int32_t non_lazy_chunklen = srcsize - trailer_len;
-    // The offset of the actual chunk is in the trailer
-    int64_t chunk_offset = *(int64_t*)(src + non_lazy_chunklen + sizeof(int32_t));
-    // Get the csize of the nblock
-    int32_t *block_csizes = (int32_t *)(src + non_lazy_chunklen + sizeof(int32_t) + sizeof(int64_t));
-    int32_t block_csize = block_csizes[nblock];
-    // Read the lazy block on disk
-    FILE* fp = fopen(fname, "rb");
-    // The offset of the block is src_offset
-    fseek(fp, chunk_offset + src_offset, SEEK_SET);
-    size_t rbytes = fread((void*)(src + src_offset), 1, block_csize, fp);
-    fclose(fp);
-    if (rbytes != block_csize) {
-      BLOSC_TRACE_ERROR("Cannot read the (lazy) block out of the fileframe.");
-      return -13;
+    int rc = read_lazy_blocks(context, src, srcsize, nblock, nblock);
+    if (rc < 0) {
+      return rc;
     }
   }
 
@@ -1105,11 +1292,16 @@ static int blosc_d(
     }
     else {
       if (compformat == BLOSC_BLOSCLZ_FORMAT) {
-        nbytes = blosclz_decompress(src, cbytes, _dest, (int)neblock);
+        nbytes = blosclz_decompress(src, cbytes, _dest, (int)neblock,
+                                    context->use_dict ? context->dict_buffer : NULL,
+                                    (int)context->dict_size);
+      }
+      else if (compformat == BLOSC_NDLZ_FORMAT) {
+        nbytes = ndlz_decompress(src, cbytes, _dest, (int)neblock);
       }
   #if defined(HAVE_LZ4)
       else if (compformat == BLOSC_LZ4_FORMAT) {
-        nbytes = lz4_wrap_decompress((char*)src, (size_t)cbytes,
+        nbytes = lz4_wrap_decompress(thread_context, (char*)src, (size_t)cbytes,
                                      (char*)_dest, (size_t)neblock);
       }
   #endif /*  HAVE_LZ4 */
@@ -1171,6 +1363,195 @@ static int blosc_d(
 }
 
 
+/* If all the streams of a block are runs of the same byte, and the filters do not change that,
+ * return the byte.  Else, return -1. */
+static int get_block_run(blosc2_context* context, const uint8_t* src, int32_t srcsize,
+                         int32_t src_offset, int32_t nblock, int32_t leftoverblock) {
+  if ((context->header_flags & (uint8_t)BLOSC_MEMCPYED) ||
+      ((context->blosc2_flags & 0x08u) && !context->lazy_blocks_read)) {
+    // The block is not there (yet)
+    return -1;
+  }
+  if (context->block_maskout != NULL && context->block_maskout[nblock]) {
+    return -1;
+  }
+  for (int i = 0; i < BLOSC2_MAX_FILTERS; i++) {
+    uint8_t filter = context->filters[i];
+    if (filter != BLOSC_NOFILTER && filter != BLOSC_SHUFFLE && filter != BLOSC_TRUNC_PREC) {
+      return -1;
+    }
+  }
+  int dont_split = (context->header_flags & (uint8_t)0x10) >> 4u;
+  int nstreams = (!dont_split && !leftoverblock && !context->use_dict) ? context->typesize : 1;
+  if (src_offset <= 0 || src_offset > srcsize - nstreams * (int32_t)sizeof(int32_t)) {
+    return -1;
+  }
+  int run = -1;
+  for (int j = 0; j < nstreams; j++) {
+    // Runs are encoded as a negative length for the stream, with no data after it
+    int32_t cbytes = sw32_(src + src_offset + j * sizeof(int32_t));
+    if (cbytes > 0 || cbytes < -255 || (run >= 0 && run != -cbytes)) {
+      return -1;
+    }
+    run = -cbytes;
+  }
+  return run;
+}
+
+
+/* Get the bytes [start, stop) of the chunk in `src` that fall in block `nblock`, and put them
+ * in their place in `dest` (which receives the bytes of the chunk from `start` on).  Partial
+ * blocks are decompressed into a temporary, and runs are just set. */
+static int getitem_block(struct thread_context* thread_context, const uint8_t* src,
+                         int32_t srcsize, int32_t src_offset, int32_t nblock, int32_t bsize,
+                         int32_t leftoverblock, int32_t start, int32_t stop, uint8_t* dest) {
+  blosc2_context* context = thread_context->parent_context;
+  int32_t blocksize = context->blocksize;
+  int32_t startb = start - nblock * blocksize;
+  int32_t stopb = stop - nblock * blocksize;
+  if (startb < 0) {
+    startb = 0;
+  }
+  if (stopb > bsize) {
+    stopb = bsize;
+  }
+  if (startb >= stopb) {
+    // The block is out of the range
+    return 0;
+  }
+  uint8_t* bdest = dest + nblock * blocksize + startb - start;
+
+  int run = get_block_run(context, src, srcsize, src_offset, nblock, leftoverblock);
+  if (run >= 0) {
+    memset(bdest, run, (size_t)(stopb - startb));
+    return stopb - startb;
+  }
+  if (startb == 0 && stopb == bsize) {
+    // The whole block is needed, so it can go straight to its place
+    int cbytes = blosc_d(thread_context, bsize, leftoverblock, src, srcsize, src_offset, nblock,
+                         dest, nblock * blocksize - start, thread_context->tmp,
+                         thread_context->tmp2);
+    return cbytes < 0 ? cbytes : bsize;
+  }
+  int cbytes = blosc_d(thread_context, bsize, leftoverblock, src, srcsize, src_offset, nblock,
+                       thread_context->tmp3, 0, thread_context->tmp, thread_context->tmp2);
+  if (cbytes < 0) {
+    return cbytes;
+  }
+  memcpy(bdest, thread_context->tmp3 + startb, (size_t)(stopb - startb));
+  return stopb - startb;
+}
+
+
+/* Decompress a block out of the way and hand it over to the postfilter, which is in charge of
+ * writing it into its place in `dest` (if at all). */
+static int postfilter_block(struct thread_context* thread_context, int32_t bsize,
+                            int32_t leftoverblock, const uint8_t* src, int32_t srcsize,
+                            int32_t src_offset, int32_t nblock, uint8_t* dest) {
+  blosc2_context* context = thread_context->parent_context;
+  if (context->block_maskout != NULL && context->block_maskout[nblock]) {
+    return bsize;
+  }
+  // tmp3 is not used while decompressing whole chunks, and it is out of the temporaries below
+  int nbytes = blosc_d(thread_context, bsize, leftoverblock, src, srcsize, src_offset, nblock,
+                       thread_context->tmp3, 0, thread_context->tmp, thread_context->tmp2);
+  if (nbytes < 0) {
+    return nbytes;
+  }
+
+  // Create new postfilter parameters for this block (must be private for each thread)
+  blosc2_postfilter_params postparams;
+  memcpy(&postparams, context->postparams, sizeof(postparams));
+  postparams.in = thread_context->tmp3;
+  postparams.out = dest + nblock * context->blocksize;
+  postparams.size = nbytes;
+  postparams.typesize = context->typesize;
+  postparams.offset = nblock * context->blocksize;
+  postparams.nblock = nblock;
+  postparams.tid = thread_context->tid;
+  postparams.ttmp = thread_context->tmp;
+  postparams.ttmp_nbytes = (size_t)(thread_context->tmp3 - thread_context->tmp);
+  postparams.ctx = context;
+
+  if (context->postfilter(&postparams) != 0) {
+    BLOSC_TRACE_ERROR("Execution of postfilter function failed");
+    return -1;
+  }
+
+  return nbytes;
+}
+
+
+/* Get the place of byte `pos` of the chunk in a scattered destination, and the byte of the
+ * chunk where its piece ends. */
+static uint8_t* scattered_place(const struct scattered_dest* scattered, int32_t pos,
+                                int64_t* piece_stop) {
+  if (scattered->iov == NULL) {
+    // Strided pieces of the same size
+    int32_t npiece = pos / scattered->size;
+    *piece_stop = (int64_t)(npiece + 1) * scattered->size;
+    return scattered->base + npiece * scattered->stride + pos % scattered->size;
+  }
+  // The last piece that starts at or before pos (which skips empty pieces)
+  int lo = 0;
+  int hi = scattered->niov - 1;
+  while (lo < hi) {
+    int mid = (lo + hi + 1) / 2;
+    if (scattered->starts[mid] <= pos) {
+      lo = mid;
+    }
+    else {
+      hi = mid - 1;
+    }
+  }
+  *piece_stop = scattered->starts[lo + 1];
+  return (uint8_t*)scattered->iov[lo].base + (pos - scattered->starts[lo]);
+}
+
+
+/* Copy the bytes [start, start + nbytes) of the chunk out of `src` into a scattered
+ * destination. */
+static void scattered_copy(const struct scattered_dest* scattered, int32_t start,
+                           const uint8_t* src, int32_t nbytes) {
+  int32_t pos = start;
+  int32_t stop = start + nbytes;
+  while (pos < stop) {
+    int64_t piece_stop;
+    uint8_t* place = scattered_place(scattered, pos, &piece_stop);
+    int32_t end = piece_stop < stop ? (int32_t)piece_stop : stop;
+    memcpy(place, src + pos - start, (size_t)(end - pos));
+    pos = end;
+  }
+}
+
+
+/* Decompress a block into its place in a scattered destination.  Blocks that fall in a single
+ * piece are decompressed straight there, and the rest go through a temporary. */
+static int scattered_block(struct thread_context* thread_context, int32_t bsize,
+                           int32_t leftoverblock, const uint8_t* src, int32_t srcsize,
+                           int32_t src_offset, int32_t nblock) {
+  blosc2_context* context = thread_context->parent_context;
+  if (context->block_maskout != NULL && context->block_maskout[nblock]) {
+    return bsize;
+  }
+  int32_t start = nblock * context->blocksize;
+  int64_t piece_stop;
+  uint8_t* place = scattered_place(context->scattered, start, &piece_stop);
+  if (start + bsize <= piece_stop) {
+    return blosc_d(thread_context, bsize, leftoverblock, src, srcsize, src_offset, nblock,
+                   place, 0, thread_context->tmp, thread_context->tmp2);
+  }
+  // tmp3 is not used while decompressing whole chunks, and it is out of the temporaries below
+  int nbytes = blosc_d(thread_context, bsize, leftoverblock, src, srcsize, src_offset, nblock,
+                       thread_context->tmp3, 0, thread_context->tmp, thread_context->tmp2);
+  if (nbytes < 0) {
+    return nbytes;
+  }
+  scattered_copy(context->scattered, start, thread_context->tmp3, nbytes);
+  return nbytes;
+}
+
+
 /* Serial version for compression/decompression */
 static int serial_blosc(struct thread_context* thread_context) {
   blosc2_context* context = thread_context->parent_context;
@@ -1199,6 +1580,9 @@ static int serial_blosc(struct thread_context* thread_context) {
         memcpy(context->dest + BLOSC_MAX_OVERHEAD + j * context->blocksize,
                  context->src + j * context->blocksize,
                  (unsigned int)bsize);
+        if (context->zonemap_type != BLOSC2_ZONEMAP_NONE) {
+          block_zonemap(context, context->src + j * context->blocksize, bsize, j);
+        }
         cbytes = (int32_t)bsize;
       }
       else {
@@ -1216,9 +1600,19 @@ static int serial_blosc(struct thread_context* thread_context) {
       /* Regular decompression */
       // If memcpyed we don't have a bstarts section (because it is not needed)
       int32_t src_offset = memcpyed ? BLOSC_MAX_OVERHEAD + j * context->blocksize : sw32_(bstarts + j);
-      cbytes = blosc_d(thread_context, bsize, leftoverblock,
-                       context->src, context->srcsize, src_offset, j,
-                       context->dest, j * context->blocksize, tmp, tmp2);
+      if (context->scattered != NULL) {
+        cbytes = scattered_block(thread_context, bsize, leftoverblock, context->src,
+                                 context->srcsize, src_offset, j);
+      }
+      else if (context->postfilter != NULL) {
+        cbytes = postfilter_block(thread_context, bsize, leftoverblock, context->src,
+                                  context->srcsize, src_offset, j, context->dest);
+      }
+      else {
+        cbytes = blosc_d(thread_context, bsize, leftoverblock,
+                         context->src, context->srcsize, src_offset, j,
+                         context->dest, j * context->blocksize, tmp, tmp2);
+      }
     }
 
     if (cbytes < 0) {
@@ -1241,6 +1635,10 @@ static int parallel_blosc(blosc2_context* context) {
   /* Set sentinels */
   context->thread_giveup_code = 1;
   context->thread_nblock = -1;
+  if (context->getitem_stop > 0) {
+    // Blocks before the range for getitem are not needed
+    context->thread_nblock = context->getitem_start / context->blocksize - 1;
+  }
 
   if (threads_callback) {
     threads_callback(threads_callback_data, t_blosc_do_job,
@@ -1278,6 +1676,10 @@ static void init_thread_context(struct thread_context* thread_context, blosc2_co
   thread_context->tmp3 = thread_context->tmp + context->blocksize + ebsize;
   thread_context->tmp4 = thread_context->tmp + 2 * context->blocksize + ebsize;
   thread_context->tmp_blocksize = context->blocksize;
+  #if defined(HAVE_LZ4)
+  thread_context->lz4_cstream = NULL;
+  thread_context->lz4hc_cstream = NULL;
+  #endif
   #if defined(HAVE_ZSTD)
   thread_context->zstd_cctx = NULL;
   thread_context->zstd_dctx = NULL;
@@ -1312,6 +1714,14 @@ create_thread_context(blosc2_context* context, int32_t tid) {
 /* free members of thread_context, but not thread_context itself */
 static void destroy_thread_context(struct thread_context* thread_context) {
   my_free(thread_context->tmp);
+#if defined(HAVE_LZ4)
+  if (thread_context->lz4_cstream != NULL) {
+    LZ4_freeStream(thread_context->lz4_cstream);
+  }
+  if (thread_context->lz4hc_cstream != NULL) {
+    LZ4_freeStreamHC(thread_context->lz4hc_cstream);
+  }
+#endif
 #if defined(HAVE_ZSTD)
   if (thread_context->zstd_cctx != NULL) {
     ZSTD_freeCCtx(thread_context->zstd_cctx);
@@ -1511,6 +1921,18 @@ static int initialize_context_compression(
   context->nblocks = (context->leftover > 0) ?
                      (context->nblocks + 1) : context->nblocks;
 
+  if (context->zonemap_type != BLOSC2_ZONEMAP_NONE) {
+    if (context->nblocks > context->zonemaps_len) {
+      free(context->zonemaps);
+      context->zonemaps = malloc(context->nblocks * sizeof(blosc2_zonemap));
+      context->zonemaps_len = context->nblocks;
+    }
+    // The blocks that do not go through the workers (if any) remain unknown
+    for (int32_t i = 0; i < context->nblocks; i++) {
+      context->zonemaps[i].nitems = -1;
+    }
+  }
+
   return 1;
 }
 
@@ -1536,6 +1958,82 @@ static uint8_t get_filter_flags(const uint8_t header_flags,
 }
 
 
+static void free_ddict(blosc2_context* context) {
+  if (context->dict_ddict != NULL) {
+#if defined(HAVE_ZSTD)
+    ZSTD_freeDDict(context->dict_ddict);
+#endif   // HAVE_ZSTD
+    context->dict_ddict = NULL;
+  }
+  context->dict_id = 0;
+}
+
+
+/* Set up the dict (if any) for decompressing the chunk in context->src, which comes right
+ * after its bstarts.  Return the number of bytes that the dict takes in the chunk (0 if there
+ * is none), or a negative value if the chunk is malformed. */
+static int32_t read_chunk_dict(blosc2_context* context, int32_t bstarts_end, int32_t srcsize) {
+  bool memcpyed = context->header_flags & (uint8_t)BLOSC_MEMCPYED;
+  // Memcpyed chunks do not have bstarts, so they cannot have a dict either
+  context->use_dict = (context->blosc2_flags & BLOSC2_USEDICT) != 0 && !memcpyed;
+  if (!context->use_dict) {
+    return 0;
+  }
+  if (srcsize < (int32_t)sizeof(int32_t)) {
+    /* Not enough input to size (or ID) of dictionary */
+    return -1;
+  }
+  // Only ZSTD needs a digested form for decompressing; LZ4 and BloscLZ use the dict as-is
+  int32_t compformat = (context->header_flags & (uint8_t)0xe0) >> 5u;
+
+  if (context->blosc2_flags & BLOSC2_SHAREDDICT) {
+    // The chunk only has the ID of the dict of its super-chunk
+    uint32_t dict_id = (uint32_t)sw32_(context->src + bstarts_end);
+    blosc2_schunk* schunk = context->schunk;
+    if (schunk == NULL || schunk->dict == NULL || schunk->dict_id != dict_id) {
+      BLOSC_TRACE_ERROR("The chunk needs the dict of its super-chunk (ID %u), which is "
+                        "not available.", dict_id);
+      return -1;
+    }
+    if (context->dict_id != dict_id ||
+        (compformat == BLOSC_ZSTD_FORMAT && context->dict_ddict == NULL)) {
+      // The digested dict is kept for the next chunks of the super-chunk
+      free_ddict(context);
+      if (compformat == BLOSC_ZSTD_FORMAT) {
+#if defined(HAVE_ZSTD)
+        context->dict_ddict = ZSTD_createDDict(schunk->dict, (size_t)schunk->dict_size);
+#endif   // HAVE_ZSTD
+      }
+      context->dict_id = dict_id;
+    }
+    context->dict_buffer = schunk->dict;
+    context->dict_size = (size_t)schunk->dict_size;
+    return (int32_t)sizeof(int32_t);
+  }
+
+  // Free the existing dictionary (probably from another chunk)
+  free_ddict(context);
+  // The trained dictionary is after the bstarts block
+  srcsize -= sizeof(int32_t);
+  context->dict_size = (size_t)sw32_(context->src + bstarts_end);
+  if (context->dict_size <= 0 || context->dict_size > BLOSC2_MAXDICTSIZE) {
+    /* Dictionary size is smaller than minimum or larger than maximum allowed */
+    return -1;
+  }
+  if (srcsize < (int32_t)context->dict_size) {
+    /* Not enough input to read entire dictionary */
+    return -1;
+  }
+  context->dict_buffer = (void*)(context->src + bstarts_end + sizeof(int32_t));
+  if (compformat == BLOSC_ZSTD_FORMAT) {
+#if defined(HAVE_ZSTD)
+    context->dict_ddict = ZSTD_createDDict(context->dict_buffer, context->dict_size);
+#endif   // HAVE_ZSTD
+  }
+  return (int32_t)(sizeof(int32_t) + context->dict_size);
+}
+
+
 static int initialize_context_decompression(blosc2_context* context, const void* src, int32_t srcsize,
                                             void* dest, int32_t destsize) {
   int32_t cbytes;
@@ -1610,9 +2108,16 @@ static int initialize_context_decompression(blosc2_context* context, const void*
     context->filter_flags = get_filter_flags(context->header_flags,
                                              context->typesize);
     flags_to_filters(context->header_flags, context->filters);
+    context->blosc2_flags = 0;
     bstarts_offset = BLOSC_MIN_HEADER_LENGTH;
   }
 
+  if (context->postfilter != NULL && (context->filter_flags & BLOSC_DODELTA)) {
+    // The delta of every block refers to the first one in dest, which is not there
+    BLOSC_TRACE_ERROR("The postfilter cannot be used with the delta filter.");
+    return -1;
+  }
+
   context->bstarts = (int32_t*)(context->src + bstarts_offset);
   bstarts_end = bstarts_offset + (context->nblocks * sizeof(int32_t));
   if (srcsize < bstarts_end) {
@@ -1622,112 +2127,109 @@ static int initialize_context_decompression(blosc2_context* context, const void*
   srcsize -= bstarts_end;
 
   /* Read optional dictionary if flag set */
-  if (context->blosc2_flags & BLOSC2_USEDICT) {
-#if defined(HAVE_ZSTD)
-    context->use_dict = 1;
-    if (context->dict_ddict != NULL) {
-      // Free the existing dictionary (probably from another chunk)
-      ZSTD_freeDDict(context->dict_ddict);
-    }
-    // The trained dictionary is after the bstarts block
-    if (srcsize < sizeof(int32_t)) {
-      /* Not enough input to size of dictionary */
-      return -1;
-    }
-    srcsize -= sizeof(int32_t);
-    context->dict_size = (size_t)sw32_(context->src + bstarts_end);
-    if (context->dict_size <= 0 || context->dict_size > BLOSC2_MAXDICTSIZE) {
-      /* Dictionary size is smaller than minimum or larger than maximum allowed */
-      return -1;
-    }
-    if (srcsize < (int32_t)context->dict_size) {
-      /* Not enough input to read entire dictionary */
-      return -1;
-    }
-    srcsize -= context->dict_size;
-    context->dict_buffer = (void*)(context->src + bstarts_end + sizeof(int32_t));
-    context->dict_ddict = ZSTD_createDDict(context->dict_buffer, context->dict_size);
-#endif   // HAVE_ZSTD
+  int32_t dict_len = read_chunk_dict(context, bstarts_end, srcsize);
+  if (dict_len < 0) {
+    return dict_len;
   }
 
-
   return 0;
 }
 
 
-static int write_compression_header(blosc2_context* context,
-                                    bool extended_header) {
-  int32_t compformat;
-  int dont_split;
-  int dict_training = context->use_dict && (context->dict_cdict == NULL);
-
-  // Set the whole header to zeros so that the reserved values are zeroed
-  if (extended_header) {
-    memset(context->dest, 0, BLOSC_EXTENDED_HEADER_LENGTH);
-  }
-  else {
-    memset(context->dest, 0, BLOSC_MIN_HEADER_LENGTH);
-  }
-
-  /* Write version header for this block */
-  context->dest[BLOSC2_CHUNK_VERSION] = BLOSC_VERSION_FORMAT;
-
-  /* Write compressor format */
-  compformat = -1;
-  switch (context->compcode) {
+/* Get the format of a codec in the chunk header (and the version of the format in `version`).
+ * Return -1 if Blosc has not been compiled with support for the codec. */
+int compcode_to_compformat(int compcode, uint8_t* version) {
+  switch (compcode) {
     case BLOSC_BLOSCLZ:
-      compformat = BLOSC_BLOSCLZ_FORMAT;
-      context->dest[BLOSC2_CHUNK_VERSIONLZ] = BLOSC_BLOSCLZ_VERSION_FORMAT;
-      break;
+      *version = BLOSC_BLOSCLZ_VERSION_FORMAT;
+      return BLOSC_BLOSCLZ_FORMAT;
+
+    case BLOSC_NDLZ:
+      *version = BLOSC_NDLZ_VERSION_FORMAT;
+      return BLOSC_NDLZ_FORMAT;
 
 #if defined(HAVE_LZ4)
     case BLOSC_LZ4:
-      compformat = BLOSC_LZ4_FORMAT;
-      context->dest[BLOSC2_CHUNK_VERSIONLZ] = BLOSC_LZ4_VERSION_FORMAT;
-      break;
+      *version = BLOSC_LZ4_VERSION_FORMAT;
+      return BLOSC_LZ4_FORMAT;
     case BLOSC_LZ4HC:
-      compformat = BLOSC_LZ4HC_FORMAT;
-      context->dest[BLOSC2_CHUNK_VERSIONLZ] = BLOSC_LZ4HC_VERSION_FORMAT;
-      break;
+      *version = BLOSC_LZ4HC_VERSION_FORMAT;
+      return BLOSC_LZ4HC_FORMAT;
 #endif /*  HAVE_LZ4 */
 
 #if defined(HAVE_LIZARD)
     case BLOSC_LIZARD:
-      compformat = BLOSC_LIZARD_FORMAT;
-      context->dest[BLOSC2_CHUNK_VERSIONLZ] = BLOSC_LIZARD_VERSION_FORMAT;
-      break;
+      *version = BLOSC_LIZARD_VERSION_FORMAT;
+      return BLOSC_LIZARD_FORMAT;
 #endif /*  HAVE_LIZARD */
 
 #if defined(HAVE_SNAPPY)
     case BLOSC_SNAPPY:
-      compformat = BLOSC_SNAPPY_FORMAT;
-      context->dest[BLOSC2_CHUNK_VERSIONLZ] = BLOSC_SNAPPY_VERSION_FORMAT;
-      break;
+      *version = BLOSC_SNAPPY_VERSION_FORMAT;
+      return BLOSC_SNAPPY_FORMAT;
 #endif /*  HAVE_SNAPPY */
 
 #if defined(HAVE_ZLIB)
     case BLOSC_ZLIB:
-      compformat = BLOSC_ZLIB_FORMAT;
-      context->dest[BLOSC2_CHUNK_VERSIONLZ] = BLOSC_ZLIB_VERSION_FORMAT;
-      break;
+      *version = BLOSC_ZLIB_VERSION_FORMAT;
+      return BLOSC_ZLIB_FORMAT;
 #endif /*  HAVE_ZLIB */
 
 #if defined(HAVE_ZSTD)
     case BLOSC_ZSTD:
-      compformat = BLOSC_ZSTD_FORMAT;
-      context->dest[BLOSC2_CHUNK_VERSIONLZ] = BLOSC_ZSTD_VERSION_FORMAT;
-      break;
+      *version = BLOSC_ZSTD_VERSION_FORMAT;
+      return BLOSC_ZSTD_FORMAT;
 #endif /*  HAVE_ZSTD */
 
-    default: {
-      const char* compname;
-      compname = clibcode_to_clibname(compformat);
-      BLOSC_TRACE_ERROR("Blosc has not been compiled with '%s' "
-                        "compression support.  Please use one having it.",
-                        compname);
-      return -5;    /* signals no compression support */
-      break;
-    }
+    default:
+      return -1;
+  }
+}
+
+
+/* Get the blocksize and whether the blocks are split for a chunk that `context` would compress
+ * out of `nbytes`, just as blosc2_compress_ctx() decides them (the context is not modified). */
+void compression_layout(const blosc2_context* context, int32_t nbytes, int32_t* blocksize,
+                        bool* split) {
+  blosc2_context layout = *context;
+  layout.sourcesize = nbytes;
+  layout.filter_flags = filters_to_flags(layout.filters);
+  layout.blocksize = layout.user_blocksize;
+  btune_next_blocksize(&layout);
+  if (layout.typesize > BLOSC_MAX_TYPESIZE) {
+    layout.typesize = 1;
+  }
+  *blocksize = layout.blocksize;
+  *split = split_block(&layout, layout.typesize, layout.blocksize, true);
+}
+
+
+static int write_compression_header(blosc2_context* context,
+                                    bool extended_header) {
+  int32_t compformat;
+  int dont_split;
+  int dict_training = context->use_dict && (context->dict_cdict == NULL);
+
+  // Set the whole header to zeros so that the reserved values are zeroed
+  if (extended_header) {
+    memset(context->dest, 0, BLOSC_EXTENDED_HEADER_LENGTH);
+  }
+  else {
+    memset(context->dest, 0, BLOSC_MIN_HEADER_LENGTH);
+  }
+
+  /* Write version header for this block */
+  context->dest[BLOSC2_CHUNK_VERSION] = BLOSC_VERSION_FORMAT;
+
+  /* Write compressor format */
+  compformat = compcode_to_compformat(context->compcode, &context->dest[BLOSC2_CHUNK_VERSIONLZ]);
+  if (compformat < 0) {
+    const char* compname;
+    compname = clibcode_to_clibname(compformat);
+    BLOSC_TRACE_ERROR("Blosc has not been compiled with '%s' "
+                      "compression support.  Please use one having it.",
+                      compname);
+    return -5;    /* signals no compression support */
   }
 
   if (context->clevel == 0) {
@@ -1765,9 +2267,17 @@ static int write_compression_header(blosc2_context* context,
       context->bstarts = (int32_t*)(context->dest + BLOSC_EXTENDED_HEADER_LENGTH);
       context->output_bytes = BLOSC_EXTENDED_HEADER_LENGTH +
                               sizeof(int32_t) * context->nblocks;
+      if (context->use_dict == BLOSC2_DICT_SCHUNK) {
+        // The dict is in the super-chunk, so only its ID goes after the bstarts
+        _sw32(context->dest + context->output_bytes, (int32_t)context->dict_id);
+        context->output_bytes += sizeof(int32_t);
+      }
     }
     if (context->use_dict) {
       *blosc2_flags |= BLOSC2_USEDICT;
+      if (context->use_dict == BLOSC2_DICT_SCHUNK) {
+        *blosc2_flags |= BLOSC2_SHAREDDICT;
+      }
     }
   } else {
     // Regular header
@@ -1867,6 +2377,169 @@ int blosc_compress_context(blosc2_context* context) {
 }
 
 
+/* Build a dict out of the samples (the filtered blocks of a chunk).  Return its size. */
+static int32_t train_dict(blosc2_context* context, const uint8_t* samples, void* dict_buffer,
+                          int32_t dict_maxsize) {
+#ifdef HAVE_ZSTD
+  // ZDICT dicts are good for LZ4 and BloscLZ too, because their content is at the end
+  unsigned nblocks = 8;  // the minimum that accepts zstd as of 1.4.0
+  unsigned sample_fraction = 1;  // 1 allows to use most of the chunk for training
+  size_t sample_size = context->sourcesize / nblocks / sample_fraction;
+
+  // Populate the samples sizes for training the dictionary
+  size_t* samples_sizes = malloc(nblocks * sizeof(size_t));
+  for (size_t i = 0; i < nblocks; i++) {
+    samples_sizes[i] = sample_size;
+  }
+
+  // Train from samples
+  size_t dict_actual_size = ZDICT_trainFromBuffer(dict_buffer, dict_maxsize, samples, samples_sizes, nblocks);
+  free(samples_sizes);
+
+  // TODO: experiment with parameters of low-level fast cover algorithm
+  // Note that this API is still unstable.  See: https://github.com/facebook/zstd/issues/1599
+  // ZDICT_fastCover_params_t fast_cover_params;
+  // memset(&fast_cover_params, 0, sizeof(fast_cover_params));
+  // fast_cover_params.d = nblocks;
+  // fast_cover_params.steps = 4;
+  // fast_cover_params.zParams.compressionLevel = context->clevel;
+  //size_t dict_actual_size = ZDICT_optimizeTrainFromBuffer_fastCover(dict_buffer, dict_maxsize, samples_buffer, samples_sizes, nblocks, &fast_cover_params);
+
+  if (ZDICT_isError(dict_actual_size) != ZSTD_error_no_error) {
+    BLOSC_TRACE_ERROR("Error in ZDICT_trainFromBuffer(): '%s'."
+                      "  Giving up.", ZDICT_getErrorName(dict_actual_size));
+    return -20;
+  }
+  assert(dict_actual_size > 0);
+  return (int32_t)dict_actual_size;
+#else
+  // Without a trainer, the dict is made of evenly spaced pieces of the chunk
+  int32_t npieces = 8;
+  int32_t piece_size = dict_maxsize / npieces;
+  if (piece_size <= 0) {
+    BLOSC_TRACE_ERROR("The chunk is too small for building a dict.  Giving up.");
+    return -20;
+  }
+  for (int32_t i = 0; i < npieces; i++) {
+    int64_t start = (int64_t)context->sourcesize * i / npieces;
+    memcpy((uint8_t*)dict_buffer + i * piece_size, samples + start, (size_t)piece_size);
+  }
+  return piece_size * npieces;
+#endif  // HAVE_ZSTD
+}
+
+
+/* Digest context->dict_buffer for compressing with the codec of the context */
+static int create_cdict(blosc2_context* context) {
+  switch (context->compcode) {
+    case BLOSC_BLOSCLZ:
+      context->dict_cdict = blosclz_create_cdict(context->clevel, context->dict_buffer,
+                                                 (int)context->dict_size);
+      break;
+#if defined(HAVE_LZ4)
+    case BLOSC_LZ4: {
+      LZ4_stream_t* stream = LZ4_createStream();
+      LZ4_loadDict(stream, context->dict_buffer, (int)context->dict_size);
+      context->dict_cdict = stream;
+      break;
+    }
+    case BLOSC_LZ4HC: {
+      LZ4_streamHC_t* stream = LZ4_createStreamHC();
+      LZ4_resetStreamHC_fast(stream, context->clevel);
+      LZ4_loadDictHC(stream, context->dict_buffer, (int)context->dict_size);
+      context->dict_cdict = stream;
+      break;
+    }
+#endif /* HAVE_LZ4 */
+#if defined(HAVE_ZSTD)
+    case BLOSC_ZSTD:
+      context->dict_cdict = ZSTD_createCDict(context->dict_buffer, context->dict_size, 1);  // TODO: use get_accel()
+      break;
+#endif /* HAVE_ZSTD */
+    default:
+      break;
+  }
+  if (context->dict_cdict == NULL) {
+    BLOSC_TRACE_ERROR("Cannot digest the dict for compressing.");
+    return -1;
+  }
+  return 0;
+}
+
+
+static void free_cdict(blosc2_context* context) {
+  if (context->dict_cdict == NULL) {
+    return;
+  }
+  switch (context->compcode) {
+    case BLOSC_BLOSCLZ:
+      blosclz_free_cdict(context->dict_cdict);
+      break;
+#if defined(HAVE_LZ4)
+    case BLOSC_LZ4:
+      LZ4_freeStream(context->dict_cdict);
+      break;
+    case BLOSC_LZ4HC:
+      LZ4_freeStreamHC(context->dict_cdict);
+      break;
+#endif /* HAVE_LZ4 */
+#if defined(HAVE_ZSTD)
+    case BLOSC_ZSTD:
+      ZSTD_freeCDict(context->dict_cdict);
+      break;
+#endif /* HAVE_ZSTD */
+    default:
+      break;
+  }
+  context->dict_cdict = NULL;
+  context->dict_id = 0;
+}
+
+
+/* Make a dict the one shared by the chunks of a super-chunk, unless another context (maybe in
+ * another thread) has already done it. */
+void publish_schunk_dict(blosc2_schunk* schunk, const void* dict, int32_t dict_size) {
+  pthread_mutex_lock(&dict_mutex);
+  if (schunk->dict == NULL) {
+    schunk->dict = malloc((size_t)dict_size);
+    memcpy(schunk->dict, dict, (size_t)dict_size);
+    schunk->dict_size = dict_size;
+    // A digest as the ID ensures that chunks are never decompressed with another dict
+    uint32_t dict_id = (uint32_t)xxh64(dict, (size_t)dict_size, 0);
+    schunk->dict_id = (dict_id != 0) ? dict_id : 1;
+  }
+  pthread_mutex_unlock(&dict_mutex);
+}
+
+
+/* Digest the dict shared by the chunks of the super-chunk of the context for compressing, unless
+ * it is digested already.  Return 1 if success, 0 if the super-chunk has no dict yet and a
+ * negative value on errors. */
+static int load_schunk_dict(blosc2_context* context) {
+  blosc2_schunk* schunk = context->schunk;
+  pthread_mutex_lock(&dict_mutex);
+  uint8_t* dict = schunk->dict;
+  int32_t dict_size = schunk->dict_size;
+  uint32_t dict_id = schunk->dict_id;
+  pthread_mutex_unlock(&dict_mutex);
+  if (dict == NULL) {
+    return 0;
+  }
+  if (context->dict_cdict != NULL && context->dict_id == dict_id) {
+    return 1;
+  }
+  free_cdict(context);
+  context->dict_buffer = dict;
+  context->dict_size = (size_t)dict_size;
+  if (create_cdict(context) < 0) {
+    context->dict_buffer = NULL;
+    return -1;
+  }
+  context->dict_id = dict_id;
+  return 1;
+}
+
+
 /* The public secure routine for compression with context. */
 int blosc2_compress_ctx(blosc2_context* context, const void* src, int32_t srcsize,
                         void* dest, int32_t destsize) {
@@ -1877,10 +2550,22 @@ int blosc2_compress_ctx(blosc2_context* context, const void* src, int32_t srcsiz
     return -10;
   }
 
+  if (context->use_dict == BLOSC2_DICT_SCHUNK) {
+    if (context->schunk == NULL) {
+      BLOSC_TRACE_ERROR("Dicts shared by the chunks of a super-chunk need a super-chunk."
+                        "  Giving up.");
+      return -20;
+    }
+    // Once the super-chunk has a dict, chunks are compressed with it straight away
+    if (load_schunk_dict(context) < 0) {
+      return -20;
+    }
+  }
+
   error = initialize_context_compression(
     context, src, srcsize, dest, destsize,
     context->clevel, context->filters, context->filters_meta,
-    context->typesize, context->compcode, context->blocksize,
+    context->typesize, context->compcode, context->user_blocksize,
     context->new_nthreads, context->nthreads, context->schunk);
   if (error <= 0) {
     return error;
@@ -1897,9 +2582,12 @@ int blosc2_compress_ctx(blosc2_context* context, const void* src, int32_t srcsiz
     return cbytes;
   }
 
-  if (context->use_dict && context->dict_cdict == NULL) {
+  // Memcpyed chunks (e.g. too small ones) do not need a dict
+  bool memcpyed = context->dest[BLOSC2_CHUNK_FLAGS] & (uint8_t)BLOSC_MEMCPYED;
+  if (context->use_dict && context->dict_cdict == NULL && !memcpyed) {
 
-    if (context->compcode != BLOSC_ZSTD) {
+    if (context->compcode != BLOSC_ZSTD && context->compcode != BLOSC_BLOSCLZ &&
+        context->compcode != BLOSC_LZ4 && context->compcode != BLOSC_LZ4HC) {
       const char* compname;
       compname = clibcode_to_clibname(context->compcode);
       BLOSC_TRACE_ERROR("Codec %s does not support dicts.  Giving up.",
@@ -1907,68 +2595,62 @@ int blosc2_compress_ctx(blosc2_context* context, const void* src, int32_t srcsiz
       return -20;
     }
 
-#ifdef HAVE_ZSTD
     // Build the dictionary out of the filters outcome and compress with it
     int32_t dict_maxsize = BLOSC2_MAXDICTSIZE;
+    if (context->compcode != BLOSC_ZSTD) {
+      // LZ4 and BloscLZ matches cannot reach further than 64 KB
+      dict_maxsize = BLOSCLZ_MAX_DICT_SIZE;
+    }
     // Do not make the dict more than 5% larger than uncompressed buffer
     if (dict_maxsize > srcsize / 20) {
       dict_maxsize = srcsize / 20;
     }
-    void* samples_buffer = context->dest + BLOSC_EXTENDED_HEADER_LENGTH;
-    unsigned nblocks = 8;  // the minimum that accepts zstd as of 1.4.0
-    unsigned sample_fraction = 1;  // 1 allows to use most of the chunk for training
-    size_t sample_size = context->sourcesize / nblocks / sample_fraction;
-
-    // Populate the samples sizes for training the dictionary
-    size_t* samples_sizes = malloc(nblocks * sizeof(void*));
-    for (size_t i = 0; i < nblocks; i++) {
-      samples_sizes[i] = sample_size;
-    }
-
-    // Train from samples
+    uint8_t* samples_buffer = context->dest + BLOSC_EXTENDED_HEADER_LENGTH;
     void* dict_buffer = malloc(dict_maxsize);
-    size_t dict_actual_size = ZDICT_trainFromBuffer(dict_buffer, dict_maxsize, samples_buffer, samples_sizes, nblocks);
-
-    // TODO: experiment with parameters of low-level fast cover algorithm
-    // Note that this API is still unstable.  See: https://github.com/facebook/zstd/issues/1599
-    // ZDICT_fastCover_params_t fast_cover_params;
-    // memset(&fast_cover_params, 0, sizeof(fast_cover_params));
-    // fast_cover_params.d = nblocks;
-    // fast_cover_params.steps = 4;
-    // fast_cover_params.zParams.compressionLevel = context->clevel;
-    //size_t dict_actual_size = ZDICT_optimizeTrainFromBuffer_fastCover(dict_buffer, dict_maxsize, samples_buffer, samples_sizes, nblocks, &fast_cover_params);
-
-    if (ZDICT_isError(dict_actual_size) != ZSTD_error_no_error) {
-      BLOSC_TRACE_ERROR("Error in ZDICT_trainFromBuffer(): '%s'."
-                        "  Giving up.", ZDICT_getErrorName(dict_actual_size));
+    int32_t dict_actual_size = train_dict(context, samples_buffer, dict_buffer, dict_maxsize);
+    if (dict_actual_size <= 0) {
+      free(dict_buffer);
       return -20;
     }
-    assert(dict_actual_size > 0);
-    free(samples_sizes);
 
     // Update bytes counter and pointers to bstarts for the new compressed buffer
     context->bstarts = (int32_t*)(context->dest + BLOSC_EXTENDED_HEADER_LENGTH);
     context->output_bytes = BLOSC_EXTENDED_HEADER_LENGTH +
                             sizeof(int32_t) * context->nblocks;
-    /* Write the size of trained dict at the end of bstarts */
-    _sw32(context->dest + context->output_bytes, (int32_t)dict_actual_size);
-    context->output_bytes += sizeof(int32_t);
-    /* Write the trained dict afterwards */
-    context->dict_buffer = context->dest + context->output_bytes;
-    memcpy(context->dict_buffer, dict_buffer, (unsigned int)dict_actual_size);
-    context->dict_cdict = ZSTD_createCDict(dict_buffer, dict_actual_size, 1);  // TODO: use get_accel()
-    free(dict_buffer);      // the dictionary is copied in the header now
-    context->output_bytes += (int32_t)dict_actual_size;
-    context->dict_size = dict_actual_size;
+    if (context->use_dict == BLOSC2_DICT_SCHUNK) {
+      // The dict goes to the super-chunk, and the chunk just keeps its ID
+      publish_schunk_dict(context->schunk, dict_buffer, dict_actual_size);
+      free(dict_buffer);
+      if (load_schunk_dict(context) <= 0) {
+        return -20;
+      }
+      _sw32(context->dest + context->output_bytes, (int32_t)context->dict_id);
+      context->output_bytes += sizeof(int32_t);
+    }
+    else {
+      /* Write the size of trained dict at the end of bstarts */
+      _sw32(context->dest + context->output_bytes, dict_actual_size);
+      context->output_bytes += sizeof(int32_t);
+      /* Write the trained dict afterwards */
+      context->dict_buffer = context->dest + context->output_bytes;
+      memcpy(context->dict_buffer, dict_buffer, (unsigned int)dict_actual_size);
+      free(dict_buffer);      // the dictionary is copied in the header now
+      context->output_bytes += dict_actual_size;
+      context->dict_size = (size_t)dict_actual_size;
+      if (create_cdict(context) < 0) {
+        context->dict_buffer = NULL;
+        return -20;
+      }
+    }
 
     /* Compress with dict */
     cbytes = blosc_compress_context(context);
 
-    // Invalidate the dictionary for compressing other chunks using the same context
-    context->dict_buffer = NULL;
-    ZSTD_freeCDict(context->dict_cdict);
-    context->dict_cdict = NULL;
-#endif  // HAVE_ZSTD
+    if (context->use_dict != BLOSC2_DICT_SCHUNK) {
+      // Invalidate the dictionary for compressing other chunks using the same context
+      context->dict_buffer = NULL;
+      free_cdict(context);
+    }
   }
 
   return cbytes;
@@ -2191,6 +2873,126 @@ int blosc2_decompress_ctx(blosc2_context* context, const void* src, int32_t srcs
 }
 
 
+/* Whether the blocks of a chunk are delta-encoded (against the first one). */
+bool chunk_uses_delta(const uint8_t* src, int32_t srcsize) {
+  uint8_t flags = src[BLOSC2_CHUNK_FLAGS];
+  if ((flags & BLOSC_DOSHUFFLE) && (flags & BLOSC_DOBITSHUFFLE)) {
+    if (srcsize < BLOSC_EXTENDED_HEADER_LENGTH) {
+      return false;
+    }
+    const uint8_t* filters = src + BLOSC_MIN_HEADER_LENGTH;
+    for (int i = 0; i < BLOSC2_MAX_FILTERS; i++) {
+      if (filters[i] == BLOSC_DELTA) {
+        return true;
+      }
+    }
+    return false;
+  }
+  return (flags & BLOSC_DODELTA) != 0;
+}
+
+
+/* Decompress a chunk into a scattered destination of `destsize` bytes. */
+static int decompress_scattered(blosc2_context* context, const void* src, int32_t srcsize,
+                                struct scattered_dest* scattered, int32_t destsize) {
+  if (context->do_compress != 0) {
+    BLOSC_TRACE_ERROR("Context is not meant for decompression.  Giving up.");
+    return -10;
+  }
+  if (context->postfilter != NULL) {
+    BLOSC_TRACE_ERROR("A scattered destination cannot be used with a postfilter.");
+    return -1;
+  }
+  if (srcsize < BLOSC_MIN_HEADER_LENGTH) {
+    /* Not enough input to read minimum header */
+    return -1;
+  }
+  const uint8_t* _src = src;
+  int32_t nbytes = sw32_(_src + BLOSC2_CHUNK_NBYTES);
+  if (nbytes > destsize) {
+    BLOSC_TRACE_ERROR("The destination is too small for the decompressed buffer "
+                      "('%d' bytes, but '%d' are needed).", destsize, nbytes);
+    return -1;
+  }
+
+  int result;
+  if (chunk_uses_delta(_src, srcsize)) {
+    // The delta of every block refers to the first one, so decompress into a temporary
+    bool* maskout = NULL;
+    int nblocks = context->block_maskout_nitems;
+    if (context->block_maskout != NULL) {
+      // The mask is reset while decompressing, but the masked out blocks are not to be copied
+      maskout = malloc((size_t)nblocks);
+      memcpy(maskout, context->block_maskout, (size_t)nblocks);
+    }
+    uint8_t* tmp = malloc((size_t)nbytes);
+    result = blosc2_decompress_ctx(context, src, srcsize, tmp, nbytes);
+    if (result > 0 && maskout == NULL) {
+      scattered_copy(scattered, 0, tmp, nbytes);
+    }
+    else if (result > 0) {
+      int32_t blocksize = sw32_(_src + BLOSC2_CHUNK_BLOCKSIZE);
+      for (int i = 0; i < nblocks; i++) {
+        int32_t start = i * blocksize;
+        if (!maskout[i]) {
+          scattered_copy(scattered, start, tmp + start,
+                         nbytes - start < blocksize ? nbytes - start : blocksize);
+        }
+      }
+    }
+    free(maskout);
+    free(tmp);
+    return result;
+  }
+  context->scattered = scattered;
+  result = blosc2_decompress_ctx(context, src, srcsize, NULL, destsize);
+  context->scattered = NULL;
+  return result;
+}
+
+
+/* Decompress a chunk into the pieces of `iov`. */
+int blosc2_decompress_ctx_iov(blosc2_context* context, const void* src, int32_t srcsize,
+                              const blosc2_iov* iov, int niov) {
+  if (niov <= 0) {
+    BLOSC_TRACE_ERROR("There must be some pieces in the destination.");
+    return -1;
+  }
+  struct scattered_dest scattered = {.iov=iov, .niov=niov};
+  scattered.starts = malloc((niov + 1) * sizeof(int32_t));
+  int64_t len = 0;
+  for (int i = 0; i < niov; i++) {
+    if (iov[i].len < 0) {
+      BLOSC_TRACE_ERROR("The piece %d of the destination has a negative length.", i);
+      free(scattered.starts);
+      return -1;
+    }
+    // Bytes beyond the reach of a chunk are never written
+    scattered.starts[i] = (int32_t)(len < INT32_MAX ? len : INT32_MAX);
+    len += iov[i].len;
+  }
+  scattered.starts[niov] = (int32_t)(len < INT32_MAX ? len : INT32_MAX);
+  int result = decompress_scattered(context, src, srcsize, &scattered, scattered.starts[niov]);
+  free(scattered.starts);
+  return result;
+}
+
+
+/* Decompress a chunk into `count` pieces of `size` bytes that are `stride` bytes apart. */
+int blosc2_decompress_ctx_strided(blosc2_context* context, const void* src, int32_t srcsize,
+                                  void* dest, int32_t size, int64_t stride, int32_t count) {
+  if (size <= 0 || count < 0) {
+    BLOSC_TRACE_ERROR("Invalid size (%d) or count (%d) for the strided destination.",
+                      size, count);
+    return -1;
+  }
+  struct scattered_dest scattered = {.base=dest, .size=size, .stride=stride};
+  int64_t len = (int64_t)size * count;
+  return decompress_scattered(context, src, srcsize, &scattered,
+                              (int32_t)(len < INT32_MAX ? len : INT32_MAX));
+}
+
+
 /* The public secure routine for decompression. */
 int blosc2_decompress(const void* src, int32_t srcsize, void* dest, int32_t destsize) {
   int result;
@@ -2253,9 +3055,8 @@ int _blosc_getitem(blosc2_context* context, const void* src, int32_t srcsize,
   int32_t leftover;                  /* extra bytes at end of buffer */
   int32_t* bstarts;                /* start pointers for each block */
   int32_t typesize, blocksize, nbytes;
-  int32_t bsize, bsize2, ebsize, leftoverblock;
+  int32_t bsize, ebsize, leftoverblock;
   int32_t cbytes;
-  int32_t startb, stopb;
   int32_t stop = start + nitems;
   int j;
 
@@ -2290,7 +3091,6 @@ int _blosc_getitem(blosc2_context* context, const void* src, int32_t srcsize,
   leftover = nbytes % blocksize;
   nblocks = (leftover > 0) ? nblocks + 1 : nblocks;
 
-  int32_t header_overhead = BLOSC_MIN_HEADER_LENGTH;
   if ((context->header_flags & BLOSC_DOSHUFFLE) &&
       (context->header_flags & BLOSC_DOBITSHUFFLE)) {
     /* Extended header */
@@ -2298,7 +3098,6 @@ int _blosc_getitem(blosc2_context* context, const void* src, int32_t srcsize,
       /* Not enough input to parse Blosc2 header */
       return -1;
     }
-    header_overhead = BLOSC_EXTENDED_HEADER_LENGTH;
     uint8_t* filters = _src + BLOSC_MIN_HEADER_LENGTH;
     uint8_t* filters_meta = filters + 8;
     for (int i = 0; i < BLOSC2_MAX_FILTERS; i++) {
@@ -2313,6 +3112,7 @@ int _blosc_getitem(blosc2_context* context, const void* src, int32_t srcsize,
     /* Minimal header */
     flags_to_filters(flags, context->filters);
     bstarts = (int32_t*)(_src + BLOSC_MIN_HEADER_LENGTH);
+    context->blosc2_flags = 0;
   }
 
   // Some checks for malformed buffers
@@ -2331,76 +3131,154 @@ int _blosc_getitem(blosc2_context* context, const void* src, int32_t srcsize,
     return -1;
   }
 
+  bool is_lazy = context->blosc2_flags & 0x08u;
+  if (memcpyed && !is_lazy && context->block_maskout == NULL) {
+    // The items are there as-is, so there is no need to go block by block
+    if (cbytes != nbytes + BLOSC_MAX_OVERHEAD || srcsize < cbytes) {
+      return -1;
+    }
+    memcpy(dest, _src + BLOSC_MAX_OVERHEAD + start * typesize, (size_t)nitems * typesize);
+    return nitems * typesize;
+  }
+
   if (_src + srcsize < (uint8_t *)(bstarts + nblocks)) {
     /* Not enough input to read all `bstarts` */
     return -1;
   }
+  // The dict (if any) comes right after the bstarts
+  int32_t bstarts_end = (int32_t)((uint8_t*)(bstarts + nblocks) - _src);
+  int32_t dict_len = read_chunk_dict(context, bstarts_end, srcsize - bstarts_end);
+  if (dict_len < 0) {
+    return dict_len;
+  }
 
-  for (j = 0; j < nblocks; j++) {
-    bsize = blocksize;
-    leftoverblock = 0;
-    if ((j == nblocks - 1) && (leftover > 0)) {
-      bsize = leftover;
-      leftoverblock = 1;
+  for (int i = 0; i < BLOSC2_MAX_FILTERS; i++) {
+    if (context->filters[i] == BLOSC_DELTA && stop * typesize > blocksize) {
+      // Blocks are delta-encoded against the first one, so decompress the whole chunk
+      if (is_lazy) {
+        int rc = read_lazy_blocks(context, _src, srcsize, 0, nblocks - 1);
+        if (rc < 0) {
+          return rc;
+        }
+        context->lazy_blocks_read = true;
+      }
+      uint8_t* tmp = malloc((size_t)nbytes);
+      cbytes = blosc_run_decompression_with_context(context, src, srcsize, tmp, nbytes);
+      context->lazy_blocks_read = false;
+      if (cbytes == nbytes) {
+        memcpy(dest, tmp + start * typesize, (size_t)nitems * typesize);
+      }
+      free(tmp);
+      return cbytes == nbytes ? nitems * typesize : -1;
     }
+  }
 
-    /* Compute start & stop for each block */
-    startb = start * typesize - j * blocksize;
-    stopb = stop * typesize - j * blocksize;
-    if (stopb <= 0) {
-      // We can exit as soon as this block is beyond stop
-      break;
-    }
-    if (startb >= blocksize) {
-      continue;
-    }
-    if (startb < 0) {
-      startb = 0;
-    }
-    if (stopb > blocksize) {
-      stopb = blocksize;
-    }
-    bsize2 = stopb - startb;
+  struct thread_context* scontext = context->serial_context;
 
-    /* Do the actual data copy */
-    struct thread_context* scontext = context->serial_context;
+  /* Resize the temporaries in serial context if needed */
+  if (blocksize != scontext->tmp_blocksize) {
+    my_free(scontext->tmp);
+    scontext->tmp_nbytes = (size_t)3 * context->blocksize + ebsize;
+    scontext->tmp = my_malloc(scontext->tmp_nbytes);
+    scontext->tmp2 = scontext->tmp + blocksize;
+    scontext->tmp3 = scontext->tmp + blocksize + ebsize;
+    scontext->tmp4 = scontext->tmp + 2 * blocksize + ebsize;
+    scontext->tmp_blocksize = (int32_t)blocksize;
+  }
 
-    /* Resize the temporaries in serial context if needed */
-    if (blocksize != scontext->tmp_blocksize) {
-      my_free(scontext->tmp);
-      scontext->tmp_nbytes = (size_t)3 * context->blocksize + ebsize;
-      scontext->tmp = my_malloc(scontext->tmp_nbytes);
-      scontext->tmp2 = scontext->tmp + blocksize;
-      scontext->tmp3 = scontext->tmp + blocksize + ebsize;
-      scontext->tmp4 = scontext->tmp + 2 * blocksize + ebsize;
-      scontext->tmp_blocksize = (int32_t)blocksize;
+  if (is_lazy) {
+    // Read the blocks with the items (and only them) out of the frame at once
+    int rc = read_lazy_blocks(context, _src, srcsize, start * typesize / blocksize,
+                              (stop * typesize - 1) / blocksize);
+    if (rc < 0) {
+      return rc;
     }
+    context->lazy_blocks_read = true;
+  }
 
-    // Regular decompression.  Put results in tmp2.
-    // If the block is aligned and the worst case fits in destination, let's avoid a copy
-    bool get_single_block = ((startb == 0) && (bsize == nitems * typesize));
-    uint8_t* tmp2 = get_single_block ? dest : scontext->tmp2;
+  // Only the first block can be delta-decoded here, and it is its own reference
+  context->dref_not_init = 1;
+  // Go straight to the first block with some of the items
+  for (j = start * typesize / blocksize; j < nblocks; j++) {
+    if (j * blocksize >= stop * typesize) {
+      // We can exit as soon as this block is beyond stop
+      break;
+    }
+    bsize = blocksize;
+    leftoverblock = 0;
+    if ((j == nblocks - 1) && (leftover > 0)) {
+      bsize = leftover;
+      leftoverblock = 1;
+    }
     // If memcpyed we don't have a bstarts section (because it is not needed)
-    int32_t src_offset = memcpyed ? header_overhead + j * bsize : sw32_(bstarts + j);
-    cbytes = blosc_d(context->serial_context, bsize, leftoverblock,
-                     src, srcsize, src_offset, j,
-                     tmp2, 0, scontext->tmp, scontext->tmp3);
+    int32_t src_offset = memcpyed ? BLOSC_MAX_OVERHEAD + j * blocksize : sw32_(bstarts + j);
+    cbytes = getitem_block(scontext, src, srcsize, src_offset, j, bsize, leftoverblock,
+                           start * typesize, stop * typesize, dest);
     if (cbytes < 0) {
       ntbytes = cbytes;
       break;
     }
-    if (!get_single_block) {
-      /* Copy to destination */
-      memcpy((uint8_t *) dest + ntbytes, tmp2 + startb, (unsigned int) bsize2);
-    }
-    cbytes = (int)bsize2;
     ntbytes += cbytes;
   }
+  context->lazy_blocks_read = false;
 
   return ntbytes;
 }
 
 
+/* Get items out of a chunk with the threads in the context, each decompressing some of the
+ * blocks that have items.  Fall back to the serial version when that cannot be done. */
+static int parallel_getitem(blosc2_context* context, const void* src, int32_t srcsize,
+                            int start, int nitems, void* dest) {
+  uint8_t* _src = (uint8_t*)(src);
+  int32_t nbytes = sw32_(_src + BLOSC2_CHUNK_NBYTES);
+  int32_t stop = start + nitems;
+  if (start < 0 || stop < start || (int64_t)stop * context->typesize > nbytes) {
+    // Let the serial version report the error
+    return _blosc_getitem(context, src, srcsize, start, nitems, dest);
+  }
+
+  int rc = initialize_context_decompression(context, src, srcsize, dest, nbytes);
+  if (rc < 0) {
+    return rc;
+  }
+  bool parallel = !(context->header_flags & (uint8_t)BLOSC_MEMCPYED);
+  for (int i = 0; i < BLOSC2_MAX_FILTERS; i++) {
+    // The delta filter needs the first block of the chunk to be decompressed first
+    if (context->filters[i] == BLOSC_DELTA) {
+      parallel = false;
+    }
+  }
+  if (parallel) {
+    check_nthreads(context);
+    parallel = context->nthreads > 1;
+  }
+  if (!parallel) {
+    return _blosc_getitem(context, src, srcsize, start, nitems, dest);
+  }
+
+  if (context->blosc2_flags & 0x08u) {
+    // Read the blocks with the items before the threads need them
+    rc = read_lazy_blocks(context, _src, srcsize, start * context->typesize / context->blocksize,
+                          (stop * context->typesize - 1) / context->blocksize);
+    if (rc < 0) {
+      return rc;
+    }
+    context->lazy_blocks_read = true;
+  }
+  context->getitem_start = start * context->typesize;
+  context->getitem_stop = stop * context->typesize;
+  rc = parallel_blosc(context);
+  context->getitem_start = 0;
+  context->getitem_stop = 0;
+  context->lazy_blocks_read = false;
+  if (rc < 0) {
+    return rc;
+  }
+  return nitems * context->typesize;
+}
+
+
 /* Specific routine optimized for decompression a small number of
    items out of a compressed chunk.  Public non-contextual API. */
 int blosc_getitem(const void* src, int start, int nitems, void* dest) {
@@ -2424,6 +3302,7 @@ int blosc_getitem(const void* src, int start, int nitems, void* dest) {
   context.filter_flags = get_filter_flags(context.header_flags, context.typesize);
   context.schunk = g_schunk;
   context.nthreads = 1;  // force a serial decompression; fixes #95
+  context.new_nthreads = 1;
   context.serial_context = create_thread_context(&context, 0);
   if ((context.header_flags & BLOSC_DOSHUFFLE) &&
       (context.header_flags & BLOSC_DOBITSHUFFLE)) {
@@ -2440,6 +3319,7 @@ int blosc_getitem(const void* src, int start, int nitems, void* dest) {
 
   /* Release resources */
   free_thread_context(context.serial_context);
+  free_ddict(&context);
   return result;
 }
 
@@ -2449,6 +3329,7 @@ int blosc2_getitem_ctx(blosc2_context* context, const void* src, int32_t srcsize
   int result;
 
   /* Minimally populate the context */
+  context->src = src;
   context->typesize = _src[BLOSC2_CHUNK_TYPESIZE];
   context->blocksize = sw32_(_src + BLOSC2_CHUNK_BLOCKSIZE);
   context->header_flags = *(_src + 2);
@@ -2457,8 +3338,16 @@ int blosc2_getitem_ctx(blosc2_context* context, const void* src, int32_t srcsize
     context->serial_context = create_thread_context(context, 0);
   }
 
-  /* Call the actual getitem function */
-  result = _blosc_getitem(context, src, srcsize, start, nitems, dest);
+  /* Use the threads when the items span several blocks */
+  if (context->new_nthreads > 1 && context->blocksize > 0 && nitems > 0 &&
+      (int64_t)start * context->typesize / context->blocksize <
+      (((int64_t)start + nitems) * context->typesize - 1) / context->blocksize) {
+    result = parallel_getitem(context, src, srcsize, start, nitems, dest);
+  }
+  else {
+    /* Call the actual getitem function */
+    result = _blosc_getitem(context, src, srcsize, start, nitems, dest);
+  }
 
   return result;
 }
@@ -2519,7 +3408,8 @@ static void t_blosc_do_job(void *ctxt)
 
   // Determine whether we can do a static distribution of workload among different threads
   bool memcpyed = context->header_flags & (uint8_t)BLOSC_MEMCPYED;
-  bool static_schedule = (!compress || memcpyed) && context->block_maskout == NULL;
+  bool static_schedule = (!compress || memcpyed) && context->block_maskout == NULL &&
+                         context->getitem_stop == 0;
   if (static_schedule) {
       /* Blocks per thread */
       tblocks = nblocks / context->nthreads;
@@ -2538,6 +3428,9 @@ static void t_blosc_do_job(void *ctxt)
     nblock_ = context->thread_nblock;
     pthread_mutex_unlock(&context->count_mutex);
     tblock = nblocks;
+    if (context->getitem_stop > 0) {
+      tblock = (context->getitem_stop - 1) / blocksize + 1;
+    }
   }
 
   /* Loop over blocks */
@@ -2554,6 +3447,9 @@ static void t_blosc_do_job(void *ctxt)
           /* We want to memcpy only */
           memcpy(dest + BLOSC_MAX_OVERHEAD + nblock_ * blocksize,
                  src + nblock_ * blocksize, (unsigned int) bsize);
+          if (context->zonemap_type != BLOSC2_ZONEMAP_NONE) {
+            block_zonemap(context, src + nblock_ * blocksize, bsize, nblock_);
+          }
           cbytes = (int32_t) bsize;
         }
         else {
@@ -2581,9 +3477,24 @@ static void t_blosc_do_job(void *ctxt)
       else {
         // If memcpyed we don't have a bstarts section (because it is not needed)
         int32_t src_offset = memcpyed ? BLOSC_MAX_OVERHEAD + nblock_ * blocksize : sw32_(bstarts + nblock_);
-        cbytes = blosc_d(thcontext, bsize, leftoverblock,
-                          src, srcsize, src_offset, nblock_,
-                          dest, nblock_ * blocksize, tmp, tmp2);
+        if (context->getitem_stop > 0) {
+          cbytes = getitem_block(thcontext, src, srcsize, src_offset, nblock_, bsize,
+                                 leftoverblock, context->getitem_start, context->getitem_stop,
+                                 dest);
+        }
+        else if (context->scattered != NULL) {
+          cbytes = scattered_block(thcontext, bsize, leftoverblock, src, srcsize, src_offset,
+                                   nblock_);
+        }
+        else if (context->postfilter != NULL) {
+          cbytes = postfilter_block(thcontext, bsize, leftoverblock, src, srcsize, src_offset,
+                                    nblock_, dest);
+        }
+        else {
+          cbytes = blosc_d(thcontext, bsize, leftoverblock,
+                           src, srcsize, src_offset, nblock_,
+                           dest, nblock_ * blocksize, tmp, tmp2);
+        }
       }
     }
 
@@ -2822,6 +3733,8 @@ const char* blosc_list_compressors(void) {
   strcat(ret, ",");
   strcat(ret, BLOSC_ZSTD_COMPNAME);
 #endif /* HAVE_ZSTD */
+  strcat(ret, ",");
+  strcat(ret, BLOSC_NDLZ_COMPNAME);
   compressors_list_done = 1;
   return ret;
 }
@@ -2851,6 +3764,9 @@ int blosc_get_complib_info(const char* compname, char** complib, char** version)
   if (clibcode == BLOSC_BLOSCLZ_LIB) {
     clibversion = BLOSCLZ_VERSION_STRING;
   }
+  else if (clibcode == BLOSC_NDLZ_LIB) {
+    clibversion = NDLZ_VERSION_STRING;
+  }
 #if defined(HAVE_LZ4)
   else if (clibcode == BLOSC_LZ4_LIB) {
 #if defined(LZ4_VERSION_MAJOR)
@@ -3004,6 +3920,7 @@ void blosc_init(void) {
   if (g_initlib) return;
 
   pthread_mutex_init(&global_comp_mutex, NULL);
+  pthread_mutex_init(&dict_mutex, NULL);
   /* Create a global context */
   g_global_context = (blosc2_context*)my_malloc(sizeof(blosc2_context));
   memset(g_global_context, 0, sizeof(blosc2_context));
@@ -3021,6 +3938,7 @@ void blosc_destroy(void) {
   blosc2_free_ctx(g_global_context);
 
   pthread_mutex_destroy(&global_comp_mutex);
+  pthread_mutex_destroy(&dict_mutex);
 }
 
 
@@ -3096,6 +4014,9 @@ int blosc_free_resources(void) {
 /* Create a context for compression */
 blosc2_context* blosc2_create_cctx(blosc2_cparams cparams) {
   blosc2_context* context = (blosc2_context*)my_malloc(sizeof(blosc2_context));
+  if (context == NULL) {
+    return NULL;
+  }
 
   /* Populate the context, using zeros as default values */
   memset(context, 0, sizeof(blosc2_context));
@@ -3111,6 +4032,7 @@ blosc2_context* blosc2_create_cctx(blosc2_cparams cparams) {
   context->nthreads = cparams.nthreads;
   context->new_nthreads = context->nthreads;
   context->blocksize = cparams.blocksize;
+  context->user_blocksize = cparams.blocksize;
   context->threads_started = 0;
   context->schunk = cparams.schunk;
 
@@ -3119,6 +4041,20 @@ blosc2_context* blosc2_create_cctx(blosc2_cparams cparams) {
     context->pparams = (blosc2_prefilter_params*)my_malloc(sizeof(blosc2_prefilter_params));
     memcpy(context->pparams, cparams.pparams, sizeof(blosc2_prefilter_params));
   }
+  context->zonemap_type = cparams.zonemap_type;
+  if (cparams.ndim > 0 && cparams.ndim <= BLOSC2_MAX_DIM) {
+    // Every block holds a blockshape of items, so that blocks can be located in the array
+    int64_t blocksize = cparams.typesize;
+    for (int i = 0; i < cparams.ndim; i++) {
+      context->blockshape[i] = cparams.blockshape[i];
+      blocksize *= cparams.blockshape[i];
+    }
+    context->ndim = cparams.ndim;
+    if (blocksize > 0 && blocksize <= BLOSC_MAX_BUFFERSIZE) {
+      context->blocksize = (int32_t)blocksize;
+      context->user_blocksize = (int32_t)blocksize;
+    }
+  }
 
   return context;
 }
@@ -3127,6 +4063,9 @@ blosc2_context* blosc2_create_cctx(blosc2_cparams cparams) {
 /* Create a context for decompression */
 blosc2_context* blosc2_create_dctx(blosc2_dparams dparams) {
   blosc2_context* context = (blosc2_context*)my_malloc(sizeof(blosc2_context));
+  if (context == NULL) {
+    return NULL;
+  }
 
   /* Populate the context, using zeros as default values */
   memset(context, 0, sizeof(blosc2_context));
@@ -3138,6 +4077,12 @@ blosc2_context* blosc2_create_dctx(blosc2_dparams dparams) {
   context->block_maskout_nitems = 0;
   context->schunk = dparams.schunk;
 
+  if (dparams.postfilter != NULL) {
+    context->postfilter = dparams.postfilter;
+    context->postparams = (blosc2_postfilter_params*)my_malloc(sizeof(blosc2_postfilter_params));
+    memcpy(context->postparams, dparams.postparams, sizeof(blosc2_postfilter_params));
+  }
+
   return context;
 }
 
@@ -3147,22 +4092,18 @@ void blosc2_free_ctx(blosc2_context* context) {
   if (context->serial_context != NULL) {
     free_thread_context(context->serial_context);
   }
-  if (context->dict_cdict != NULL) {
-#ifdef HAVE_ZSTD
-    ZSTD_freeCDict(context->dict_cdict);
-#endif
-  }
-  if (context->dict_ddict != NULL) {
-#ifdef HAVE_ZSTD
-    ZSTD_freeDDict(context->dict_ddict);
-#endif
-  }
+  free_cdict(context);
+  free_ddict(context);
   if (context->btune != NULL) {
     btune_free(context);
   }
   if (context->prefilter != NULL) {
     my_free(context->pparams);
   }
+  if (context->postfilter != NULL) {
+    my_free(context->postparams);
+  }
+  free(context->zonemaps);
 
   if (context->block_maskout != NULL) {
     free(context->block_maskout);
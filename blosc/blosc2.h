@@ -118,6 +118,8 @@ enum {
 enum {
   BLOSC2_MAX_FILTERS = 6,
   //!< Maximum number of filters in the filter pipeline
+  BLOSC2_MAX_DIM = 8,
+  //!< Maximum number of dimensions of the arrays kept in super-chunks
 };
 
 /**
@@ -136,6 +138,58 @@ enum {
 enum {
   BLOSC2_USEDICT = 0x1,          //!< use dictionaries with codec
   BLOSC2_BIGENDIAN = 0x2,        //!< data is in big-endian ordering
+  BLOSC2_SHAREDDICT = 0x10,      //!< the dict is the one of the super-chunk (only its ID is in the chunk)
+};
+
+/**
+ * @brief The kinds of dicts for compressing (see blosc2_cparams.use_dict)
+ */
+enum {
+  BLOSC2_DICT_NONE = 0,          //!< no dicts
+  BLOSC2_DICT_CHUNK = 1,         //!< a dict per chunk, trained out of the chunk and stored inside it
+  BLOSC2_DICT_SCHUNK = 2,        //!< a dict per super-chunk, trained once and shared by all its chunks
+};
+
+/**
+ * @brief The types of the items for computing zone maps
+ */
+enum {
+  BLOSC2_ZONEMAP_NONE = 0,       //!< no zone maps
+  BLOSC2_ZONEMAP_INT8 = 1,       //!< int8_t items
+  BLOSC2_ZONEMAP_INT16 = 2,      //!< int16_t items
+  BLOSC2_ZONEMAP_INT32 = 3,      //!< int32_t items
+  BLOSC2_ZONEMAP_INT64 = 4,      //!< int64_t items
+  BLOSC2_ZONEMAP_FLOAT32 = 5,    //!< float items
+  BLOSC2_ZONEMAP_FLOAT64 = 6,    //!< double items
+};
+
+/**
+ * @brief The comparisons for the predicates in blosc2_schunk_scan()
+ */
+enum {
+  BLOSC2_SCAN_LT = 0,            //!< item < value
+  BLOSC2_SCAN_LE = 1,            //!< item <= value
+  BLOSC2_SCAN_GT = 2,            //!< item > value
+  BLOSC2_SCAN_GE = 3,            //!< item >= value
+  BLOSC2_SCAN_EQ = 4,            //!< item == value
+  BLOSC2_SCAN_BETWEEN = 5,       //!< value <= item <= high
+};
+
+/**
+ * @brief The operations for blosc2_schunk_reduce()
+ */
+enum {
+  BLOSC2_REDUCE_SUM = 0,         //!< the sum of the items
+  BLOSC2_REDUCE_MIN = 1,         //!< the minimum of the items
+  BLOSC2_REDUCE_MAX = 2,         //!< the maximum of the items
+  BLOSC2_REDUCE_COUNT = 3,       //!< the number of (non-null) items
+};
+
+/**
+ * @brief Error codes that are common to different functions
+ */
+enum {
+  BLOSC2_ERROR_MEMORY_ALLOC = -30, //!< some memory (or a context) cannot be allocated
 };
 
 /**
@@ -156,7 +210,8 @@ enum {
   BLOSC_ZLIB = 4,
   BLOSC_ZSTD = 5,
   BLOSC_LIZARD = 6,
-  BLOSC_MAX_CODECS = 7,  //!< maximum number of reserved codecs
+  BLOSC_NDLZ = 7,
+  BLOSC_MAX_CODECS = 8,  //!< maximum number of reserved codecs
 };
 
 
@@ -169,6 +224,7 @@ enum {
 #define BLOSC_SNAPPY_COMPNAME    "snappy"
 #define BLOSC_ZLIB_COMPNAME      "zlib"
 #define BLOSC_ZSTD_COMPNAME      "zstd"
+#define BLOSC_NDLZ_COMPNAME      "ndlz"
 
 /**
  * @brief Codes for compression libraries shipped with Blosc (code must be < 8)
@@ -180,6 +236,7 @@ enum {
   BLOSC_ZLIB_LIB = 3,
   BLOSC_ZSTD_LIB = 4,
   BLOSC_LIZARD_LIB = 5,
+  BLOSC_NDLZ_LIB = 6,
   BLOSC_SCHUNK_LIB = 7,   //!< compressor library in super-chunk header
 };
 
@@ -196,6 +253,7 @@ enum {
   #define BLOSC_ZLIB_LIBNAME    "Zlib"
 #endif	/* HAVE_MINIZ */
 #define BLOSC_ZSTD_LIBNAME      "Zstd"
+#define BLOSC_NDLZ_LIBNAME      "NDLZ"
 
 /**
  * @brief The codes for compressor formats shipped with Blosc
@@ -209,6 +267,7 @@ enum {
   BLOSC_SNAPPY_FORMAT = BLOSC_SNAPPY_LIB,
   BLOSC_ZLIB_FORMAT = BLOSC_ZLIB_LIB,
   BLOSC_ZSTD_FORMAT = BLOSC_ZSTD_LIB,
+  BLOSC_NDLZ_FORMAT = BLOSC_NDLZ_LIB,
 };
 
 /**
@@ -223,6 +282,7 @@ enum {
   BLOSC_SNAPPY_VERSION_FORMAT = 1,
   BLOSC_ZLIB_VERSION_FORMAT = 1,
   BLOSC_ZSTD_VERSION_FORMAT = 1,
+  BLOSC_NDLZ_VERSION_FORMAT = 1,
 };
 
 
@@ -617,6 +677,90 @@ typedef struct {
  */
 typedef int (*blosc2_prefilter_fn)(blosc2_prefilter_params* params);
 
+/**
+ * @brief The parameters for a postfilter function.
+ *
+ */
+typedef struct {
+  void *user_data;  // user-provided info (optional)
+  const uint8_t *in;  // the input buffer (the decompressed block)
+  uint8_t *out;  // the output buffer (the place of the block in the destination)
+  int32_t size;  // the size of the block (in bytes)
+  int32_t typesize;  // the typesize
+  int32_t offset;  // offset of the block from the start of the destination
+  int32_t nblock;  // the number of the block in the chunk
+  int32_t tid;  // thread id
+  uint8_t *ttmp;  // a temporary that is able to hold a block and is private for each thread
+  size_t ttmp_nbytes;  // the size of the temporary in bytes
+  blosc2_context *ctx;  // the decompression context
+} blosc2_postfilter_params;
+
+/**
+ * @brief The type of the postfilter function.
+ *
+ * The function is in charge of writing @p out (if at all).
+ * If the function call is successful, the return value should be 0; else, a negative value.
+ */
+typedef int (*blosc2_postfilter_fn)(blosc2_postfilter_params* params);
+
+/**
+ * @brief A value in a zone map.
+ */
+typedef union {
+  int64_t i;  //!< the value for integer types
+  double f;   //!< the value for floating point types
+} blosc2_zonemap_value;
+
+/**
+ * @brief The zone map (statistics) of a block or a chunk.
+ */
+typedef struct {
+  blosc2_zonemap_value min;
+  //!< The minimum of the (non-null) items.
+  blosc2_zonemap_value max;
+  //!< The maximum of the (non-null) items.
+  int32_t nitems;
+  //!< The number of items.  It is negative if the zone map is not known.
+  int32_t nnulls;
+  //!< The number of null (NaN) items.  Always 0 for integer types.
+} blosc2_zonemap;
+
+/**
+ * @brief A predicate (a typed comparison) for scanning the items of a super-chunk.
+ */
+typedef struct {
+  uint8_t type;
+  //!< The type of the items (one of the BLOSC2_ZONEMAP_* types, except BLOSC2_ZONEMAP_NONE).
+  uint8_t op;
+  //!< The comparison (one of BLOSC2_SCAN_*).
+  blosc2_zonemap_value value;
+  //!< The value to compare with (the lowest one for BLOSC2_SCAN_BETWEEN).
+  blosc2_zonemap_value high;
+  //!< The highest value for BLOSC2_SCAN_BETWEEN.
+} blosc2_predicate;
+
+/**
+ * @brief The type of the function that receives the items of a block that match a predicate.
+ *
+ * It is called from the decompression threads (possibly at the same time), with @p tid
+ * in [0, nthreads), and only for the blocks with matches.  Bit `i % 64` of @p bitmap[i / 64]
+ * is set if the item @p start + `i` in the super-chunk matches, for `i` in [0, @p nitems).
+ * If the function call is successful, the return value should be 0; else, a negative value
+ * that stops the scan.
+ */
+typedef int (*blosc2_scan_fn)(void* user_data, int64_t start, int32_t nitems,
+                              const uint64_t* bitmap, int32_t nmatches, int tid);
+
+/**
+ * @brief A piece of a scattered destination for decompression.
+ */
+typedef struct {
+  void* base;
+  //!< The start of the piece.
+  int32_t len;
+  //!< The length of the piece in bytes.
+} blosc2_iov;
+
 /**
  * @brief The parameters for creating a context for compression purposes.
  *
@@ -629,7 +773,8 @@ typedef struct {
   uint8_t clevel;
   //!< The compression level (5).
   int use_dict;
-  //!< Use dicts or not when compressing (only for ZSTD).
+  //!< The kind of dicts to use when compressing (only for BloscLZ, LZ4, LZ4HC and ZSTD).
+  //!< See #BLOSC2_DICT_NONE, #BLOSC2_DICT_CHUNK and #BLOSC2_DICT_SCHUNK.
   int32_t typesize;
   //!< The type size (8).
   int16_t nthreads;
@@ -646,6 +791,19 @@ typedef struct {
   //!< The prefilter function.
   blosc2_prefilter_params *pparams;
   //!< The prefilter parameters.
+  uint8_t zonemap_type;
+  //!< The type of the items for computing a zone map (min, max and null count) of every block
+  //!< while compressing.  BLOSC2_ZONEMAP_NONE for none.
+  int8_t ndim;
+  //!< The number of dimensions of the array kept in a super-chunk (0; meaning a plain
+  //!< sequence of items).  See blosc2_schunk_set_ndarray().
+  int64_t shape[BLOSC2_MAX_DIM];
+  //!< The shape of the array.
+  int32_t chunkshape[BLOSC2_MAX_DIM];
+  //!< The shape of the chunks the array is split into.
+  int32_t blockshape[BLOSC2_MAX_DIM];
+  //!< The shape of the blocks the chunks are split into.  When ndim > 0, it
+  //!< sets the blocksize (blockshape items).
 } blosc2_cparams;
 
 /**
@@ -654,7 +812,7 @@ typedef struct {
 static const blosc2_cparams BLOSC2_CPARAMS_DEFAULTS = {
         BLOSC_BLOSCLZ, 5, 0, 8, 1, 0, NULL,
         {0, 0, 0, 0, 0, BLOSC_SHUFFLE}, {0, 0, 0, 0, 0, 0},
-        NULL, NULL };
+        NULL, NULL, BLOSC2_ZONEMAP_NONE, 0, {0}, {0}, {0} };
 
 /**
   @brief The parameters for creating a context for decompression purposes.
@@ -667,12 +825,18 @@ typedef struct {
   //!< The number of threads to use internally (1).
   void* schunk;
   //!< The associated schunk, if any (NULL).
+  blosc2_postfilter_fn postfilter;
+  //!< The postfilter function.  It is run for every block of the chunks that
+  //!< are fully decompressed, right after the filter pipeline, and in the
+  //!< thread that decompressed the block.  It cannot be used with the delta filter.
+  blosc2_postfilter_params *postparams;
+  //!< The postfilter parameters.
 } blosc2_dparams;
 
 /**
  * @brief Default struct for decompression params meant for user initialization.
  */
-static const blosc2_dparams BLOSC2_DPARAMS_DEFAULTS = {1, NULL};
+static const blosc2_dparams BLOSC2_DPARAMS_DEFAULTS = {1, NULL, NULL, NULL};
 
 /**
  * @brief Create a context for @a *_ctx() compression functions.
@@ -780,7 +944,7 @@ BLOSC_EXPORT int blosc2_set_maskout(blosc2_context *ctx, bool *maskout, int nblo
  * **BLOSC_TYPESIZE=(INTEGER)**: This will overwrite the *typesize*
  * parameter before the compression process starts.
  *
- * **BLOSC_COMPRESSOR=[BLOSCLZ | LZ4 | LZ4HC | LIZARD | SNAPPY | ZLIB]**:
+ * **BLOSC_COMPRESSOR=[BLOSCLZ | LZ4 | LZ4HC | LIZARD | SNAPPY | ZLIB | ZSTD | NDLZ]**:
  * This will call *blosc_set_compressor(BLOSC_COMPRESSOR)* before the
  * compression process starts.
  *
@@ -910,6 +1074,55 @@ BLOSC_EXPORT int blosc2_compress_ctx(
 BLOSC_EXPORT int blosc2_decompress_ctx(blosc2_context* context, const void* src,
                                        int32_t srcsize, void* dest, int32_t destsize);
 
+/**
+ * @brief Decompress a chunk into a scattered destination.
+ *
+ * The decompressed bytes are laid out in the pieces of @p iov, one after the other (e.g. the
+ * two parts of a ring buffer).  Every block is put in its place by the thread that decompresses
+ * it; blocks that fall in a single piece are decompressed straight there.
+ *
+ * @param context The context for decompression.  It cannot have a postfilter.
+ * @param src The buffer of compressed data.
+ * @param srcsize The length of buffer of compressed data.
+ * @param iov The pieces of the destination.
+ * @param niov The number of pieces.
+ *
+ * @remark Chunks with the delta filter are decompressed into a temporary first, as every
+ * block refers to the first one.
+ *
+ * @remark If #blosc2_set_maskout is called prior to this function, its mask is honored for
+ * just one single shot, as in #blosc2_decompress_ctx.
+ *
+ * @return The number of bytes decompressed.  If an error occurs, e.g. the pieces are not large
+ * enough, a negative value will be returned instead.
+ */
+BLOSC_EXPORT int blosc2_decompress_ctx_iov(blosc2_context* context, const void* src,
+                                           int32_t srcsize, const blosc2_iov* iov, int niov);
+
+/**
+ * @brief Decompress a chunk into a strided destination.
+ *
+ * The decompressed bytes are laid out in @p count pieces of @p size bytes, which start at
+ * @p dest + i * @p stride for i in [0, @p count) (e.g. a column of a row-major matrix, with
+ * the typesize as @p size and the size of a row as @p stride).
+ *
+ * @param context The context for decompression.  It cannot have a postfilter.
+ * @param src The buffer of compressed data.
+ * @param srcsize The length of buffer of compressed data.
+ * @param dest The start of the first piece.
+ * @param size The size of every piece in bytes.
+ * @param stride The distance between the starts of two consecutive pieces in bytes.
+ * @param count The number of pieces.
+ *
+ * @return The number of bytes decompressed.  If an error occurs, e.g. the pieces are not large
+ * enough, a negative value will be returned instead.
+ *
+ * @see #blosc2_decompress_ctx_iov
+ */
+BLOSC_EXPORT int blosc2_decompress_ctx_strided(blosc2_context* context, const void* src,
+                                               int32_t srcsize, void* dest, int32_t size,
+                                               int64_t stride, int32_t count);
+
 /**
  * @brief Context interface counterpart for #blosc_getitem.
  *
@@ -929,6 +1142,10 @@ BLOSC_EXPORT int blosc2_getitem_ctx(blosc2_context* context, const void* src,
 
 #define BLOSC2_MAX_METALAYERS 16
 #define BLOSC2_METALAYER_NAME_MAXLEN 31
+/* The metalayer with the shape, chunkshape and blockshape of n-dimensional super-chunks.  It
+   uses the name and (msgpack) format of the metalayer of Caterva arrays, which share their layout. */
+#define BLOSC2_NDIM_METALAYER "caterva"
+#define BLOSC2_NDIM_METALAYER_VERSION 0
 
 /**
  * @brief This struct is meant for holding storage parameters for a
@@ -946,12 +1163,19 @@ typedef struct {
     blosc2_dparams* dparams;
     //!< The decompression params when creating a schunk.
     //!< If NULL, sensible defaults are used depending on the context.
+    bool checksums;
+    //!< Whether a checksum (XXH64) of every compressed chunk should be kept.
+    //!< Checksums are verified the first time a chunk is decompressed as a whole (chunks
+    //!< of which only some blocks are read are not verified, see #blosc2_schunk_verify).
+    int64_t cache_size;
+    //!< The maximum size (in bytes) of the decompressed chunks kept in an LRU cache.
+    //!< If 0, there is no cache.  See blosc2_schunk_cache_stats().
 } blosc2_storage;
 
 /**
  * @brief Default struct for #blosc2_storage meant for user initialization.
  */
-static const blosc2_storage BLOSC2_STORAGE_DEFAULTS = {false, NULL, NULL, NULL};
+static const blosc2_storage BLOSC2_STORAGE_DEFAULTS = {false, NULL, NULL, NULL, false, 0};
 
 typedef struct {
   char* fname;             //!< The name of the file; if NULL, this is in-memory
@@ -959,7 +1183,10 @@ typedef struct {
   uint8_t* coffsets;       //!< Pointers to the (compressed, on-disk) chunk offsets
   int64_t len;             //!< The current length of the frame in (compressed) bytes
   int64_t maxlen;          //!< The maximum length of the frame; if 0, there is no maximum
+  bool shm;                //!< Whether sdata is a mapping of a shared memory segment of maxlen bytes
   uint32_t trailer_len;    //!< The current length of the trailer in (compressed) bytes
+  uint32_t generation;     //!< The generation of the frame (bumped each time that it is modified)
+  void* lock;              //!< The state of the advisory lock on a file frame (NULL if never locked)
 } blosc2_frame;
 
 /**
@@ -991,7 +1218,7 @@ typedef struct blosc2_schunk {
   int32_t blocksize;
   //!< The requested size of the compressed blocks (0; meaning automatic).
   int32_t chunksize;
-  //!< Size of each chunk. 0 if not a fixed chunksize.
+  //!< Size of each chunk. 0 if not a fixed chunksize (i.e. chunks have variable lengths).
   uint8_t filters[BLOSC2_MAX_FILTERS];
   //!< The (sequence of) filters.  8-bit per filter.
   uint8_t filters_meta[BLOSC2_MAX_FILTERS];
@@ -1024,6 +1251,22 @@ typedef struct blosc2_schunk {
   //<! The user-defined metadata.
   int32_t usermeta_len;
   //<! The (compressed) length of the user-defined metadata.
+  uint64_t* checksums;
+  //!< The checksums (XXH64) of the compressed chunks.  NULL if checksums are not kept.
+  bool* checksums_verified;
+  //!< Whether the checksum of each chunk has already been verified.
+  void* cache;
+  //!< The cache of decompressed chunks.  NULL if there is no cache.
+  void* nbytes_index;
+  //!< Where each chunk starts, for super-chunks with variable-length chunks.  NULL until needed.
+  void* zonemaps;
+  //!< The zone maps of the chunks and their blocks.  NULL if zone maps are not kept.
+  uint8_t* dict;
+  //!< The dict shared by the chunks (see #BLOSC2_DICT_SCHUNK).  NULL until it is trained.
+  int32_t dict_size;
+  //!< The size of the shared dict.
+  uint32_t dict_id;
+  //!< The ID of the shared dict, which is what the chunks compressed with it keep.
 } blosc2_schunk;
 
 /**
@@ -1061,6 +1304,12 @@ blosc2_schunk_empty(int nchunks, blosc2_storage storage);
  * @remark The storage.path must be not NULL and it should exist on-disk.
  * New data or metadata can be appended or updated.
  *
+ * @note The same frame can be opened by different processes at the same time.
+ * Unless the library is built with `DEACTIVATE_LOCKS`, readers take a shared
+ * advisory lock and writers an exclusive one, and chunks appended (or reordered)
+ * by other processes are seen the next time that the super-chunk is accessed.
+ * Metalayers and usermeta are only read when opening the super-chunk.
+ *
  * @return The new super-chunk.
  */
 BLOSC_EXPORT blosc2_schunk*
@@ -1082,6 +1331,55 @@ blosc2_schunk_open(blosc2_storage storage);
 BLOSC_EXPORT blosc2_schunk*
 blosc2_schunk_open_sframe(uint8_t *sframe, int64_t len);
 
+/**
+ * @brief Create a new super-chunk whose frame lives in a POSIX shared memory
+ * segment, so that other processes can read it without copying it.
+ *
+ * @param name The name of the segment (e.g. "/myframe").  It must not exist.
+ * @param maxlen The size of the segment, i.e. the maximum length that the
+ * frame can reach (in bytes).
+ * @param storage The storage properties (`sequential` and `path` are ignored).
+ *
+ * @remark The segment cannot be grown without invalidating the mappings in
+ * the readers, so appends beyond @p maxlen fail.  Pages are only allocated
+ * by the OS as they are used, so @p maxlen can be generous.  The segment
+ * survives the process; use blosc2_unlink_shm() to remove it.  Not supported
+ * on Windows.
+ *
+ * @return The new super-chunk, or NULL in case of error.
+ */
+BLOSC_EXPORT blosc2_schunk*
+blosc2_schunk_new_shm(const char* name, int64_t maxlen, blosc2_storage storage);
+
+/**
+ * @brief Open (read-only) a super-chunk living in a POSIX shared memory
+ * segment created with blosc2_schunk_new_shm() (no copy is made).
+ *
+ * @param name The name of the segment.
+ * @param storage The storage properties (e.g. for setting the cache size or the
+ * dparams); `sequential` and `path` are ignored.  If NULL, the defaults are used.
+ *
+ * @note The chunks appended by the creator are seen the next time that the
+ * super-chunk is accessed; the same locks than in blosc2_schunk_open()
+ * guarantee that a consistent frame is always seen.  Any attempt to modify
+ * the super-chunk fails.
+ *
+ * @return The new super-chunk, or NULL in case of error.
+ */
+BLOSC_EXPORT blosc2_schunk*
+blosc2_schunk_open_shm(const char* name, const blosc2_storage* storage);
+
+/**
+ * @brief Remove a shared memory segment created with blosc2_schunk_new_shm().
+ *
+ * @param name The name of the segment.
+ *
+ * @remark The processes that have the segment opened can keep using it.
+ *
+ * @return 0 if success, a negative value otherwise.
+ */
+BLOSC_EXPORT int blosc2_unlink_shm(const char* name);
+
 /**
  * @brief Create an in-memory frame out of a super-chunk.
  *
@@ -1116,6 +1414,10 @@ BLOSC_EXPORT int blosc2_schunk_free(blosc2_schunk *schunk);
  * freed if desired.
  * @param copy Whether the chunk should be copied internally or can be used as-is.
  *
+ * @note Chunks can have any length.  The super-chunk keeps a fixed chunksize
+ * as long as every chunk has the length of the first one, except the last
+ * one, which can be shorter; otherwise, its chunksize becomes 0.
+ *
  * @return The number of chunks in super-chunk. If some problem is
  * detected, this number will be negative.
  */
@@ -1131,6 +1433,11 @@ BLOSC_EXPORT int blosc2_schunk_append_chunk(blosc2_schunk *schunk, uint8_t *chun
   * freed if desired.
   * @param copy Whether the chunk should be copied internally or can be used as-is.
   *
+  * @note The new chunk can have a different length (uncompressed) than the
+  * old one, in which case the super-chunk may switch to variable-length
+  * chunks (see blosc2_schunk_append_chunk).  In frames, the space of the old
+  * chunk is not reclaimed until the frame is serialized again.
+  *
   * @return The number of chunks in super-chunk. If some problem is
   * detected, this number will be negative.
   */
@@ -1162,6 +1469,23 @@ BLOSC_EXPORT int blosc2_schunk_insert_chunk(blosc2_schunk *schunk, int nchunk, u
  */
 BLOSC_EXPORT int blosc2_schunk_append_buffer(blosc2_schunk *schunk, void *src, int32_t nbytes);
 
+/**
+ * @brief Train the dict shared by the chunks of a super-chunk out of a sample of data.
+ *
+ * The super-chunk has to be created with #BLOSC2_DICT_SCHUNK in its cparams.use_dict.  When
+ * this is not called, the dict is trained out of the first chunk that is compressed.  Either
+ * way, the dict is stored only once (in the trailer of the frame, if any), and the chunks
+ * just keep its ID.
+ *
+ * @param schunk The super-chunk.
+ * @param src The sample of data, which should be like the data that will be appended.
+ * @param nbytes The size of the @p src buffer.
+ *
+ * @return The size of the dict. If the super-chunk already has a dict, or some problem is
+ * detected, a negative value is returned instead.
+ */
+BLOSC_EXPORT int blosc2_schunk_train_dict(blosc2_schunk *schunk, const void *src, int32_t nbytes);
+
 /**
  * @brief Decompress and return the @p nchunk chunk of a super-chunk.
  *
@@ -1176,11 +1500,308 @@ BLOSC_EXPORT int blosc2_schunk_append_buffer(blosc2_schunk *schunk, void *src, i
  * @warning You must make sure that you have space enough to store the
  * uncompressed data.
  *
+ * @note If the super-chunk has a cache (see `blosc2_storage.cache_size`),
+ * chunks that have been decompressed recently are just copied out of it.
+ *
  * @return The size of the decompressed chunk or 0 if it is non-initialized. If some problem is
  * detected, a negative code is returned instead.
  */
 BLOSC_EXPORT int blosc2_schunk_decompress_chunk(blosc2_schunk *schunk, int nchunk, void *dest, int32_t nbytes);
 
+/**
+ * @brief Get a read-only view of the decompressed contents of the @p nchunk chunk of a super-chunk.
+ *
+ * Memcpyed chunks (e.g. those compressed with clevel 0, or that are not compressible) that are
+ * in memory do not need any decoding, so a pointer to their contents inside the chunk is returned
+ * without any copy.  Else, the chunk is decompressed into a new buffer.
+ *
+ * @param schunk The super-chunk.
+ * @param nchunk The chunk (0 indexed).
+ * @param view The pointer where the view will be returned.  It is NULL for non-initialized chunks.
+ * @param needs_free The pointer to a boolean indicating if it is the user's
+ * responsibility to free the view returned or not.
+ *
+ * @warning A view that does not need a free points into the super-chunk (or its backing
+ * frame), so it is only valid until the super-chunk is modified or freed.
+ *
+ * @return The size of the decompressed chunk or 0 if it is non-initialized. If some problem is
+ * detected, a negative code is returned instead.
+ */
+BLOSC_EXPORT int blosc2_schunk_get_view(blosc2_schunk *schunk, int nchunk, uint8_t **view,
+                                        bool *needs_free);
+
+/**
+ * @brief Get the items [@p start, @p stop) of a super-chunk.
+ *
+ * Chunks that are completely inside the slice are decompressed straight
+ * into @p dest, while just the blocks that are needed are decompressed
+ * (and read, for frames on-disk) for chunks at the edges, which are not
+ * checked against their checksums for this reason.  Chunks are
+ * processed in parallel with the number of threads of the decompression
+ * context of the super-chunk.
+ *
+ * With variable-length chunks, the chunks with the items are found with a
+ * binary search on the cumulative sizes of the chunks, which are read (just
+ * the chunk headers) the first time they are needed.
+ *
+ * @param schunk The super-chunk.  Its chunks must start at item boundaries.
+ * @param start The first item (in units of the typesize of the super-chunk).
+ * @param stop The item after the last one.
+ * @param dest The buffer where the items will be put.  It must have room
+ * for (stop - start) * typesize bytes.
+ *
+ * @return The number of bytes copied to @p dest.  If some problem is
+ * detected, a negative code is returned instead.
+ */
+BLOSC_EXPORT int64_t blosc2_schunk_get_slice(blosc2_schunk *schunk, int64_t start, int64_t stop,
+                                             void *dest);
+
+/**
+ * @brief Set the items [@p start, @p stop) of a super-chunk.
+ *
+ * Chunks that are completely inside the slice are compressed straight
+ * from @p src, while just the chunks at the edges are decompressed,
+ * patched and compressed again.  Chunks are compressed in parallel with the
+ * number of threads of the compression context of the super-chunk.
+ *
+ * @param schunk The super-chunk.  Its chunks must start at item boundaries.
+ * @param start The first item (in units of the typesize of the super-chunk).
+ * @param stop The item after the last one.
+ * @param src The buffer with the new items.  It must have
+ * (stop - start) * typesize bytes.
+ *
+ * @return The number of bytes copied out of @p src.  If some problem is
+ * detected, a negative code is returned instead.
+ */
+BLOSC_EXPORT int64_t blosc2_schunk_set_slice(blosc2_schunk *schunk, int64_t start, int64_t stop,
+                                             const void *src);
+
+/**
+ * @brief Fill an empty n-dimensional super-chunk with the items of an array.
+ *
+ * The super-chunk must have been created with the n-dimensional shapes (ndim, shape, chunkshape
+ * and blockshape) in its cparams, which are kept in the #BLOSC2_NDIM_METALAYER metalayer.  The
+ * array is split into chunks of chunkshape items (in C order), and every chunk into blocks of
+ * blockshape items (in C order too).  The chunks are padded with zeros up to a multiple of
+ * blockshape, and the chunks at the edges of the array up to chunkshape.
+ *
+ * @param schunk The n-dimensional super-chunk.  It must not have any chunk yet.
+ * @param src The buffer with the items of the array in C order.
+ * @param srcsize The size of @p src.  It must be the number of items in the shape times
+ * the typesize.
+ *
+ * @return The number of chunks in the super-chunk.  If some problem is detected, a negative
+ * code is returned instead.
+ */
+BLOSC_EXPORT int blosc2_schunk_set_ndarray(blosc2_schunk *schunk, const void *src, int64_t srcsize);
+
+/**
+ * @brief Get the hyperslab [@p start, @p stop) of an n-dimensional super-chunk.
+ *
+ * Just the chunks that intersect the hyperslab are read, and just the blocks of them that
+ * intersect the hyperslab are decompressed (via a mask of blocks), so thin slices of large
+ * chunks are cheap.  See blosc2_schunk_set_ndarray() for the layout of the array.
+ *
+ * @param schunk The n-dimensional super-chunk.
+ * @param start The first item in every dimension (ndim items).
+ * @param stop The item after the last one in every dimension (ndim items).
+ * @param dest The buffer where the hyperslab will be put in C order.  It must have room for
+ * the number of items in the hyperslab times the typesize.
+ *
+ * @return The number of bytes copied to @p dest.  If some problem is detected, a negative
+ * code is returned instead.
+ */
+BLOSC_EXPORT int64_t blosc2_schunk_get_hyperslab(blosc2_schunk *schunk, const int64_t *start,
+                                                 const int64_t *stop, void *dest);
+
+/**
+ * @brief Append the chunks of the super-chunk @p src at the end of @p dest.
+ *
+ * The chunks of @p src that are compressed with the same parameters
+ * (typesize, codec, compression level and filters) as @p dest would use
+ * are copied as-is, without being decompressed.  For frames, the compressed
+ * chunks are read and written in a row, and the offsets are updated once
+ * per batch of chunks.  The rest of the chunks are decompressed and
+ * compressed again with the parameters of @p dest, in parallel (one chunk
+ * per thread) with the number of threads of its compression context.
+ *
+ * @param dest The super-chunk where the chunks will be appended.
+ * @param src The super-chunk with the chunks to append.  It is not modified.
+ *
+ * @return The number of chunks in @p dest.  If some problem is detected, a
+ * negative code is returned instead (and @p dest may have some of the chunks
+ * of @p src already).
+ */
+BLOSC_EXPORT int blosc2_schunk_concat(blosc2_schunk *dest, blosc2_schunk *src);
+
+/**
+ * @brief Create a new super-chunk with the contents of @p src compressed
+ * with different parameters.
+ *
+ * The chunks are streamed out of @p src in batches and recompressed as in
+ * #blosc2_schunk_concat, so that the chunks which are already compressed
+ * with @p cparams are just copied.  The metalayers and the usermeta chunk of
+ * @p src are copied into the new super-chunk too.
+ *
+ * @param src The super-chunk to recompress.  It is not modified.
+ * @param cparams The compression parameters for the new super-chunk.  Its
+ * @p nthreads is the number of chunks that are recompressed at the same time.
+ * @param storage The storage for the new super-chunk.  Its @p cparams
+ * member is ignored.
+ *
+ * @return The new super-chunk.  If some problem is detected, NULL is
+ * returned instead (and the frame file in @p storage, if any, is removed).
+ */
+BLOSC_EXPORT blosc2_schunk* blosc2_schunk_recompress(blosc2_schunk *src, blosc2_cparams cparams,
+                                                     blosc2_storage storage);
+
+/**
+ * @brief Get the items in positions @p indices of a super-chunk.
+ *
+ * The indices are grouped by chunk and block, so that every block with some
+ * of the items is decompressed just once, no matter the order (or the
+ * repetitions) of @p indices.  Chunks are processed in parallel with the
+ * number of threads of the decompression context of the super-chunk.
+ *
+ * @param schunk The super-chunk.  Its chunks must start at item boundaries.
+ * @param indices The positions of the items (in units of the typesize of the
+ * super-chunk).
+ * @param n The number of items in @p indices.
+ * @param dest The buffer where the items will be put, in the same order as
+ * in @p indices.  It must have room for n * typesize bytes.
+ *
+ * @return The number of bytes copied to @p dest.  If some problem is
+ * detected, a negative code is returned instead.
+ */
+BLOSC_EXPORT int64_t blosc2_schunk_get_items(blosc2_schunk *schunk, const int64_t *indices,
+                                             int64_t n, void *dest);
+
+/**
+ * @brief Get the counters of the cache of decompressed chunks of a super-chunk.
+ *
+ * @param schunk The super-chunk.
+ * @param hits The number of calls to blosc2_schunk_decompress_chunk() that
+ * found the chunk in the cache.
+ * @param misses The number of calls that did not find it.
+ *
+ * @return 0 if success, or a negative value if the super-chunk has no cache.
+ */
+BLOSC_EXPORT int blosc2_schunk_cache_stats(blosc2_schunk *schunk, int64_t *hits, int64_t *misses);
+
+/**
+ * @brief An iterator for decompressing the chunks of a super-chunk sequentially.
+ */
+typedef struct blosc2_schunk_iter_s blosc2_schunk_iter;   /* opaque type */
+
+/**
+ * @brief Create an iterator over the chunks of a super-chunk.
+ *
+ * For super-chunks backed by a file frame, a background I/O thread reads
+ * the next @p prefetch (compressed) chunks ahead, so that reading a chunk
+ * overlaps with the decompression of the previous one.  For in-memory
+ * super-chunks there is no I/O involved, so no prefetching is done.
+ *
+ * @param schunk The super-chunk to iterate over.
+ * @param prefetch The number of chunks to read in advance. If 0, the
+ * chunks are read synchronously, as in #blosc2_schunk_decompress_chunk.
+ *
+ * @warning The super-chunk should not be modified while the iterator is alive.
+ *
+ * @return The new iterator, or NULL if some problem is detected.
+ */
+BLOSC_EXPORT blosc2_schunk_iter* blosc2_schunk_iter_new(blosc2_schunk *schunk, int prefetch);
+
+/**
+ * @brief Decompress the next chunk of the iteration.
+ *
+ * @param iter The iterator.
+ * @param nchunk The index of the decompressed chunk is returned here, or -1 when
+ * all the chunks have been already returned.
+ * @param dest The buffer where the decompressed data will be put.
+ * @param nbytes The size of the area pointed by @p *dest.
+ *
+ * @return The size of the decompressed chunk, or 0 if it is non-initialized or the
+ * iteration is exhausted. If some problem is detected, a negative code is returned instead.
+ */
+BLOSC_EXPORT int blosc2_schunk_iter_next(blosc2_schunk_iter *iter, int *nchunk, void *dest,
+                                         int32_t nbytes);
+
+/**
+ * @brief Release the resources of an iterator (it can be done before it is exhausted).
+ *
+ * @param iter The iterator to be freed.
+ *
+ * @return 0 if succeeds. Else a negative code is returned.
+ */
+BLOSC_EXPORT int blosc2_schunk_iter_free(blosc2_schunk_iter *iter);
+
+/**
+ * @brief An appender for compressing buffers in the background and appending them to a super-chunk.
+ */
+typedef struct blosc2_schunk_appender_s blosc2_schunk_appender;   /* opaque type */
+
+/**
+ * @brief Create an appender for a super-chunk.
+ *
+ * The buffers handed in with #blosc2_schunk_appender_push are compressed by a
+ * pool of @p nthreads threads (each with its own serial context), in no
+ * particular order, and a committer thread appends the resulting chunks to the
+ * super-chunk in the order the buffers were handed in.  This way, the ingestion
+ * scales with the number of cores even for small chunks, which cannot take
+ * advantage of the threads of a single context.
+ *
+ * @param schunk The super-chunk where the chunks will be appended.
+ * @param nthreads The number of compressor threads.  If 0, the number of threads
+ * of the compression context of the super-chunk is used.
+ * @param nqueued The maximum number of buffers that can be waiting to be appended.
+ * When this is reached, #blosc2_schunk_appender_push blocks until there is room
+ * for another buffer, so the memory used by the appender is bounded.  It should
+ * be larger than @p nthreads (else, 2 * @p nthreads is used).
+ *
+ * @warning The super-chunk should not be modified otherwise while the appender is alive.
+ *
+ * @return The new appender.  If its threads cannot be created, buffers are
+ * compressed and appended synchronously.
+ */
+BLOSC_EXPORT blosc2_schunk_appender* blosc2_schunk_appender_new(blosc2_schunk *schunk, int nthreads,
+                                                                int nqueued);
+
+/**
+ * @brief Hand a buffer in to be compressed and appended to the super-chunk.
+ *
+ * The buffer is copied, so it can be reused as soon as this returns.
+ *
+ * @param appender The appender.
+ * @param src The buffer of data to be compressed.
+ * @param nbytes The size of the @p src buffer.
+ *
+ * @return The number of chunks that the super-chunk will have once the buffer
+ * is appended.  If some problem is detected (in this or in any of the previous
+ * buffers), a negative code is returned instead.
+ */
+BLOSC_EXPORT int blosc2_schunk_appender_push(blosc2_schunk_appender *appender, const void *src,
+                                             int32_t nbytes);
+
+/**
+ * @brief Wait until all the buffers handed in have been appended to the super-chunk.
+ *
+ * @param appender The appender.
+ *
+ * @return The number of chunks in the super-chunk.  If some problem has been
+ * detected while compressing or appending a buffer, a negative code is returned
+ * instead, and the buffers after the failing one are discarded.
+ */
+BLOSC_EXPORT int blosc2_schunk_appender_flush(blosc2_schunk_appender *appender);
+
+/**
+ * @brief Append the buffers that are still queued, and release the resources of an appender.
+ *
+ * @param appender The appender to be freed.
+ *
+ * @return The same as #blosc2_schunk_appender_flush.
+ */
+BLOSC_EXPORT int blosc2_schunk_appender_free(blosc2_schunk_appender *appender);
+
 /**
  * @brief Return a compressed chunk that is part of a super-chunk in the @p chunk parameter.
  *
@@ -1263,6 +1884,130 @@ BLOSC_EXPORT int blosc2_schunk_get_dparams(blosc2_schunk *schunk, blosc2_dparams
  */
 BLOSC_EXPORT int blosc2_schunk_reorder_offsets(blosc2_schunk *schunk, int *offsets_order);
 
+/**
+ * @brief Verify the checksums of all the chunks in a super-chunk.
+ *
+ * The compressed chunks are hashed in parallel (using the number of threads of the
+ * decompression context) and compared against the checksums stored in the super-chunk,
+ * so no decompression is needed.  When the super-chunk is backed by a frame, the frame
+ * fingerprint in the trailer is checked too.
+ *
+ * @param schunk The super-chunk to be verified.
+ *
+ * @return 0 if all the chunks are correct, or the number of chunks that do not match
+ * their checksums.  If the super-chunk does not keep checksums or the frame fingerprint
+ * does not match, a negative code is returned.
+ */
+BLOSC_EXPORT int blosc2_schunk_verify(blosc2_schunk *schunk);
+
+/**
+ * @brief Get the zone map of a whole chunk in a super-chunk.
+ *
+ * Zone maps are computed (per block, by the compression threads) for the super-chunks
+ * created with a `zonemap_type` in their compression parameters, and are kept in the frame
+ * (if any) beside the chunk offsets.  They allow to skip the chunks (and blocks) that cannot
+ * have items in a given range of values.
+ *
+ * @param schunk The super-chunk.
+ * @param nchunk The chunk.
+ * @param zonemap The zone map of the chunk.  Its `nitems` is negative if it is not known
+ * (e.g. for chunks that have been compressed elsewhere).
+ *
+ * @return 0 if succeeds.  Else (e.g. the super-chunk does not keep zone maps) a negative code
+ * is returned.
+ */
+BLOSC_EXPORT int blosc2_schunk_get_zonemap(blosc2_schunk *schunk, int nchunk, blosc2_zonemap *zonemap);
+
+/**
+ * @brief Get the zone maps of the blocks of a chunk in a super-chunk.
+ *
+ * @param schunk The super-chunk.
+ * @param nchunk The chunk.
+ * @param zonemaps The pointer where the zone maps of the blocks will be returned.  It is NULL
+ * if they are not known.
+ *
+ * @warning A new buffer is allocated, and the user should free it after use.
+ *
+ * @return The number of blocks (0 if the zone maps are not known).  Else a negative code is
+ * returned.
+ */
+BLOSC_EXPORT int blosc2_schunk_get_block_zonemaps(blosc2_schunk *schunk, int nchunk,
+                                                  blosc2_zonemap **zonemaps);
+
+/**
+ * @brief Get the blocks of a chunk in a super-chunk that cannot have items in [@p low, @p high].
+ *
+ * The values are integers or floating point numbers as per the type of the zone maps, and null
+ * (NaN) items are never in the range.  The mask is meant for blosc2_set_maskout(), so that
+ * only the blocks that may have items in the range are decompressed.
+ *
+ * @param schunk The super-chunk.
+ * @param nchunk The chunk.
+ * @param low The lowest value in the range.
+ * @param high The highest value in the range.
+ * @param maskout The pointer where the mask (true for the blocks that can be skipped) will be
+ * returned.  It is NULL if every block may have items in the range (e.g. the zone maps are
+ * not known), or no block does.
+ * @param nblocks The pointer where the number of blocks in the chunk will be returned.
+ *
+ * @warning A new buffer is allocated, and the user should free it after use.
+ *
+ * @return The number of blocks that may have items in the range, so that the whole chunk can be
+ * skipped if it is 0.  Else a negative code is returned.
+ */
+BLOSC_EXPORT int blosc2_schunk_zonemap_maskout(blosc2_schunk *schunk, int nchunk,
+                                               blosc2_zonemap_value low, blosc2_zonemap_value high,
+                                               bool **maskout, int32_t *nblocks);
+
+/**
+ * @brief Find the items of a super-chunk that match a predicate.
+ *
+ * The predicate is evaluated on every decompressed block by the decompression threads, so the
+ * super-chunk is never decompressed as a whole.  The chunks and blocks that cannot match as per
+ * their zone maps (if they are kept for the type of the predicate) are neither decompressed nor
+ * read.  Null (NaN) items never match.
+ *
+ * The blocks of chunks that use the delta filter refer to the first one, so these chunks are
+ * decompressed as a whole (by the decompression threads) before evaluating the predicate on
+ * their blocks, and the callback is always called from thread 0 for them.
+ *
+ * @param schunk The super-chunk.  Its typesize must be the size of the type of the predicate.
+ * @param predicate The predicate.
+ * @param callback The function that receives the matches of each block.  It can be NULL for
+ * just counting the matches.
+ * @param user_data The data to be passed to @p callback.
+ *
+ * @return The number of items that match the predicate.  Else a negative code is returned.
+ */
+BLOSC_EXPORT int64_t blosc2_schunk_scan(blosc2_schunk *schunk, const blosc2_predicate *predicate,
+                                        blosc2_scan_fn callback, void *user_data);
+
+/**
+ * @brief Reduce the items of a super-chunk to a single value.
+ *
+ * Every decompressed block is reduced by the decompression threads into their own accumulators,
+ * so the super-chunk is never decompressed as a whole.  The minimum, maximum and count of the
+ * chunks are taken from their zone maps (if they are kept for @p type) without decompressing
+ * them.  Null (NaN) items are ignored.
+ *
+ * The blocks of chunks that use the delta filter refer to the first one, so these chunks are
+ * decompressed as a whole (by the decompression threads) before reducing their blocks.
+ *
+ * @param schunk The super-chunk.  Its typesize must be the size of @p type.
+ * @param op The operation (one of BLOSC2_REDUCE_*).
+ * @param type The type of the items (one of the BLOSC2_ZONEMAP_* types, except
+ * BLOSC2_ZONEMAP_NONE).
+ * @param result The pointer where the result will be returned.  It is an integer (the sum wraps
+ * around on overflow) or a double as per @p type, except for BLOSC2_REDUCE_COUNT, which is always
+ * an integer.  The minimum and maximum of no items are the highest and lowest values of the
+ * result type (infinities for floating point types).
+ *
+ * @return The number of (non-null) items that have been reduced.  Else a negative code is
+ * returned.
+ */
+BLOSC_EXPORT int64_t blosc2_schunk_reduce(blosc2_schunk *schunk, uint8_t op, uint8_t type,
+                                          blosc2_zonemap_value *result);
+
 
 /*********************************************************************
   Functions related with metalayers.
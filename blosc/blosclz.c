@@ -14,6 +14,7 @@
 
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include "blosclz.h"
 #include "fastcopy.h"
@@ -506,8 +507,55 @@ static int get_csize(uint8_t* ibase, int maxlen, bool force_3b_shift) {
 }
 
 
+/* A dictionary digested for compression */
+typedef struct {
+  const uint8_t* dict;
+  uint32_t dict_size;
+  uint8_t hashlog;
+  uint32_t htab[1U << HASH_LOG];
+} blosclz_cdict;
+
+
+static uint8_t get_hashlog(int clevel) {
+  uint8_t hashlog_[10] = {0, HASH_LOG - 2, HASH_LOG - 1, HASH_LOG, HASH_LOG,
+                          HASH_LOG, HASH_LOG, HASH_LOG, HASH_LOG, HASH_LOG};
+  return hashlog_[clevel];
+}
+
+
+void* blosclz_create_cdict(int clevel, const void* dict, int dict_size) {
+  if (clevel < 1 || clevel > 9 || dict_size < 16 || dict_size > BLOSCLZ_MAX_DICT_SIZE) {
+    return NULL;
+  }
+  blosclz_cdict* cdict = malloc(sizeof(blosclz_cdict));
+  if (cdict == NULL) {
+    return NULL;
+  }
+  cdict->dict = (const uint8_t*)dict;
+  cdict->dict_size = (uint32_t)dict_size;
+  cdict->hashlog = get_hashlog(clevel);
+  memset(cdict->htab, 0, sizeof(uint32_t) << cdict->hashlog);
+
+  // The positions of the dictionary come before the ones of the input
+  uint32_t hval;
+  uint32_t seq;
+  for (uint32_t i = 0; i + 4 <= cdict->dict_size; i++) {
+    seq = BLOSCLZ_READU32(cdict->dict + i);
+    HASH_FUNCTION(hval, seq, cdict->hashlog)
+    cdict->htab[hval] = i;
+  }
+  return cdict;
+}
+
+
+void blosclz_free_cdict(void* cdict) {
+  free(cdict);
+}
+
+
 int blosclz_compress(const int clevel, const void* input, int length,
-                     void* output, int maxout) {
+                     void* output, int maxout, const void* cdict_) {
+  const blosclz_cdict* cdict = (const blosclz_cdict*)cdict_;
   uint8_t* ibase = (uint8_t*)input;
   uint8_t* ip = ibase;
   uint8_t* ip_bound = ibase + length - 1;
@@ -527,12 +575,20 @@ int blosclz_compress(const int clevel, const void* input, int length,
   // Minimum compression ratios for initiate encoding
   double cratio_[10] = {0, 2, 2, 2, 2, 1.8, 1.6, 1.4, 1.2, 1.1};
 
-  uint8_t hashlog_[10] = {0, HASH_LOG - 2, HASH_LOG - 1, HASH_LOG, HASH_LOG,
-                          HASH_LOG, HASH_LOG, HASH_LOG, HASH_LOG, HASH_LOG};
-  uint8_t hashlog = hashlog_[clevel];
-  // Initialize the hash table to distances of 0
-  for (unsigned i = 0; i < (1U << hashlog); i++) {
-    htab[i] = 0;
+  uint8_t hashlog = get_hashlog(clevel);
+  // With a dictionary, the input logically follows it, so positions are shifted by its size
+  const uint8_t* dict = NULL;
+  uint32_t dict_size = 0;
+  if (cdict != NULL && cdict->hashlog == hashlog) {
+    dict = cdict->dict;
+    dict_size = cdict->dict_size;
+    memcpy(htab, cdict->htab, sizeof(uint32_t) << hashlog);
+  }
+  else {
+    // Initialize the hash table to distances of 0
+    for (unsigned i = 0; i < (1U << hashlog); i++) {
+      htab[i] = 0;
+    }
   }
 
   /* input and output buffer cannot be less than 16 and 66 bytes or we can get into trouble */
@@ -554,7 +610,8 @@ int blosclz_compress(const int clevel, const void* input, int length,
   int csize_3b;
   int csize_4b;
   double cratio = 0;
-  switch (clevel) {
+  // The probes do not see the dictionary, so they would discard blocks that compress well with it
+  switch (dict == NULL ? clevel : 0) {
     case 1:
     case 2:
     case 3:
@@ -583,7 +640,7 @@ int blosclz_compress(const int clevel, const void* input, int length,
       break;
   }
   // discard probes with small compression ratios (too expensive)
-  if (cratio < cratio_ [clevel]) {
+  if (dict == NULL && cratio < cratio_ [clevel]) {
     goto out;
   }
 
@@ -598,19 +655,30 @@ int blosclz_compress(const int clevel, const void* input, int length,
   /* main loop */
   while (BLOSCLZ_LIKELY(ip < ip_limit)) {
     const uint8_t* ref;
+    uint8_t* match_bound = ip_bound;
     unsigned distance;
     uint8_t* anchor = ip;    /* comparison starting-point */
+    uint32_t pos = dict_size + (uint32_t)(anchor - ibase);
 
     /* find potential match */
     seq = BLOSCLZ_READU32(ip);
     HASH_FUNCTION(hval, seq, hashlog)
-    ref = ibase + htab[hval];
+    if (BLOSCLZ_LIKELY(htab[hval] >= dict_size)) {
+      ref = ibase + (htab[hval] - dict_size);
+    }
+    else {
+      // The match is in the dictionary, and it cannot go past its end
+      ref = dict + htab[hval];
+      if (ip + (dict + dict_size - ref) < ip_bound) {
+        match_bound = ip + (dict + dict_size - ref);
+      }
+    }
 
     /* calculate distance to the match */
-    distance = anchor - ref;
+    distance = pos - htab[hval];
 
     /* update hash table */
-    htab[hval] = (uint32_t) (anchor - ibase);
+    htab[hval] = pos;
 
     if (distance == 0 || (distance >= MAX_FARDISTANCE)) {
       LITERAL(ip, op, op_limit, anchor, copy)
@@ -633,7 +701,7 @@ int blosclz_compress(const int clevel, const void* input, int length,
     distance--;
 
     /* get runs or matches; zero distance means a run */
-    ip = get_run_or_match(ip, ip_bound, ref, !distance);
+    ip = get_run_or_match(ip, match_bound, ref, !distance);
 
     /* length is biased, '1' means a match of 3 bytes */
     ip -= ipshift;
@@ -679,10 +747,10 @@ int blosclz_compress(const int clevel, const void* input, int length,
     /* update the hash at match boundary */
     seq = BLOSCLZ_READU32(ip);
     HASH_FUNCTION(hval, seq, hashlog)
-    htab[hval] = (uint32_t) (ip++ - ibase);
+    htab[hval] = dict_size + (uint32_t) (ip++ - ibase);
     seq >>= 8U;
     HASH_FUNCTION(hval, seq, hashlog)
-    htab[hval] = (uint32_t) (ip++ - ibase);
+    htab[hval] = dict_size + (uint32_t) (ip++ - ibase);
     /* assuming literal copy */
 
     if (BLOSCLZ_UNLIKELY(op + 1 > op_limit))
@@ -780,7 +848,8 @@ static inline void wild_copy(uint8_t *out, const uint8_t* from, uint8_t* end) {
   do { memcpy(d,s,8); d+=8; s+=8; } while (d<e);
 }
 
-int blosclz_decompress(const void* input, int length, void* output, int maxout) {
+int blosclz_decompress(const void* input, int length, void* output, int maxout,
+                       const void* dict, int dict_size) {
   const uint8_t* ip = (const uint8_t*)input;
   const uint8_t* ip_limit = ip + length;
   uint8_t* op = (uint8_t*)output;
@@ -834,7 +903,22 @@ int blosclz_decompress(const void* input, int length, void* output, int maxout)
       }
 
       if (BLOSCLZ_UNLIKELY(ref - 1 < (uint8_t*)output)) {
-        return 0;
+        // The match starts in the dictionary, which logically precedes the output
+        int32_t dict_distance = (int32_t)((uint8_t*)output - (ref - 1));
+        if (dict == NULL || dict_distance > dict_size) {
+          return 0;
+        }
+        if (BLOSCLZ_UNLIKELY(ip >= ip_limit)) break;
+        ctrl = *ip++;
+
+        int32_t dict_len = (len < dict_distance) ? len : dict_distance;
+        memcpy(op, (const uint8_t*)dict + dict_size - dict_distance, (size_t)dict_len);
+        op += dict_len;
+        if (len > dict_len) {
+          // ...and it goes on with the start of the output
+          op = copy_match(op, (uint8_t*)output, (unsigned)(len - dict_len));
+        }
+        continue;
       }
 
       if (BLOSCLZ_UNLIKELY(ip >= ip_limit)) break;
@@ -22,6 +22,9 @@ extern "C" {
 
 #define BLOSCLZ_VERSION_STRING "2.3.0"
 
+/* The maximum size of dictionaries (larger ones would be out of the reach of matches) */
+#define BLOSCLZ_MAX_DICT_SIZE (64 * 1024)
+
 
 /**
   Compress a block of data in the input buffer and returns the size of
@@ -40,11 +43,15 @@ extern "C" {
   internal hash is updated at full rate.  A value < 1 is not allowed
   and will be silently set to 1.
 
+  If cdict is not NULL, the input is compressed as if it was preceded
+  by the dictionary in cdict (see blosclz_create_cdict()), so it can
+  only be decompressed with the same dictionary.
+
   The input buffer and the output buffer can not overlap.
 */
 
 int blosclz_compress(int opt_level, const void* input, int length,
-                     void* output, int maxout);
+                     void* output, int maxout, const void* cdict);
 
 /**
   Decompress a block of compressed data and returns the size of the
@@ -56,9 +63,29 @@ int blosclz_compress(int opt_level, const void* input, int length,
 
   Decompression is memory safe and guaranteed not to write the output buffer
   more than what is specified in maxout.
+
+  The dictionary (dict_size bytes at dict) must be the one used for
+  compressing the block, or NULL if none was used.
+ */
+
+int blosclz_decompress(const void* input, int length, void* output, int maxout,
+                       const void* dict, int dict_size);
+
+/**
+  Digest a dictionary (up to BLOSCLZ_MAX_DICT_SIZE bytes) for compressing
+  with blosclz_compress() at clevel.  The dictionary is not copied, so it
+  must be kept unchanged while the digested form is used.
+
+  Returns NULL if the dictionary cannot be used.
+ */
+
+void* blosclz_create_cdict(int clevel, const void* dict, int dict_size);
+
+/**
+  Free a dictionary digested with blosclz_create_cdict().
  */
 
-int blosclz_decompress(const void* input, int length, void* output, int maxout);
+void blosclz_free_cdict(void* cdict);
 
 #if defined (__cplusplus)
 }
@@ -29,6 +29,8 @@ static bool is_HCR(blosc2_context * context) {
       return true;
     case BLOSC_ZSTD :
       return true;
+    case BLOSC_NDLZ :
+      return false;
     default :
       BLOSC_TRACE_ERROR("Error in is_COMP_HCR: codec %d not handled.",
               context->compcode);
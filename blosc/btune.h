@@ -37,6 +37,10 @@ static int split_block(blosc2_context* context, int32_t typesize,
   // Normally all the compressors designed for speed benefit from a split.
   int compcode = context->compcode;
   bool shuffle = context->filter_flags & BLOSC_DOSHUFFLE;
+  // Blocks compressed with dicts are never split (see blosc_d)
+  if (context->use_dict) {
+    return 0;
+  }
   return (
     // fast codecs like blosclz prefer to split with shuffle
     ((compcode == BLOSC_BLOSCLZ && shuffle) ||
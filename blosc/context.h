@@ -24,6 +24,11 @@
 
 #include "blosc2.h"
 
+#if defined(HAVE_LZ4)
+  #include "lz4.h"
+  #include "lz4hc.h"
+#endif /*  HAVE_LZ4 */
+
 #if defined(HAVE_ZSTD)
   #include "zstd.h"
 #endif /*  HAVE_ZSTD */
@@ -32,6 +37,22 @@
   #include <ipps.h>
 #endif /* HAVE_IPP */
 
+/* A scattered (or strided) destination for decompression */
+struct scattered_dest {
+  const blosc2_iov* iov;
+  /* The pieces (NULL for a strided destination) */
+  int32_t* starts;
+  /* The first byte of the chunk in each piece, plus the total length at the end */
+  int niov;
+  /* The number of pieces in iov */
+  uint8_t* base;
+  /* The start of the first piece of a strided destination */
+  int32_t size;
+  /* The size of the pieces of a strided destination */
+  int64_t stride;
+  /* The distance between the starts of the pieces of a strided destination */
+};
+
 struct blosc2_context_s {
   const uint8_t* src;
   /* The source buffer */
@@ -49,6 +70,8 @@ struct blosc2_context_s {
   /* Extra bytes at end of buffer */
   int32_t blocksize;
   /* Length of the block in bytes */
+  int32_t user_blocksize;
+  /* The blocksize requested for compression (0 means automatic) */
   int32_t output_bytes;
   /* Counter for the number of input bytes */
   int32_t srcsize;
@@ -73,6 +96,8 @@ struct blosc2_context_s {
   /* The dictionary in digested form for compression */
   void* dict_ddict;
   /* The dictionary in digested form for decompression */
+  uint32_t dict_id;
+  /* The ID of the super-chunk dict in digested form (0 if it is not the one digested) */
   uint8_t filter_flags;
   /* The filter flags in the filter pipeline */
   uint8_t filters[BLOSC2_MAX_FILTERS];
@@ -83,12 +108,35 @@ struct blosc2_context_s {
   /* prefilter function */
   blosc2_prefilter_params *pparams;
   /* prefilter params */
+  blosc2_postfilter_fn postfilter;
+  /* postfilter function */
+  blosc2_postfilter_params *postparams;
+  /* postfilter params */
+  uint8_t zonemap_type;
+  /* The type of the items for the zone maps of the blocks (BLOSC2_ZONEMAP_NONE for none) */
+  blosc2_zonemap* zonemaps;
+  /* The zone maps of the blocks of the last compressed buffer */
+  int32_t zonemaps_len;
+  /* The number of items allocated in zonemaps */
+  int8_t ndim;
+  /* The number of dimensions of the blocks (0 for plain sequences of items) */
+  int32_t blockshape[BLOSC2_MAX_DIM];
+  /* The shape of the blocks (only the first ndim items are meaningful) */
   bool* block_maskout;
   /* The blocks that are not meant to be decompressed.
    * If NULL (default), all blocks in a chunk should be read. */
   int block_maskout_nitems;
   /* The number of items in block_maskout array (must match
    * the number of blocks in chunk) */
+  int32_t getitem_start;
+  /* The first byte of the chunk that goes to dest in a parallel getitem */
+  int32_t getitem_stop;
+  /* The byte after the last one that goes to dest in a parallel getitem.
+   * If 0 (default), whole chunks are decompressed. */
+  struct scattered_dest* scattered;
+  /* The scattered destination for decompression (NULL for a contiguous one) */
+  bool lazy_blocks_read;
+  /* Whether the blocks of a lazy chunk that are needed have been read from disk already */
   blosc2_schunk* schunk;
   /* Associated super-chunk (if available) */
   struct thread_context* serial_context;
@@ -134,6 +182,11 @@ struct thread_context {
   uint8_t* tmp4;
   int32_t tmp_blocksize; /* the blocksize for different temporaries */
   size_t tmp_nbytes;   /* keep track of how big the temporary buffers are */
+#if defined(HAVE_LZ4)
+  /* The streams for compressing with LZ4 dicts */
+  LZ4_stream_t* lz4_cstream;
+  LZ4_streamHC_t* lz4hc_cstream;
+#endif /* HAVE_LZ4 */
 #if defined(HAVE_ZSTD)
   /* The contexts for ZSTD */
   ZSTD_CCtx* zstd_cctx;
@@ -144,5 +197,18 @@ struct thread_context {
 #endif
 };
 
+/* Set the dict shared by the chunks of a super-chunk (a no-op if it has one already) */
+void publish_schunk_dict(blosc2_schunk* schunk, const void* dict, int32_t dict_size);
+
+/* The format of a codec in the chunk header (-1 if not supported) */
+int compcode_to_compformat(int compcode, uint8_t* version);
+
+/* The blocksize and split mode that a compression context would use for `nbytes` */
+void compression_layout(const blosc2_context* context, int32_t nbytes, int32_t* blocksize,
+                        bool* split);
+
+/* Whether the blocks of a chunk are delta-encoded (so they cannot go through a postfilter) */
+bool chunk_uses_delta(const uint8_t* src, int32_t srcsize);
+
 
 #endif  /* CONTEXT_H */
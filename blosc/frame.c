@@ -7,6 +7,10 @@
   See LICENSE.txt for details about copyright and rights to use.
 **********************************************************************/
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE  // for open file description locks (F_OFD_SETLKW)
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,6 +20,26 @@
 #include "blosc-private.h"
 #include "context.h"
 #include "frame.h"
+#include "xxhash64.h"
+
+#if defined(USING_CMAKE)
+  #include "config.h"
+#endif /*  USING_CMAKE */
+
+#if !defined(_WIN32)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(HAVE_FRAME_LOCKS)
+#include <sys/file.h>
+#endif
+#if defined(HAVE_PWRITEV)
+#include <limits.h>
+#include <sys/uio.h>
+#endif
+#endif
 
 #if defined(_WIN32) && !defined(__MINGW32__)
 #include <windows.h>
@@ -37,6 +61,58 @@
 #include <stdalign.h>
 #endif
 
+// Copying the chunks of a frame with several threads only pays off for large frames
+#define FRAME_COPY_MIN_BYTES (4 * 1024 * 1024)
+// The size of the stdio buffer used when writing a frame to a file
+#define FRAME_WRITE_BUFSIZE (4 * 1024 * 1024)
+// The size of the stdio buffer used when reading several chunks out of a file frame
+#define FRAME_READ_BUFSIZE (4 * 1024 * 1024)
+// The number of chunks written to a file in a single system call
+#if defined(IOV_MAX) && IOV_MAX < 1024
+#define FRAME_IOV_BATCH IOV_MAX
+#else
+#define FRAME_IOV_BATCH 1024
+#endif
+
+// The state of the advisory lock on a file (or shared memory) frame
+typedef struct {
+  int fd;         // the descriptor that holds the lock
+  int depth;      // the nesting level of frame_lock() calls (in the thread that holds the mutex)
+  bool writable;  // whether the frame can be modified through this descriptor
+#if !defined(_WIN32)
+  pthread_mutex_t mutex;  // (recursive) excludes the other threads, which share the descriptor
+#endif
+} frame_lock_t;
+
+
+#if !defined(_WIN32)
+static frame_lock_t* new_frame_lock(int fd, bool writable) {
+  frame_lock_t* lock = malloc(sizeof(frame_lock_t));
+  lock->fd = fd;
+  lock->depth = 0;
+  lock->writable = writable;
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&lock->mutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+  return lock;
+}
+
+
+#if defined(HAVE_FRAME_LOCKS)
+// Protects the creation of the locks of file frames, which is done on their first use
+static pthread_mutex_t new_lock_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+
+static void free_frame_lock(frame_lock_t* lock) {
+  close(lock->fd);
+  pthread_mutex_destroy(&lock->mutex);
+  free(lock);
+}
+#endif
+
 
 // big <-> little-endian and store it in a memory position.  Sizes supported: 1, 2, 4, 8 bytes.
 void swap_store(void *dest, const void *pa, int size) {
@@ -93,7 +169,14 @@ blosc2_frame* blosc2_frame_new(const char* fname) {
 int blosc2_frame_free(blosc2_frame *frame) {
 
   if (frame->sdata != NULL) {
-    free(frame->sdata);
+    if (frame->shm) {
+#if !defined(_WIN32)
+      munmap(frame->sdata, (size_t)frame->maxlen);
+#endif
+    }
+    else {
+      free(frame->sdata);
+    }
   }
 
   if (frame->coffsets != NULL) {
@@ -104,22 +187,72 @@ int blosc2_frame_free(blosc2_frame *frame) {
     free(frame->fname);
   }
 
+  if (frame->lock != NULL) {
+#if !defined(_WIN32)
+    free_frame_lock(frame->lock);
+#else
+    free(frame->lock);
+#endif
+  }
+
   free(frame);
 
   return 0;
 }
 
 
+/* Whether the header of an existing frame has room for the generation counter */
+static bool has_generation(blosc2_frame *frame) {
+  if (frame->len <= 0) {
+    return true;  // a brand new frame
+  }
+  uint8_t nitems = 0x90 + FRAME_HEADER_NITEMS;
+  if (frame->sdata != NULL) {
+    nitems = frame->sdata[0];
+  }
+  else {
+    FILE* fp = fopen(frame->fname, "rb");
+    if (fp != NULL) {
+      size_t rbytes = fread(&nitems, 1, 1, fp);
+      (void) rbytes;
+      fclose(fp);
+    }
+  }
+  return nitems != 0x90 + FRAME_HEADER_NITEMS_NOGEN;
+}
+
+
+/* Where the metalayers section starts in `header` */
+static int32_t get_metalayers_offset(const uint8_t *header) {
+  if (header[0] == 0x90 + FRAME_HEADER_NITEMS_NOGEN) {
+    return FRAME_GENERATION;
+  }
+  return FRAME_METALAYERS;
+}
+
+
+/* The generation counter in `header` (0 for frames that do not have one) */
+static uint32_t get_generation(const uint8_t *header) {
+  uint32_t generation = 0;
+  if (header[0] != 0x90 + FRAME_HEADER_NITEMS_NOGEN) {
+    swap_store(&generation, header + FRAME_GENERATION + 1, sizeof(generation));
+  }
+  return generation;
+}
+
+
 void *new_header_frame(blosc2_schunk *schunk, blosc2_frame *frame) {
   if (frame == NULL) {
     return NULL;
   }
   uint8_t* h2 = calloc(FRAME_HEADER_MINLEN, 1);
   uint8_t* h2p = h2;
+  // Frames coming from previous versions are kept without a generation counter
+  bool generation = has_generation(frame);
 
   // The msgpack header starts here
   *h2p = 0x90;  // fixarray...
-  *h2p += 13;   // ...with 13 elements
+  *h2p += generation ? FRAME_HEADER_NITEMS : FRAME_HEADER_NITEMS_NOGEN;
   h2p += 1;
 
   // Magic number
@@ -163,7 +296,9 @@ void *new_header_frame(blosc2_schunk *schunk, blosc2_frame *frame) {
     return NULL;
   }
 
-  // Reserved flags
+  // Other flags
+  *h2p = (schunk->checksums != NULL) ? (uint8_t)FRAME_HAS_CHECKSUMS : (uint8_t)0;
+  *h2p |= (uint8_t)(schunk_zonemap_type(schunk) << FRAME_ZONEMAP_TYPE_SHIFT);
   h2p += 1;
   if (h2p - h2 >= FRAME_HEADER_MINLEN) {
     return NULL;
@@ -271,11 +406,22 @@ void *new_header_frame(blosc2_schunk *schunk, blosc2_frame *frame) {
   *h2p = (uint8_t)nfilters;
   h2p += 1;
   h2p += 16;
-  if (h2p - h2 != FRAME_HEADER_MINLEN) {
+  if (h2p - h2 != FRAME_GENERATION) {
     return NULL;
   }
 
-  int32_t hsize = FRAME_HEADER_MINLEN;
+  // The generation counter
+  if (generation) {
+    *h2p = 0xce;  // uint32
+    h2p += 1;
+    swap_store(h2p, &frame->generation, sizeof(frame->generation));
+    h2p += 4;
+    if (h2p - h2 != FRAME_HEADER_MINLEN) {
+      return NULL;
+    }
+  }
+
+  int32_t hsize = (int32_t)(h2p - h2);
 
   // Now, deal with metalayers
   int16_t nmetalayers = schunk->nmetalayers;
@@ -332,7 +478,7 @@ void *new_header_frame(blosc2_schunk *schunk, blosc2_frame *frame) {
     return NULL;
   }
   uint16_t map_size = (uint16_t) (hsize2 - hsize);
-  swap_store(h2 + FRAME_IDX_SIZE, &map_size, sizeof(map_size));
+  swap_store(h2 + get_metalayers_offset(h2) + 2, &map_size, sizeof(map_size));
 
   // Make space for an (empty) array
   hsize = (int32_t)(h2p - h2);
@@ -376,6 +522,9 @@ void *new_header_frame(blosc2_schunk *schunk, blosc2_frame *frame) {
 }
 
 
+uint8_t* get_coffsets(blosc2_frame *frame, int32_t header_len, int64_t cbytes, int32_t *off_cbytes);
+
+
 int get_header_info(blosc2_frame *frame, int32_t *header_len, int64_t *frame_len, int64_t *nbytes,
                     int64_t *cbytes, int32_t *chunksize, int32_t *nchunks, int32_t *typesize,
                     uint8_t *compcode, uint8_t *clevel, uint8_t *filters, uint8_t *filters_meta) {
@@ -443,6 +592,13 @@ int get_header_info(blosc2_frame *frame, int32_t *header_len, int64_t *frame_len
       }
       *nchunks += 1;
     }
+  } else if (*nbytes > 0 && *chunksize == 0) {
+    // With variable-length chunks, the offsets chunk is the one that knows how many there are
+    uint8_t* coffsets = get_coffsets(frame, *header_len, *cbytes, NULL);
+    if (coffsets == NULL) {
+      return -1;
+    }
+    *nchunks = sw32_(coffsets + BLOSC2_CHUNK_NBYTES) / (int32_t)sizeof(int64_t);
   } else {
     *nchunks = 0;
   }
@@ -461,6 +617,26 @@ int64_t get_trailer_offset(blosc2_frame *frame, int32_t header_len, int64_t cbyt
 }
 
 
+/* Make room for `len` bytes in an in-memory frame.  Frames with a maximum length (like the ones
+ * in shared memory, which cannot be moved) can only grow up to it.  Return NULL on failure;
+ * the frame is left untouched in this case. */
+static uint8_t* resize_sdata(blosc2_frame* frame, int64_t len) {
+  if (frame->maxlen > 0 && len > frame->maxlen) {
+    BLOSC_TRACE_ERROR("The frame cannot grow beyond its maximum length (%lld > %lld bytes).",
+                      (long long)len, (long long)frame->maxlen);
+    return NULL;
+  }
+  if (frame->shm) {
+    return frame->sdata;
+  }
+  uint8_t* sdata = realloc(frame->sdata, (size_t)len);
+  if (sdata == NULL) {
+    BLOSC_TRACE_ERROR("Cannot realloc space for the frame.");
+  }
+  return sdata;
+}
+
+
 // Update the length in the header
 int update_frame_len(blosc2_frame* frame, int64_t len) {
   int rc = 1;
@@ -483,16 +659,45 @@ int update_frame_len(blosc2_frame* frame, int64_t len) {
 }
 
 
+// The length of the trailer for a super-chunk (the dict shared by its chunks is optional)
+/* The fingerprint of a frame: the XXH64 of the checksums of its chunks, serialized as
+ * little-endian so that it does not depend on the machine that computes it. */
+static uint64_t get_fingerprint(blosc2_schunk* schunk) {
+  size_t nbytes = (size_t)schunk->nchunks * sizeof(uint64_t);
+  if (is_little_endian()) {
+    return xxh64(schunk->checksums, nbytes, 0);
+  }
+  uint8_t* checksums = malloc(nbytes);
+  for (int32_t nchunk = 0; nchunk < schunk->nchunks; nchunk++) {
+    for (int i = 0; i < (int)sizeof(uint64_t); i++) {
+      checksums[nchunk * sizeof(uint64_t) + i] = (uint8_t)(schunk->checksums[nchunk] >> (8 * i));
+    }
+  }
+  uint64_t fingerprint = xxh64(checksums, nbytes, 0);
+  free(checksums);
+  return fingerprint;
+}
+
+
+static uint32_t get_trailer_len(blosc2_schunk* schunk) {
+  uint32_t trailer_len = FRAME_TRAILER_MINLEN + schunk->usermeta_len;
+  if (schunk->dict != NULL) {
+    trailer_len += 1 + 4 + schunk->dict_size;
+  }
+  return trailer_len;
+}
+
+
 int frame_update_trailer(blosc2_frame* frame, blosc2_schunk* schunk) {
   if (frame->len == 0) {
   BLOSC_TRACE_ERROR("The trailer cannot be updated on empty frames.");
   }
 
   // Create the trailer in msgpack (see the frame format document)
-  uint32_t trailer_len = FRAME_TRAILER_MINLEN + schunk->usermeta_len;
+  uint32_t trailer_len = get_trailer_len(schunk);
   uint8_t* trailer = (uint8_t*)calloc((size_t)trailer_len, 1);
   uint8_t* ptrailer = trailer;
-  *ptrailer = 0x90 + 4;  // fixarray with 4 elements
+  *ptrailer = 0x90 + ((schunk->dict != NULL) ? 5 : 4);  // fixarray with 4 (or 5) elements
   ptrailer += 1;
   // Trailer format version
   *ptrailer = FRAME_TRAILER_VERSION;
@@ -505,19 +710,36 @@ int frame_update_trailer(blosc2_frame* frame, blosc2_schunk* schunk) {
   if (schunk->usermeta_len > 0)
     memcpy(ptrailer, schunk->usermeta, schunk->usermeta_len);
   ptrailer += schunk->usermeta_len;
+  // The dict shared by the chunks (if any)
+  if (schunk->dict != NULL) {
+    *ptrailer = 0xc6;     // bin32
+    ptrailer += 1;
+    swap_store(ptrailer, &(schunk->dict_size), 4);
+    ptrailer += 4;
+    memcpy(ptrailer, schunk->dict, schunk->dict_size);
+    ptrailer += schunk->dict_size;
+  }
   // Trailer length
   *ptrailer = 0xce;  // uint32
   ptrailer += 1;
   swap_store(ptrailer, &(trailer_len), sizeof(uint32_t));
   ptrailer += sizeof(uint32_t);
-  // Up to 16 bytes for frame fingerprint (using XXH3 included in https://github.com/Cyan4973/xxHash)
+  // Up to 16 bytes for frame fingerprint (using the XXH64 from https://github.com/Cyan4973/xxHash)
   // Maybe someone would need 256-bit in the future, but for the time being 128-bit seems like a good tradeoff
   *ptrailer = 0xd8;  // fixext 16
   ptrailer += 1;
-  *ptrailer = 0;  // fingerprint type: 0 -> no fp; 1 -> 32-bit; 2 -> 64-bit; 3 -> 128-bit
-  ptrailer += 1;
-  // Uncomment this when we compute an actual fingerprint
-  // memcpy(ptrailer, xxh3_fingerprint, sizeof(xxh3_fingerprint));
+  // fingerprint type: 0 -> no fp; 1 -> 32-bit; 2 -> 64-bit; 3 -> 128-bit
+  if (schunk->checksums != NULL) {
+    *ptrailer = FRAME_FP_XXH64;
+    ptrailer += 1;
+    // The fingerprint is the XXH64 of the chunk checksums (padded to the left)
+    uint64_t fingerprint = get_fingerprint(schunk);
+    swap_store(ptrailer + 16 - sizeof(fingerprint), &fingerprint, sizeof(fingerprint));
+  }
+  else {
+    *ptrailer = 0;
+    ptrailer += 1;
+  }
   ptrailer += 16;
   // Sanity check
   if (ptrailer - trailer != trailer_len) {
@@ -543,11 +765,12 @@ int frame_update_trailer(blosc2_frame* frame, blosc2_schunk* schunk) {
   // and it is always at the end of the frame, we can just write (or overwrite) it
   // at the end of the frame.
   if (frame->sdata != NULL) {
-    frame->sdata = realloc(frame->sdata, (size_t)(trailer_offset + trailer_len));
-    if (frame->sdata == NULL) {
-      BLOSC_TRACE_ERROR("Cannot realloc space for the frame.");
+    uint8_t* sdata = resize_sdata(frame, trailer_offset + trailer_len);
+    if (sdata == NULL) {
+      free(trailer);
       return -1;
     }
+    frame->sdata = sdata;
     memcpy(frame->sdata + trailer_offset, trailer, trailer_len);
   }
   else {
@@ -573,11 +796,248 @@ int frame_update_trailer(blosc2_frame* frame, blosc2_schunk* schunk) {
 }
 
 
+/* Get the chunk with the (compressed) checksums of the first `nchunks` chunks, followed by the
+ * chunk with their (compressed) zone maps.  Return their size, or 0 if the super-chunk keeps
+ * neither checksums nor zone maps. */
+int32_t get_checksums_chunk(blosc2_schunk* schunk, int32_t nchunks, uint8_t** chk_chunk) {
+  *chk_chunk = NULL;
+  if (nchunks == 0) {
+    return 0;
+  }
+
+  int32_t chk_nbytes = 0;
+  if (schunk->checksums != NULL) {
+    chk_nbytes = nchunks * (int32_t)sizeof(uint64_t);
+  }
+  uint8_t* zm_buffer = NULL;
+  int32_t zm_nbytes = 0;
+  if (schunk->zonemaps != NULL) {
+    zm_nbytes = schunk_zonemaps_to_buffer(schunk, nchunks, &zm_buffer);
+    if (zm_nbytes < 0) {
+      return zm_nbytes;
+    }
+  }
+  if (chk_nbytes == 0 && zm_nbytes == 0) {
+    return 0;
+  }
+
+  *chk_chunk = malloc((size_t)chk_nbytes + (size_t)zm_nbytes + 2 * BLOSC_MAX_OVERHEAD);
+  blosc2_context* cctx = blosc2_create_cctx(BLOSC2_CPARAMS_DEFAULTS);
+  cctx->typesize = 8;
+  int32_t chk_cbytes = 0;
+  if (chk_nbytes > 0) {
+    chk_cbytes = blosc2_compress_ctx(cctx, schunk->checksums, chk_nbytes, *chk_chunk,
+                                     chk_nbytes + BLOSC_MAX_OVERHEAD);
+    if (chk_cbytes < 0) {
+      BLOSC_TRACE_ERROR("Cannot compress the checksums chunk.");
+    }
+  }
+  if (chk_cbytes >= 0 && zm_nbytes > 0) {
+    int32_t zm_cbytes = blosc2_compress_ctx(cctx, zm_buffer, zm_nbytes, *chk_chunk + chk_cbytes,
+                                            zm_nbytes + BLOSC_MAX_OVERHEAD);
+    if (zm_cbytes < 0) {
+      BLOSC_TRACE_ERROR("Cannot compress the zone maps chunk.");
+      chk_cbytes = zm_cbytes;
+    }
+    else {
+      chk_cbytes += zm_cbytes;
+    }
+  }
+  blosc2_free_ctx(cctx);
+  free(zm_buffer);
+  if (chk_cbytes < 0) {
+    free(*chk_chunk);
+    *chk_chunk = NULL;
+  }
+  return chk_cbytes;
+}
+
+
+// A range of chunks to be copied into an in-memory frame
+typedef struct {
+  blosc2_schunk* schunk;
+  const uint64_t* offsets;
+  uint8_t* dest;
+  int start;
+  int stop;
+} copy_chunks_job;
+
+
+static void* copy_chunks_worker(void* arg) {
+  copy_chunks_job* job = arg;
+  for (int i = job->start; i < job->stop; i++) {
+    uint8_t* data_chunk = job->schunk->data[i];
+    int32_t chunk_cbytes = sw32_(data_chunk + BLOSC2_CHUNK_CBYTES);
+    memcpy(job->dest + job->offsets[i], data_chunk, (size_t)chunk_cbytes);
+  }
+  return NULL;
+}
+
+
+/* Copy the data chunks of a super-chunk to their (already computed) offsets in `dest`.  Large
+ * frames are split in ranges of chunks of about the same size in bytes, and these are copied
+ * by as many threads as the compression context has. */
+static void copy_chunks(blosc2_schunk* schunk, const uint64_t* offsets, uint8_t* dest) {
+  int nchunks = schunk->nchunks;
+  int64_t cbytes = schunk->cbytes;
+  int nthreads = schunk->cctx->nthreads;
+  if (nthreads > cbytes / FRAME_COPY_MIN_BYTES) {
+    nthreads = (int)(cbytes / FRAME_COPY_MIN_BYTES);
+  }
+  if (nthreads > nchunks) {
+    nthreads = nchunks;
+  }
+  if (nthreads <= 1) {
+    copy_chunks_job job = {schunk, offsets, dest, 0, nchunks};
+    copy_chunks_worker(&job);
+    return;
+  }
+
+  copy_chunks_job* jobs = malloc(nthreads * sizeof(copy_chunks_job));
+  pthread_t* threads = malloc(nthreads * sizeof(pthread_t));
+  bool* started = calloc(nthreads, sizeof(bool));
+  int start = 0;
+  for (int t = 0; t < nthreads; t++) {
+    int64_t limit = cbytes * (t + 1) / nthreads;
+    int stop = start;
+    while (stop < nchunks && (t == nthreads - 1 || (int64_t)offsets[stop] < limit)) {
+      stop++;
+    }
+    copy_chunks_job job = {schunk, offsets, dest, start, stop};
+    jobs[t] = job;
+    start = stop;
+  }
+  // The calling thread takes care of the first range
+  for (int t = 1; t < nthreads; t++) {
+    started[t] = (pthread_create(&threads[t], NULL, copy_chunks_worker, &jobs[t]) == 0);
+  }
+  copy_chunks_worker(&jobs[0]);
+  for (int t = 1; t < nthreads; t++) {
+    if (started[t]) {
+      pthread_join(threads[t], NULL);
+    }
+    else {
+      copy_chunks_worker(&jobs[t]);
+    }
+  }
+  free(started);
+  free(threads);
+  free(jobs);
+}
+
+
+#if defined(HAVE_PWRITEV)
+/* Write all the buffers in `iov` to `fd` starting at `offset`, retrying partial writes. */
+static int pwritev_all(int fd, struct iovec* iov, int niov, int64_t offset) {
+  while (niov > 0) {
+    ssize_t wbytes = pwritev(fd, iov, niov, (off_t)offset);
+    if (wbytes < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    offset += wbytes;
+    while (niov > 0 && (size_t)wbytes >= iov->iov_len) {
+      wbytes -= iov->iov_len;
+      iov++;
+      niov--;
+    }
+    if (niov > 0) {
+      iov->iov_base = (uint8_t*)iov->iov_base + wbytes;
+      iov->iov_len -= (size_t)wbytes;
+    }
+  }
+  return 0;
+}
+#endif
+
+
+/* Write the header, the data chunks, the offsets and the checksums of a frame to its file.
+ * The chunks are written in batches of FRAME_IOV_BATCH per system call where pwritev() is
+ * available, and through a large stdio buffer otherwise. */
+static int write_file_frame(blosc2_frame* frame, blosc2_schunk* schunk, const uint8_t* h2,
+                            uint32_t h2len, const uint8_t* off_chunk, int32_t off_cbytes,
+                            const uint8_t* chk_chunk, int32_t chk_cbytes) {
+  int nchunks = schunk->nchunks;
+  // Everything that goes to the file, in order
+  int nbufs = nchunks + 3;
+  const uint8_t** bufs = malloc(nbufs * sizeof(uint8_t*));
+  size_t* lens = malloc(nbufs * sizeof(size_t));
+  bufs[0] = h2;
+  lens[0] = h2len;
+  for (int i = 0; i < nchunks; i++) {
+    bufs[i + 1] = schunk->data[i];
+    lens[i + 1] = (size_t)sw32_(schunk->data[i] + BLOSC2_CHUNK_CBYTES);
+  }
+  bufs[nchunks + 1] = off_chunk;
+  lens[nchunks + 1] = (size_t)off_cbytes;
+  bufs[nchunks + 2] = chk_chunk;
+  lens[nchunks + 2] = (size_t)chk_cbytes;
+
+  int rc = 0;
+#if defined(HAVE_PWRITEV)
+  int fd = open(frame->fname, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) {
+    BLOSC_TRACE_ERROR("Cannot open '%s' for writing.", frame->fname);
+    free(bufs);
+    free(lens);
+    return -1;
+  }
+  struct iovec iov[FRAME_IOV_BATCH];
+  int niov = 0;
+  int64_t offset = 0;
+  int64_t batch_len = 0;
+  for (int i = 0; i < nbufs && rc == 0; i++) {
+    if (lens[i] > 0) {
+      iov[niov].iov_base = (void*)bufs[i];
+      iov[niov].iov_len = lens[i];
+      niov++;
+      batch_len += (int64_t)lens[i];
+    }
+    if (niov == FRAME_IOV_BATCH || (i == nbufs - 1 && niov > 0)) {
+      rc = pwritev_all(fd, iov, niov, offset);
+      offset += batch_len;
+      batch_len = 0;
+      niov = 0;
+    }
+  }
+  if (close(fd) < 0) {
+    rc = -1;
+  }
+#else
+  FILE* fp = fopen(frame->fname, "wb");
+  if (fp == NULL) {
+    BLOSC_TRACE_ERROR("Cannot open '%s' for writing.", frame->fname);
+    free(bufs);
+    free(lens);
+    return -1;
+  }
+  char* fbuf = malloc(FRAME_WRITE_BUFSIZE);
+  setvbuf(fp, fbuf, _IOFBF, FRAME_WRITE_BUFSIZE);
+  for (int i = 0; i < nbufs && rc == 0; i++) {
+    if (lens[i] > 0 && fwrite(bufs[i], 1, lens[i], fp) != lens[i]) {
+      rc = -1;
+    }
+  }
+  if (fclose(fp) != 0) {
+    rc = -1;
+  }
+  free(fbuf);
+#endif
+  if (rc < 0) {
+    BLOSC_TRACE_ERROR("Cannot write the frame to '%s'.", frame->fname);
+  }
+  free(bufs);
+  free(lens);
+  return rc;
+}
+
+
 /* Create a frame out of a super-chunk. */
 int64_t blosc2_frame_from_schunk(blosc2_schunk *schunk, blosc2_frame *frame) {
   int32_t nchunks = schunk->nchunks;
   int64_t cbytes = schunk->cbytes;
-  FILE* fp = NULL;
 
   uint8_t* h2 = new_header_frame(schunk, frame);
   if (h2 == NULL) {
@@ -587,26 +1047,21 @@ int64_t blosc2_frame_from_schunk(blosc2_schunk *schunk, blosc2_frame *frame) {
   swap_store(&h2len, h2 + FRAME_HEADER_LEN, sizeof(h2len));
 
   // Build the offsets chunk
-  int32_t chunksize = -1;
+  int32_t chunksize = schunk->chunksize;
   int32_t off_cbytes = 0;
   uint64_t coffset = 0;
   int32_t off_nbytes = nchunks * 8;
+  // The offsets are kept around for copying the chunks to their final location later on
   uint64_t* data_tmp = malloc(off_nbytes);
   for (int i = 0; i < nchunks; i++) {
     uint8_t* data_chunk = schunk->data[i];
     int32_t chunk_cbytes = sw32_(data_chunk + BLOSC2_CHUNK_CBYTES);
     data_tmp[i] = coffset;
     coffset += chunk_cbytes;
-    int32_t chunksize_ = sw32_(data_chunk + BLOSC2_CHUNK_NBYTES);
-    if (i == 0) {
-      chunksize = chunksize_;
-    }
-    else if (chunksize != chunksize_) {
-      // Variable size  // TODO: update flags for this (or do not use them at all)
-      chunksize = 0;
-    }
   }
   if ((int64_t)coffset != cbytes) {
+    free(data_tmp);
+    free(h2);
     return -1;
   }
 
@@ -621,6 +1076,7 @@ int64_t blosc2_frame_from_schunk(blosc2_schunk *schunk, blosc2_frame *frame) {
     blosc2_free_ctx(cctx);
     if (off_cbytes < 0) {
       free(off_chunk);
+      free(data_tmp);
       free(h2);
       return -1;
     }
@@ -628,52 +1084,47 @@ int64_t blosc2_frame_from_schunk(blosc2_schunk *schunk, blosc2_frame *frame) {
   else {
     off_cbytes = 0;
   }
-  free(data_tmp);
+
+  // The checksums go right after the offsets
+  uint8_t *chk_chunk = NULL;
+  int32_t chk_cbytes = get_checksums_chunk(schunk, nchunks, &chk_chunk);
+  if (chk_cbytes < 0) {
+    free(off_chunk);
+    free(data_tmp);
+    free(h2);
+    return -1;
+  }
 
   // Now that we know them, fill the chunksize and frame length in header
   swap_store(h2 + FRAME_CHUNKSIZE, &chunksize, sizeof(chunksize));
-  frame->len = h2len + cbytes + off_cbytes + FRAME_TRAILER_MINLEN + schunk->usermeta_len;
+  frame->trailer_len = get_trailer_len(schunk);
+  frame->len = h2len + cbytes + off_cbytes + chk_cbytes + frame->trailer_len;
   int64_t tbytes = frame->len;
   swap_store(h2 + FRAME_LEN, &tbytes, sizeof(tbytes));
 
-  // Create the frame and put the header at the beginning
+  // Create the frame: the header, the actual data chunks and the offsets (and checksums) chunk
+  int rc = 0;
   if (frame->fname == NULL) {
     frame->sdata = malloc((size_t)frame->len);
     memcpy(frame->sdata, h2, h2len);
-  }
-  else {
-    fp = fopen(frame->fname, "wb");
-    fwrite(h2, h2len, 1, fp);
-  }
-  free(h2);
-
-  // Fill the frame with the actual data chunks
-  coffset = 0;
-  for (int i = 0; i < nchunks; i++) {
-    uint8_t* data_chunk = schunk->data[i];
-    int32_t chunk_cbytes = sw32_(data_chunk + BLOSC2_CHUNK_CBYTES);
-    if (frame->fname == NULL) {
-      memcpy(frame->sdata + h2len + coffset, data_chunk, (size_t)chunk_cbytes);
-    } else {
-      fwrite(data_chunk, (size_t)chunk_cbytes, 1, fp);
-    }
-    coffset += chunk_cbytes;
-  }
-  if ((int64_t)coffset != cbytes) {
-    return -1;
-  }
-
-  // Copy the offsets chunk at the end of the frame
-  if (frame->fname == NULL) {
+    copy_chunks(schunk, data_tmp, frame->sdata + h2len);
     memcpy(frame->sdata + h2len + cbytes, off_chunk, off_cbytes);
+    if (chk_cbytes > 0) {
+      memcpy(frame->sdata + h2len + cbytes + off_cbytes, chk_chunk, chk_cbytes);
+    }
   }
   else {
-    fwrite(off_chunk, (size_t)off_cbytes, 1, fp);
-    fclose(fp);
+    rc = write_file_frame(frame, schunk, h2, h2len, off_chunk, off_cbytes, chk_chunk, chk_cbytes);
   }
+  free(h2);
+  free(data_tmp);
   free(off_chunk);
+  free(chk_chunk);
+  if (rc < 0) {
+    return rc;
+  }
 
-  int rc = frame_update_trailer(frame, schunk);
+  rc = frame_update_trailer(frame, schunk);
   if (rc < 0) {
     return rc;
   }
@@ -684,30 +1135,28 @@ int64_t blosc2_frame_from_schunk(blosc2_schunk *schunk, blosc2_frame *frame) {
 
 /* Create an in-memory frame out of a super-chunk */
 int64_t blosc2_schunk_to_sframe(blosc2_schunk* schunk, uint8_t** sframe) {
-  blosc2_frame* frame = NULL;
-  uint8_t* sdata = NULL;
   int64_t sdata_len = 0;
   //if ((schunk->storage->sequential == true) && (schunk->storage->path == NULL)) {
   // TODO: the above is the canonical way to check, but that does not work (??)
   if (schunk->frame != NULL && schunk->frame->sdata != NULL) {
-    sdata = schunk->frame->sdata;
+    // Get a copy of the internal sframe
     sdata_len = schunk->frame->len;
+    *sframe = malloc((size_t)sdata_len);
+    memcpy(*sframe, schunk->frame->sdata, (size_t)sdata_len);
+    return sdata_len;
   }
-  else {
-    frame = blosc2_frame_new(NULL);
-    sdata_len = blosc2_frame_from_schunk(schunk, frame);
-    if (sdata_len < 0) {
-      BLOSC_TRACE_ERROR("Error during the conversion of schunk to frame.");
-      return sdata_len;
-    }
-    sdata = frame->sdata;
-  }
-  // Get a copy of the internal sframe
-  *sframe = malloc((size_t)sdata_len);
-  memcpy(*sframe, sdata, (size_t)sdata_len);
-  if (frame != NULL) {
+
+  blosc2_frame* frame = blosc2_frame_new(NULL);
+  sdata_len = blosc2_frame_from_schunk(schunk, frame);
+  if (sdata_len < 0) {
+    BLOSC_TRACE_ERROR("Error during the conversion of schunk to frame.");
     blosc2_frame_free(frame);
+    return sdata_len;
   }
+  // The new frame is not used for anything else, so hand its buffer over without a copy
+  *sframe = frame->sdata;
+  frame->sdata = NULL;
+  blosc2_frame_free(frame);
   return sdata_len;
 }
 
@@ -726,73 +1175,114 @@ int64_t blosc2_frame_to_file(blosc2_frame *frame, const char *fname) {
 }
 
 
-/* Initialize a frame out of a file */
-blosc2_frame* blosc2_frame_from_file(const char *fname) {
-  // Get the length of the frame
+/* Read the frame length, trailer length and generation of a file frame */
+static int get_file_lengths(const char *fname, int64_t *frame_len, uint32_t *trailer_len,
+                            uint32_t *generation) {
   uint8_t header[FRAME_HEADER_MINLEN];
   uint8_t trailer[FRAME_TRAILER_MINLEN];
 
   FILE* fp = fopen(fname, "rb");
+  if (fp == NULL) {
+    BLOSC_TRACE_ERROR("Cannot open file '%s'.", fname);
+    return -1;
+  }
   size_t rbytes = fread(header, 1, FRAME_HEADER_MINLEN, fp);
   if (rbytes != FRAME_HEADER_MINLEN) {
     BLOSC_TRACE_ERROR("Cannot read from file '%s'.", fname);
     fclose(fp);
-    return NULL;
+    return -1;
   }
-  int64_t frame_len;
-  swap_store(&frame_len, header + FRAME_LEN, sizeof(frame_len));
-
-  blosc2_frame* frame = calloc(1, sizeof(blosc2_frame));
-  char* fname_cpy = malloc(strlen(fname) + 1);
-  frame->fname = strcpy(fname_cpy, fname);
-  frame->len = frame_len;
+  swap_store(frame_len, header + FRAME_LEN, sizeof(*frame_len));
+  *generation = get_generation(header);
 
   // Now, the trailer length
-  fseek(fp, frame_len - FRAME_TRAILER_MINLEN, SEEK_SET);
+  fseek(fp, *frame_len - FRAME_TRAILER_MINLEN, SEEK_SET);
   rbytes = fread(trailer, 1, FRAME_TRAILER_MINLEN, fp);
   fclose(fp);
   if (rbytes != FRAME_TRAILER_MINLEN) {
     BLOSC_TRACE_ERROR("Cannot read from file '%s'.", fname);
-    return NULL;
+    return -1;
   }
   int trailer_offset = FRAME_TRAILER_MINLEN - FRAME_TRAILER_LEN_OFFSET;
   if (trailer[trailer_offset - 1] != 0xce) {
-    return NULL;
+    return -1;
   }
+  swap_store(trailer_len, trailer + trailer_offset, sizeof(*trailer_len));
+
+  return 0;
+}
+
+
+/* Initialize a frame out of a file */
+blosc2_frame* blosc2_frame_from_file(const char *fname) {
+  int64_t frame_len;
   uint32_t trailer_len;
-  swap_store(&trailer_len, trailer + trailer_offset, sizeof(trailer_len));
+  uint32_t generation;
+  blosc2_frame* frame = calloc(1, sizeof(blosc2_frame));
+  char* fname_cpy = malloc(strlen(fname) + 1);
+  frame->fname = strcpy(fname_cpy, fname);
+
+  // Other processes may be writing the frame while we read its lengths
+  if (frame_lock(frame, false) < 0) {
+    blosc2_frame_free(frame);
+    return NULL;
+  }
+  int rc = get_file_lengths(fname, &frame_len, &trailer_len, &generation);
+  frame_unlock(frame);
+  if (rc < 0) {
+    blosc2_frame_free(frame);
+    return NULL;
+  }
+
+  frame->len = frame_len;
   frame->trailer_len = trailer_len;
+  frame->generation = generation;
 
   return frame;
 }
 
 
+/* Read the frame length, trailer length and generation of an in-memory frame that lives
+ * in a buffer of `maxlen` bytes */
+static int get_sdata_lengths(const uint8_t *sdata, int64_t maxlen, int64_t *frame_len,
+                             uint32_t *trailer_len, uint32_t *generation) {
+  if (maxlen < FRAME_HEADER_MINLEN) {
+    return -1;
+  }
+  swap_store(frame_len, sdata + FRAME_LEN, sizeof(*frame_len));
+  if (*frame_len < FRAME_HEADER_MINLEN + FRAME_TRAILER_MINLEN || *frame_len > maxlen) {
+    return -1;
+  }
+  *generation = get_generation(sdata);
+
+  // Now, the trailer length
+  const uint8_t* trailer = sdata + *frame_len - FRAME_TRAILER_MINLEN;
+  int trailer_offset = FRAME_TRAILER_MINLEN - FRAME_TRAILER_LEN_OFFSET;
+  if (trailer[trailer_offset - 1] != 0xce) {
+    return -1;
+  }
+  swap_store(trailer_len, trailer + trailer_offset, sizeof(*trailer_len));
+
+  return 0;
+}
+
+
 /* Initialize a frame out of a serialized frame */
 blosc2_frame* blosc2_frame_from_sframe(uint8_t *sframe, int64_t len, bool copy) {
-  // Get the length of the frame
-  const uint8_t* header = sframe;
   int64_t frame_len;
-  if (len < FRAME_HEADER_MINLEN) {
+  uint32_t trailer_len;
+  uint32_t generation;
+  if (get_sdata_lengths(sframe, len, &frame_len, &trailer_len, &generation) < 0) {
     return NULL;
   }
-  swap_store(&frame_len, header + FRAME_LEN, sizeof(frame_len));
   if (frame_len != len) {   // sanity check
     return NULL;
   }
 
   blosc2_frame* frame = calloc(1, sizeof(blosc2_frame));
   frame->len = frame_len;
-
-  // Now, the trailer length
-  const uint8_t* trailer = sframe + frame_len - FRAME_TRAILER_MINLEN;
-  int trailer_offset = FRAME_TRAILER_MINLEN - FRAME_TRAILER_LEN_OFFSET;
-  if (trailer[trailer_offset - 1] != 0xce) {
-    free(frame);
-    return NULL;
-  }
-  uint32_t trailer_len;
-  swap_store(&trailer_len, trailer + trailer_offset, sizeof(trailer_len));
   frame->trailer_len = trailer_len;
+  frame->generation = generation;
 
   if (copy) {
     frame->sdata = malloc((size_t)len);
@@ -809,6 +1299,9 @@ blosc2_frame* blosc2_frame_from_sframe(uint8_t *sframe, int64_t len, bool copy)
 // Get the compressed data offsets
 uint8_t* get_coffsets(blosc2_frame *frame, int32_t header_len, int64_t cbytes, int32_t *off_cbytes) {
   if (frame->coffsets != NULL) {
+    if (off_cbytes != NULL) {
+      *off_cbytes = (int32_t)(get_trailer_offset(frame, header_len, cbytes) - (header_len + cbytes));
+    }
     return frame->coffsets;
   }
 
@@ -869,6 +1362,9 @@ int frame_update_header(blosc2_frame* frame, blosc2_schunk* schunk, bool new) {
   uint32_t prev_h2len;
   swap_store(&prev_h2len, framep + FRAME_HEADER_LEN, sizeof(prev_h2len));
 
+  // Let other processes know that the frame has changed
+  frame->generation++;
+
   // Build a new header
   uint8_t* h2 = new_header_frame(schunk, frame);
   uint32_t h2len;
@@ -896,7 +1392,12 @@ int frame_update_header(blosc2_frame* frame, blosc2_schunk* schunk, bool new) {
   }
   else {
     if (new) {
-      frame->sdata = realloc(frame->sdata, h2len);
+      uint8_t* sdata = resize_sdata(frame, h2len);
+      if (sdata == NULL) {
+        free(h2);
+        return -1;
+      }
+      frame->sdata = sdata;
     }
     memcpy(frame->sdata, h2, h2len);
   }
@@ -969,10 +1470,10 @@ int32_t frame_get_usermeta(blosc2_frame* frame, uint8_t** usermeta) {
 }
 
 
-int frame_get_metalayers(blosc2_frame* frame, blosc2_schunk* schunk) {
+/* Get the dict shared by the chunks out of a frame (if any) */
+int frame_get_dict(blosc2_frame* frame, blosc2_schunk* schunk) {
   int32_t header_len;
   int64_t frame_len;
-  int64_t frame_pos = FRAME_IDX_SIZE;
   int64_t nbytes;
   int64_t cbytes;
   int32_t chunksize;
@@ -983,10 +1484,104 @@ int frame_get_metalayers(blosc2_frame* frame, blosc2_schunk* schunk) {
     BLOSC_TRACE_ERROR("Unable to get the header info from frame.");
     return -1;
   }
-
-  // Get the header
-  uint8_t* header = NULL;
-  if (frame->sdata != NULL) {
+  int64_t trailer_offset = get_trailer_offset(frame, header_len, cbytes);
+  if (trailer_offset < 0) {
+    BLOSC_TRACE_ERROR("Unable to get the trailer offset from frame.");
+    return -1;
+  }
+
+  // The trailer only has a dict when it is an array of 5 elements
+  uint8_t fixarray;
+  int32_t usermeta_len_network;
+  FILE* fp = NULL;
+  if (frame->sdata != NULL) {
+    fixarray = frame->sdata[trailer_offset];
+    memcpy(&usermeta_len_network, frame->sdata + trailer_offset + FRAME_TRAILER_USERMETA_LEN_OFFSET, sizeof(int32_t));
+  }
+  else {
+    fp = fopen(frame->fname, "rb");
+    fseek(fp, trailer_offset, SEEK_SET);
+    size_t rbytes = fread(&fixarray, 1, 1, fp);
+    fseek(fp, trailer_offset + FRAME_TRAILER_USERMETA_LEN_OFFSET, SEEK_SET);
+    rbytes += fread(&usermeta_len_network, 1, sizeof(int32_t), fp);
+    if (rbytes != 1 + sizeof(int32_t)) {
+      BLOSC_TRACE_ERROR("Cannot access the trailer out of the fileframe.");
+      fclose(fp);
+      return -1;
+    }
+  }
+  if (fixarray != 0x90 + 5) {
+    if (fp != NULL) {
+      fclose(fp);
+    }
+    return 0;
+  }
+  int32_t usermeta_len;
+  swap_store(&usermeta_len, &usermeta_len_network, sizeof(int32_t));
+
+  // The dict goes as a bin32 right after the usermeta
+  int64_t dict_offset = trailer_offset + FRAME_TRAILER_USERMETA_OFFSET + usermeta_len + 1;
+  int32_t dict_size_network;
+  if (frame->sdata != NULL) {
+    memcpy(&dict_size_network, frame->sdata + dict_offset, sizeof(int32_t));
+  }
+  else {
+    fseek(fp, dict_offset, SEEK_SET);
+    size_t rbytes = fread(&dict_size_network, 1, sizeof(int32_t), fp);
+    if (rbytes != sizeof(int32_t)) {
+      BLOSC_TRACE_ERROR("Cannot access the dict_size out of the fileframe.");
+      fclose(fp);
+      return -1;
+    }
+  }
+  int32_t dict_size;
+  swap_store(&dict_size, &dict_size_network, sizeof(int32_t));
+  if (dict_size <= 0 || dict_offset + (int64_t)sizeof(int32_t) + dict_size > frame->len) {
+    BLOSC_TRACE_ERROR("The dict in the frame trailer is corrupted.");
+    if (fp != NULL) {
+      fclose(fp);
+    }
+    return -1;
+  }
+
+  uint8_t* dict = malloc((size_t)dict_size);
+  if (frame->sdata != NULL) {
+    memcpy(dict, frame->sdata + dict_offset + sizeof(int32_t), (size_t)dict_size);
+  }
+  else {
+    size_t rbytes = fread(dict, 1, (size_t)dict_size, fp);
+    fclose(fp);
+    if (rbytes != (size_t)dict_size) {
+      BLOSC_TRACE_ERROR("Cannot read the complete dict in frame.");
+      free(dict);
+      return -1;
+    }
+  }
+  publish_schunk_dict(schunk, dict, dict_size);
+  free(dict);
+
+  return dict_size;
+}
+
+
+int frame_get_metalayers(blosc2_frame* frame, blosc2_schunk* schunk) {
+  int32_t header_len;
+  int64_t frame_len;
+  int64_t frame_pos;
+  int64_t nbytes;
+  int64_t cbytes;
+  int32_t chunksize;
+  int32_t nchunks;
+  int ret = get_header_info(frame, &header_len, &frame_len, &nbytes, &cbytes, &chunksize, &nchunks,
+                            NULL, NULL, NULL, NULL, NULL);
+  if (ret < 0) {
+    BLOSC_TRACE_ERROR("Unable to get the header info from frame.");
+    return -1;
+  }
+
+  // Get the header
+  uint8_t* header = NULL;
+  if (frame->sdata != NULL) {
     header = frame->sdata;
   } else {
     size_t rbytes = 0;
@@ -1005,14 +1600,16 @@ int frame_get_metalayers(blosc2_frame* frame, blosc2_schunk* schunk) {
 
   // Get the size for the index of metalayers
   uint16_t idx_size;
+  frame_pos = get_metalayers_offset(header) + 1 + 1;
+  int64_t idx_size_pos = frame_pos;
   frame_pos += sizeof(idx_size);
   if (frame_len < frame_pos) {
     return -1;
   }
-  swap_store(&idx_size, header + FRAME_IDX_SIZE, sizeof(idx_size));
+  swap_store(&idx_size, header + idx_size_pos, sizeof(idx_size));
 
   // Get the actual index of metalayers
-  uint8_t* metalayers_idx = header + FRAME_IDX_SIZE + 2;
+  uint8_t* metalayers_idx = header + idx_size_pos + 2;
   frame_pos += 1;
   if (frame_len < frame_pos) {
     return -1;
@@ -1105,6 +1702,183 @@ int frame_get_metalayers(blosc2_frame* frame, blosc2_schunk* schunk) {
 }
 
 
+static int get_other_flags(blosc2_frame* frame, uint8_t* other_flags) {
+  if (frame->sdata != NULL) {
+    *other_flags = frame->sdata[FRAME_OTHER_FLAGS];
+    return 0;
+  }
+  size_t rbytes = 0;
+  FILE* fp = fopen(frame->fname, "rb");
+  if (fp != NULL) {
+    fseek(fp, FRAME_OTHER_FLAGS, SEEK_SET);
+    rbytes = fread(other_flags, 1, 1, fp);
+    fclose(fp);
+  }
+  if (rbytes != 1) {
+    BLOSC_TRACE_ERROR("Cannot read the flags out of the fileframe.");
+    return -1;
+  }
+  return 0;
+}
+
+
+/* Populate the chunk checksums of a super-chunk out of a frame (if the frame has them) */
+int frame_get_checksums(blosc2_frame* frame, blosc2_schunk* schunk) {
+  int32_t header_len;
+  int64_t frame_len;
+  int64_t nbytes;
+  int64_t cbytes;
+  int32_t chunksize;
+  int32_t nchunks;
+  int ret = get_header_info(frame, &header_len, &frame_len, &nbytes, &cbytes, &chunksize, &nchunks,
+                            NULL, NULL, NULL, NULL, NULL);
+  if (ret < 0) {
+    BLOSC_TRACE_ERROR("Unable to get the header info from frame.");
+    return -1;
+  }
+
+  uint8_t other_flags;
+  if (get_other_flags(frame, &other_flags) < 0) {
+    return -1;
+  }
+  if (!(other_flags & FRAME_HAS_CHECKSUMS)) {
+    return 0;
+  }
+
+  // Always allocate, as a non-NULL pointer means that checksums are kept
+  size_t nitems = nchunks > 0 ? (size_t)nchunks : 1;
+  schunk->checksums = calloc(nitems, sizeof(uint64_t));
+  schunk->checksums_verified = calloc(nitems, sizeof(bool));
+  if (nchunks == 0) {
+    return 0;
+  }
+
+  // The checksums chunk comes right after the offsets chunk
+  uint8_t* coffsets = get_coffsets(frame, header_len, cbytes, NULL);
+  if (coffsets == NULL) {
+    BLOSC_TRACE_ERROR("Cannot get the offsets for the frame.");
+    return -2;
+  }
+  int32_t off_cbytes = sw32_(coffsets + BLOSC2_CHUNK_CBYTES);
+  uint8_t* chk_chunk = coffsets + off_cbytes;
+  int32_t chk_cbytes = sw32_(chk_chunk + BLOSC2_CHUNK_CBYTES);
+
+  blosc2_context *dctx = blosc2_create_dctx(BLOSC2_DPARAMS_DEFAULTS);
+  int32_t chk_nbytes = blosc2_decompress_ctx(dctx, chk_chunk, chk_cbytes, schunk->checksums,
+                                             nchunks * (int32_t)sizeof(uint64_t));
+  blosc2_free_ctx(dctx);
+  if (chk_nbytes != nchunks * (int32_t)sizeof(uint64_t)) {
+    BLOSC_TRACE_ERROR("Cannot decompress the checksums chunk.");
+    return -3;
+  }
+
+  return 0;
+}
+
+
+/* Populate the zone maps of a super-chunk out of a frame (if the frame has them) */
+int frame_get_zonemaps(blosc2_frame* frame, blosc2_schunk* schunk) {
+  int32_t header_len;
+  int64_t frame_len;
+  int64_t nbytes;
+  int64_t cbytes;
+  int32_t chunksize;
+  int32_t nchunks;
+  int ret = get_header_info(frame, &header_len, &frame_len, &nbytes, &cbytes, &chunksize, &nchunks,
+                            NULL, NULL, NULL, NULL, NULL);
+  if (ret < 0) {
+    BLOSC_TRACE_ERROR("Unable to get the header info from frame.");
+    return -1;
+  }
+
+  uint8_t other_flags;
+  if (get_other_flags(frame, &other_flags) < 0) {
+    return -1;
+  }
+  uint8_t type = (uint8_t)((other_flags & FRAME_ZONEMAP_TYPE_MASK) >> FRAME_ZONEMAP_TYPE_SHIFT);
+  if (type == BLOSC2_ZONEMAP_NONE) {
+    return 0;
+  }
+  // The new chunks get their zone maps computed as well
+  schunk->cctx->zonemap_type = type;
+  if (nchunks == 0) {
+    return schunk_zonemaps_from_buffer(schunk, type, 0, NULL, 0);
+  }
+
+  // The zone maps chunk comes right after the offsets chunk and the checksums chunk (if any)
+  uint8_t* coffsets = get_coffsets(frame, header_len, cbytes, NULL);
+  if (coffsets == NULL) {
+    BLOSC_TRACE_ERROR("Cannot get the offsets for the frame.");
+    return -2;
+  }
+  uint8_t* zm_chunk = coffsets + sw32_(coffsets + BLOSC2_CHUNK_CBYTES);
+  if (other_flags & FRAME_HAS_CHECKSUMS) {
+    zm_chunk += sw32_(zm_chunk + BLOSC2_CHUNK_CBYTES);
+  }
+  int32_t zm_cbytes = sw32_(zm_chunk + BLOSC2_CHUNK_CBYTES);
+  int32_t zm_nbytes = sw32_(zm_chunk + BLOSC2_CHUNK_NBYTES);
+
+  uint8_t* zm_buffer = malloc((size_t)zm_nbytes);
+  blosc2_context *dctx = blosc2_create_dctx(BLOSC2_DPARAMS_DEFAULTS);
+  int32_t rbytes = blosc2_decompress_ctx(dctx, zm_chunk, zm_cbytes, zm_buffer, zm_nbytes);
+  blosc2_free_ctx(dctx);
+  if (rbytes != zm_nbytes) {
+    BLOSC_TRACE_ERROR("Cannot decompress the zone maps chunk.");
+    free(zm_buffer);
+    return -3;
+  }
+  ret = schunk_zonemaps_from_buffer(schunk, type, nchunks, zm_buffer, zm_nbytes);
+  free(zm_buffer);
+
+  return ret;
+}
+
+
+/* Check the fingerprint in the frame trailer against the chunk checksums.
+ * Return 0 if they match, and a negative value otherwise. */
+int frame_verify_fingerprint(blosc2_frame* frame, blosc2_schunk* schunk) {
+  uint8_t fp_trailer[1 + 16];
+  if (frame->sdata != NULL) {
+    memcpy(fp_trailer, frame->sdata + frame->len - FRAME_TRAILER_FP_OFFSET, sizeof(fp_trailer));
+  }
+  else {
+    size_t rbytes = 0;
+    FILE* fp = fopen(frame->fname, "rb");
+    if (fp != NULL) {
+      fseek(fp, frame->len - FRAME_TRAILER_FP_OFFSET, SEEK_SET);
+      rbytes = fread(fp_trailer, 1, sizeof(fp_trailer), fp);
+      fclose(fp);
+    }
+    if (rbytes != sizeof(fp_trailer)) {
+      BLOSC_TRACE_ERROR("Cannot read the fingerprint out of the fileframe.");
+      return -1;
+    }
+  }
+
+  if (fp_trailer[0] != FRAME_FP_XXH64) {
+    BLOSC_TRACE_ERROR("Unsupported fingerprint type (%d).", fp_trailer[0]);
+    return -2;
+  }
+  uint64_t fingerprint;
+  swap_store(&fingerprint, fp_trailer + 1 + 16 - sizeof(fingerprint), sizeof(fingerprint));
+  uint64_t fingerprint_ = get_fingerprint(schunk);
+  if (fingerprint != fingerprint_) {
+    BLOSC_TRACE_ERROR("The fingerprint of the frame does not match its chunk checksums.");
+    return -3;
+  }
+
+  return 0;
+}
+
+
+/* Free a super-chunk whose creation out of a frame has failed after getting its data chunks.
+ * The frame itself is not freed, as it still belongs to the caller. */
+static void free_incomplete_schunk(blosc2_schunk* schunk) {
+  schunk->frame = NULL;
+  blosc2_schunk_free(schunk);
+}
+
+
 /* Get a super-chunk out of a frame */
 blosc2_schunk* blosc2_frame_to_schunk(blosc2_frame* frame, bool copy) {
   int32_t header_len;
@@ -1127,7 +1901,11 @@ blosc2_schunk* blosc2_frame_to_schunk(blosc2_frame* frame, bool copy) {
 
   // Compression and decompression contexts
   blosc2_cparams *cparams;
-  blosc2_schunk_get_cparams(schunk, &cparams);
+  if (blosc2_schunk_get_cparams(schunk, &cparams) < 0) {
+    BLOSC_TRACE_ERROR("Unable to get the cparams of the super-chunk.");
+    free(schunk);
+    return NULL;
+  }
   schunk->cctx = blosc2_create_cctx(*cparams);
   free(cparams);
   blosc2_dparams *dparams;
@@ -1243,12 +2021,12 @@ blosc2_schunk* blosc2_frame_to_schunk(blosc2_frame* frame, bool copy) {
   }
   free(offsets);
 
-  if (acc_nbytes != nbytes || acc_cbytes != cbytes) {
-    blosc2_free_ctx(schunk->cctx);
-    blosc2_free_ctx(schunk->dctx);
-    free(schunk);
+  // The frame may keep the space of chunks that have been updated, but the copy does not
+  if (acc_nbytes != nbytes || acc_cbytes > cbytes) {
+    free_incomplete_schunk(schunk);
     return NULL;
   }
+  schunk->cbytes = acc_cbytes;
 
   uint8_t* usermeta;
   int32_t usermeta_len;
@@ -1257,24 +2035,41 @@ blosc2_schunk* blosc2_frame_to_schunk(blosc2_frame* frame, bool copy) {
   out:
   rc = frame_get_metalayers(frame, schunk);
   if (rc < 0) {
-    blosc2_free_ctx(schunk->cctx);
-    blosc2_free_ctx(schunk->dctx);
-    free(schunk);
+    free_incomplete_schunk(schunk);
     BLOSC_TRACE_ERROR("Cannot access the metalayers.");
     return NULL;
   }
 
   usermeta_len = frame_get_usermeta(frame, &usermeta);
   if (usermeta_len < 0) {
-    blosc2_free_ctx(schunk->cctx);
-    blosc2_free_ctx(schunk->dctx);
-    free(schunk);
+    free_incomplete_schunk(schunk);
     BLOSC_TRACE_ERROR("Cannot access the usermeta chunk.");
     return NULL;
   }
   schunk->usermeta = usermeta;
   schunk->usermeta_len = usermeta_len;
 
+  rc = frame_get_dict(frame, schunk);
+  if (rc < 0) {
+    free_incomplete_schunk(schunk);
+    BLOSC_TRACE_ERROR("Cannot access the dict of the chunks.");
+    return NULL;
+  }
+
+  rc = frame_get_checksums(frame, schunk);
+  if (rc < 0) {
+    free_incomplete_schunk(schunk);
+    BLOSC_TRACE_ERROR("Cannot access the chunk checksums.");
+    return NULL;
+  }
+
+  rc = frame_get_zonemaps(frame, schunk);
+  if (rc < 0) {
+    free_incomplete_schunk(schunk);
+    BLOSC_TRACE_ERROR("Cannot access the zone maps.");
+    return NULL;
+  }
+
   return schunk;
 }
 
@@ -1311,6 +2106,93 @@ int64_t get_coffset(blosc2_frame* frame, int32_t header_len, int64_t cbytes, int
   return offset;
 }
 
+/* Get a decompressed copy of the chunk offsets of a frame.  The offsets are relative to the
+ * end of the header, whose length is returned in `header_len`.
+ * The caller is responsible of freeing the returned buffer.  NULL is returned in case of error. */
+int64_t* frame_get_offsets(blosc2_frame *frame, int32_t *header_len, int32_t *nchunks) {
+  int64_t frame_len;
+  int64_t nbytes;
+  int64_t cbytes;
+  int32_t chunksize;
+  int ret = get_header_info(frame, header_len, &frame_len, &nbytes, &cbytes, &chunksize, nchunks,
+                            NULL, NULL, NULL, NULL, NULL);
+  if (ret < 0) {
+    BLOSC_TRACE_ERROR("Unable to get meta info from frame.");
+    return NULL;
+  }
+
+  int64_t* offsets = (int64_t *) malloc((size_t)(*nchunks > 0 ? *nchunks : 1) * 8);
+  if (*nchunks == 0) {
+    return offsets;
+  }
+  int32_t coffsets_cbytes = 0;
+  uint8_t *coffsets = get_coffsets(frame, *header_len, cbytes, &coffsets_cbytes);
+  if (coffsets == NULL) {
+    BLOSC_TRACE_ERROR("Cannot get the offsets for the frame.");
+    free(offsets);
+    return NULL;
+  }
+  blosc2_context *dctx = blosc2_create_dctx(BLOSC2_DPARAMS_DEFAULTS);
+  int32_t off_nbytes = blosc2_decompress_ctx(dctx, coffsets, coffsets_cbytes, offsets, *nchunks * 8);
+  blosc2_free_ctx(dctx);
+  if (off_nbytes < 0) {
+    BLOSC_TRACE_ERROR("Cannot decompress the offsets chunk.");
+    free(offsets);
+    return NULL;
+  }
+  return offsets;
+}
+
+
+/* Get the uncompressed sizes of the chunks [first, first + n) in a frame.  Only the headers of
+ * the chunks are read, and a file frame is opened just once. */
+int frame_get_chunks_nbytes(blosc2_frame *frame, int first, int n, int32_t *nbytes) {
+  int32_t header_len;
+  int32_t nchunks;
+  int64_t* offsets = frame_get_offsets(frame, &header_len, &nchunks);
+  if (offsets == NULL) {
+    return -1;
+  }
+  if (first < 0 || n < 0 || first + n > nchunks) {
+    BLOSC_TRACE_ERROR("The chunks [%d, %d) are not in the frame (%d chunks).",
+                      first, first + n, nchunks);
+    free(offsets);
+    return -1;
+  }
+
+  int rc = 0;
+  FILE* fp = NULL;
+  if (frame->sdata == NULL && n > 0) {
+    fp = fopen(frame->fname, "rb");
+    if (fp == NULL) {
+      BLOSC_TRACE_ERROR("Cannot open the fileframe.");
+      free(offsets);
+      return -1;
+    }
+  }
+  for (int i = 0; i < n; i++) {
+    int64_t offset = header_len + offsets[first + i] + BLOSC2_CHUNK_NBYTES;
+    if (fp == NULL) {
+      nbytes[i] = sw32_(frame->sdata + offset);
+      continue;
+    }
+    int32_t nbytes_;
+    fseek(fp, offset, SEEK_SET);
+    if (fread(&nbytes_, 1, sizeof(nbytes_), fp) != sizeof(nbytes_)) {
+      BLOSC_TRACE_ERROR("Cannot read the nbytes for chunk %d in the fileframe.", first + i);
+      rc = -1;
+      break;
+    }
+    nbytes[i] = sw32_(&nbytes_);
+  }
+  if (fp != NULL) {
+    fclose(fp);
+  }
+  free(offsets);
+  return rc;
+}
+
+
 /* Return a compressed chunk that is part of a frame in the `chunk` parameter.
  * If the frame is disk-based, a buffer is allocated for the (compressed) chunk,
  * and hence a free is needed.  You can check if the chunk requires a free with the `needs_free`
@@ -1376,15 +2258,96 @@ int frame_get_chunk(blosc2_frame *frame, int nchunk, uint8_t **chunk, bool *need
 }
 
 
-/* Return a compressed chunk that is part of a frame in the `chunk` parameter.
- * If the frame is disk-based, a buffer is allocated for the (lazy) chunk,
- * and hence a free is needed.  You can check if the chunk requires a free with the `needs_free`
- * parameter.
- * If the chunk does not need a free, it means that the frame is in memory and that just a
- * pointer to the location of the chunk in memory is returned.
+/* Get the chunks [first, first + n) of a frame, in the same way as frame_get_chunk() does for
+ * a single chunk.  For frames on-disk, the file is opened just once and the chunks that are
+ * stored in a row are read sequentially through a large buffer.
  *
- * The size of the (compressed, potentially lazy) chunk is returned.  If some problem is detected,
- * a negative code is returned instead.
+ * Returns 0 if everything went well, or a negative code (with no chunk to be freed) otherwise.
+*/
+int frame_get_chunks(blosc2_frame *frame, int first, int n, uint8_t **chunks, bool *needs_free) {
+  int32_t header_len;
+  int32_t nchunks;
+  int64_t* offsets = frame_get_offsets(frame, &header_len, &nchunks);
+  if (offsets == NULL) {
+    return -1;
+  }
+  if (first < 0 || n < 0 || first + n > nchunks) {
+    BLOSC_TRACE_ERROR("The chunks [%d, %d) are not in the frame (%d chunks).",
+                      first, first + n, nchunks);
+    free(offsets);
+    return -2;
+  }
+  if (frame->sdata != NULL) {
+    // The chunks are in memory and just one pointer away
+    for (int i = 0; i < n; i++) {
+      chunks[i] = frame->sdata + header_len + offsets[first + i];
+      needs_free[i] = false;
+    }
+    free(offsets);
+    return 0;
+  }
+
+  FILE* fp = fopen(frame->fname, "rb");
+  if (fp == NULL) {
+    BLOSC_TRACE_ERROR("Cannot open the fileframe.");
+    free(offsets);
+    return -5;
+  }
+  char* fbuf = malloc(FRAME_READ_BUFSIZE);
+  setvbuf(fp, fbuf, _IOFBF, FRAME_READ_BUFSIZE);
+  int rc = 0;
+  int64_t position = -1;
+  int i;
+  for (i = 0; i < n; i++) {
+    int64_t offset = header_len + offsets[first + i];
+    if (offset != position) {
+      fseek(fp, offset, SEEK_SET);
+    }
+    uint8_t header[BLOSC_MIN_HEADER_LENGTH];
+    if (fread(header, 1, BLOSC_MIN_HEADER_LENGTH, fp) != BLOSC_MIN_HEADER_LENGTH) {
+      BLOSC_TRACE_ERROR("Cannot read the header of chunk %d out of the fileframe.", first + i);
+      rc = -5;
+      break;
+    }
+    int32_t chunk_cbytes = sw32_(header + BLOSC2_CHUNK_CBYTES);
+    if (chunk_cbytes < BLOSC_MIN_HEADER_LENGTH) {
+      BLOSC_TRACE_ERROR("Chunk %d in the fileframe is corrupted.", first + i);
+      rc = -6;
+      break;
+    }
+    chunks[i] = malloc((size_t)chunk_cbytes);
+    needs_free[i] = true;
+    memcpy(chunks[i], header, BLOSC_MIN_HEADER_LENGTH);
+    size_t nread = (size_t)chunk_cbytes - BLOSC_MIN_HEADER_LENGTH;
+    if (fread(chunks[i] + BLOSC_MIN_HEADER_LENGTH, 1, nread, fp) != nread) {
+      BLOSC_TRACE_ERROR("Cannot read chunk %d out of the fileframe.", first + i);
+      free(chunks[i]);
+      rc = -6;
+      break;
+    }
+    position = offset + chunk_cbytes;
+  }
+  fclose(fp);
+  free(fbuf);
+  free(offsets);
+  if (rc < 0) {
+    for (int j = 0; j < i; j++) {
+      free(chunks[j]);
+    }
+  }
+  return rc;
+}
+
+
+/* Return a compressed chunk that is part of a frame in the `chunk` parameter.
+ * If the frame is disk-based, a buffer is allocated for the (lazy) chunk,
+ * and hence a free is needed.  You can check if the chunk requires a free with the `needs_free`
+ * parameter.
+ * If the chunk does not need a free, it means that the frame is in memory and that just a
+ * pointer to the location of the chunk in memory is returned.
+ *
+ * The size of the (compressed, potentially lazy) chunk is returned.  If some problem is detected,
+ * a negative code is returned instead.
 */
 int frame_get_lazychunk(blosc2_frame *frame, int nchunk, uint8_t **chunk, bool *needs_free) {
   int32_t header_len;
@@ -1440,8 +2403,33 @@ int frame_get_lazychunk(blosc2_frame *frame, int nchunk, uint8_t **chunk, bool *
     fseek(fp, header_len + offset, SEEK_SET);
     size_t lazy_partial_len = BLOSC_EXTENDED_HEADER_LENGTH + nblocks * sizeof(int32_t);
     rbytes = fread(*chunk, 1, lazy_partial_len, fp);
+    uint8_t chunk_flags = *(*chunk + BLOSC2_CHUNK_FLAGS);
+    uint8_t chunk_blosc2_flags = *(*chunk + BLOSC2_CHUNK_BLOSC2_FLAGS);
+    if (rbytes == lazy_partial_len && !(chunk_flags & (uint8_t)BLOSC_MEMCPYED) &&
+        (chunk_blosc2_flags & BLOSC2_USEDICT)) {
+      // Any block needs the dict (or the ID of the super-chunk dict) right after the bstarts
+      size_t dict_len = sizeof(int32_t);
+      rbytes += fread(*chunk + lazy_partial_len, 1, dict_len, fp);
+      if (rbytes == lazy_partial_len + dict_len && !(chunk_blosc2_flags & BLOSC2_SHAREDDICT)) {
+        int32_t dict_size = sw32_(*chunk + lazy_partial_len);
+        if (dict_size <= 0 || lazy_partial_len + dict_len + dict_size > chunk_cbytes) {
+          fclose(fp);
+          free(*chunk);
+          *chunk = NULL;
+          *needs_free = false;
+          BLOSC_TRACE_ERROR("The dict of the (lazy) chunk is corrupted.");
+          return -6;
+        }
+        rbytes += fread(*chunk + lazy_partial_len + dict_len, 1, (size_t)dict_size, fp);
+        dict_len += (size_t)dict_size;
+      }
+      lazy_partial_len += dict_len;
+    }
     fclose(fp);
     if (rbytes != lazy_partial_len) {
+      free(*chunk);
+      *chunk = NULL;
+      *needs_free = false;
       BLOSC_TRACE_ERROR("Cannot read the (lazy) chunk out of the fileframe.");
       return -6;
     }
@@ -1498,81 +2486,20 @@ int frame_get_lazychunk(blosc2_frame *frame, int nchunk, uint8_t **chunk, bool *
 }
 
 
-/* Append an existing chunk into a frame. */
-void* frame_append_chunk(blosc2_frame* frame, void* chunk, blosc2_schunk* schunk) {
-  int32_t header_len;
-  int64_t frame_len;
-  int64_t nbytes;
-  int64_t cbytes;
-  int32_t chunksize;
-  int32_t nchunks;
-  int rc = get_header_info(frame, &header_len, &frame_len, &nbytes, &cbytes, &chunksize, &nchunks,
-                           NULL, NULL, NULL, NULL, NULL);
-  if (rc < 0) {
-    BLOSC_TRACE_ERROR("Unable to get meta info from frame.");
-    return NULL;
-  }
-
-  int64_t trailer_offset = get_trailer_offset(frame, header_len, cbytes);
-  int64_t trailer_len = frame->len - trailer_offset;
-
-  /* The uncompressed and compressed sizes start at byte 4 and 12 */
-  int32_t nbytes_chunk = sw32_((uint8_t*)chunk + BLOSC2_CHUNK_NBYTES);
-  int32_t cbytes_chunk = sw32_((uint8_t*)chunk + BLOSC2_CHUNK_CBYTES);
-  int64_t new_cbytes = cbytes + cbytes_chunk;
-
-  if ((nchunks > 0) && (nbytes_chunk > chunksize)) {
-    BLOSC_TRACE_ERROR("Appending chunks with a larger chunksize than frame is "
-                      "not allowed yet %d != %d.", nbytes_chunk, chunksize);
-    return NULL;
-  }
-
-  // Check that we are not appending a small chunk after another small chunk
-  if ((nchunks > 0) && (nbytes_chunk < chunksize)) {
-    uint8_t* last_chunk;
-    bool needs_free;
-    int retcode = frame_get_lazychunk(frame, nchunks - 1, &last_chunk, &needs_free);
-    if (retcode < 0) {
-      BLOSC_TRACE_ERROR("Cannot get the last chunk (in position %d).",
-                        nchunks - 1);
-      return NULL;
-    }
-    int32_t last_nbytes = sw32_(last_chunk + BLOSC2_CHUNK_NBYTES);
-    if (needs_free) {
-      free(last_chunk);
-    }
-    if ((last_nbytes < chunksize) && (nbytes < chunksize)) {
-      BLOSC_TRACE_ERROR("Appending two consecutive chunks with a chunksize smaller "
-                        "than the frame chunksize is not allowed yet: %d != %d.",
-                        nbytes_chunk, chunksize);
-      return NULL;
-    }
-  }
-
-  // Get the current offsets and add one more
-  int32_t off_nbytes = (nchunks + 1) * 8;
-  int64_t* offsets = (int64_t *) malloc((size_t)off_nbytes);
-  if (nchunks > 0) {
-    int32_t coffsets_cbytes = 0;
-    uint8_t *coffsets = get_coffsets(frame, header_len, cbytes, &coffsets_cbytes);
-    if (coffsets == NULL) {
-      BLOSC_TRACE_ERROR("Cannot get the offsets for the frame.");
-      return NULL;
-    }
-    // Decompress offsets
-    blosc2_dparams off_dparams = BLOSC2_DPARAMS_DEFAULTS;
-    blosc2_context *dctx = blosc2_create_dctx(off_dparams);
-    int32_t prev_nbytes = blosc2_decompress_ctx(dctx, coffsets, coffsets_cbytes, offsets, nchunks * 8);
-    blosc2_free_ctx(dctx);
-    if (prev_nbytes < 0) {
-      free(offsets);
-      BLOSC_TRACE_ERROR("Cannot decompress the offsets chunk.");
-      return NULL;
-    }
+/* Write a chunk at the end of the data chunks of a frame, followed by the new index of
+ * `nchunks` `offsets` (and checksums), and then update the header and trailer.
+ * The data of the existing chunks is never overwritten, so it is safe to do this while
+ * others have pointers to (or are reading) them. */
+/* Write `nnew` chunks one after the other at the end of the chunks of a frame, followed by the
+ * new offsets (and checksums), and update the header and trailer. */
+static void* put_chunks(blosc2_frame* frame, blosc2_schunk* schunk, int32_t header_len,
+                        int64_t cbytes, int64_t trailer_len, uint8_t** chunks, int nnew,
+                        int64_t* offsets, int32_t nchunks) {
+  int64_t new_cbytes = cbytes;
+  for (int i = 0; i < nnew; i++) {
+    new_cbytes += sw32_(chunks[i] + BLOSC2_CHUNK_CBYTES);
   }
-
-  // Add the new offset
-  offsets[nchunks] = cbytes;
+  int32_t off_nbytes = nchunks * 8;
 
   // Re-compress the offsets again
   blosc2_context* cctx = blosc2_create_cctx(BLOSC2_CPARAMS_DEFAULTS);
@@ -1581,63 +2508,92 @@ void* frame_append_chunk(blosc2_frame* frame, void* chunk, blosc2_schunk* schunk
   int32_t new_off_cbytes = blosc2_compress_ctx(cctx, offsets, off_nbytes,
           off_chunk, off_nbytes + BLOSC_MAX_OVERHEAD);
   blosc2_free_ctx(cctx);
-
-//  // You may want to uncomment this code block for debugging
-//  int64_t offset;
-//  int rc2 = blosc_getitem(off_chunk, nchunks, 1, &offset);
-//  // Safety check.  This is cheap and can save time while debugging.
-//  if (rc2 != 8 || offset != cbytes) {
-//    fprintf(stderr, "Chunk offset has not being compressed correctly!\n");
-//    return NULL;
-//  }
-
-  free(offsets);
   if (new_off_cbytes < 0) {
     free(off_chunk);
     return NULL;
   }
 
-  int64_t new_frame_len = header_len + new_cbytes + new_off_cbytes + trailer_len;
+  // The checksums (if any) have already been updated with the new chunk
+  uint8_t* chk_chunk = NULL;
+  int32_t chk_cbytes = get_checksums_chunk(schunk, nchunks, &chk_chunk);
+  if (chk_cbytes < 0) {
+    free(off_chunk);
+    return NULL;
+  }
+
+  int64_t new_frame_len = header_len + new_cbytes + new_off_cbytes + chk_cbytes + trailer_len;
 
   FILE* fp = NULL;
   if (frame->sdata != NULL) {
-    uint8_t* framep = frame->sdata;
     /* Make space for the new chunk and copy it */
-    frame->sdata = framep = realloc(framep, (size_t)new_frame_len);
+    uint8_t* framep = resize_sdata(frame, new_frame_len);
     if (framep == NULL) {
-      BLOSC_TRACE_ERROR("Cannot realloc space for the frame.");
+      free(off_chunk);
+      free(chk_chunk);
       return NULL;
     }
-    /* Copy the chunk */
-    memcpy(framep + header_len + cbytes, chunk, (size_t)cbytes_chunk);
+    frame->sdata = framep;
+    /* Copy the chunks */
+    int64_t coffset = header_len + cbytes;
+    for (int i = 0; i < nnew; i++) {
+      int32_t cbytes_chunk = sw32_(chunks[i] + BLOSC2_CHUNK_CBYTES);
+      memcpy(framep + coffset, chunks[i], (size_t)cbytes_chunk);
+      coffset += cbytes_chunk;
+    }
     /* Copy the offsets */
     memcpy(framep + header_len + new_cbytes, off_chunk, (size_t)new_off_cbytes);
+    /* And the checksums */
+    if (chk_cbytes > 0) {
+      memcpy(framep + header_len + new_cbytes + new_off_cbytes, chk_chunk, (size_t)chk_cbytes);
+    }
   } else {
     // fileframe
     fp = fopen(frame->fname, "rb+");
+    char* fbuf = NULL;
+    if (nnew > 1) {
+      fbuf = malloc(FRAME_WRITE_BUFSIZE);
+      setvbuf(fp, fbuf, _IOFBF, FRAME_WRITE_BUFSIZE);
+    }
     fseek(fp, header_len + cbytes, SEEK_SET);
-    size_t wbytes = fwrite(chunk, 1, (size_t)cbytes_chunk, fp);  // the new chunk
-    if (wbytes != (size_t)cbytes_chunk) {
-      BLOSC_TRACE_ERROR("Cannot write the full chunk to fileframe.");
-      return NULL;
+    size_t wbytes;
+    for (int i = 0; i < nnew; i++) {
+      // The new chunks go in a row, so the writes are sequential
+      int32_t cbytes_chunk = sw32_(chunks[i] + BLOSC2_CHUNK_CBYTES);
+      wbytes = fwrite(chunks[i], 1, (size_t)cbytes_chunk, fp);
+      if (wbytes != (size_t)cbytes_chunk) {
+        BLOSC_TRACE_ERROR("Cannot write the full chunk to fileframe.");
+        fclose(fp);
+        free(fbuf);
+        free(off_chunk);
+        free(chk_chunk);
+        return NULL;
+      }
     }
     wbytes = fwrite(off_chunk, 1, (size_t)new_off_cbytes, fp);  // the new offsets
     if (wbytes != (size_t)new_off_cbytes) {
       BLOSC_TRACE_ERROR("Cannot write the offsets to fileframe.");
       return NULL;
     }
+    if (chk_cbytes > 0) {
+      wbytes = fwrite(chk_chunk, 1, (size_t)chk_cbytes, fp);  // the new checksums
+      if (wbytes != (size_t)chk_cbytes) {
+        BLOSC_TRACE_ERROR("Cannot write the checksums to fileframe.");
+        return NULL;
+      }
+    }
     fclose(fp);
+    free(fbuf);
     // Invalidate the cache for chunk offsets
     if (frame->coffsets != NULL) {
       free(frame->coffsets);
       frame->coffsets = NULL;
     }
   }
-  free(chunk);
   free(off_chunk);
+  free(chk_chunk);
 
   frame->len = new_frame_len;
-  rc = frame_update_header(frame, schunk, false);
+  int rc = frame_update_header(frame, schunk, false);
   if (rc < 0) {
     return NULL;
   }
@@ -1651,6 +2607,106 @@ void* frame_append_chunk(blosc2_frame* frame, void* chunk, blosc2_schunk* schunk
 }
 
 
+/* Append existing chunks into a frame.  The chunks are written in a row and the offsets are
+ * updated just once. */
+void* frame_append_chunks(blosc2_frame* frame, uint8_t** chunks, int n, blosc2_schunk* schunk) {
+  int32_t header_len;
+  int64_t frame_len;
+  int64_t nbytes;
+  int64_t cbytes;
+  int32_t chunksize;
+  int32_t nchunks;
+  int rc = get_header_info(frame, &header_len, &frame_len, &nbytes, &cbytes, &chunksize, &nchunks,
+                           NULL, NULL, NULL, NULL, NULL);
+  if (rc < 0) {
+    BLOSC_TRACE_ERROR("Unable to get meta info from frame.");
+    return NULL;
+  }
+
+  int64_t trailer_offset = get_trailer_offset(frame, header_len, cbytes);
+  int64_t trailer_len = frame->len - trailer_offset;
+
+  // The super-chunk has already checked whether the chunks keep its chunksize fixed or not
+  // Get the current offsets and add the new ones
+  int32_t off_nbytes = (nchunks + n) * 8;
+  int64_t* offsets = (int64_t *) malloc((size_t)off_nbytes);
+  if (nchunks > 0) {
+    int32_t coffsets_cbytes = 0;
+    uint8_t *coffsets = get_coffsets(frame, header_len, cbytes, &coffsets_cbytes);
+    if (coffsets == NULL) {
+      BLOSC_TRACE_ERROR("Cannot get the offsets for the frame.");
+      return NULL;
+    }
+    // Decompress offsets
+    blosc2_dparams off_dparams = BLOSC2_DPARAMS_DEFAULTS;
+    blosc2_context *dctx = blosc2_create_dctx(off_dparams);
+    int32_t prev_nbytes = blosc2_decompress_ctx(dctx, coffsets, coffsets_cbytes, offsets, nchunks * 8);
+    blosc2_free_ctx(dctx);
+    if (prev_nbytes < 0) {
+      free(offsets);
+      BLOSC_TRACE_ERROR("Cannot decompress the offsets chunk.");
+      return NULL;
+    }
+  }
+
+  // Add the new offsets
+  int64_t coffset = cbytes;
+  for (int i = 0; i < n; i++) {
+    offsets[nchunks + i] = coffset;
+    coffset += sw32_(chunks[i] + BLOSC2_CHUNK_CBYTES);
+  }
+  void* rc_frame = put_chunks(frame, schunk, header_len, cbytes, trailer_len, chunks, n, offsets,
+                              nchunks + n);
+  free(offsets);
+  return rc_frame;
+}
+
+
+/* Append an existing chunk into a frame. */
+void* frame_append_chunk(blosc2_frame* frame, void* chunk, blosc2_schunk* schunk) {
+  uint8_t* chunks[1] = {chunk};
+  return frame_append_chunks(frame, chunks, 1, schunk);
+}
+
+
+/* Replace the chunk in position `nchunk` of a frame.  The new chunk is written after the
+ * rest of the chunks and the space of the old one is not reclaimed (it is still accounted
+ * in the frame cbytes) until the frame is serialized again. */
+void* frame_update_chunk(blosc2_frame* frame, int nchunk, void* chunk, blosc2_schunk* schunk) {
+  int32_t header_len;
+  int64_t frame_len;
+  int64_t nbytes;
+  int64_t cbytes;
+  int32_t chunksize;
+  int32_t nchunks;
+  int rc = get_header_info(frame, &header_len, &frame_len, &nbytes, &cbytes, &chunksize, &nchunks,
+                           NULL, NULL, NULL, NULL, NULL);
+  if (rc < 0) {
+    BLOSC_TRACE_ERROR("Unable to get meta info from frame.");
+    return NULL;
+  }
+  if (nchunk < 0 || nchunk >= nchunks) {
+    BLOSC_TRACE_ERROR("The chunk to update (%d) is not in the frame (%d chunks).", nchunk, nchunks);
+    return NULL;
+  }
+
+  int64_t trailer_offset = get_trailer_offset(frame, header_len, cbytes);
+  int64_t trailer_len = frame->len - trailer_offset;
+
+  int64_t* offsets = frame_get_offsets(frame, &header_len, &nchunks);
+  if (offsets == NULL) {
+    BLOSC_TRACE_ERROR("Cannot get the offsets for the frame.");
+    return NULL;
+  }
+  offsets[nchunk] = cbytes;
+  uint8_t* chunks[1] = {chunk};
+  void* rc_frame = put_chunks(frame, schunk, header_len, cbytes, trailer_len, chunks, 1, offsets,
+                              nchunks);
+  free(offsets);
+  return rc_frame;
+}
+
+
 /* Decompress and return a chunk that is part of a frame. */
 int frame_decompress_chunk(blosc2_context *dctx, blosc2_frame *frame, int nchunk, void *dest, int32_t nbytes) {
   uint8_t* src;
@@ -1663,6 +2719,9 @@ int frame_decompress_chunk(blosc2_context *dctx, blosc2_frame *frame, int nchunk
   }
   if (chunk_cbytes < sizeof(int32_t)) {
     /* Not enough input to read `nbytes` */
+    if (needs_free) {
+      free(src);
+    }
     return -1;
   }
 
@@ -1670,19 +2729,22 @@ int frame_decompress_chunk(blosc2_context *dctx, blosc2_frame *frame, int nchunk
   int32_t nbytes_ = sw32_(src + BLOSC2_CHUNK_NBYTES);
   if (nbytes_ > (int32_t)nbytes) {
     BLOSC_TRACE_ERROR("Not enough space for decompressing in dest.");
+    if (needs_free) {
+      free(src);
+    }
     return -1;
   }
 
   /* And decompress it */
   int32_t chunksize = blosc2_decompress_ctx(dctx, src, chunk_cbytes, dest, nbytes);
+  if (needs_free) {
+    free(src);
+  }
   if (chunksize < 0 || chunksize != nbytes_) {
     BLOSC_TRACE_ERROR("Error in decompressing chunk.");
     return -11;
   }
 
-  if (needs_free) {
-    free(src);
-  }
   return (int)chunksize;
 }
 
@@ -1744,19 +2806,32 @@ int frame_reorder_offsets(blosc2_frame *frame, int *offsets_order, blosc2_schunk
     return -1;
   }
   free(offsets);
-  int64_t new_frame_len = header_len + cbytes + new_off_cbytes + trailer_len;
+
+  // The checksums (if any) have already been reordered in the super-chunk
+  uint8_t* chk_chunk = NULL;
+  int32_t chk_cbytes = get_checksums_chunk(schunk, nchunks, &chk_chunk);
+  if (chk_cbytes < 0) {
+    free(off_chunk);
+    return -1;
+  }
+  int64_t new_frame_len = header_len + cbytes + new_off_cbytes + chk_cbytes + trailer_len;
 
   FILE* fp = NULL;
   if (frame->sdata != NULL) {
-    uint8_t* framep = frame->sdata;
-    /* Make space for the new chunk and copy it */
-    frame->sdata = framep = realloc(framep, (size_t)new_frame_len);
+    /* Make space for the new offsets */
+    uint8_t* framep = resize_sdata(frame, new_frame_len);
     if (framep == NULL) {
-      BLOSC_TRACE_ERROR("Cannot realloc space for the frame.");
+      free(off_chunk);
+      free(chk_chunk);
       return -1;
     }
+    frame->sdata = framep;
     /* Copy the offsets */
     memcpy(framep + header_len + cbytes, off_chunk, (size_t)new_off_cbytes);
+    /* And the checksums */
+    if (chk_cbytes > 0) {
+      memcpy(framep + header_len + cbytes + new_off_cbytes, chk_chunk, (size_t)chk_cbytes);
+    }
   } else {
     // fileframe
     fp = fopen(frame->fname, "rb+");
@@ -1766,6 +2841,13 @@ int frame_reorder_offsets(blosc2_frame *frame, int *offsets_order, blosc2_schunk
       BLOSC_TRACE_ERROR("Cannot write the offsets to fileframe.");
       return -1;
     }
+    if (chk_cbytes > 0) {
+      wbytes = fwrite(chk_chunk, 1, (size_t)chk_cbytes, fp);  // the new checksums
+      if (wbytes != (size_t)chk_cbytes) {
+        BLOSC_TRACE_ERROR("Cannot write the checksums to fileframe.");
+        return -1;
+      }
+    }
     fclose(fp);
     // Invalidate the cache for chunk offsets
     if (frame->coffsets != NULL) {
@@ -1774,6 +2856,7 @@ int frame_reorder_offsets(blosc2_frame *frame, int *offsets_order, blosc2_schunk
     }
   }
   free(off_chunk);
+  free(chk_chunk);
 
   frame->len = new_frame_len;
   int rc = frame_update_header(frame, schunk, false);
@@ -1788,3 +2871,314 @@ int frame_reorder_offsets(blosc2_frame *frame, int *offsets_order, blosc2_schunk
 
   return 0;
 }
+
+
+/* Acquire an advisory lock on a file frame: shared for readers and exclusive for writers.
+ * Only the region of the header is locked, but as the offsets, the checksums and the trailer
+ * are always updated before the header, this protects all of them.  The data chunks themselves
+ * are never overwritten, so they can be read without locking.
+ * Locks can be nested; only the outermost call does actually lock the file.  As fcntl() and
+ * flock() locks do not exclude the threads sharing a descriptor, the threads of a process are
+ * serialized with a mutex (taken before the file lock), even for reading: refreshing the cached
+ * state of the frame and decompressing with the contexts of a super-chunk are not thread-safe.
+ * Return 1 if the file has been locked by this call, 0 if it was already locked (or if locks
+ * are not supported) and a negative value in case of error. */
+int frame_lock(blosc2_frame* frame, bool exclusive) {
+  frame_lock_t* lock = frame->lock;
+  if (lock == NULL && (frame->sdata != NULL || frame->fname == NULL)) {
+    return 0;
+  }
+  if (exclusive && lock != NULL && !lock->writable) {
+    BLOSC_TRACE_ERROR("The frame is read-only.");
+    return -1;
+  }
+#if defined(HAVE_FRAME_LOCKS)
+  if (lock == NULL) {
+    // Several threads may be getting here for the first time
+    pthread_mutex_lock(&new_lock_mutex);
+    lock = frame->lock;
+    if (lock == NULL) {
+      // An exclusive fcntl() lock requires a descriptor opened for writing
+      int fd = open(frame->fname, O_RDWR);
+      if (fd < 0) {
+        fd = open(frame->fname, O_RDONLY);
+      }
+      if (fd < 0) {
+        BLOSC_TRACE_ERROR("Cannot open '%s' for locking it.", frame->fname);
+        pthread_mutex_unlock(&new_lock_mutex);
+        return -1;
+      }
+      // Writes are still possible via stdio, and will fail there with a proper error
+      lock = new_frame_lock(fd, true);
+      frame->lock = lock;
+    }
+    pthread_mutex_unlock(&new_lock_mutex);
+  }
+  pthread_mutex_lock(&lock->mutex);
+  if (lock->depth++ > 0) {
+    return 0;
+  }
+
+  int rc;
+#if defined(F_OFD_SETLKW)
+  // Locks on the open file description survive other descriptors of the same file being closed
+  struct flock fl;
+  memset(&fl, 0, sizeof(fl));
+  fl.l_type = exclusive ? F_WRLCK : F_RDLCK;
+  fl.l_whence = SEEK_SET;
+  fl.l_start = 0;
+  fl.l_len = FRAME_HEADER_MINLEN;
+  do {
+    rc = fcntl(lock->fd, F_OFD_SETLKW, &fl);
+  } while (rc < 0 && errno == EINTR);
+#else
+  // Classic fcntl() locks are dropped as soon as the process closes *any* descriptor of the
+  // file (which happens all the time here), so use flock() instead, which locks the whole file
+  do {
+    rc = flock(lock->fd, exclusive ? LOCK_EX : LOCK_SH);
+  } while (rc < 0 && errno == EINTR);
+#endif
+  if (rc < 0) {
+    BLOSC_TRACE_ERROR("Cannot lock the frame: %s.", strerror(errno));
+    lock->depth--;
+    pthread_mutex_unlock(&lock->mutex);
+    return -2;
+  }
+  return 1;
+#else
+  (void) exclusive;
+  return 0;
+#endif
+}
+
+
+/* Release a lock acquired with frame_lock(). */
+int frame_unlock(blosc2_frame* frame) {
+#if defined(HAVE_FRAME_LOCKS)
+  frame_lock_t* lock = frame->lock;
+  if (lock == NULL || lock->depth == 0) {
+    return 0;
+  }
+  if (--lock->depth > 0) {
+    pthread_mutex_unlock(&lock->mutex);
+    return 0;
+  }
+
+  int rc;
+#if defined(F_OFD_SETLKW)
+  struct flock fl;
+  memset(&fl, 0, sizeof(fl));
+  fl.l_type = F_UNLCK;
+  fl.l_whence = SEEK_SET;
+  fl.l_start = 0;
+  fl.l_len = FRAME_HEADER_MINLEN;
+  rc = fcntl(lock->fd, F_OFD_SETLK, &fl);
+#else
+  rc = flock(lock->fd, LOCK_UN);
+#endif
+  pthread_mutex_unlock(&lock->mutex);
+  if (rc < 0) {
+    BLOSC_TRACE_ERROR("Cannot unlock the frame: %s.", strerror(errno));
+    return -1;
+  }
+#else
+  (void) frame;
+#endif
+  return 0;
+}
+
+
+/* Bring the cached state of a file frame (and its super-chunk, if not NULL) up to date in case
+ * another process has modified it.  This is cheap when nothing has changed, as only the header
+ * has to be read.  It should be called with the frame locked.
+ * Return 1 if the frame has changed, 0 if not, and a negative value in case of error. */
+int frame_refresh(blosc2_frame* frame, blosc2_schunk* schunk) {
+  if (frame->sdata != NULL && !frame->shm) {
+    return 0;
+  }
+
+  // Most of the times, the header is all that we need to read
+  uint8_t header[FRAME_HEADER_MINLEN];
+  if (frame->shm) {
+    memcpy(header, frame->sdata, FRAME_HEADER_MINLEN);
+  }
+  else {
+    size_t rbytes = 0;
+    FILE* fp = fopen(frame->fname, "rb");
+    if (fp != NULL) {
+      rbytes = fread(header, 1, FRAME_HEADER_MINLEN, fp);
+      fclose(fp);
+    }
+    if (rbytes != FRAME_HEADER_MINLEN) {
+      BLOSC_TRACE_ERROR("Cannot read the header out of the fileframe.");
+      return -1;
+    }
+  }
+  int64_t frame_len;
+  swap_store(&frame_len, header + FRAME_LEN, sizeof(frame_len));
+  if (get_generation(header) == frame->generation && frame_len == frame->len) {
+    return 0;
+  }
+
+  uint32_t trailer_len;
+  uint32_t generation;
+  int rc;
+  if (frame->shm) {
+    rc = get_sdata_lengths(frame->sdata, frame->maxlen, &frame_len, &trailer_len, &generation);
+  }
+  else {
+    rc = get_file_lengths(frame->fname, &frame_len, &trailer_len, &generation);
+  }
+  if (rc < 0) {
+    BLOSC_TRACE_ERROR("Cannot get the lengths of the frame.");
+    return -1;
+  }
+  frame->len = frame_len;
+  frame->trailer_len = trailer_len;
+  frame->generation = generation;
+  if (frame->coffsets != NULL) {
+    free(frame->coffsets);
+    frame->coffsets = NULL;
+  }
+  if (schunk == NULL) {
+    return 1;
+  }
+
+  int32_t header_len;
+  int ret = get_header_info(frame, &header_len, &frame_len, &schunk->nbytes, &schunk->cbytes,
+                            &schunk->chunksize, &schunk->nchunks, NULL, NULL, NULL, NULL, NULL);
+  if (ret < 0) {
+    BLOSC_TRACE_ERROR("Unable to get meta info from frame.");
+    return -1;
+  }
+  if (schunk->checksums != NULL) {
+    free(schunk->checksums);
+    free(schunk->checksums_verified);
+    schunk->checksums = NULL;
+    schunk->checksums_verified = NULL;
+    ret = frame_get_checksums(frame, schunk);
+    if (ret < 0) {
+      return ret;
+    }
+  }
+  if (schunk->zonemaps != NULL) {
+    ret = frame_get_zonemaps(frame, schunk);
+    if (ret < 0) {
+      return ret;
+    }
+  }
+
+  // Another writer may have added the dict of the chunks
+  if (schunk->dict == NULL) {
+    ret = frame_get_dict(frame, schunk);
+    if (ret < 0) {
+      return ret;
+    }
+  }
+
+  return 1;
+}
+
+
+/* Move an in-memory frame to a new POSIX shared memory segment of `maxlen` bytes, so that other
+ * processes can open it by `name`.  The frame cannot grow beyond `maxlen` afterwards, as the
+ * segment cannot be moved without invalidating the mappings of the readers.
+ * Return 0 if success and a negative value otherwise. */
+int frame_to_shm(blosc2_frame* frame, const char* name, int64_t maxlen) {
+#if defined(_WIN32)
+  (void) frame;
+  (void) name;
+  (void) maxlen;
+  BLOSC_TRACE_ERROR("Shared memory frames are not supported on Windows.");
+  return -1;
+#else
+  if (frame->sdata == NULL || frame->shm) {
+    BLOSC_TRACE_ERROR("Only regular in-memory frames can be moved to shared memory.");
+    return -1;
+  }
+  if (maxlen < frame->len) {
+    BLOSC_TRACE_ERROR("The maximum length (%lld bytes) cannot hold the frame (%lld bytes).",
+                      (long long)maxlen, (long long)frame->len);
+    return -1;
+  }
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    BLOSC_TRACE_ERROR("Cannot create the shared memory segment '%s': %s.", name, strerror(errno));
+    return -1;
+  }
+  // The pages of the segment are only allocated when they are touched for the first time
+  if (ftruncate(fd, (off_t)maxlen) < 0) {
+    BLOSC_TRACE_ERROR("Cannot size the shared memory segment '%s': %s.", name, strerror(errno));
+    close(fd);
+    shm_unlink(name);
+    return -1;
+  }
+  void* sdata = mmap(NULL, (size_t)maxlen, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (sdata == MAP_FAILED) {
+    BLOSC_TRACE_ERROR("Cannot map the shared memory segment '%s': %s.", name, strerror(errno));
+    close(fd);
+    shm_unlink(name);
+    return -1;
+  }
+  memcpy(sdata, frame->sdata, (size_t)frame->len);
+  free(frame->sdata);
+  frame->sdata = sdata;
+  frame->shm = true;
+  frame->maxlen = maxlen;
+
+  frame->lock = new_frame_lock(fd, true);
+
+  return 0;
+#endif
+}
+
+
+/* Map (read-only) a frame living in the POSIX shared memory segment `name`. */
+blosc2_frame* frame_open_shm(const char* name) {
+#if defined(_WIN32)
+  (void) name;
+  BLOSC_TRACE_ERROR("Shared memory frames are not supported on Windows.");
+  return NULL;
+#else
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0) {
+    BLOSC_TRACE_ERROR("Cannot open the shared memory segment '%s': %s.", name, strerror(errno));
+    return NULL;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size < FRAME_HEADER_MINLEN) {
+    BLOSC_TRACE_ERROR("The shared memory segment '%s' does not contain a frame.", name);
+    close(fd);
+    return NULL;
+  }
+  int64_t maxlen = (int64_t)st.st_size;
+  void* sdata = mmap(NULL, (size_t)maxlen, PROT_READ, MAP_SHARED, fd, 0);
+  if (sdata == MAP_FAILED) {
+    BLOSC_TRACE_ERROR("Cannot map the shared memory segment '%s': %s.", name, strerror(errno));
+    close(fd);
+    return NULL;
+  }
+
+  blosc2_frame* frame = calloc(1, sizeof(blosc2_frame));
+  frame->sdata = sdata;
+  frame->shm = true;
+  frame->maxlen = maxlen;
+  frame->lock = new_frame_lock(fd, false);
+
+  // The writer may be in the middle of an update
+  if (frame_lock(frame, false) < 0) {
+    blosc2_frame_free(frame);
+    return NULL;
+  }
+  int rc = get_sdata_lengths(frame->sdata, maxlen, &frame->len, &frame->trailer_len,
+                             &frame->generation);
+  frame_unlock(frame);
+  if (rc < 0) {
+    BLOSC_TRACE_ERROR("The shared memory segment '%s' does not contain a frame.", name);
+    blosc2_frame_free(frame);
+    return NULL;
+  }
+
+  return frame;
+#endif
+}
@@ -17,6 +17,7 @@
 #define FRAME_HEADER_LEN (FRAME_HEADER_MAGIC + 8 + 1)  // 11
 #define FRAME_LEN (FRAME_HEADER_LEN + 4 + 1)  // 16
 #define FRAME_FLAGS (FRAME_LEN + 8 + 1)  // 25
+#define FRAME_OTHER_FLAGS (FRAME_FLAGS + 1)  // 26
 #define FRAME_CODECS (FRAME_FLAGS + 2)  // 27
 #define FRAME_NBYTES (FRAME_FLAGS + 4 + 1)  // 30
 #define FRAME_CBYTES (FRAME_NBYTES + 8 + 1)  // 39
@@ -26,12 +27,20 @@
 #define FRAME_NTHREADS_D (FRAME_NTHREADS_C + 2 + 1)  // 61
 #define FRAME_HAS_USERMETA (FRAME_NTHREADS_D + 2)  // 63
 #define FRAME_FILTER_PIPELINE (FRAME_HAS_USERMETA + 1 + 1) // 65
-#define FRAME_HEADER_MINLEN (FRAME_FILTER_PIPELINE + 1 + 16)  // 82 <- minimum length
-#define FRAME_METALAYERS (FRAME_HEADER_MINLEN)  // 82
-#define FRAME_IDX_SIZE (FRAME_METALAYERS + 1 + 1)  // 84
+#define FRAME_GENERATION (FRAME_FILTER_PIPELINE + 1 + 16)  // 82
+#define FRAME_HEADER_MINLEN (FRAME_GENERATION + 1 + 4)  // 87 <- minimum length
+#define FRAME_METALAYERS (FRAME_HEADER_MINLEN)  // 87
+#define FRAME_IDX_SIZE (FRAME_METALAYERS + 1 + 1)  // 89
+
+#define FRAME_HEADER_NITEMS (14)  // the number of elements in the header
+#define FRAME_HEADER_NITEMS_NOGEN (13)  // for frames without a generation counter (beta.6 and former)
 
 #define FRAME_FILTER_PIPELINE_MAX (8)  // the maximum number of filters that can be stored in header
 
+#define FRAME_HAS_CHECKSUMS (0x1U)  // in other flags; a chunk of checksums follows the offsets chunk
+#define FRAME_ZONEMAP_TYPE_SHIFT (1U)  // in other flags; the type of the zone maps (if any)
+#define FRAME_ZONEMAP_TYPE_MASK (0xEU)  // a chunk of zone maps follows the checksums (if any)
+
 #define FRAME_TRAILER_VERSION_BETA2 (0U)  // for beta.2 and former
 #define FRAME_TRAILER_VERSION (1U)        // can be up to 127
 
@@ -39,10 +48,17 @@
 #define FRAME_TRAILER_USERMETA_OFFSET (7)  // offset to usermeta chunk
 #define FRAME_TRAILER_MINLEN (30)  // minimum length for the trailer (msgpack overhead)
 #define FRAME_TRAILER_LEN_OFFSET (22)  // offset to trailer length (counting from the end)
+#define FRAME_TRAILER_FP_OFFSET (17)  // offset to fingerprint type (counting from the end)
+#define FRAME_FP_XXH64 (2U)  // 64-bit fingerprint (XXH64 of the chunk checksums)
 
 void* frame_append_chunk(blosc2_frame* frame, void* chunk, blosc2_schunk* schunk);
+void* frame_append_chunks(blosc2_frame* frame, uint8_t** chunks, int n, blosc2_schunk* schunk);
+void* frame_update_chunk(blosc2_frame* frame, int nchunk, void* chunk, blosc2_schunk* schunk);
 int frame_get_chunk(blosc2_frame *frame, int nchunk, uint8_t **chunk, bool *needs_free);
+int frame_get_chunks(blosc2_frame *frame, int first, int n, uint8_t **chunks, bool *needs_free);
 int frame_get_lazychunk(blosc2_frame *frame, int nchunk, uint8_t **chunk, bool *needs_free);
+int64_t* frame_get_offsets(blosc2_frame *frame, int32_t *header_len, int32_t *nchunks);
+int frame_get_chunks_nbytes(blosc2_frame *frame, int first, int n, int32_t *nbytes);
 int frame_decompress_chunk(blosc2_context *dctx, blosc2_frame *frame, int nchunk,
                            void *dest, int32_t nbytes);
 
@@ -51,4 +67,22 @@ int frame_reorder_offsets(blosc2_frame *frame, int *offsets_order, blosc2_schunk
 int frame_update_header(blosc2_frame* frame, blosc2_schunk* schunk, bool new);
 int frame_update_trailer(blosc2_frame* frame, blosc2_schunk* schunk);
 
+int frame_lock(blosc2_frame* frame, bool exclusive);
+int frame_unlock(blosc2_frame* frame);
+int frame_refresh(blosc2_frame* frame, blosc2_schunk* schunk);
+
+int frame_to_shm(blosc2_frame* frame, const char* name, int64_t maxlen);
+blosc2_frame* frame_open_shm(const char* name);
+
+int frame_get_checksums(blosc2_frame* frame, blosc2_schunk* schunk);
+int frame_verify_fingerprint(blosc2_frame* frame, blosc2_schunk* schunk);
+int frame_get_zonemaps(blosc2_frame* frame, blosc2_schunk* schunk);
+int frame_get_dict(blosc2_frame* frame, blosc2_schunk* schunk);
+
+// The zone maps of a super-chunk are private to schunk.c
+uint8_t schunk_zonemap_type(blosc2_schunk* schunk);
+int32_t schunk_zonemaps_to_buffer(blosc2_schunk* schunk, int32_t nchunks, uint8_t** buffer);
+int schunk_zonemaps_from_buffer(blosc2_schunk* schunk, uint8_t type, int32_t nchunks,
+                                const uint8_t* buffer, int32_t len);
+
 #endif //BLOSC_FRAME_H
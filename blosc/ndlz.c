@@ -14,15 +14,31 @@
   better compression ratios.  The idea is to look for similarities
   in places that are closer in a euclidean metric, not the typical
   linear one.
-**********************************************************************/
 
-#define XXH_NAMESPACE ndlz
+  A block is seen as a 2-dim image of bytes (or a stack of them for
+  3-dim blocks), which is split in cells of 4x4 bytes.  Every cell is
+  encoded with a token, followed by its data:
+
+  - 0x00: a literal cell (the bytes of the cell, row by row).
+  - 0x40: a cell with all the bytes equal (the byte).
+  - 0xC0: a match of a whole literal cell (the distance to it).
+  - 0x80 | i << 5 | j << 3 (or 0x80 for rows 2 and 3): a match of the
+    rows i and j (the distance to them, and the other two rows).
+  - 0xE0 | x << 3: a match of three rows (the distance to them, and
+    the other row).
+  - 0x20 | j << 3: a match of the rows 0 and j, plus another match of
+    the other two rows (the distances to both).
+
+  Distances are 16-bit and go back from the token to the rows of a
+  literal cell.  Cells at the edges that do not have 4x4 bytes are
+  always literal.  The stream starts with ndim (2 or 3) and the shape
+  of the image (in bytes), and the bytes of the block that do not fit
+  in the image (e.g. in leftover blocks) go literally at its end.
+**********************************************************************/
 
-#define XXH_INLINE_ALL
-#include <xxhash.c>
 #include <stdio.h>
-#include <ndlz.h>
-
+#include "ndlz.h"
+#include "blosc-private.h"
 
 
 /*
@@ -43,638 +59,513 @@
 #define inline __inline  /* Visual C is not C99, but supports some kind of inline */
 #endif
 
-#define MAX_COPY 32U
 #define MAX_DISTANCE 65535
+#define CELL_SIZE 16
 
-#ifdef BLOSC_STRICT_ALIGN
-  #define NDLZ_READU16(p) ((p)[0] | (p)[1]<<8)
-  #define NDLZ_READU32(p) ((p)[0] | (p)[1]<<8 | (p)[2]<<16 | (p)[3]<<24)
-#else
-  #define NDLZ_READU16(p) *((const uint16_t*)(p))
-  #define NDLZ_READU32(p) *((const uint32_t*)(p))
-#endif
+#define HASH_LOG (12U)
+#define MIN_HASH_LOG (6U)
 
-#define HASH_LOG (12)
+#define TOKEN_LITERAL 0x00U
+#define TOKEN_RUN 0x40U
+#define TOKEN_CELL 0xC0U
+#define TOKEN_PAIR 0x80U
+#define TOKEN_TRIPLE 0xE0U
+#define TOKEN_PAIRS 0x20U
 
 
-int ndlz_compress(blosc2_context* context, const void* input, int length,
-                    void* output, int maxout) {
+typedef struct {
+  uint8_t* obase;
+  uint8_t* op_limit;
+  unsigned hash_log;
+  uint32_t tab_cell[1U << HASH_LOG];
+  uint32_t tab_triple[1U << HASH_LOG];
+  uint32_t tab_pair[1U << HASH_LOG];
+} ndlz_state;
 
-  int ndim = context->ndim;
-  int32_t* blockshape = context->blockshape;
 
-  if (ndim != 2) {
-    fprintf(stderr, "This codec only works for ndim = 2");
-    return -1;
-  }
+static inline uint32_t read_u32(const uint8_t* p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+
+static inline uint16_t read_u16(const uint8_t* p) {
+  return (uint16_t)(p[0] | p[1] << 8);
+}
 
-  if (length == context->leftover) {
-    printf("\n Leftover block is not supported \n");
-    return 0;
-  }
 
-  if (length != (blockshape[0] * blockshape[1])) {
-    printf("Length not equal to blocksize \n");
-    return -1;
+static inline void write_u16(uint8_t* p, uint32_t value) {
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+}
+
+
+/* Hash nrows consecutive rows (of 4 bytes) */
+static inline uint32_t hash_rows(const uint8_t* rows, int nrows, unsigned hash_log) {
+  uint32_t hval = 0;
+  for (int i = 0; i < nrows; i++) {
+    hval = (hval ^ read_u32(rows + 4 * i)) * 2654435761U;
   }
+  return hval >> (32U - hash_log);
+}
 
-  uint8_t* ip = (uint8_t *) input;
-  uint8_t* op = (uint8_t *) output;
-  uint8_t* op_limit;
-  uint32_t hval, hash_cell;
-  uint32_t hash_triple[2] = {0};
-  uint32_t hash_pair[3] = {0};
-  uint8_t bufarea[16];
-  uint8_t* buf_cell = bufarea;
-  uint8_t buf_triple[12];
-  uint8_t buf_pair[8];
-  uint8_t* buf_aux;
-  uint32_t tab_cell[1U << 12U] = {0};
-  uint32_t tab_triple[1U << 12U] = {0};
-  uint32_t tab_pair[1U << 12U] = {0};
-  uint32_t update_triple[2] = {0};
-  uint32_t update_pair[3] = {0};
-
-  // Minimum cratios before issuing and _early giveup_
-  // Remind that ndlz is not meant for cratios <= 2 (too costly to decompress)
-
-  op_limit = op + maxout;
-
-  // Initialize the hash table to distances of 0
-  for (unsigned i = 0; i < (1U << 12U); i++) {
-    tab_cell[i] = 0;
+
+/* Whether two cells are equal */
+static inline bool cell_equal(const uint8_t* cell, const uint8_t* ref) {
+#if defined(__SSE2__)
+  __m128i value = _mm_loadu_si128((const __m128i*)cell);
+  __m128i value2 = _mm_loadu_si128((const __m128i*)ref);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(value, value2)) == 0xFFFF;
+#else
+  return memcmp(cell, ref, CELL_SIZE) == 0;
+#endif
+}
+
+
+/* Whether all the bytes of a cell are equal */
+static inline bool cell_is_run(const uint8_t* cell) {
+#if defined(__SSE2__)
+  __m128i value = _mm_loadu_si128((const __m128i*)cell);
+  __m128i first = _mm_set1_epi8((char)cell[0]);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(value, first)) == 0xFFFF;
+#else
+  for (int i = 1; i < CELL_SIZE; i++) {
+    if (cell[i] != cell[0]) {
+      return false;
+    }
   }
+  return true;
+#endif
+}
+
 
-  /* input and output buffer cannot be less than 16 and 66 bytes or we can get into trouble */
-  int overhead = 17 + (blockshape[0] * blockshape[1] / 16 - 1) * 3;
-  if (length < 16 || maxout < overhead) {
-    printf("Incorrect length or maxout");
+/* Look for earlier (literal) rows that are equal to rows.  Return the distance to them, or 0. */
+static inline uint32_t find_rows(const ndlz_state* state, const uint32_t* table, uint32_t hval,
+                                 const uint8_t* rows, int nrows, const uint8_t* anchor) {
+  uint32_t entry = table[hval];
+  if (entry == 0) {
+    return 0;
+  }
+  uint32_t distance = (uint32_t)(anchor - state->obase) - entry;
+  if (distance >= MAX_DISTANCE) {
     return 0;
   }
+  const uint8_t* ref = state->obase + entry;
+  bool same = nrows == 4 ? cell_equal(rows, ref) : memcmp(rows, ref, (size_t)(4 * nrows)) == 0;
+  return same ? distance : 0;
+}
 
-  uint8_t* obase = op;
 
-  /* we start with literal copy */
-  *op++ = ndim;
-  memcpy(op, &blockshape[0], 4);
-  op += 4;
-  memcpy(op, &blockshape[1], 4);
-  op += 4;
+/* Encode a full (4x4) cell at op */
+static uint8_t* encode_cell(ndlz_state* state, const uint8_t* cell, uint8_t* op) {
+  uint8_t* anchor = op;
+  unsigned hash_log = state->hash_log;
+  uint8_t rows[12];
 
-  uint32_t i_stop[2];
-  for (int i = 0; i < 2; ++i) {
-    i_stop[i] = (blockshape[i] + 3) / 4;
+  if (cell_is_run(cell)) {
+    *op++ = TOKEN_RUN;
+    *op++ = cell[0];
+    return op;
   }
 
-  /* main loop */
-  uint32_t padding[2];
-  uint32_t ii[2];
-  for (ii[0] = 0; ii[0] < i_stop[0]; ++ii[0]) {
-    for (ii[1] = 0; ii[1] < i_stop[1]; ++ii[1]) {      // for each cell
-      uint8_t token;
-      for (int h = 0; h < 2; h++){          // new cell -> new possible refereces
-        update_triple[h] = 0;
-        update_pair[h] = 0;
-      }
-      update_pair[2] = 0;
-
-      uint32_t orig = ii[0] * 4 * blockshape[1] + ii[1] * 4;
-      if (((blockshape[0] % 4 != 0) && (ii[0] == i_stop[0] - 1)) || ((blockshape[1] % 4 != 0) && (ii[1] == i_stop[1] - 1))) {
-        token = 0;                                   // padding -> literal copy
-        *op++ = token;
-        if (ii[0] == i_stop[0] - 1) {
-          padding[0] = (blockshape[0] % 4 == 0) ? 4 : blockshape[0] % 4;
-        } else {
-          padding[0] = 4;
-        }
-        if (ii[1] == i_stop[1] - 1) {
-          padding[1] = (blockshape[1] % 4 == 0) ? 4 : blockshape[1] % 4;
-        } else {
-          padding[1] = 4;
-        }
-        for (int i = 0; i < padding[0]; i++) {
-          memcpy(op, &ip[orig + i * blockshape[1]], padding[1]);
-          op += padding[1];
-        }
-      }
-      else {
-        for (uint64_t i = 0; i < 4; i++) {           // fill cell buffer
-          uint64_t ind = orig + i * blockshape[1];
-          memcpy(buf_cell, &ip[ind], 4);
-          buf_cell += 4;
-        }
-        buf_cell -= 16;
+  uint32_t hash_cell = hash_rows(cell, 4, hash_log);
+  uint32_t distance = find_rows(state, state->tab_cell, hash_cell, cell, 4, anchor);
+  if (distance != 0) {
+    *op++ = TOKEN_CELL;
+    write_u16(op, distance);
+    return op + 2;
+  }
 
-/*
-        printf("\n buf_cell: ");
-        for (int i = 0; i < 16; i++) {
-            printf("%u, ", buf_cell[i]);
-        }
-*/
-        if (NDLZ_UNEXPECT_CONDITIONAL(op + 16 > op_limit)) {
-          printf("Literal copy \n");
-          return 0;
-        }
-        const uint8_t* ref;
-        uint32_t distance;
-        uint8_t* anchor = op;    /* comparison starting-point */
-
-        /* find potential match */
-        hash_cell = XXH32(buf_cell, 16, 1);        // calculate cell hash
-        hash_cell >>= 32U - 12U;
-        ref = obase + tab_cell[hash_cell];
-
-        /* calculate distance to the match */
-        if (tab_cell[hash_cell] == 0) {
-          distance = 0;
-        } else {
-          bool same = true;
-          buf_aux = obase + tab_cell[hash_cell];
-          for(int i = 0; i < 16; i++){
-            // printf("buf_cell[i]: %u, buf2: %u \n", buf_cell[i], buf_aux[i]);
-            if (buf_cell[i] != buf_aux[i]) {
-              same = false;
-              break;
-            }
-          }
-          if (same) {
-            distance = (int32_t) (anchor - ref);
-          } else {
-            distance = 0;
-          }
+  // Rows 0 and j, plus the other two rows
+  for (int j = 1; j < 4; j++) {
+    memcpy(rows, cell, 4);
+    memcpy(rows + 4, cell + 4 * j, 4);
+    distance = find_rows(state, state->tab_pair, hash_rows(rows, 2, hash_log), rows, 2, anchor);
+    if (distance == 0) {
+      continue;
+    }
+    int l = j == 1 ? 2 : 1;
+    int m = j == 3 ? 2 : 3;
+    memcpy(rows, cell + 4 * l, 4);
+    memcpy(rows + 4, cell + 4 * m, 4);
+    uint32_t distance2 = find_rows(state, state->tab_pair, hash_rows(rows, 2, hash_log), rows, 2,
+                                   anchor);
+    if (distance2 != 0) {
+      *op++ = (uint8_t)(TOKEN_PAIRS | j << 3U);
+      write_u16(op, distance);
+      write_u16(op + 2, distance2);
+      return op + 4;
+    }
+  }
+
+  // Three rows, plus the other one
+  for (int i = 0; i < 2; i++) {
+    for (int j = i + 1; j < 3; j++) {
+      for (int k = j + 1; k < 4; k++) {
+        memcpy(rows, cell + 4 * i, 4);
+        memcpy(rows + 4, cell + 4 * j, 4);
+        memcpy(rows + 8, cell + 4 * k, 4);
+        distance = find_rows(state, state->tab_triple, hash_rows(rows, 3, hash_log), rows, 3,
+                             anchor);
+        if (distance == 0) {
+          continue;
         }
+        *op++ = (uint8_t)(i == 1 ? TOKEN_TRIPLE : TOKEN_TRIPLE | (j + k - 2) << 3U);
+        write_u16(op, distance);
+        op += 2;
+        int l = 6 - i - j - k;
+        memcpy(op, cell + 4 * l, 4);
+        return op + 4;
+      }
+    }
+  }
 
-        bool alleq = true;
-        for (int i = 1; i < 16; i++) {
-          if (buf_cell[i] != buf_cell[0]) {
-            alleq = false;
-            break;
-          }
+  // Two rows, plus the other two
+  for (int i = 0; i < 3; i++) {
+    for (int j = i + 1; j < 4; j++) {
+      memcpy(rows, cell + 4 * i, 4);
+      memcpy(rows + 4, cell + 4 * j, 4);
+      distance = find_rows(state, state->tab_pair, hash_rows(rows, 2, hash_log), rows, 2, anchor);
+      if (distance == 0) {
+        continue;
+      }
+      *op++ = (uint8_t)(i == 2 ? TOKEN_PAIR : TOKEN_PAIR | i << 5U | j << 3U);
+      write_u16(op, distance);
+      op += 2;
+      for (int k = 0; k < 4; k++) {
+        if (k != i && k != j) {
+          memcpy(op, cell + 4 * k, 4);
+          op += 4;
         }
-        if (alleq) {                              // all elements of the cell equal
-          token = (uint8_t) (1U << 6U);
-          *op++ = token;
-          *op++ = buf_cell[0];
-
-        } else if (distance == 0 || (distance >= MAX_DISTANCE)) {   // no cell match
-          bool literal = true;
-
-          // 2 rows pairs matches
-
-          for (int j = 1; j < 4; j++) {
-            memcpy(buf_pair, buf_cell, 4);
-            memcpy(&buf_pair[4], &buf_cell[j * 4], 4);
-            hval = XXH32(buf_pair, 8, 1);        // calculate rows pair hash
-            hval >>= 32U - 12U;
-            ref = obase + tab_pair[hval];
-            /* calculate distance to the match */
-            bool same = true;
-            uint16_t offset;
-            if (tab_pair[hval] != 0) {
-              buf_aux = obase + tab_pair[hval];
-              for (int k = 0; k < 8; k++) {
-                //     printf("buf_pair[i]: %u, buf_aux: %u \n", buf_pair[k], buf_aux[k]);
-                if (buf_pair[k] != buf_aux[k]) {
-                  same = false;
-                  break;
-                }
-              }
-              offset = (uint16_t) (anchor - obase - tab_pair[hval]);
-            } else {
-              same = false;
-            }
-            if (same) {
-              distance = (int32_t) (anchor - ref);
-            } else {
-              distance = 0;
-            }
-            if ((distance != 0) && (distance < MAX_DISTANCE)) {     /* rows pair match */
-              int k, m, l = -1;
-              for (k = 1; k < 4; k++) {
-                if (k != j) {
-                  if (l == -1) {
-                    l = k;
-                  } else {
-                    m = k;
-                  }
-                }
-              }
-              memcpy(buf_pair, &buf_cell[l * 4], 4);
-              memcpy(&buf_pair[4], &buf_cell[m * 4], 4);
-              hval = XXH32(buf_pair, 8, 1);        // calculate rows pair hash
-              hval >>= 32U - 12U;
-              ref = obase + tab_pair[hval];
-              same = true;
-              if (tab_pair[hval] != 0) {
-                buf_aux = obase + tab_pair[hval];
-                for (k = 0; k < 8; k++) {
-                   //    printf("buf_pair[i]: %u, buf_aux: %u \n", buf_pair[k], buf_aux[k]);
-                  if (buf_pair[k] != buf_aux[k]) {
-                    same = false;
-                    break;
-                  }
-                }
-              } else {
-                same = false;
-              }
-              if (same) {
-                distance = (int32_t) (anchor - l * 4 - ref);
-              } else {
-                distance = 0;
-              }
-              if ((distance != 0) && (distance < MAX_DISTANCE)) {   /* 2 pair matches */
-                literal = false;
-                token = (uint8_t) ((1U << 5U) | (j << 3U));
-                *op++ = token;
-                uint16_t offset_2 = (uint16_t) (anchor - obase - tab_pair[hval]);
-                *(uint16_t *) op = offset;
-                op += sizeof(offset);
-                *(uint16_t *) op = offset_2;
-                op += sizeof(offset_2);
-                goto match;
-              }
-            }
-          }
+      }
+      return op;
+    }
+  }
 
-          // rows triples
-          for(int i = 0; i < 2; i++) {
-            memcpy(buf_triple, &buf_cell[i * 4], 4);
-            for (int j = i + 1; j < 3; j++) {
-              memcpy(&buf_triple[4], &buf_cell[j * 4], 4);
-              for (int k = j + 1; k < 4; k++) {
-                memcpy(&buf_triple[8], &buf_cell[k * 4], 4);
-                hval = XXH32(buf_triple, 12, 1);        // calculate triple hash
-                hval >>= 32U - 12U;
-                /* calculate distance to the match */
-                bool same = true;
-                uint16_t offset;
-                if (tab_triple[hval] != 0) {
-                  buf_aux = obase + tab_triple[hval];
-                  for (int l = 0; l < 12; l++) {
-                    // printf("bufthr[i]: %u, bufaux: %u \n", buf_triple[l], buf_aux[l]);
-                    if (buf_triple[l] != buf_aux[l]) {
-                      same = false;
-                      break;
-                    }
-                  }
-                  offset = (uint16_t) (anchor - obase - tab_triple[hval]);
-                } else {
-                  same = false;
-                  if ((j - i == 1) && (k - j == 1)) {
-                    update_triple[i] = (uint32_t) (anchor + 1 + i * 4 - obase);     /* update hash table */
-                    hash_triple[i] = hval;
-                  }
-                }
-                ref = obase + tab_triple[hval];
-
-                if (same) {
-                  distance = (int32_t) (anchor - i * 4 - ref);
-                } else {
-                  distance = 0;
-                }
-                if ((distance != 0) && (distance < MAX_DISTANCE)) {
-                  literal = false;
-                  if (i == 1) {
-                    token = (uint8_t) (7U << 5U);
-                  } else {
-                    token = (uint8_t) ((7U << 5U) | ((j + k - 2) << 3U));
-                  }
-                  *op++ = token;
-                  memcpy(op, &offset, 2);
-                  op += 2;
-                  for (int l = 0; l < 4; l++) {
-                    if ((l != i) && (l != j) && (l != k)) {
-                      memcpy(op, &buf_cell[4 * l], 4);
-                      op += 4;
-                      goto match;
-                    }
-                  }
-                }
-              }
-            }
-          }
+  // A literal, which can be referenced by the next cells
+  *op++ = TOKEN_LITERAL;
+  uint32_t position = (uint32_t)(op - state->obase);
+  state->tab_cell[hash_cell] = position;
+  for (int i = 0; i < 3; i++) {
+    state->tab_pair[hash_rows(cell + 4 * i, 2, hash_log)] = position + 4 * i;
+  }
+  for (int i = 0; i < 2; i++) {
+    state->tab_triple[hash_rows(cell + 4 * i, 3, hash_log)] = position + 4 * i;
+  }
+  memcpy(op, cell, CELL_SIZE);
+  return op + CELL_SIZE;
+}
 
-          // rows pairs
-          for(int i = 0; i < 3; i++) {
-            memcpy(buf_pair, &buf_cell[i * 4], 4);
-            for (int j = i + 1; j < 4; j++) {
-              memcpy(&buf_pair[4], &buf_cell[j * 4], 4);
-              hval = XXH32(buf_pair, 8, 1);        // calculate rows pair hash
-              hval >>= 32U - 12U;
-              ref = obase + tab_pair[hval];
-              /* calculate distance to the match */
-              bool same = true;
-              uint16_t offset;
-              if (tab_pair[hval] != 0) {
-                buf_aux = obase + tab_pair[hval];
-                for(int k = 0; k < 8; k++){
-             //     printf("buf_pair[i]: %u, buf_aux: %u \n", buf_pair[k], buf_aux[k]);
-                  if(buf_pair[k] != buf_aux[k]) {
-                    same = false;
-                    break;
-                  }
-                }
-                offset = (uint16_t) (anchor - obase - tab_pair[hval]);
-              } else {
-                same = false;
-                if (j - i == 1) {
-                  update_pair[i] = (uint32_t) (anchor + 1 + i * 4 - obase);     /* update hash table */
-                  hash_pair[i] = hval;
-                }
-              }
-              if (same) {
-                distance = (int32_t) (anchor - i * 4 - ref);
-              } else {
-                distance = 0;
-              }
-              if ((distance != 0) && (distance < MAX_DISTANCE)) {     /* rows pair match */
-                literal = false;
-                if (i == 2) {
-                    token = (uint8_t) (1U << 7U);
-                } else {
-                  token = (uint8_t) ((1U << 7U) | (i << 5U) | (j << 3U));
-                }
-                *op++ = token;
-                memcpy(op, &offset, 2);
-                op += 2;
-                for (int k = 0; k < 4; k++) {
-                  if ((k != i) && (k != j)) {
-                    memcpy(op, &buf_cell[4 * k], 4);
-                    op += 4;
-                  }
-                }
-                goto match;
-              }
-            }
-          }
 
-          match:
-          if (literal) {
-            tab_cell[hash_cell] = (uint32_t) (anchor + 1 - obase);     /* update hash tables */
-            if (update_triple[0] != 0) {
-              for (int h = 0; h < 2; h++) {
-                tab_triple[hash_triple[h]] = update_triple[h];
-              }
-            }
-            if (update_pair[0] != 0) {
-              for (int h = 0; h < 3; h++) {
-                tab_pair[hash_pair[h]] = update_pair[h];
-              }
-            }
-            token = 0;
-            *op++ = token;
-            memcpy(op, buf_cell, 16);
-            op += 16;
-          }
+/* Encode a 2-dim image with nrows x ncols bytes at op.  Return NULL if it does not fit. */
+static uint8_t* encode_image(ndlz_state* state, const uint8_t* ip, int32_t nrows, int32_t ncols,
+                             uint8_t* op) {
+  uint8_t cell[CELL_SIZE];
 
-        } else {   // cell match
-          token = (uint8_t )((1U << 7U) | (1U << 6U));
-          *op++ = token;
-          uint16_t offset = (uint16_t) (anchor - obase - tab_cell[hash_cell]);
-          memcpy(op, &offset, 2);
-          op += 2;
+  for (int32_t row = 0; row < nrows; row += 4) {
+    int32_t cell_rows = nrows - row < 4 ? nrows - row : 4;
+    for (int32_t col = 0; col < ncols; col += 4) {
+      int32_t cell_cols = ncols - col < 4 ? ncols - col : 4;
+      // The largest encoding is a literal cell
+      if (NDLZ_UNEXPECT_CONDITIONAL(op + 1 + CELL_SIZE > state->op_limit)) {
+        return NULL;
+      }
+      const uint8_t* orig = ip + (int64_t)row * ncols + col;
+      if (cell_rows < 4 || cell_cols < 4) {
+        // Cells at the edges are not full, so they go literally
+        *op++ = TOKEN_LITERAL;
+        for (int i = 0; i < cell_rows; i++) {
+          memcpy(op, orig + (int64_t)i * ncols, (size_t)cell_cols);
+          op += cell_cols;
         }
-
+        continue;
       }
-      if((op - obase) > length) {
-        printf("Compressed data is bigger than input! \n");
-        return 0;
+      for (int i = 0; i < 4; i++) {
+        memcpy(cell + 4 * i, orig + (int64_t)i * ncols, 4);
       }
-   //g   printf("\n token %u, pad [%u, %u] \n", token, padding[0], padding[1]);
+      op = encode_cell(state, cell, op);
     }
   }
-
-  return (int)(op - obase);
+  return op;
 }
 
 
-// See https://habr.com/en/company/yandex/blog/457612/
-#ifdef __AVX2__
+/* Get the shape (in bytes) of the image (or stack of images) that a block is seen as. */
+static int block_shape(const blosc2_context* context, int length, int32_t* shape) {
+  int ndim = context->ndim;
+  int32_t typesize = context->typesize;
+  bool shuffle = typesize > 1 && (context->filter_flags & BLOSC_DOSHUFFLE);
+  int64_t nbytes = typesize;
+  for (int i = 0; i < ndim; i++) {
+    nbytes *= context->blockshape[i];
+  }
 
-#if defined(_MSC_VER)
-#define ALIGNED_(x) __declspec(align(x))
-#else
-#if defined(__GNUC__)
-#define ALIGNED_(x) __attribute__ ((aligned(x)))
-#endif
-#endif
-#define ALIGNED_TYPE_(t, x) t ALIGNED_(x)
-
-static unsigned char* copy_match_16(unsigned char *op, const unsigned char *match, int32_t len)
-{
-  size_t offset = op - match;
-  while (len >= 16) {
-
-    static const ALIGNED_TYPE_(uint8_t, 16) masks[] =
-      {
-                0,  1,  2,  1,  4,  1,  4,  2,  8,  7,  6,  5,  4,  3,  2,  1, // offset = 0, not used as mask, but for shift
-                0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, // offset = 1
-                0,  1,  0,  1,  0,  1,  0,  1,  0,  1,  0,  1,  0,  1,  0,  1,
-                0,  1,  2,  0,  1,  2,  0,  1,  2,  0,  1,  2,  0,  1,  2,  0,
-                0,  1,  2,  3,  0,  1,  2,  3,  0,  1,  2,  3,  0,  1,  2,  3,
-                0,  1,  2,  3,  4,  0,  1,  2,  3,  4,  0,  1,  2,  3,  4,  0,
-                0,  1,  2,  3,  4,  5,  0,  1,  2,  3,  4,  5,  0,  1,  2,  3,
-                0,  1,  2,  3,  4,  5,  6,  0,  1,  2,  3,  4,  5,  6,  0,  1,
-                0,  1,  2,  3,  4,  5,  6,  7,  0,  1,  2,  3,  4,  5,  6,  7,
-                0,  1,  2,  3,  4,  5,  6,  7,  8,  0,  1,  2,  3,  4,  5,  6,
-                0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  0,  1,  2,  3,  4,  5,
-                0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10,  0,  1,  2,  3,  4,
-                0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11,  0,  1,  2,  3,
-                0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12,  0,  1,  2,
-                0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13,  0,  1,
-                0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,  0,
-                0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,  15, // offset = 16
-      };
-
-    _mm_storeu_si128((__m128i *)(op),
-                     _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(match)),
-                                      _mm_load_si128((const __m128i *)(masks) + offset)));
-
-    match += masks[offset];
-
-    op += 16;
-    len -= 16;
+  if (ndim >= 2 && nbytes == length) {
+    // The leading dimensions are stacked, and so are the byte planes of shuffled items
+    int nshape = ndim == 2 ? 2 : 3;
+    shape[0] = 1;
+    for (int i = 0; i < ndim - 2; i++) {
+      shape[0] *= context->blockshape[i];
+    }
+    shape[nshape - 2] = context->blockshape[ndim - 2];
+    shape[nshape - 1] = context->blockshape[ndim - 1];
+    if (shuffle) {
+      shape[0] *= typesize;
+    }
+    else {
+      shape[nshape - 1] *= typesize;
+    }
+    return nshape;
   }
-  // Deal with remainders
-  for (; len > 0; len--) {
-    *op++ = *match++;
+
+  // Leftover blocks keep the rows of the full blocks, and blocks without shape get square rows
+  int32_t ncols = 4;
+  if (ndim >= 2) {
+    ncols = context->blockshape[ndim - 1] * (shuffle ? 1 : typesize);
   }
-  return op;
+  else {
+    while ((int64_t)ncols * ncols * 4 <= length) {
+      ncols *= 2;
+    }
+  }
+  shape[0] = length / ncols;
+  shape[1] = ncols;
+  return 2;
 }
-#endif
 
 
-int ndlz_decompress(const void* input, int length, void* output, int maxout) {
-
-  uint8_t* ip = (uint8_t*)input;
-  uint8_t* ip_limit = ip + length;
+int ndlz_compress(blosc2_context* context, const void* input, int length,
+                  void* output, int maxout) {
+  const uint8_t* ip = (const uint8_t*)input;
   uint8_t* op = (uint8_t*)output;
-  uint8_t ndim;
-  uint32_t blockshape[2];
-  uint32_t eshape[2];
-  uint8_t* buffercpy;
-  uint8_t local_buffer[16];
-  uint8_t token;
-  if (NDLZ_UNEXPECT_CONDITIONAL(length <= 0)) {
+  int32_t shape[3];
+  int ndim = block_shape(context, length, shape);
+  int header_len = 1 + 4 * ndim;
+
+  if (length < CELL_SIZE || maxout < header_len + 1 + CELL_SIZE) {
     return 0;
   }
 
-  /* we start with literal copy */
-  ndim = *ip;
-  ip ++;
-  memcpy(&blockshape[0], ip, 4);
-  ip += 4;
-  memcpy(&blockshape[1], ip, 4);
-  ip += 4;
-  eshape[0] = ((blockshape[0] + 3) / 4) * 4;
-  eshape[1] = ((blockshape[1] + 3) / 4) * 4;
-
-  memset(op, 0, blockshape[0] * blockshape[1]);
-
-  uint32_t i_stop[2];
-  for (int i = 0; i < 2; ++i) {
-    i_stop[i] = eshape[i] / 4;
+  ndlz_state state;
+  state.obase = op;
+  state.op_limit = op + maxout;
+  // Small blocks do not need the whole hash tables
+  state.hash_log = MIN_HASH_LOG;
+  while (state.hash_log < HASH_LOG && (1 << state.hash_log) < length / CELL_SIZE) {
+    state.hash_log++;
+  }
+  size_t table_size = sizeof(uint32_t) << state.hash_log;
+  memset(state.tab_cell, 0, table_size);
+  memset(state.tab_triple, 0, table_size);
+  memset(state.tab_pair, 0, table_size);
+
+  *op++ = (uint8_t)ndim;
+  for (int i = 0; i < ndim; i++) {
+    _sw32(op, shape[i]);
+    op += 4;
+  }
+
+  int32_t nimages = ndim == 3 ? shape[0] : 1;
+  int32_t nrows = shape[ndim - 2];
+  int32_t ncols = shape[ndim - 1];
+  for (int32_t n = 0; n < nimages; n++) {
+    // The images of a stack share the hash tables, so cells can match those of previous images
+    op = encode_image(&state, ip + (int64_t)n * nrows * ncols, nrows, ncols, op);
+    if (op == NULL) {
+      return 0;
+    }
   }
 
- // printf("\n decomp \n");
-
-  /* main loop */
-  uint32_t ii[2];
-  uint32_t padding[2];
-  uint32_t ind;
-  uint8_t cell_aux[16];
-  for (ii[0] = 0; ii[0] < i_stop[0]; ++ii[0]) {
-    for (ii[1] = 0; ii[1] < i_stop[1]; ++ii[1]) {      // for each cell
-      if (ii[0] == i_stop[0] - 1) {
-        padding[0] = (blockshape[0] % 4 == 0) ? 4 : blockshape[0] % 4;
-      } else {
-        padding[0] = 4;
+  int32_t tail = length - nimages * nrows * ncols;
+  if (op + tail > state.op_limit || op + tail - state.obase >= length) {
+    return 0;
+  }
+  memcpy(op, ip + length - tail, (size_t)tail);
+  op += tail;
+
+  return (int)(op - state.obase);
+}
+
+
+/* Decode the cell at ip into cell.  Return the position after its data, or NULL on errors. */
+static const uint8_t* decode_cell(const uint8_t* ip, const uint8_t* ip_limit, const uint8_t* ibase,
+                                  uint8_t* cell) {
+  const uint8_t* anchor = ip;
+  uint8_t token = *ip++;
+  int i, j, k, l, m;
+
+  switch (token >> 5U) {
+    case TOKEN_LITERAL >> 5U:
+      if (token == TOKEN_LITERAL) {
+        if (ip_limit - ip < CELL_SIZE) {
+          return NULL;
+        }
+        memcpy(cell, ip, CELL_SIZE);
+        return ip + CELL_SIZE;
       }
-      if (ii[1] == i_stop[1] - 1) {
-        padding[1] = (blockshape[1] % 4 == 0) ? 4 : blockshape[1] % 4;
-      } else {
-        padding[1] = 4;
+      return NULL;
+    case TOKEN_PAIRS >> 5U: {
+      j = (token >> 3U) & 3U;
+      if ((token & 7U) != 0 || j == 0 || ip_limit - ip < 4) {
+        return NULL;
       }
-      token = *ip++;
-    //  printf("token %u, pad [%u, %u] \n", token, padding[0], padding[1]);
-      if (token == 0){    // no match
-        buffercpy = ip;
-        ip += padding[0] * padding[1];
-      } else if (token == (uint8_t)((1U << 7U) | (1U << 6U))) {  // cell match
-        uint16_t offset = *((uint16_t*) ip);
-        buffercpy = ip - offset - 1;
-        ip += 2;
-      } else if (token == (uint8_t)(1U << 6U)) { // whole cell of same element
-        buffercpy = cell_aux;
-        memset(buffercpy, *ip, 16);
-        ip++;
-      } else if ((token >= 224) && (token <= 255)) { // three rows match
-        buffercpy = local_buffer;
-        uint16_t offset = *((uint16_t*) ip);
-        offset += 3;
-        ip += 2;
-        int i, j, k;
-        if ((token >> 3U) == 28) {
-          i = 1;
-          j = 2;
-          k = 3;
-        } else {
-          i = 0;
-          if ((token >> 3U) < 30) {
-            j = 1;
-            k = 2;
-          } else {
-            k = 3;
-            if ((token >> 3U) == 30) {
-              j = 1;
-            } else {
-              j = 2;
-            }
-          }
-        }
-        memcpy(&buffercpy[i * 4], ip - offset, 4);
-        memcpy(&buffercpy[j * 4], ip - offset + 4, 4);
-        memcpy(&buffercpy[k * 4], ip - offset + 8, 4);
-        for (int l = 0; l < 4; l++) {
-          if ((l != i) && (l != j) && (l != k)) {
-            memcpy(&buffercpy[l * 4], ip, 4);
-            ip += 4;
-            break;
-          }
+      uint16_t distance = read_u16(ip);
+      uint16_t distance2 = read_u16(ip + 2);
+      if (distance < 8 || distance > anchor - ibase || distance2 < 8 || distance2 > anchor - ibase) {
+        return NULL;
+      }
+      l = j == 1 ? 2 : 1;
+      m = j == 3 ? 2 : 3;
+      memcpy(cell, anchor - distance, 4);
+      memcpy(cell + 4 * j, anchor - distance + 4, 4);
+      memcpy(cell + 4 * l, anchor - distance2, 4);
+      memcpy(cell + 4 * m, anchor - distance2 + 4, 4);
+      return ip + 4;
+    }
+    case TOKEN_RUN >> 5U:
+      if (token != TOKEN_RUN || ip_limit - ip < 1) {
+        return NULL;
+      }
+      memset(cell, *ip, CELL_SIZE);
+      return ip + 1;
+    case TOKEN_CELL >> 5U: {
+      if (token != TOKEN_CELL || ip_limit - ip < 2) {
+        return NULL;
+      }
+      uint16_t distance = read_u16(ip);
+      if (distance < CELL_SIZE || distance > anchor - ibase) {
+        return NULL;
+      }
+      memcpy(cell, anchor - distance, CELL_SIZE);
+      return ip + 2;
+    }
+    case TOKEN_TRIPLE >> 5U: {
+      if ((token & 7U) != 0 || ip_limit - ip < 2 + 4) {
+        return NULL;
+      }
+      switch ((token >> 3U) & 3U) {
+        case 0:
+          i = 1, j = 2, k = 3;
+          break;
+        case 1:
+          i = 0, j = 1, k = 2;
+          break;
+        case 2:
+          i = 0, j = 1, k = 3;
+          break;
+        default:
+          i = 0, j = 2, k = 3;
+      }
+      uint16_t distance = read_u16(ip);
+      if (distance < 12 || distance > anchor - ibase) {
+        return NULL;
+      }
+      memcpy(cell + 4 * i, anchor - distance, 4);
+      memcpy(cell + 4 * j, anchor - distance + 4, 4);
+      memcpy(cell + 4 * k, anchor - distance + 8, 4);
+      memcpy(cell + 4 * (6 - i - j - k), ip + 2, 4);
+      return ip + 2 + 4;
+    }
+    default: {
+      // TOKEN_PAIR
+      if (token == TOKEN_PAIR) {
+        i = 2, j = 3;
+      }
+      else {
+        i = (token >> 5U) & 1U;
+        j = (token >> 3U) & 3U;
+      }
+      if ((token & 7U) != 0 || j <= i || ip_limit - ip < 2 + 8) {
+        return NULL;
+      }
+      uint16_t distance = read_u16(ip);
+      if (distance < 8 || distance > anchor - ibase) {
+        return NULL;
+      }
+      memcpy(cell + 4 * i, anchor - distance, 4);
+      memcpy(cell + 4 * j, anchor - distance + 4, 4);
+      ip += 2;
+      for (k = 0; k < 4; k++) {
+        if (k != i && k != j) {
+          memcpy(cell + 4 * k, ip, 4);
+          ip += 4;
         }
+      }
+      return ip;
+    }
+  }
+}
+
+
+int ndlz_decompress(const void* input, int length, void* output, int maxout) {
+  const uint8_t* ibase = (const uint8_t*)input;
+  const uint8_t* ip = ibase;
+  const uint8_t* ip_limit = ip + length;
+  uint8_t* op = (uint8_t*)output;
+  uint8_t cell[CELL_SIZE];
+  int32_t shape[3];
+
+  if (NDLZ_UNEXPECT_CONDITIONAL(length <= 0)) {
+    return 0;
+  }
+  int ndim = *ip++;
+  if (ndim < 2 || ndim > 3 || length < 1 + 4 * ndim) {
+    return 0;
+  }
+  int64_t nbytes = 1;
+  for (int i = 0; i < ndim; i++) {
+    shape[i] = sw32_(ip);
+    ip += 4;
+    // Checking every step keeps the product of (untrusted) dims from overflowing
+    if (shape[i] <= 0 || shape[i] > maxout) {
+      return 0;
+    }
+    nbytes *= shape[i];
+    if (nbytes > maxout) {
+      return 0;
+    }
+  }
 
-      } else if ((token >= 128) && (token <= 191)){ // rows pair match
-        buffercpy = local_buffer;
-        uint16_t offset = *((uint16_t*) ip);
-        offset += 3;
-        ip += 2;
-        int i, j;
-        if (token == 128) {
-          i = 2;
-          j = 3;
-        } else {
-          i = (token - 128) >> 5U;
-          j = ((token - 128) >> 3U) - (i << 2U);
+  int32_t nimages = ndim == 3 ? shape[0] : 1;
+  int32_t nrows = shape[ndim - 2];
+  int32_t ncols = shape[ndim - 1];
+  for (int32_t n = 0; n < nimages; n++) {
+    uint8_t* image = op + (int64_t)n * nrows * ncols;
+    for (int32_t row = 0; row < nrows; row += 4) {
+      int32_t cell_rows = nrows - row < 4 ? nrows - row : 4;
+      for (int32_t col = 0; col < ncols; col += 4) {
+        int32_t cell_cols = ncols - col < 4 ? ncols - col : 4;
+        uint8_t* orig = image + (int64_t)row * ncols + col;
+        if (NDLZ_UNEXPECT_CONDITIONAL(ip >= ip_limit)) {
+          return 0;
         }
-        memcpy(&buffercpy[i * 4], ip - offset, 4);
-        memcpy(&buffercpy[j * 4], ip - offset + 4, 4);
-        for (int k = 0; k < 4; k++) {
-          if ((k != i) && (k != j)) {
-            memcpy(&buffercpy[k * 4], ip, 4);
-            ip += 4;
+        if (cell_rows < 4 || cell_cols < 4) {
+          if (*ip++ != TOKEN_LITERAL || ip_limit - ip < cell_rows * cell_cols) {
+            return 0;
           }
-        }
-      } else if ((token >= 40) && (token <= 63)) {  // 2 rows pair matches
-        buffercpy = local_buffer;
-        uint16_t offset_1 = *((uint16_t*) ip);
-        offset_1 += 5;
-        ip += 2;
-        uint16_t offset_2 = *((uint16_t*) ip);
-        offset_2 += 5;
-        ip += 2;
-        int i, j, k, l, m;
-        i = 0;
-        j = ((token - 32) >> 3U);
-        l = -1;
-        for (k = 1; k < 4; k++) {
-          if ((k != i) && (k != j)) {
-            if (l == -1) {
-              l = k;
-            } else {
-              m = k;
-            }
+          for (int i = 0; i < cell_rows; i++) {
+            memcpy(orig + (int64_t)i * ncols, ip, (size_t)cell_cols);
+            ip += cell_cols;
           }
+          continue;
         }
-        memcpy(&buffercpy[i * 4], ip - offset_1, 4);
-        memcpy(&buffercpy[j * 4], ip - offset_1 + 4, 4);
-        memcpy(&buffercpy[l * 4], ip - offset_2, 4);
-        memcpy(&buffercpy[m * 4], ip - offset_2 + 4, 4);
-
-      } else {
-     //   printf("Invalid token: %u at cell [%d, %d]\n", token, ii[0], ii[1]);
-        return 0;
-      }
-      // fill op with buffercpy
-      uint32_t orig = ii[0] * 4 * blockshape[1] + ii[1] * 4;
-      for (int i = 0; i < 4; i++) {
-        if (i < padding[0]) {
-          ind = orig + i * blockshape[1];
-          memcpy(&op[ind], buffercpy, padding[1]);
+        ip = decode_cell(ip, ip_limit, ibase, cell);
+        if (NDLZ_UNEXPECT_CONDITIONAL(ip == NULL)) {
+          return 0;
+        }
+        for (int i = 0; i < 4; i++) {
+          memcpy(orig + (int64_t)i * ncols, cell + 4 * i, 4);
         }
-        buffercpy += padding[1];
       }
     }
   }
-  ind += padding[1];
 
-  if (ind != (blockshape[0] * blockshape[1])) {
-    printf("Output size is not compatible with embeded blockshape \n");
-    return 0;
-  }
-  if (ind > maxout) {
-    printf("Output size is bigger than max \n");
+  int32_t tail = (int32_t)(ip_limit - ip);
+  if (nbytes + tail > maxout) {
     return 0;
   }
+  memcpy(op + nbytes, ip, (size_t)tail);
 
-  return ind;
+  return (int)(nbytes + tail);
 }
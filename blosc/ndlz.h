@@ -15,14 +15,6 @@
 #if defined (__cplusplus)
 extern "C" {
 #endif
-#define XXH_INLINE_ALL
-#include <xxhash.h>
-/*
-#include <stdio.h>
-#include "blosc2-common.h"
-#include "fastcopy.h"
-*/
-
 #define NDLZ_VERSION_STRING "1.0.0"
 
 
@@ -31,18 +23,16 @@ extern "C" {
   compressed block. The size of input buffer is specified by
   length. The minimum input buffer size is 16.
 
-  The output buffer must be at least 5% larger than the input buffer
-  and can not be smaller than 66 bytes.
+  The block is seen as a 2-dim image of bytes (or a stack of them) with
+  the blockshape and typesize in context, when the block is full and
+  has 2 or more dimensions.  Otherwise (e.g. for leftover blocks) the
+  block is seen as an image with rows of the same length (or square
+  rows when there is no blockshape), and its last bytes go literally.
 
   If the input is not compressible, or output does not fit in maxout
   bytes, the return value will be 0 and you will have to discard the
   output buffer.
 
-  The acceleration parameter is related with the frequency for
-  updating the internal hash.  An acceleration of 1 means that the
-  internal hash is updated at full rate.  A value < 1 is not allowed
-  and will be silently set to 1.
-
   The input buffer and the output buffer can not overlap.
 */
 
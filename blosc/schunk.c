@@ -11,10 +11,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <float.h>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
 #include "blosc2.h"
 #include "blosc-private.h"
 #include "context.h"
 #include "frame.h"
+#include "xxhash64.h"
 
 #if defined(_WIN32) && !defined(__MINGW32__)
   #include <windows.h>
@@ -35,6 +42,199 @@
 #endif
 
 
+/* Store an integer in big-endian byte order (as msgpack does) */
+static void store_be(uint8_t *dest, uint64_t value, int size) {
+  for (int i = 0; i < size; i++) {
+    dest[i] = (uint8_t)(value >> (8 * (size - 1 - i)));
+  }
+}
+
+
+/* Load an integer in big-endian byte order (as msgpack does) */
+static uint64_t load_be(const uint8_t *src, int size) {
+  uint64_t value = 0;
+  for (int i = 0; i < size; i++) {
+    value = (value << 8) | src[i];
+  }
+  return value;
+}
+
+
+/* Serialize the n-dimensional shapes of the cparams as the content of the ndim metalayer.
+ *
+ * The content is a msgpack array with the version, ndim, shape (int64 items), chunkshape
+ * and blockshape (int32 items).
+ */
+static int32_t ndim_meta_to_buffer(const blosc2_cparams *cparams, uint8_t **content) {
+  int8_t ndim = cparams->ndim;
+  int32_t content_len = 3 + 3 + ndim * (9 + 5 + 5);
+  uint8_t *pmeta = malloc((size_t)content_len);
+  *content = pmeta;
+  *pmeta++ = 0x90 + 5;  // fixarray with 5 entries
+  *pmeta++ = BLOSC2_NDIM_METALAYER_VERSION;  // positive fixint
+  *pmeta++ = (uint8_t)ndim;  // positive fixint
+  *pmeta++ = (uint8_t)(0x90 + ndim);
+  for (int i = 0; i < ndim; i++) {
+    *pmeta++ = 0xd3;  // int64
+    store_be(pmeta, (uint64_t)cparams->shape[i], sizeof(int64_t));
+    pmeta += sizeof(int64_t);
+  }
+  *pmeta++ = (uint8_t)(0x90 + ndim);
+  for (int i = 0; i < ndim; i++) {
+    *pmeta++ = 0xd2;  // int32
+    store_be(pmeta, (uint32_t)cparams->chunkshape[i], sizeof(int32_t));
+    pmeta += sizeof(int32_t);
+  }
+  *pmeta++ = (uint8_t)(0x90 + ndim);
+  for (int i = 0; i < ndim; i++) {
+    *pmeta++ = 0xd2;  // int32
+    store_be(pmeta, (uint32_t)cparams->blockshape[i], sizeof(int32_t));
+    pmeta += sizeof(int32_t);
+  }
+  return content_len;
+}
+
+
+/* Deserialize the content of the ndim metalayer into the n-dimensional shapes of the cparams. */
+static int ndim_meta_from_buffer(const uint8_t *content, int32_t content_len,
+                                 blosc2_cparams *cparams) {
+  if (content_len < 6 || content[0] != 0x90 + 5 || content[1] != BLOSC2_NDIM_METALAYER_VERSION) {
+    BLOSC_TRACE_ERROR("The content of the ndim metalayer is not supported.");
+    return -1;
+  }
+  int8_t ndim = (int8_t)content[2];
+  if (ndim < 1 || ndim > BLOSC2_MAX_DIM || content_len != 3 + 3 + ndim * (9 + 5 + 5)) {
+    BLOSC_TRACE_ERROR("The content of the ndim metalayer is corrupted.");
+    return -1;
+  }
+  const uint8_t *pmeta = content + 3;
+  for (int entry = 0; entry < 3; entry++) {
+    if (*pmeta++ != 0x90 + ndim) {
+      BLOSC_TRACE_ERROR("The content of the ndim metalayer is corrupted.");
+      return -1;
+    }
+    int size = entry == 0 ? sizeof(int64_t) : sizeof(int32_t);
+    for (int i = 0; i < ndim; i++) {
+      if (*pmeta++ != (entry == 0 ? 0xd3 : 0xd2)) {
+        BLOSC_TRACE_ERROR("The content of the ndim metalayer is corrupted.");
+        return -1;
+      }
+      uint64_t value = load_be(pmeta, size);
+      pmeta += size;
+      switch (entry) {
+        case 0:
+          cparams->shape[i] = (int64_t)value;
+          break;
+        case 1:
+          cparams->chunkshape[i] = (int32_t)(uint32_t)value;
+          break;
+        default:
+          cparams->blockshape[i] = (int32_t)(uint32_t)value;
+      }
+    }
+  }
+  cparams->ndim = ndim;
+  return 0;
+}
+
+
+/* Get the n-dimensional shapes in the ndim metalayer of a super-chunk (if any) into cparams.
+ *
+ * Return 1 if the super-chunk has the metalayer, 0 if not, or a negative code on errors.
+ */
+static int schunk_ndim_cparams(blosc2_schunk *schunk, blosc2_cparams *cparams) {
+  int nmetalayer = blosc2_has_metalayer(schunk, BLOSC2_NDIM_METALAYER);
+  if (nmetalayer < 0) {
+    return 0;
+  }
+  blosc2_metalayer *metalayer = schunk->metalayers[nmetalayer];
+  int rc = ndim_meta_from_buffer(metalayer->content, metalayer->content_len, cparams);
+  return rc < 0 ? rc : 1;
+}
+
+
+/* The layout of an n-dimensional super-chunk.
+ *
+ * The array is split into chunks of chunkshape items, which are kept in C order.  Every chunk
+ * is split into blocks of blockshape items, which are kept in C order too (so the chunks are
+ * padded up to a multiple of blockshape, and the chunks at the edges of the array are padded up
+ * to chunkshape, with zeros).  The items of every block are in C order.
+ */
+typedef struct {
+  int8_t ndim;
+  int32_t typesize;
+  int64_t shape[BLOSC2_MAX_DIM];
+  int32_t chunkshape[BLOSC2_MAX_DIM];
+  int32_t blockshape[BLOSC2_MAX_DIM];
+  int64_t chunks_in_array[BLOSC2_MAX_DIM];
+  int64_t blocks_in_chunk[BLOSC2_MAX_DIM];
+  int64_t nchunks;
+  int32_t nblocks;
+  int32_t blocksize;     // in bytes
+  int32_t chunk_nbytes;
+} ndim_layout;
+
+
+/* Check the n-dimensional shapes in cparams and compute the layout for them. */
+static int ndim_layout_new(const blosc2_cparams *cparams, int32_t typesize, ndim_layout *layout) {
+  int8_t ndim = cparams->ndim;
+  if (ndim < 1 || ndim > BLOSC2_MAX_DIM) {
+    BLOSC_TRACE_ERROR("ndim (%d) must be between 1 and %d.", ndim, BLOSC2_MAX_DIM);
+    return -1;
+  }
+  layout->ndim = ndim;
+  layout->typesize = typesize;
+  layout->nchunks = 1;
+  int64_t nblocks = 1;
+  int64_t blocksize = typesize;
+  for (int i = 0; i < ndim; i++) {
+    int64_t shape = cparams->shape[i];
+    int32_t chunkshape = cparams->chunkshape[i];
+    int32_t blockshape = cparams->blockshape[i];
+    if (shape < 0 || chunkshape <= 0 || blockshape <= 0 || blockshape > chunkshape) {
+      BLOSC_TRACE_ERROR("Bad shapes for dimension %d (shape: %lld, chunkshape: %d, "
+                        "blockshape: %d).", i, (long long)shape, chunkshape, blockshape);
+      return -1;
+    }
+    layout->shape[i] = shape;
+    layout->chunkshape[i] = chunkshape;
+    layout->blockshape[i] = blockshape;
+    layout->chunks_in_array[i] = shape == 0 ? 0 : (shape - 1) / chunkshape + 1;
+    layout->blocks_in_chunk[i] = (chunkshape + blockshape - 1) / blockshape;
+    if (layout->chunks_in_array[i] > 0 && layout->nchunks > INT32_MAX / layout->chunks_in_array[i]) {
+      BLOSC_TRACE_ERROR("The array cannot have more than %d chunks.", INT32_MAX);
+      return -1;
+    }
+    layout->nchunks *= layout->chunks_in_array[i];
+    nblocks *= layout->blocks_in_chunk[i];
+    blocksize *= blockshape;
+    if (nblocks > BLOSC_MAX_BUFFERSIZE || blocksize > BLOSC_MAX_BUFFERSIZE ||
+        nblocks * blocksize > BLOSC_MAX_BUFFERSIZE) {
+      BLOSC_TRACE_ERROR("The chunks cannot exceed %d bytes.", BLOSC_MAX_BUFFERSIZE);
+      return -1;
+    }
+  }
+  layout->nblocks = (int32_t)nblocks;
+  layout->blocksize = (int32_t)blocksize;
+  layout->chunk_nbytes = (int32_t)(nblocks * blocksize);
+  return 0;
+}
+
+
+/* Get the layout of an n-dimensional super-chunk. */
+static int schunk_ndim_layout(blosc2_schunk *schunk, ndim_layout *layout) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  int rc = schunk_ndim_cparams(schunk, &cparams);
+  if (rc <= 0) {
+    if (rc == 0) {
+      BLOSC_TRACE_ERROR("The super-chunk has no \"%s\" metalayer.", BLOSC2_NDIM_METALAYER);
+    }
+    return -1;
+  }
+  return ndim_layout_new(&cparams, schunk->typesize, layout);
+}
+
+
 /* Get the cparams associated with a super-chunk */
 int blosc2_schunk_get_cparams(blosc2_schunk *schunk, blosc2_cparams **cparams) {
   *cparams = calloc(sizeof(blosc2_cparams), 1);
@@ -52,6 +252,13 @@ int blosc2_schunk_get_cparams(blosc2_schunk *schunk, blosc2_cparams **cparams) {
   }
   else {
     (*cparams)->nthreads = (int16_t)schunk->cctx->nthreads;
+    (*cparams)->zonemap_type = schunk->cctx->zonemap_type;
+    (*cparams)->use_dict = schunk->cctx->use_dict;
+  }
+  if (schunk_ndim_cparams(schunk, *cparams) < 0) {
+    free(*cparams);
+    *cparams = NULL;
+    return -1;
   }
   return 0;
 }
@@ -73,7 +280,7 @@ int blosc2_schunk_get_dparams(blosc2_schunk *schunk, blosc2_dparams **dparams) {
 blosc2_storage* get_new_storage(const blosc2_storage* storage, const blosc2_cparams* cdefaults,
                                 const blosc2_dparams* ddefaults) {
   blosc2_storage* new_storage = (blosc2_storage*)calloc(1, sizeof(blosc2_storage));
-  memcpy(new_storage, &storage, sizeof(blosc2_storage));
+  memcpy(new_storage, storage, sizeof(blosc2_storage));
   if (storage->path != NULL) {
     size_t pathlen = strlen(storage->path);
     new_storage->path = malloc(pathlen + 1);
@@ -102,563 +309,4382 @@ blosc2_storage* get_new_storage(const blosc2_storage* storage, const blosc2_cpar
   return new_storage;
 }
 
-void update_schunk_properties(struct blosc2_schunk* schunk) {
-  blosc2_cparams* cparams = schunk->storage->cparams;
-  blosc2_dparams* dparams = schunk->storage->dparams;
 
-  for (int i = 0; i < BLOSC2_MAX_FILTERS; i++) {
-    schunk->filters[i] = cparams->filters[i];
-    schunk->filters_meta[i] = cparams->filters_meta[i];
-  }
-  schunk->compcode = cparams->compcode;
-  schunk->clevel = cparams->clevel;
-  schunk->typesize = cparams->typesize;
-  schunk->blocksize = cparams->blocksize;
-  schunk->chunksize = -1;
+// An entry in the cache of decompressed chunks
+typedef struct cache_entry_s {
+  int nchunk;
+  int32_t nbytes;
+  uint8_t* data;
+  struct cache_entry_s* prev;   // the entry used right after this one
+  struct cache_entry_s* next;   // the entry used right before this one
+} cache_entry;
 
-  /* The compression context */
-  if (schunk->cctx != NULL) {
-    blosc2_free_ctx(schunk->cctx);
-  }
-  cparams->schunk = schunk;
-  schunk->cctx = blosc2_create_cctx(*cparams);
+// A size-bounded LRU cache of decompressed chunks
+typedef struct {
+  int64_t maxsize;      // the maximum number of decompressed bytes kept
+  int64_t size;         // the number of decompressed bytes kept
+  cache_entry* head;    // the most recently used entry
+  cache_entry* tail;    // the least recently used entry
+  int64_t hits;
+  int64_t misses;
+  pthread_mutex_t mutex;
+} chunk_cache;
 
-  /* The decompression context */
-  if (schunk->dctx != NULL) {
-    blosc2_free_ctx(schunk->dctx);
-  }
-  dparams->schunk = schunk;
-  schunk->dctx = blosc2_create_dctx(*dparams);
-}
 
-/* Create a new super-chunk */
-blosc2_schunk* blosc2_schunk_new(const blosc2_storage storage) {
-  blosc2_schunk* schunk = calloc(1, sizeof(blosc2_schunk));
-  schunk->version = 0;     /* pre-first version */
+static chunk_cache* cache_new(int64_t maxsize) {
+  chunk_cache* cache = calloc(1, sizeof(chunk_cache));
+  cache->maxsize = maxsize;
+  pthread_mutex_init(&cache->mutex, NULL);
+  return cache;
+}
 
-  // Get the storage with proper defaults
-  schunk->storage = get_new_storage(&storage, &BLOSC2_CPARAMS_DEFAULTS, &BLOSC2_DPARAMS_DEFAULTS);
-  // ...and update internal properties
-  update_schunk_properties(schunk);
 
-  if (storage.sequential) {
-    // We want a frame as storage
-    blosc2_frame* frame = blosc2_frame_new(storage.path);
-    // Initialize frame (basically, encode the header)
-    int64_t frame_len = blosc2_frame_from_schunk(schunk, frame);
-    if (frame_len < 0) {
-      BLOSC_TRACE_ERROR("Error during the conversion of schunk to frame.");
-    }
-    schunk->frame = frame;
+static void cache_unlink(chunk_cache* cache, cache_entry* entry) {
+  if (entry->prev != NULL) {
+    entry->prev->next = entry->next;
   }
-  else if (storage.path != NULL) {
-    BLOSC_TRACE_ERROR("Creating empty sparse schunks on-disk is not supported yet.");
-    return NULL;
+  else {
+    cache->head = entry->next;
+  }
+  if (entry->next != NULL) {
+    entry->next->prev = entry->prev;
+  }
+  else {
+    cache->tail = entry->prev;
   }
-
-  return schunk;
 }
 
 
-/* Create an empty super-chunk */
-blosc2_schunk *blosc2_schunk_empty(int nchunks, const blosc2_storage storage) {
-  blosc2_schunk* schunk = blosc2_schunk_new(storage);
-  if (storage.sequential) {
-    BLOSC_TRACE_ERROR("Creating empty frames is not supported yet.");
-    return NULL;
+static void cache_push(chunk_cache* cache, cache_entry* entry) {
+  entry->prev = NULL;
+  entry->next = cache->head;
+  if (cache->head != NULL) {
+    cache->head->prev = entry;
   }
+  cache->head = entry;
+  if (cache->tail == NULL) {
+    cache->tail = entry;
+  }
+}
 
-  // Init offsets
-  schunk->nchunks = nchunks;
-  schunk->chunksize = -1;
-  schunk->nbytes = 0;
-  schunk->cbytes = 0;
-
-  schunk->data_len += sizeof(void *) * nchunks;  // must be a multiple of sizeof(void*)
-  schunk->data = calloc(nchunks, sizeof(void *));
 
-  return schunk;
+static void cache_remove(chunk_cache* cache, cache_entry* entry) {
+  cache_unlink(cache, entry);
+  cache->size -= entry->nbytes;
+  free(entry->data);
+  free(entry);
 }
 
 
-/* Open an existing super-chunk that is on-disk (no copy is made). */
-blosc2_schunk* blosc2_schunk_open(const blosc2_storage storage) {
-  if (!storage.sequential) {
-    BLOSC_TRACE_ERROR("Opening sparse super-chunks on-disk is not supported yet.");
-    return NULL;
+/* Drop chunk `nchunk` from the cache of a super-chunk, or every chunk if `nchunk` < 0. */
+static void cache_invalidate(blosc2_schunk* schunk, int nchunk) {
+  chunk_cache* cache = schunk->cache;
+  if (cache == NULL) {
+    return;
   }
-  if (storage.path == NULL) {
-    BLOSC_TRACE_ERROR("You need to supply a storage.path.");
-    return NULL;
+  pthread_mutex_lock(&cache->mutex);
+  cache_entry* entry = cache->head;
+  while (entry != NULL) {
+    cache_entry* next = entry->next;
+    if (nchunk < 0 || entry->nchunk == nchunk) {
+      cache_remove(cache, entry);
+    }
+    entry = next;
   }
+  pthread_mutex_unlock(&cache->mutex);
+}
 
-  // We only support frames yet
-  blosc2_frame* frame = blosc2_frame_from_file(storage.path);
-  blosc2_schunk* schunk = blosc2_frame_to_schunk(frame, false);
-
-  // Get the storage with proper defaults
-  blosc2_cparams *store_cparams;
-  blosc2_schunk_get_cparams(schunk, &store_cparams);
-  blosc2_dparams *store_dparams;
-  blosc2_schunk_get_dparams(schunk, &store_dparams);
-  schunk->storage = get_new_storage(&storage, store_cparams, store_dparams);
-  free(store_cparams);
-  free(store_dparams);
-  // Update the existing cparams/dparams with the new defaults
-  update_schunk_properties(schunk);
 
-  return schunk;
+static void cache_free(chunk_cache* cache) {
+  while (cache->head != NULL) {
+    cache_remove(cache, cache->head);
+  }
+  pthread_mutex_destroy(&cache->mutex);
+  free(cache);
 }
 
 
-/* Free all memory from a super-chunk. */
-int blosc2_schunk_free(blosc2_schunk *schunk) {
-  if (schunk->data != NULL) {
-    for (int i = 0; i < schunk->nchunks; i++) {
-      free(schunk->data[i]);
+/* Copy chunk `nchunk` out of the cache.  Return its size, or -1 if it is not there. */
+static int cache_get(chunk_cache* cache, int nchunk, void* dest, int32_t nbytes) {
+  int rc = -1;
+  pthread_mutex_lock(&cache->mutex);
+  for (cache_entry* entry = cache->head; entry != NULL; entry = entry->next) {
+    if (entry->nchunk == nchunk) {
+      if (entry->nbytes <= nbytes) {
+        memcpy(dest, entry->data, (size_t)entry->nbytes);
+        rc = entry->nbytes;
+        cache_unlink(cache, entry);
+        cache_push(cache, entry);
+      }
+      break;
     }
-    free(schunk->data);
   }
-  blosc2_free_ctx(schunk->cctx);
-  blosc2_free_ctx(schunk->dctx);
+  if (rc < 0) {
+    cache->misses++;
+  }
+  else {
+    cache->hits++;
+  }
+  pthread_mutex_unlock(&cache->mutex);
+  return rc;
+}
 
-  if (schunk->nmetalayers > 0) {
-    for (int i = 0; i < schunk->nmetalayers; i++) {
-      free(schunk->metalayers[i]->name);
-      free(schunk->metalayers[i]->content);
-      free(schunk->metalayers[i]);
-    }
-    schunk->nmetalayers = 0;
+
+/* Keep a copy of a decompressed chunk, evicting the least recently used ones if needed. */
+static void cache_put(chunk_cache* cache, int nchunk, const void* src, int32_t nbytes) {
+  if (nbytes <= 0 || nbytes > cache->maxsize) {
+    return;
   }
+  cache_entry* entry = malloc(sizeof(cache_entry));
+  entry->nchunk = nchunk;
+  entry->nbytes = nbytes;
+  entry->data = malloc((size_t)nbytes);
+  memcpy(entry->data, src, (size_t)nbytes);
 
-  if (schunk->storage != NULL) {
-    if (schunk->storage->path != NULL) {
-      free(schunk->storage->path);
+  pthread_mutex_lock(&cache->mutex);
+  // Another thread may have put the same chunk in the meanwhile
+  for (cache_entry* old = cache->head; old != NULL; old = old->next) {
+    if (old->nchunk == nchunk) {
+      cache_remove(cache, old);
+      break;
     }
-    free(schunk->storage->cparams);
-    free(schunk->storage->dparams);
-    free(schunk->storage);
   }
+  while (cache->size + nbytes > cache->maxsize) {
+    cache_remove(cache, cache->tail);
+  }
+  cache_push(cache, entry);
+  cache->size += nbytes;
+  pthread_mutex_unlock(&cache->mutex);
+}
 
-  if (schunk->frame != NULL) {
-    blosc2_frame_free(schunk->frame);
+
+/* Get the counters of the cache of decompressed chunks. */
+int blosc2_schunk_cache_stats(blosc2_schunk *schunk, int64_t *hits, int64_t *misses) {
+  chunk_cache* cache = schunk->cache;
+  if (cache == NULL) {
+    BLOSC_TRACE_ERROR("The super-chunk does not have a cache.");
+    return -1;
   }
+  pthread_mutex_lock(&cache->mutex);
+  *hits = cache->hits;
+  *misses = cache->misses;
+  pthread_mutex_unlock(&cache->mutex);
+  return 0;
+}
 
-  if (schunk->usermeta_len > 0) {
-    free(schunk->usermeta);
+
+// Where the chunks of a super-chunk with variable-length chunks start
+typedef struct {
+  int64_t* starts;      // starts[i] is the number of bytes in the chunks before chunk i
+  int32_t nvalid;       // the number of entries in `starts` that are up to date
+  int32_t capacity;     // the number of entries allocated in `starts`
+  int32_t misaligned;   // the first entry that is not a multiple of the typesize, or -1
+} nbytes_index;
+
+
+static void index_grow(nbytes_index* index, int32_t nchunks) {
+  if (nchunks > index->capacity) {
+    index->capacity = nchunks > 2 * index->capacity ? nchunks : 2 * index->capacity;
+    index->starts = realloc(index->starts, index->capacity * sizeof(int64_t));
   }
+}
 
-  free(schunk);
 
-  return 0;
+/* Forget where the chunks after `nchunk` start, or all of them if `nchunk` < 0. */
+static void index_invalidate(blosc2_schunk* schunk, int nchunk) {
+  nbytes_index* index = schunk->nbytes_index;
+  if (index == NULL) {
+    return;
+  }
+  int32_t nvalid = nchunk < 0 ? 0 : nchunk + 1;
+  if (index->nvalid > nvalid) {
+    index->nvalid = nvalid;
+  }
+  if (index->misaligned >= index->nvalid) {
+    index->misaligned = -1;
+  }
 }
 
 
-/* Create a super-chunk out of a serialized frame (no copy is made). */
-blosc2_schunk* blosc2_schunk_open_sframe(uint8_t *sframe, int64_t len) {
-  blosc2_frame* frame = blosc2_frame_from_sframe(sframe, len, false);
-  if (frame == NULL) {
-    return NULL;
+/* Add the start of a new chunk at the end of a super-chunk whose counters are not updated yet. */
+static void index_append(blosc2_schunk* schunk) {
+  nbytes_index* index = schunk->nbytes_index;
+  if (index == NULL || index->nvalid != schunk->nchunks) {
+    // It will be rebuilt when needed
+    return;
   }
-  blosc2_schunk* schunk = blosc2_frame_to_schunk(frame, false);
-  if (schunk == NULL) {
-    /* Use free instead of blosc2_frame_free since no copy */
-    free(frame);
+  index_grow(index, index->nvalid + 1);
+  index->starts[index->nvalid] = schunk->nbytes;
+  if (index->misaligned < 0 && schunk->nbytes % schunk->typesize != 0) {
+    index->misaligned = index->nvalid;
   }
-  return schunk;
+  index->nvalid++;
 }
 
 
-/* Append an existing chunk into a super-chunk. */
-int blosc2_schunk_append_chunk(blosc2_schunk *schunk, uint8_t *chunk, bool copy) {
+/* Make the index cover all the chunks, reading the sizes of the ones that are not there yet. */
+static int index_update(blosc2_schunk* schunk) {
+  nbytes_index* index = schunk->nbytes_index;
+  if (index == NULL) {
+    index = calloc(1, sizeof(nbytes_index));
+    index->misaligned = -1;
+    schunk->nbytes_index = index;
+  }
   int32_t nchunks = schunk->nchunks;
-  int32_t nbytes = sw32_(chunk + BLOSC2_CHUNK_NBYTES);
-  int32_t cbytes = sw32_(chunk + BLOSC2_CHUNK_CBYTES);
-
-  if (schunk->chunksize == -1) {
-    schunk->chunksize = nbytes;  // The super-chunk is initialized now
+  if (index->nvalid >= nchunks) {
+    return 0;
   }
-
-  if (nbytes > schunk->chunksize) {
-    BLOSC_TRACE_ERROR("Appending chunks that have different lengths in the same schunk "
-                      "is not supported yet: %d > %d.", nbytes, schunk->chunksize);
-    return -1;
+  index_grow(index, nchunks);
+  if (index->nvalid == 0) {
+    index->starts[0] = 0;
+    index->nvalid = 1;
   }
 
-  /* Update counters */
-  schunk->nchunks = nchunks + 1;
-  schunk->nbytes += nbytes;
-  schunk->cbytes += cbytes;
-
-  // Update super-chunk or frame
-  if (schunk->frame == NULL) {
-    if (schunk->storage->path != NULL) {
-      BLOSC_TRACE_ERROR("The persistent sparse storage is not supported yet.");
+  int32_t first = index->nvalid - 1;
+  int32_t n = nchunks - index->nvalid;
+  int32_t* nbytes = malloc((n > 0 ? n : 1) * sizeof(int32_t));
+  if (schunk->frame != NULL) {
+    if (frame_get_chunks_nbytes(schunk->frame, first, n, nbytes) < 0) {
+      BLOSC_TRACE_ERROR("Cannot get the sizes of the chunks in the frame.");
+      free(nbytes);
       return -1;
     }
-    // Check that we are not appending a small chunk after another small chunk
-    if ((schunk->nchunks > 0) && (nbytes < schunk->chunksize)) {
-      uint8_t* last_chunk = schunk->data[nchunks - 1];
-      int32_t last_nbytes = sw32_(last_chunk + BLOSC2_CHUNK_NBYTES);
-      if ((last_nbytes < schunk->chunksize) && (nbytes < schunk->chunksize)) {
-        BLOSC_TRACE_ERROR(
-                "Appending two consecutive chunks with a chunksize smaller than the schunk chunksize "
-                "is not allowed yet: %d != %d.", nbytes, schunk->chunksize);
-        return -1;
-      }
-    }
-
-    if (copy) {
-        // Make a copy of the chunk
-        uint8_t *chunk_copy = malloc(cbytes);
-        memcpy(chunk_copy, chunk, cbytes);
-        chunk = chunk_copy;
+  }
+  else {
+    for (int32_t i = 0; i < n; i++) {
+      uint8_t* chunk = schunk->data[first + i];
+      // Non-initialized chunks do not have any data yet
+      nbytes[i] = chunk == NULL ? 0 : sw32_(chunk + BLOSC2_CHUNK_NBYTES);
     }
-    else if (cbytes < nbytes) {
-      // We still want to do a shrink of the chunk
-      chunk = realloc(chunk, cbytes);
+  }
+  for (int32_t i = 0; i < n; i++) {
+    int64_t start = index->starts[first + i] + nbytes[i];
+    index->starts[first + i + 1] = start;
+    if (index->misaligned < 0 && start % schunk->typesize != 0) {
+      index->misaligned = first + i + 1;
     }
+  }
+  index->nvalid = nchunks;
+  free(nbytes);
+  return 0;
+}
 
-    /* Make space for appending the copy of the chunk and do it */
+
+static void index_free(nbytes_index* index) {
+  free(index->starts);
+  free(index);
+}
+
+
+// The zone maps of a chunk: the one of the whole chunk, followed by the ones of its blocks
+typedef struct {
+  int32_t nblocks;
+  blosc2_zonemap maps[];
+} chunk_zonemaps;
+
+// The zone maps of the chunks of a super-chunk
+typedef struct {
+  uint8_t type;
+  int32_t nchunks;
+  int32_t capacity;
+  chunk_zonemaps** chunks;  // NULL entries are not known
+} zonemap_index;
+
+
+/* Make the zone maps cover `nchunks` chunks; the new ones are not known. */
+static void zonemaps_resize(zonemap_index* index, int32_t nchunks) {
+  if (nchunks > index->capacity) {
+    index->capacity = nchunks > 2 * index->capacity ? nchunks : 2 * index->capacity;
+    index->chunks = realloc(index->chunks, index->capacity * sizeof(chunk_zonemaps*));
+  }
+  for (int32_t i = nchunks; i < index->nchunks; i++) {
+    free(index->chunks[i]);
+  }
+  for (int32_t i = index->nchunks; i < nchunks; i++) {
+    index->chunks[i] = NULL;
+  }
+  index->nchunks = nchunks;
+}
+
+
+static zonemap_index* zonemaps_new(uint8_t type, int32_t nchunks) {
+  zonemap_index* index = calloc(1, sizeof(zonemap_index));
+  index->type = type;
+  zonemaps_resize(index, nchunks);
+  return index;
+}
+
+
+static void zonemaps_free(zonemap_index* index) {
+  zonemaps_resize(index, 0);
+  free(index->chunks);
+  free(index);
+}
+
+
+/* Get the zone maps of the chunk that has just been compressed with `cctx`, or NULL if
+ * they are not known. */
+static chunk_zonemaps* zonemaps_capture(blosc2_context* cctx) {
+  if (cctx->zonemap_type == BLOSC2_ZONEMAP_NONE || cctx->nblocks <= 0) {
+    return NULL;
+  }
+  bool is_float = cctx->zonemap_type >= BLOSC2_ZONEMAP_FLOAT32;
+  int32_t nblocks = cctx->nblocks;
+  chunk_zonemaps* zonemaps = malloc(sizeof(chunk_zonemaps) + (1 + nblocks) * sizeof(blosc2_zonemap));
+  zonemaps->nblocks = nblocks;
+  blosc2_zonemap* chunk_map = &zonemaps->maps[0];
+  chunk_map->nitems = 0;
+  chunk_map->nnulls = 0;
+  if (is_float) {
+    chunk_map->min.f = INFINITY;
+    chunk_map->max.f = -INFINITY;
+  }
+  else {
+    chunk_map->min.i = INT64_MAX;
+    chunk_map->max.i = INT64_MIN;
+  }
+  for (int32_t i = 0; i < nblocks; i++) {
+    blosc2_zonemap* map = &cctx->zonemaps[i];
+    if (map->nitems < 0) {
+      free(zonemaps);
+      return NULL;
+    }
+    zonemaps->maps[1 + i] = *map;
+    chunk_map->nitems += map->nitems;
+    chunk_map->nnulls += map->nnulls;
+    if (is_float) {
+      if (map->min.f < chunk_map->min.f) chunk_map->min.f = map->min.f;
+      if (map->max.f > chunk_map->max.f) chunk_map->max.f = map->max.f;
+    }
+    else {
+      if (map->min.i < chunk_map->min.i) chunk_map->min.i = map->min.i;
+      if (map->max.i > chunk_map->max.i) chunk_map->max.i = map->max.i;
+    }
+  }
+  return zonemaps;
+}
+
+
+/* Get a copy of the zone maps of chunk `nchunk` for a super-chunk with zone maps of `type`. */
+static chunk_zonemaps* zonemaps_copy(blosc2_schunk* schunk, int nchunk, uint8_t type) {
+  zonemap_index* index = schunk->zonemaps;
+  if (index == NULL || index->type != type || nchunk >= index->nchunks ||
+      index->chunks[nchunk] == NULL) {
+    return NULL;
+  }
+  size_t size = sizeof(chunk_zonemaps) + (1 + index->chunks[nchunk]->nblocks) * sizeof(blosc2_zonemap);
+  chunk_zonemaps* zonemaps = malloc(size);
+  memcpy(zonemaps, index->chunks[nchunk], size);
+  return zonemaps;
+}
+
+
+/* Put the zone maps (which are taken over) of a chunk inserted in position `nchunk`. */
+static void zonemaps_insert(blosc2_schunk* schunk, int nchunk, chunk_zonemaps* zonemaps) {
+  zonemap_index* index = schunk->zonemaps;
+  if (index == NULL) {
+    free(zonemaps);
+    return;
+  }
+  zonemaps_resize(index, index->nchunks + 1);
+  for (int32_t i = index->nchunks - 1; i > nchunk; i--) {
+    index->chunks[i] = index->chunks[i - 1];
+  }
+  index->chunks[nchunk] = zonemaps;
+}
+
+
+/* Replace the zone maps of chunk `nchunk` with `zonemaps` (which are taken over), and return
+ * the previous ones. */
+static chunk_zonemaps* zonemaps_swap(blosc2_schunk* schunk, int nchunk, chunk_zonemaps* zonemaps) {
+  zonemap_index* index = schunk->zonemaps;
+  if (index == NULL) {
+    free(zonemaps);
+    return NULL;
+  }
+  if (nchunk >= index->nchunks) {
+    zonemaps_resize(index, nchunk + 1);
+  }
+  chunk_zonemaps* old = index->chunks[nchunk];
+  index->chunks[nchunk] = zonemaps;
+  return old;
+}
+
+
+/* Forget the zone maps of the chunks from `nchunks` on. */
+static void zonemaps_truncate(blosc2_schunk* schunk, int32_t nchunks) {
+  zonemap_index* index = schunk->zonemaps;
+  if (index != NULL && index->nchunks > nchunks) {
+    zonemaps_resize(index, nchunks);
+  }
+}
+
+
+uint8_t schunk_zonemap_type(blosc2_schunk* schunk) {
+  zonemap_index* index = schunk->zonemaps;
+  return index == NULL ? (uint8_t)BLOSC2_ZONEMAP_NONE : index->type;
+}
+
+
+/* Serialize the zone maps of the first `nchunks` chunks into a new `buffer`: for every chunk,
+ * the number of blocks (-1 if not known) followed by the maps of the chunk and its blocks. */
+int32_t schunk_zonemaps_to_buffer(blosc2_schunk* schunk, int32_t nchunks, uint8_t** buffer) {
+  zonemap_index* index = schunk->zonemaps;
+  int64_t len = 0;
+  for (int32_t i = 0; i < nchunks; i++) {
+    len += sizeof(int32_t);
+    if (i < index->nchunks && index->chunks[i] != NULL) {
+      len += (1 + index->chunks[i]->nblocks) * sizeof(blosc2_zonemap);
+    }
+  }
+  if (len > INT32_MAX - BLOSC_MAX_OVERHEAD) {
+    BLOSC_TRACE_ERROR("The zone maps are too large.");
+    return -1;
+  }
+  *buffer = malloc((size_t)len);
+  uint8_t* bp = *buffer;
+  for (int32_t i = 0; i < nchunks; i++) {
+    chunk_zonemaps* zonemaps = i < index->nchunks ? index->chunks[i] : NULL;
+    int32_t nblocks = zonemaps == NULL ? -1 : zonemaps->nblocks;
+    memcpy(bp, &nblocks, sizeof(int32_t));
+    bp += sizeof(int32_t);
+    if (zonemaps != NULL) {
+      memcpy(bp, zonemaps->maps, (1 + nblocks) * sizeof(blosc2_zonemap));
+      bp += (1 + nblocks) * sizeof(blosc2_zonemap);
+    }
+  }
+  return (int32_t)len;
+}
+
+
+/* Set the zone maps of `type` of a super-chunk with `nchunks` chunks out of a `buffer` made by
+ * `schunk_zonemaps_to_buffer` (or none, if they are not known). */
+int schunk_zonemaps_from_buffer(blosc2_schunk* schunk, uint8_t type, int32_t nchunks,
+                                const uint8_t* buffer, int32_t len) {
+  if (schunk->zonemaps != NULL) {
+    zonemaps_free(schunk->zonemaps);
+  }
+  zonemap_index* index = zonemaps_new(type, nchunks);
+  schunk->zonemaps = index;
+  const uint8_t* bp = buffer;
+  const uint8_t* bpend = buffer + len;
+  for (int32_t i = 0; i < nchunks && buffer != NULL; i++) {
+    int32_t nblocks;
+    if (bpend - bp < (int64_t)sizeof(int32_t)) {
+      break;
+    }
+    memcpy(&nblocks, bp, sizeof(int32_t));
+    bp += sizeof(int32_t);
+    if (nblocks < 0) {
+      continue;
+    }
+    size_t size = (1 + (size_t)nblocks) * sizeof(blosc2_zonemap);
+    if ((size_t)(bpend - bp) < size) {
+      break;
+    }
+    index->chunks[i] = malloc(sizeof(chunk_zonemaps) + size);
+    index->chunks[i]->nblocks = nblocks;
+    memcpy(index->chunks[i]->maps, bp, size);
+    bp += size;
+  }
+  if (bp != bpend) {
+    BLOSC_TRACE_ERROR("The zone maps are corrupted.");
+    zonemaps_free(index);
+    schunk->zonemaps = NULL;
+    return -1;
+  }
+  return 0;
+}
+
+
+/* Switch a super-chunk to variable-length chunks if a chunk with `nbytes` in position `nchunk`
+ * (either inserted or replacing the existing one) would not keep its chunksize fixed.  With a
+ * fixed chunksize, every chunk has `chunksize` bytes except the last one, which can be shorter. */
+static void update_chunksize(blosc2_schunk* schunk, int nchunk, int32_t nbytes, bool insert) {
+  int32_t chunksize = schunk->chunksize;
+  if (chunksize == -1) {
+    schunk->chunksize = nbytes;  // The super-chunk is initialized now
+    return;
+  }
+  if (chunksize == 0) {
+    return;
+  }
+  int32_t nchunks = schunk->nchunks;
+  bool fixed;
+  if (insert && nchunk == nchunks) {
+    // The chunk that is the last one now must be complete
+    fixed = nbytes <= chunksize && schunk->nbytes == (int64_t)nchunks * chunksize;
+  }
+  else if (!insert && nchunk == nchunks - 1) {
+    fixed = nbytes <= chunksize;
+  }
+  else {
+    fixed = nbytes == chunksize;
+  }
+  if (!fixed) {
+    schunk->chunksize = 0;
+  }
+}
+
+
+void update_schunk_properties(struct blosc2_schunk* schunk) {
+  blosc2_cparams* cparams = schunk->storage->cparams;
+  blosc2_dparams* dparams = schunk->storage->dparams;
+
+  for (int i = 0; i < BLOSC2_MAX_FILTERS; i++) {
+    schunk->filters[i] = cparams->filters[i];
+    schunk->filters_meta[i] = cparams->filters_meta[i];
+  }
+  schunk->compcode = cparams->compcode;
+  schunk->clevel = cparams->clevel;
+  schunk->typesize = cparams->typesize;
+  schunk->blocksize = cparams->blocksize;
+
+  /* The compression context */
+  if (schunk->cctx != NULL) {
+    blosc2_free_ctx(schunk->cctx);
+  }
+  cparams->schunk = schunk;
+  schunk->cctx = blosc2_create_cctx(*cparams);
+
+  /* The decompression context */
+  if (schunk->dctx != NULL) {
+    blosc2_free_ctx(schunk->dctx);
+  }
+  dparams->schunk = schunk;
+  schunk->dctx = blosc2_create_dctx(*dparams);
+
+  /* The cache of decompressed chunks */
+  if (schunk->cache != NULL) {
+    cache_free(schunk->cache);
+    schunk->cache = NULL;
+  }
+  if (schunk->storage->cache_size > 0) {
+    schunk->cache = cache_new(schunk->storage->cache_size);
+  }
+}
+
+/* Create a new super-chunk */
+blosc2_schunk* blosc2_schunk_new(const blosc2_storage storage) {
+  blosc2_schunk* schunk = calloc(1, sizeof(blosc2_schunk));
+  schunk->version = 0;     /* pre-first version */
+  schunk->chunksize = -1;  /* not initialized until the first chunk is appended */
+
+  // Get the storage with proper defaults
+  schunk->storage = get_new_storage(&storage, &BLOSC2_CPARAMS_DEFAULTS, &BLOSC2_DPARAMS_DEFAULTS);
+  // ...and update internal properties
+  update_schunk_properties(schunk);
+
+  if (storage.checksums) {
+    // A non-NULL pointer means that checksums are kept; it will grow with every new chunk
+    schunk->checksums = calloc(1, sizeof(uint64_t));
+    schunk->checksums_verified = calloc(1, sizeof(bool));
+  }
+
+  if (schunk->storage->cparams->zonemap_type != BLOSC2_ZONEMAP_NONE) {
+    // The zone maps of the chunks are kept beside them
+    schunk->zonemaps = zonemaps_new(schunk->storage->cparams->zonemap_type, 0);
+  }
+
+  if (schunk->storage->cparams->ndim > 0) {
+    // Keep the n-dimensional shapes in the standard metalayer (before the frame is built)
+    ndim_layout layout;
+    if (ndim_layout_new(schunk->storage->cparams, schunk->typesize, &layout) < 0) {
+      blosc2_schunk_free(schunk);
+      return NULL;
+    }
+    uint8_t *content;
+    int32_t content_len = ndim_meta_to_buffer(schunk->storage->cparams, &content);
+    int rc = blosc2_add_metalayer(schunk, BLOSC2_NDIM_METALAYER, content, (uint32_t)content_len);
+    free(content);
+    if (rc < 0) {
+      blosc2_schunk_free(schunk);
+      return NULL;
+    }
+  }
+
+  if (storage.sequential) {
+    // We want a frame as storage
+    blosc2_frame* frame = blosc2_frame_new(storage.path);
+    // Initialize frame (basically, encode the header)
+    int64_t frame_len = blosc2_frame_from_schunk(schunk, frame);
+    if (frame_len < 0) {
+      BLOSC_TRACE_ERROR("Error during the conversion of schunk to frame.");
+    }
+    schunk->frame = frame;
+  }
+  else if (storage.path != NULL) {
+    BLOSC_TRACE_ERROR("Creating empty sparse schunks on-disk is not supported yet.");
+    return NULL;
+  }
+
+  return schunk;
+}
+
+
+/* Create an empty super-chunk */
+blosc2_schunk *blosc2_schunk_empty(int nchunks, const blosc2_storage storage) {
+  blosc2_schunk* schunk = blosc2_schunk_new(storage);
+  if (storage.sequential) {
+    BLOSC_TRACE_ERROR("Creating empty frames is not supported yet.");
+    return NULL;
+  }
+
+  // Init offsets
+  schunk->nchunks = nchunks;
+  schunk->chunksize = -1;
+  schunk->nbytes = 0;
+  schunk->cbytes = 0;
+
+  schunk->data_len += sizeof(void *) * nchunks;  // must be a multiple of sizeof(void*)
+  schunk->data = calloc(nchunks, sizeof(void *));
+
+  if (schunk->checksums != NULL && nchunks > 0) {
+    // Non-initialized chunks get a zero checksum
+    free(schunk->checksums);
+    free(schunk->checksums_verified);
+    schunk->checksums = calloc(nchunks, sizeof(uint64_t));
+    schunk->checksums_verified = calloc(nchunks, sizeof(bool));
+  }
+  if (schunk->zonemaps != NULL) {
+    zonemaps_resize(schunk->zonemaps, nchunks);
+  }
+
+  return schunk;
+}
+
+
+/* Set the storage of a super-chunk that has been opened out of a frame (and free it on errors) */
+static int set_open_storage(blosc2_schunk* schunk, const blosc2_storage* storage) {
+  // Get the storage with proper defaults
+  blosc2_cparams *store_cparams;
+  if (blosc2_schunk_get_cparams(schunk, &store_cparams) < 0) {
+    blosc2_schunk_free(schunk);
+    return -1;
+  }
+  blosc2_dparams *store_dparams;
+  blosc2_schunk_get_dparams(schunk, &store_dparams);
+  schunk->storage = get_new_storage(storage, store_cparams, store_dparams);
+  free(store_cparams);
+  free(store_dparams);
+  schunk->storage->checksums = (schunk->checksums != NULL);
+  // Keep computing the zone maps of the new chunks if the frame has them
+  if (schunk->zonemaps != NULL) {
+    schunk->storage->cparams->zonemap_type = schunk_zonemap_type(schunk);
+  }
+  // ...and laying out new chunks as per the n-dimensional shapes of the frame
+  if (schunk_ndim_cparams(schunk, schunk->storage->cparams) < 0) {
+    blosc2_schunk_free(schunk);
+    return -1;
+  }
+  // ...and compressing them with the dict of the frame
+  if (schunk->dict != NULL) {
+    schunk->storage->cparams->use_dict = BLOSC2_DICT_SCHUNK;
+  }
+  // Update the existing cparams/dparams with the new defaults
+  update_schunk_properties(schunk);
+
+  return 0;
+}
+
+
+/* Open an existing super-chunk that is on-disk (no copy is made). */
+blosc2_schunk* blosc2_schunk_open(const blosc2_storage storage) {
+  if (!storage.sequential) {
+    BLOSC_TRACE_ERROR("Opening sparse super-chunks on-disk is not supported yet.");
+    return NULL;
+  }
+  if (storage.path == NULL) {
+    BLOSC_TRACE_ERROR("You need to supply a storage.path.");
+    return NULL;
+  }
+
+  // We only support frames yet
+  blosc2_frame* frame = blosc2_frame_from_file(storage.path);
+  if (frame == NULL) {
+    BLOSC_TRACE_ERROR("Cannot open the frame in '%s'.", storage.path);
+    return NULL;
+  }
+  // Make sure that nobody is modifying the frame while we are reading it
+  if (frame_lock(frame, false) < 0) {
+    blosc2_frame_free(frame);
+    return NULL;
+  }
+  frame_refresh(frame, NULL);
+  blosc2_schunk* schunk = blosc2_frame_to_schunk(frame, false);
+  frame_unlock(frame);
+  if (schunk == NULL) {
+    blosc2_frame_free(frame);
+    return NULL;
+  }
+  if (set_open_storage(schunk, &storage) < 0) {
+    return NULL;
+  }
+
+  return schunk;
+}
+
+
+/* Free all memory from a super-chunk. */
+int blosc2_schunk_free(blosc2_schunk *schunk) {
+  if (schunk->data != NULL) {
+    for (int i = 0; i < schunk->nchunks; i++) {
+      free(schunk->data[i]);
+    }
+    free(schunk->data);
+  }
+  blosc2_free_ctx(schunk->cctx);
+  blosc2_free_ctx(schunk->dctx);
+
+  if (schunk->nmetalayers > 0) {
+    for (int i = 0; i < schunk->nmetalayers; i++) {
+      free(schunk->metalayers[i]->name);
+      free(schunk->metalayers[i]->content);
+      free(schunk->metalayers[i]);
+    }
+    schunk->nmetalayers = 0;
+  }
+
+  if (schunk->storage != NULL) {
+    if (schunk->storage->path != NULL) {
+      free(schunk->storage->path);
+    }
+    free(schunk->storage->cparams);
+    free(schunk->storage->dparams);
+    free(schunk->storage);
+  }
+
+  if (schunk->frame != NULL) {
+    blosc2_frame_free(schunk->frame);
+  }
+
+  if (schunk->usermeta_len > 0) {
+    free(schunk->usermeta);
+  }
+
+  if (schunk->checksums != NULL) {
+    free(schunk->checksums);
+    free(schunk->checksums_verified);
+  }
+
+  if (schunk->cache != NULL) {
+    cache_free(schunk->cache);
+  }
+
+  if (schunk->nbytes_index != NULL) {
+    index_free(schunk->nbytes_index);
+  }
+
+  if (schunk->zonemaps != NULL) {
+    zonemaps_free(schunk->zonemaps);
+  }
+
+  if (schunk->dict != NULL) {
+    free(schunk->dict);
+  }
+
+  free(schunk);
+
+  return 0;
+}
+
+
+/* Create a super-chunk out of a serialized frame (no copy is made). */
+blosc2_schunk* blosc2_schunk_open_sframe(uint8_t *sframe, int64_t len) {
+  blosc2_frame* frame = blosc2_frame_from_sframe(sframe, len, false);
+  if (frame == NULL) {
+    return NULL;
+  }
+  blosc2_schunk* schunk = blosc2_frame_to_schunk(frame, false);
+  if (schunk == NULL) {
+    /* Use free instead of blosc2_frame_free since no copy */
+    free(frame);
+  }
+  return schunk;
+}
+
+
+/* Create a new super-chunk whose frame lives in a shared memory segment. */
+blosc2_schunk* blosc2_schunk_new_shm(const char* name, int64_t maxlen, blosc2_storage storage) {
+  storage.sequential = true;
+  storage.path = NULL;
+  blosc2_schunk* schunk = blosc2_schunk_new(storage);
+  if (schunk == NULL || schunk->frame == NULL) {
+    return NULL;
+  }
+  if (frame_to_shm(schunk->frame, name, maxlen) < 0) {
+    BLOSC_TRACE_ERROR("Cannot move the frame to the shared memory segment '%s'.", name);
+    blosc2_schunk_free(schunk);
+    return NULL;
+  }
+  return schunk;
+}
+
+
+/* Open (read-only, and without copying it) a super-chunk living in a shared memory segment. */
+blosc2_schunk* blosc2_schunk_open_shm(const char* name, const blosc2_storage* storage) {
+  blosc2_frame* frame = frame_open_shm(name);
+  if (frame == NULL) {
+    return NULL;
+  }
+  // Make sure that the writer is not modifying the frame while we are reading it
+  if (frame_lock(frame, false) < 0) {
+    blosc2_frame_free(frame);
+    return NULL;
+  }
+  frame_refresh(frame, NULL);
+  blosc2_schunk* schunk = blosc2_frame_to_schunk(frame, false);
+  frame_unlock(frame);
+  if (schunk == NULL) {
+    blosc2_frame_free(frame);
+    return NULL;
+  }
+
+  blosc2_storage shm_storage = {.sequential=true, .path=NULL};
+  if (storage != NULL) {
+    shm_storage = *storage;
+    shm_storage.sequential = true;
+    shm_storage.path = NULL;
+  }
+  if (set_open_storage(schunk, &shm_storage) < 0) {
+    return NULL;
+  }
+
+  return schunk;
+}
+
+
+/* Remove a shared memory segment created with blosc2_schunk_new_shm(). */
+int blosc2_unlink_shm(const char* name) {
+#if defined(_WIN32)
+  (void) name;
+  BLOSC_TRACE_ERROR("Shared memory frames are not supported on Windows.");
+  return -1;
+#else
+  if (shm_unlink(name) < 0) {
+    BLOSC_TRACE_ERROR("Cannot remove the shared memory segment '%s'.", name);
+    return -1;
+  }
+  return 0;
+#endif
+}
+
+
+/* Make room for the checksum of a new chunk at the end. */
+static void grow_checksums(blosc2_schunk *schunk, int32_t nchunks) {
+  schunk->checksums = realloc(schunk->checksums, (nchunks + 1) * sizeof(uint64_t));
+  schunk->checksums_verified = realloc(schunk->checksums_verified, (nchunks + 1) * sizeof(bool));
+}
+
+
+/* Compute the checksum of a chunk and store it in position `nchunk`. */
+static void set_checksum(blosc2_schunk *schunk, int nchunk, const uint8_t *chunk, int32_t cbytes) {
+  schunk->checksums[nchunk] = xxh64(chunk, (size_t)cbytes, 0);
+  // We have just computed it out of the data that is being stored
+  schunk->checksums_verified[nchunk] = true;
+}
+
+
+/* Check the contents of a chunk against the checksum in position `nchunk`. */
+static int check_chunk(blosc2_schunk *schunk, int nchunk, const uint8_t *chunk, int32_t cbytes) {
+  uint64_t checksum = (cbytes == 0) ? 0 : xxh64(chunk, (size_t)cbytes, 0);
+  if (checksum != schunk->checksums[nchunk]) {
+    BLOSC_TRACE_ERROR("Checksum mismatch in chunk %d.", nchunk);
+    return -12;
+  }
+  schunk->checksums_verified[nchunk] = true;
+  return 0;
+}
+
+
+static int get_chunk(blosc2_schunk *schunk, int nchunk, uint8_t **chunk, bool *needs_free);
+static int get_lazychunk(blosc2_schunk *schunk, int nchunk, uint8_t **chunk, bool *needs_free);
+int metalayer_flush(blosc2_schunk* schunk);
+
+
+/* Get a chunk for decompressing it as a whole.  The first time that a chunk is accessed, it is
+ * read entirely and checked against its checksum; else, it is read lazily.  Paths that only
+ * decompress some of the blocks use get_lazychunk() directly, as verifying a chunk would mean
+ * reading all of it.  The frame (if any) must be locked already. */
+static int get_verified_chunk(blosc2_schunk *schunk, int nchunk, uint8_t **chunk, bool *needs_free) {
+  if (schunk->checksums == NULL || nchunk < 0 || nchunk >= schunk->nchunks ||
+      schunk->checksums_verified[nchunk]) {
+    return get_lazychunk(schunk, nchunk, chunk, needs_free);
+  }
+  int cbytes = get_chunk(schunk, nchunk, chunk, needs_free);
+  if (cbytes < 0) {
+    return cbytes;
+  }
+  int rc = check_chunk(schunk, nchunk, *chunk, cbytes);
+  if (rc < 0) {
+    if (*needs_free) {
+      free(*chunk);
+    }
+    return rc;
+  }
+  return cbytes;
+}
+
+
+/* Lock the frame backing a super-chunk (if any) for reading or writing.  As other processes
+ * may have modified the frame since the last access, its cached state is refreshed as well. */
+static int schunk_lock(blosc2_schunk *schunk, bool exclusive) {
+  if (schunk->frame == NULL) {
+    return 0;
+  }
+  int rc = frame_lock(schunk->frame, exclusive);
+  if (rc <= 0) {
+    return rc;
+  }
+  rc = frame_refresh(schunk->frame, schunk);
+  if (rc < 0) {
+    frame_unlock(schunk->frame);
+    return rc;
+  }
+  if (rc > 0) {
+    // Somebody else has modified the frame
+    cache_invalidate(schunk, -1);
+    index_invalidate(schunk, -1);
+  }
+  return 0;
+}
+
+
+static void schunk_unlock(blosc2_schunk *schunk) {
+  if (schunk->frame != NULL) {
+    frame_unlock(schunk->frame);
+  }
+}
+
+
+/* Append a chunk and its zone maps (which are taken over, and may be NULL if not known). */
+static int append_chunk(blosc2_schunk *schunk, uint8_t *chunk, bool copy,
+                        chunk_zonemaps *zonemaps) {
+  int32_t nchunks = schunk->nchunks;
+  int32_t nbytes = sw32_(chunk + BLOSC2_CHUNK_NBYTES);
+  int32_t cbytes = sw32_(chunk + BLOSC2_CHUNK_CBYTES);
+  int32_t chunksize = schunk->chunksize;
+
+  update_chunksize(schunk, nchunks, nbytes, true);
+  index_append(schunk);
+
+  /* Update counters */
+  schunk->nchunks = nchunks + 1;
+  schunk->nbytes += nbytes;
+  schunk->cbytes += cbytes;
+
+  // The checksum and zone maps have to be there before the frame (if any) is updated
+  if (schunk->checksums != NULL) {
+    grow_checksums(schunk, nchunks);
+    set_checksum(schunk, nchunks, chunk, cbytes);
+  }
+  zonemaps_insert(schunk, nchunks, zonemaps);
+
+  // Update super-chunk or frame
+  if (schunk->frame == NULL) {
+    if (schunk->storage->path != NULL) {
+      BLOSC_TRACE_ERROR("The persistent sparse storage is not supported yet.");
+      return -1;
+    }
+
+    if (copy) {
+        // Make a copy of the chunk
+        uint8_t *chunk_copy = malloc(cbytes);
+        memcpy(chunk_copy, chunk, cbytes);
+        chunk = chunk_copy;
+    }
+    else if (cbytes < nbytes) {
+      // We still want to do a shrink of the chunk
+      chunk = realloc(chunk, cbytes);
+    }
+
+    /* Make space for appending the copy of the chunk and do it */
+    if ((nchunks + 1) * sizeof(void *) > schunk->data_len) {
+      // Extend the data pointer by one memory page (4k)
+      schunk->data_len += 4096;  // must be a multiple of sizeof(void*)
+      schunk->data = realloc(schunk->data, schunk->data_len);
+    }
+    schunk->data[nchunks] = chunk;
+  }
+  else {
+    if (frame_append_chunk(schunk->frame, chunk, schunk) == NULL) {
+      BLOSC_TRACE_ERROR("Problems appending a chunk.");
+      // The frame has not been modified (e.g. it is full), so the super-chunk should not either
+      schunk->nchunks = nchunks;
+      schunk->nbytes -= nbytes;
+      schunk->cbytes -= cbytes;
+      schunk->chunksize = chunksize;
+      index_invalidate(schunk, nchunks - 1);
+      zonemaps_truncate(schunk, nchunks);
+      return -1;
+    }
+    if (!copy) {
+      // The frame keeps its own copy
+      free(chunk);
+    }
+  }
+
+  /* printf("Compression chunk #%lld: %d -> %d (%.1fx)\n", */
+  /*         nchunks, nbytes, cbytes, (1.*nbytes) / cbytes); */
+  return schunk->nchunks;
+}
+
+
+static int locked_append_chunk(blosc2_schunk *schunk, uint8_t *chunk, bool copy,
+                               chunk_zonemaps *zonemaps) {
+  int rc = schunk_lock(schunk, true);
+  if (rc < 0) {
+    free(zonemaps);
+    return rc;
+  }
+  rc = append_chunk(schunk, chunk, copy, zonemaps);
+  schunk_unlock(schunk);
+  return rc;
+}
+
+
+/* Append an existing chunk into a super-chunk. */
+int blosc2_schunk_append_chunk(blosc2_schunk *schunk, uint8_t *chunk, bool copy) {
+  // The zone maps of a chunk that comes from elsewhere are not known
+  return locked_append_chunk(schunk, chunk, copy, NULL);
+}
+
+
+/* Insert an existing @p chunk in a specified position on a super-chunk */
+int blosc2_schunk_insert_chunk(blosc2_schunk *schunk, int nchunk, uint8_t *chunk, bool copy) {
+  int32_t nchunks = schunk->nchunks;
+  int32_t nbytes = sw32_(chunk + BLOSC2_CHUNK_NBYTES);
+  int32_t cbytes = sw32_(chunk + BLOSC2_CHUNK_CBYTES);
+
+  if (schunk->frame != NULL) {
+    BLOSC_TRACE_ERROR("Frames are not allowed yet.");
+    return -1;
+  }
+  if (nchunk < 0 || nchunk > nchunks) {
+    BLOSC_TRACE_ERROR("The position to insert (%d) is not in the super-chunk (%d chunks).",
+                      nchunk, nchunks);
+    return -1;
+  }
+
+  update_chunksize(schunk, nchunk, nbytes, true);
+  // The chunks after the new one are shifted
+  index_invalidate(schunk, nchunk);
+
+  /* Update counters */
+  schunk->nchunks = nchunks + 1;
+  schunk->nbytes += nbytes;
+  schunk->cbytes += cbytes;
+
+  // Update super-chunk
+  {
+    if (copy) {
+      // Make a copy of the chunk
+      uint8_t *chunk_copy = malloc(cbytes);
+      memcpy(chunk_copy, chunk, cbytes);
+      chunk = chunk_copy;
+    }
+    else if (cbytes < nbytes) {
+      // We still want to do a shrink of the chunk
+      chunk = realloc(chunk, cbytes);
+    }
+
+    // Make space for appending the copy of the chunk and do it
     if ((nchunks + 1) * sizeof(void *) > schunk->data_len) {
       // Extend the data pointer by one memory page (4k)
       schunk->data_len += 4096;  // must be a multiple of sizeof(void*)
       schunk->data = realloc(schunk->data, schunk->data_len);
     }
-    schunk->data[nchunks] = chunk;
+
+    // Reorder the offsets and insert the new chunk
+    for (int i = nchunks; i > nchunk; --i) {
+      schunk->data[i] = schunk->data[i-1];
+    }
+    schunk->data[nchunk] = chunk;
+
+    if (schunk->checksums != NULL) {
+      grow_checksums(schunk, nchunks);
+      for (int i = nchunks; i > nchunk; --i) {
+        schunk->checksums[i] = schunk->checksums[i - 1];
+        schunk->checksums_verified[i] = schunk->checksums_verified[i - 1];
+      }
+      set_checksum(schunk, nchunk, chunk, cbytes);
+    }
+    zonemaps_insert(schunk, nchunk, NULL);
+    // The chunks after the new one have been shifted
+    cache_invalidate(schunk, -1);
+  }
+
+  return schunk->nchunks;
+}
+
+
+/* Update a chunk and its zone maps (which are taken over, and may be NULL if not known). */
+static int update_chunk(blosc2_schunk *schunk, int nchunk, uint8_t *chunk, bool copy,
+                        chunk_zonemaps *zonemaps) {
+  int32_t nchunks = schunk->nchunks;
+  int32_t nbytes = sw32_(chunk + BLOSC2_CHUNK_NBYTES);
+  int32_t cbytes = sw32_(chunk + BLOSC2_CHUNK_CBYTES);
+
+  if (nchunk < 0 || nchunk >= nchunks) {
+    BLOSC_TRACE_ERROR("The chunk to update (%d) is not in the super-chunk (%d chunks).",
+                      nchunk, nchunks);
+    free(zonemaps);
+    return -1;
+  }
+
+  int32_t chunksize = schunk->chunksize;
+  update_chunksize(schunk, nchunk, nbytes, false);
+
+  // Update super-chunk or frame
+  if (schunk->frame == NULL) {
+    uint8_t *chunk_old = schunk->data[nchunk];
+    int32_t cbytes_old;
+    int32_t nbytes_old;
+
+    if (chunk_old == 0) {
+      nbytes_old = 0;
+      cbytes_old = 0;
+    } else {
+      nbytes_old = sw32_(chunk_old + BLOSC2_CHUNK_NBYTES);
+      cbytes_old = sw32_(chunk_old + BLOSC2_CHUNK_CBYTES);
+    }
+
+    /* Update counters */
+    schunk->nbytes += nbytes;
+    schunk->nbytes -= nbytes_old;
+    schunk->cbytes += cbytes;
+    schunk->cbytes -= cbytes_old;
+
+    if (copy) {
+      // Make a copy of the chunk
+      uint8_t *chunk_copy = malloc(cbytes);
+      memcpy(chunk_copy, chunk, cbytes);
+      chunk = chunk_copy;
+    }
+    else if (cbytes < nbytes) {
+      // We still want to do a shrink of the chunk
+      chunk = realloc(chunk, cbytes);
+    }
+
+    // Free old chunk and add reference to new chunk
+    if (schunk->data[nchunk] != 0) {
+      free(schunk->data[nchunk]);
+    }
+    schunk->data[nchunk] = chunk;
+
+    if (schunk->checksums != NULL) {
+      set_checksum(schunk, nchunk, chunk, cbytes);
+    }
+    free(zonemaps_swap(schunk, nchunk, zonemaps));
+    cache_invalidate(schunk, nchunk);
+    if (nbytes != nbytes_old) {
+      index_invalidate(schunk, nchunk);
+    }
+  }
+  else {
+    int32_t nbytes_old;
+    if (frame_get_chunks_nbytes(schunk->frame, nchunk, 1, &nbytes_old) < 0) {
+      BLOSC_TRACE_ERROR("Cannot get the size of chunk %d.", nchunk);
+      schunk->chunksize = chunksize;
+      free(zonemaps);
+      return -1;
+    }
+    uint64_t checksum_old = 0;
+    if (schunk->checksums != NULL) {
+      checksum_old = schunk->checksums[nchunk];
+      set_checksum(schunk, nchunk, chunk, cbytes);
+    }
+    chunk_zonemaps *zonemaps_old = zonemaps_swap(schunk, nchunk, zonemaps);
+    // The frame keeps the space of the old chunk
+    schunk->nbytes += nbytes - nbytes_old;
+    schunk->cbytes += cbytes;
+    if (frame_update_chunk(schunk->frame, nchunk, chunk, schunk) == NULL) {
+      BLOSC_TRACE_ERROR("Problems updating chunk %d.", nchunk);
+      schunk->nbytes -= nbytes - nbytes_old;
+      schunk->cbytes -= cbytes;
+      schunk->chunksize = chunksize;
+      if (schunk->checksums != NULL) {
+        schunk->checksums[nchunk] = checksum_old;
+      }
+      free(zonemaps_swap(schunk, nchunk, zonemaps_old));
+      return -1;
+    }
+    free(zonemaps_old);
+    if (!copy) {
+      free(chunk);
+    }
+    cache_invalidate(schunk, nchunk);
+    if (nbytes != nbytes_old) {
+      index_invalidate(schunk, nchunk);
+    }
+  }
+
+  return schunk->nchunks;
+}
+
+
+/* Update a chunk at a specific position in a super-chunk. */
+int blosc2_schunk_update_chunk(blosc2_schunk *schunk, int nchunk, uint8_t *chunk, bool copy) {
+  int rc = schunk_lock(schunk, true);
+  if (rc < 0) {
+    return rc;
+  }
+  rc = update_chunk(schunk, nchunk, chunk, copy, NULL);
+  schunk_unlock(schunk);
+  return rc;
+}
+
+
+/* Append a data buffer to a super-chunk. */
+int blosc2_schunk_append_buffer(blosc2_schunk *schunk, void *src, int32_t nbytes) {
+  uint8_t* chunk = malloc(nbytes + BLOSC_MAX_OVERHEAD);
+
+  /* Compress the src buffer using super-chunk context */
+  int cbytes = blosc2_compress_ctx(schunk->cctx, src, nbytes, chunk,
+                                   nbytes + BLOSC_MAX_OVERHEAD);
+  if (cbytes < 0) {
+    free(chunk);
+    return cbytes;
+  }
+
+  // We don't need a copy of the chunk, as it will be shrinked if necessary
+  int nchunks = locked_append_chunk(schunk, chunk, false, zonemaps_capture(schunk->cctx));
+  if (nchunks < 0) {
+    // The chunk has not been stored
+    free(chunk);
+  }
+
+  return nchunks;
+}
+
+
+/* Train the dict shared by the chunks of a super-chunk out of a sample of its data */
+int blosc2_schunk_train_dict(blosc2_schunk *schunk, const void *src, int32_t nbytes) {
+  if (schunk->storage->cparams->use_dict != BLOSC2_DICT_SCHUNK) {
+    BLOSC_TRACE_ERROR("The super-chunk is not meant to share a dict among its chunks.");
+    return -1;
+  }
+  if (schunk->dict != NULL) {
+    BLOSC_TRACE_ERROR("The super-chunk has a dict already.");
+    return -2;
+  }
+
+  // Compressing the sample is what trains (and publishes) the dict
+  blosc2_cparams cparams = *schunk->storage->cparams;
+  cparams.schunk = schunk;
+  blosc2_context *cctx = blosc2_create_cctx(cparams);
+  uint8_t *chunk = malloc(nbytes + BLOSC_MAX_OVERHEAD);
+  int cbytes = blosc2_compress_ctx(cctx, src, nbytes, chunk, nbytes + BLOSC_MAX_OVERHEAD);
+  free(chunk);
+  blosc2_free_ctx(cctx);
+  if (cbytes < 0) {
+    return cbytes;
+  }
+  if (schunk->dict == NULL) {
+    BLOSC_TRACE_ERROR("Cannot train a dict out of the sample (too small?).");
+    return -3;
+  }
+
+  // The frame keeps the dict in its trailer
+  if (schunk->frame != NULL) {
+    if (schunk_lock(schunk, true) < 0) {
+      return -1;
+    }
+    int rc = frame_update_trailer(schunk->frame, schunk);
+    schunk_unlock(schunk);
+    if (rc < 0) {
+      BLOSC_TRACE_ERROR("Unable to update trailer into frame.");
+      return -4;
+    }
+  }
+
+  return schunk->dict_size;
+}
+
+static int decompress_chunk(blosc2_schunk *schunk, blosc2_context *dctx, int nchunk,
+                            void *dest, int32_t nbytes) {
+
+  uint8_t* src;
+  bool needs_free = false;
+  int chunksize;
+  if (schunk->checksums != NULL && nchunk < schunk->nchunks && !schunk->checksums_verified[nchunk]) {
+    // Lazy verification; this is done only the first time that a chunk is read, and the chunk
+    // is decompressed out of the very bytes that have been verified
+    int cbytes = get_verified_chunk(schunk, nchunk, &src, &needs_free);
+    if (cbytes < 0) {
+      return cbytes;
+    }
+  }
+  else if (schunk->frame == NULL) {
+    if (nchunk >= schunk->nchunks) {
+      BLOSC_TRACE_ERROR("nchunk ('%d') exceeds the number of chunks "
+                        "('%d') in super-chunk.", nchunk, schunk->nchunks);
+      return -11;
+    }
+    src = schunk->data[nchunk];
+  } else {
+    chunksize = frame_decompress_chunk(dctx, schunk->frame, nchunk, dest, nbytes);
+    if (chunksize < 0) {
+      return -10;
+    }
+    return chunksize;
+  }
+  if (src == 0) {
+    return 0;
+  }
+
+  int nbytes_ = sw32_(src + BLOSC2_CHUNK_NBYTES);
+  if (nbytes < nbytes_) {
+    BLOSC_TRACE_ERROR("Buffer size is too small for the decompressed buffer "
+                      "('%d' bytes, but '%d' are needed).", nbytes, nbytes_);
+    if (needs_free) {
+      free(src);
+    }
+    return -11;
+  }
+  int cbytes = sw32_(src + BLOSC2_CHUNK_CBYTES);
+  chunksize = blosc2_decompress_ctx(dctx, src, cbytes, dest, nbytes);
+  if (needs_free) {
+    free(src);
+  }
+  if (chunksize < 0 || chunksize != nbytes_) {
+    BLOSC_TRACE_ERROR("Error in decompressing chunk.");
+    return -11;
+  }
+  return chunksize;
+}
+
+
+/* Decompress a chunk with the context of the super-chunk, going through its cache (if any). */
+static int cached_decompress_chunk(blosc2_schunk *schunk, int nchunk, void *dest, int32_t nbytes) {
+  // The postfilter has to see every decompressed chunk
+  bool cached = schunk->cache != NULL && schunk->dctx->postfilter == NULL;
+  int rc;
+  if (cached) {
+    rc = cache_get(schunk->cache, nchunk, dest, nbytes);
+    if (rc >= 0) {
+      return rc;
+    }
+  }
+  rc = decompress_chunk(schunk, schunk->dctx, nchunk, dest, nbytes);
+  if (rc > 0 && cached) {
+    cache_put(schunk->cache, nchunk, dest, rc);
+  }
+  return rc;
+}
+
+
+/* Decompress and return a chunk that is part of a super-chunk. */
+int blosc2_schunk_decompress_chunk(blosc2_schunk *schunk, int nchunk,
+                                   void *dest, int32_t nbytes) {
+  int rc = schunk_lock(schunk, false);
+  if (rc < 0) {
+    return rc;
+  }
+  rc = cached_decompress_chunk(schunk, nchunk, dest, nbytes);
+  schunk_unlock(schunk);
+  return rc;
+}
+
+
+/* Get the decompressed contents of a chunk.  Memcpyed chunks that are in memory are not
+ * decompressed at all, and their contents are returned in place. */
+static int get_view(blosc2_schunk *schunk, int nchunk, uint8_t **view, bool *needs_free) {
+  *view = NULL;
+  *needs_free = false;
+  uint8_t *chunk;
+  bool chunk_needs_free;
+  int cbytes = get_verified_chunk(schunk, nchunk, &chunk, &chunk_needs_free);
+  if (cbytes <= 0) {
+    // Non-initialized chunks (or errors)
+    return cbytes;
+  }
+  int32_t nbytes = sw32_(chunk + BLOSC2_CHUNK_NBYTES);
+  // Chunks that do not need a free are in memory (and are not lazy)
+  if (!chunk_needs_free && (chunk[BLOSC2_CHUNK_FLAGS] & BLOSC_MEMCPYED) &&
+      cbytes == nbytes + BLOSC_MAX_OVERHEAD && schunk->dctx->postfilter == NULL) {
+    *view = chunk + BLOSC_MAX_OVERHEAD;
+    return nbytes;
+  }
+
+  // Decompress the chunk that has just been fetched, unless it is in the cache already
+  bool cached = schunk->cache != NULL && schunk->dctx->postfilter == NULL;
+  *view = malloc((size_t)nbytes);
+  int rc = cached ? cache_get(schunk->cache, nchunk, *view, nbytes) : -1;
+  if (rc < 0) {
+    rc = blosc2_decompress_ctx(schunk->dctx, chunk, cbytes, *view, nbytes);
+    if (rc != nbytes) {
+      BLOSC_TRACE_ERROR("Error in decompressing chunk.");
+      rc = -11;
+    }
+    else if (cached) {
+      cache_put(schunk->cache, nchunk, *view, rc);
+    }
+  }
+  if (chunk_needs_free) {
+    free(chunk);
+  }
+  if (rc < 0) {
+    free(*view);
+    *view = NULL;
+    return rc;
+  }
+  *needs_free = true;
+  return rc;
+}
+
+
+/* Get a (read-only) view of the decompressed contents of a chunk. */
+int blosc2_schunk_get_view(blosc2_schunk *schunk, int nchunk, uint8_t **view, bool *needs_free) {
+  int rc = schunk_lock(schunk, false);
+  if (rc < 0) {
+    return rc;
+  }
+  rc = get_view(schunk, nchunk, view, needs_free);
+  schunk_unlock(schunk);
+  return rc;
+}
+
+
+/* Get items [start, start + nitems) of chunk `nchunk` (in items of the super-chunk typesize).
+ * Only the blocks that contain the items are decompressed (and read, for frames on-disk). */
+static int get_chunk_items(blosc2_schunk *schunk, blosc2_context *dctx, int nchunk,
+                           int start, int nitems, uint8_t *dest) {
+  int32_t typesize = schunk->typesize;
+  uint8_t* chunk;
+  bool needs_free;
+  // Only some blocks are read, so the checksum cannot be verified
+  int cbytes = get_lazychunk(schunk, nchunk, &chunk, &needs_free);
+  if (cbytes < 0) {
+    return cbytes;
+  }
+  if (cbytes == 0) {
+    // Non-initialized chunks are made of zeros
+    memset(dest, 0, (size_t)nitems * typesize);
+    return nitems * typesize;
+  }
+  int rc = blosc2_getitem_ctx(dctx, chunk, cbytes, start, nitems, dest);
+  if (needs_free) {
+    free(chunk);
+  }
+  if (rc != nitems * typesize) {
+    BLOSC_TRACE_ERROR("Cannot get the items out of chunk %d.", nchunk);
+    return rc < 0 ? rc : -1;
+  }
+  return rc;
+}
+
+
+/* The first item in chunk `nchunk`, or the number of items for the chunk after the last one.
+ * With variable-length chunks, the index must be up to date. */
+static int64_t chunk_first_item(blosc2_schunk *schunk, int nchunk) {
+  int64_t nbytes;
+  if (nchunk >= schunk->nchunks) {
+    nbytes = schunk->nbytes;
+  }
+  else if (schunk->chunksize > 0) {
+    nbytes = nchunk * (int64_t)schunk->chunksize;
+    if (nbytes > schunk->nbytes) {
+      nbytes = schunk->nbytes;
+    }
+  }
+  else {
+    nbytes = ((nbytes_index*)schunk->nbytes_index)->starts[nchunk];
+  }
+  return nbytes / schunk->typesize;
+}
+
+
+/* The chunk where `item` is.  With variable-length chunks, the index must be up to date. */
+static int item_chunk(blosc2_schunk *schunk, int64_t item) {
+  int64_t nbyte = item * schunk->typesize;
+  if (schunk->chunksize > 0) {
+    return (int)(nbyte / schunk->chunksize);
+  }
+  // The last chunk starting at or before the item (empty chunks are skipped this way)
+  const int64_t *starts = ((nbytes_index*)schunk->nbytes_index)->starts;
+  int lo = 0;
+  int hi = schunk->nchunks - 1;
+  while (lo < hi) {
+    int mid = lo + (hi - lo + 1) / 2;
+    if (starts[mid] <= nbyte) {
+      lo = mid;
+    }
+    else {
+      hi = mid - 1;
+    }
+  }
+  return lo;
+}
+
+
+struct slice_job {
+  blosc2_schunk *schunk;
+  blosc2_context *dctx;
+  int64_t start;         // the first item of the slice
+  int64_t stop;          // the item after the last one of the slice
+  int first;             // the first chunk for this job
+  int last;              // the last chunk (inclusive) in the whole slice
+  int step;
+  uint8_t *dest;
+  int rc;
+};
+
+
+/* Copy the part of the slice that is in the chunks assigned to a worker.  Chunks that are
+ * completely in the slice are decompressed straight into its final location. */
+static void* slice_worker(void* arg) {
+  struct slice_job *job = (struct slice_job*)arg;
+  blosc2_schunk *schunk = job->schunk;
+  int32_t typesize = schunk->typesize;
+  for (int nchunk = job->first; nchunk <= job->last && job->rc >= 0; nchunk += job->step) {
+    int64_t chunk_start = chunk_first_item(schunk, nchunk);
+    int64_t chunk_stop = chunk_first_item(schunk, nchunk + 1);
+    int64_t start = job->start > chunk_start ? job->start : chunk_start;
+    int64_t stop = job->stop < chunk_stop ? job->stop : chunk_stop;
+    uint8_t *dest = job->dest + (start - job->start) * typesize;
+    int32_t nbytes = (int32_t)((stop - start) * typesize);
+    int rc;
+    if (start == chunk_start && stop == chunk_stop) {
+      rc = decompress_chunk(schunk, job->dctx, nchunk, dest, nbytes);
+      if (rc == 0) {
+        memset(dest, 0, (size_t)nbytes);
+        rc = nbytes;
+      }
+      if (rc >= 0 && rc != nbytes) {
+        BLOSC_TRACE_ERROR("Chunk %d does not have the expected size.", nchunk);
+        rc = -1;
+      }
+    }
+    else {
+      rc = get_chunk_items(schunk, job->dctx, nchunk, (int)(start - chunk_start),
+                           (int)(stop - start), dest);
+    }
+    if (rc < 0) {
+      job->rc = rc;
+    }
+  }
+  return NULL;
+}
+
+
+static int check_slice(blosc2_schunk *schunk, int64_t start, int64_t stop) {
+  int32_t typesize = schunk->typesize;
+  bool whole_items;
+  if (schunk->chunksize == 0) {
+    // Variable-length chunks are found through the index
+    if (index_update(schunk) < 0) {
+      return -1;
+    }
+    whole_items = ((nbytes_index*)schunk->nbytes_index)->misaligned < 0;
+  }
+  else {
+    whole_items = schunk->chunksize < 0 || schunk->chunksize % typesize == 0;
+  }
+  if (!whole_items) {
+    BLOSC_TRACE_ERROR("Slices are only supported in super-chunks whose chunks start at "
+                      "item boundaries.");
+    return -1;
+  }
+  int64_t nitems = schunk->nbytes / typesize;
+  if (start < 0 || stop < start || stop > nitems) {
+    BLOSC_TRACE_ERROR("The slice [%lld, %lld) is out of bounds (%lld items).",
+                      (long long)start, (long long)stop, (long long)nitems);
+    return -1;
+  }
+  return 0;
+}
+
+
+static int64_t get_slice(blosc2_schunk *schunk, int64_t start, int64_t stop, void *dest) {
+  int32_t typesize = schunk->typesize;
+  int rc = check_slice(schunk, start, stop);
+  if (rc < 0 || start == stop) {
+    return rc;
+  }
+  int first = item_chunk(schunk, start);
+  int last = item_chunk(schunk, stop - 1);
+
+  // The first chunk is done in this thread with the super-chunk context (which can use several
+  // threads for its blocks); this also populates the cache for the frame offsets (if any)
+  // before the workers start sharing it
+  struct slice_job first_job = {schunk, schunk->dctx, start, stop, first, first, 1, dest, 0};
+  slice_worker(&first_job);
+  if (first_job.rc < 0 || first == last) {
+    return first_job.rc < 0 ? first_job.rc : (stop - start) * typesize;
+  }
+
+  // The rest of the chunks are distributed among workers with their own (serial) contexts
+  int nthreads = schunk->dctx->nthreads;
+  if (nthreads > last - first) {
+    nthreads = last - first;
+  }
+  if (nthreads <= 1) {
+    struct slice_job job = {schunk, schunk->dctx, start, stop, first + 1, last, 1, dest, 0};
+    slice_worker(&job);
+    return job.rc < 0 ? job.rc : (stop - start) * typesize;
+  }
+
+  pthread_t *threads = malloc(nthreads * sizeof(pthread_t));
+  struct slice_job *jobs = malloc(nthreads * sizeof(struct slice_job));
+  blosc2_dparams dparams = {.nthreads=1, .schunk=schunk};
+  for (int tid = 0; tid < nthreads; tid++) {
+    struct slice_job job = {schunk, blosc2_create_dctx(dparams), start, stop,
+                            first + 1 + tid, last, nthreads, dest, 0};
+    jobs[tid] = job;
+  }
+  int nstarted = 0;
+  for (int tid = 0; tid < nthreads; tid++) {
+    if (pthread_create(&threads[tid], NULL, slice_worker, &jobs[tid]) != 0) {
+      BLOSC_TRACE_WARNING("Cannot create thread; getting the rest of the slice serially.");
+      break;
+    }
+    nstarted++;
+  }
+  for (int tid = nstarted; tid < nthreads; tid++) {
+    slice_worker(&jobs[tid]);
+  }
+  for (int tid = 0; tid < nthreads; tid++) {
+    if (tid < nstarted) {
+      pthread_join(threads[tid], NULL);
+    }
+    if (jobs[tid].rc < 0) {
+      rc = jobs[tid].rc;
+    }
+    blosc2_free_ctx(jobs[tid].dctx);
+  }
+  free(threads);
+  free(jobs);
+
+  return rc < 0 ? rc : (stop - start) * typesize;
+}
+
+
+/* Get the items [start, stop) of a super-chunk. */
+int64_t blosc2_schunk_get_slice(blosc2_schunk *schunk, int64_t start, int64_t stop, void *dest) {
+  int rc = schunk_lock(schunk, false);
+  if (rc < 0) {
+    return rc;
+  }
+  int64_t nbytes = get_slice(schunk, start, stop, dest);
+  schunk_unlock(schunk);
+  return nbytes;
+}
+
+
+/* The number of chunks that are compressed in a go while setting a slice (per thread) */
+#define SET_SLICE_BATCH 4
+
+struct compress_job {
+  blosc2_context *cctx;
+  int first;
+  int n;
+  int step;
+  const uint8_t **srcs;
+  int32_t *nbytes;
+  uint8_t **chunks;
+  chunk_zonemaps **zonemaps;
+  int rc;
+};
+
+
+static void* compress_worker(void* arg) {
+  struct compress_job *job = (struct compress_job*)arg;
+  for (int i = job->first; i < job->n && job->rc >= 0; i += job->step) {
+    int32_t nbytes = job->nbytes[i];
+    uint8_t *chunk = malloc((size_t)nbytes + BLOSC_MAX_OVERHEAD);
+    int cbytes = blosc2_compress_ctx(job->cctx, job->srcs[i], nbytes, chunk,
+                                     nbytes + BLOSC_MAX_OVERHEAD);
+    if (cbytes < 0) {
+      free(chunk);
+      job->rc = cbytes;
+      break;
+    }
+    job->chunks[i] = chunk;
+    job->zonemaps[i] = zonemaps_capture(job->cctx);
+  }
+  return NULL;
+}
+
+
+/* Compress the `n` buffers in `srcs` into `chunks` (and their `zonemaps`) using the contexts
+ * in `cctxs` in parallel. */
+static int compress_chunks(blosc2_context **cctxs, int nthreads, int n, const uint8_t **srcs,
+                           int32_t *nbytes, uint8_t **chunks, chunk_zonemaps **zonemaps) {
+  if (nthreads > n) {
+    nthreads = n;
+  }
+  struct compress_job *jobs = malloc(nthreads * sizeof(struct compress_job));
+  for (int tid = 0; tid < nthreads; tid++) {
+    struct compress_job job = {cctxs[tid], tid, n, nthreads, srcs, nbytes, chunks, zonemaps, 0};
+    jobs[tid] = job;
+  }
+  int nstarted = 0;
+  pthread_t *threads = NULL;
+  if (nthreads > 1) {
+    threads = malloc(nthreads * sizeof(pthread_t));
+    for (int tid = 0; tid < nthreads; tid++) {
+      if (pthread_create(&threads[tid], NULL, compress_worker, &jobs[tid]) != 0) {
+        BLOSC_TRACE_WARNING("Cannot create thread; compressing the rest of the chunks serially.");
+        break;
+      }
+      nstarted++;
+    }
+  }
+  for (int tid = nstarted; tid < nthreads; tid++) {
+    compress_worker(&jobs[tid]);
+  }
+  int rc = 0;
+  for (int tid = 0; tid < nthreads; tid++) {
+    if (tid < nstarted) {
+      pthread_join(threads[tid], NULL);
+    }
+    if (jobs[tid].rc < 0) {
+      rc = jobs[tid].rc;
+    }
+  }
+  free(threads);
+  free(jobs);
+  return rc;
+}
+
+
+/* Get the contents of chunk `nchunk` with the items in [start, stop) replaced by those in `src`. */
+static uint8_t* patch_chunk(blosc2_schunk *schunk, int nchunk, int64_t chunk_start,
+                            int32_t nbytes, int64_t start, int64_t stop, const uint8_t *src) {
+  int32_t typesize = schunk->typesize;
+  uint8_t *buffer = malloc((size_t)nbytes);
+  // The postfilter (if any) is not meant for the chunks that are being patched
+  blosc2_context *dctx = schunk->dctx;
+  if (dctx->postfilter != NULL) {
+    blosc2_dparams dparams = {.nthreads=dctx->nthreads, .schunk=schunk};
+    dctx = blosc2_create_dctx(dparams);
+  }
+  int rc = decompress_chunk(schunk, dctx, nchunk, buffer, nbytes);
+  if (dctx != schunk->dctx) {
+    blosc2_free_ctx(dctx);
+  }
+  if (rc == 0) {
+    // Non-initialized chunks are made of zeros
+    memset(buffer, 0, (size_t)nbytes);
+  }
+  else if (rc != nbytes) {
+    BLOSC_TRACE_ERROR("Cannot get the contents of chunk %d.", nchunk);
+    free(buffer);
+    return NULL;
+  }
+  memcpy(buffer + (start - chunk_start) * typesize, src, (size_t)((stop - start) * typesize));
+  return buffer;
+}
+
+
+static int64_t set_slice(blosc2_schunk *schunk, int64_t start, int64_t stop, const uint8_t *src) {
+  int32_t typesize = schunk->typesize;
+  int rc = check_slice(schunk, start, stop);
+  if (rc < 0 || start == stop) {
+    return rc;
+  }
+  int first = item_chunk(schunk, start);
+  int last = item_chunk(schunk, stop - 1);
+
+  // Chunks are compressed in batches with one (serial) context per thread, and then put in
+  // place from this thread, so that the memory for the new chunks is bounded
+  int nthreads = schunk->cctx->nthreads;
+  if (nthreads > last - first + 1) {
+    nthreads = last - first + 1;
+  }
+  blosc2_context **cctxs = malloc(nthreads * sizeof(blosc2_context*));
+  if (nthreads == 1) {
+    cctxs[0] = schunk->cctx;
+  }
+  else {
+    blosc2_cparams cparams = *schunk->storage->cparams;
+    cparams.nthreads = 1;
+    cparams.schunk = schunk;
+    for (int tid = 0; tid < nthreads; tid++) {
+      cctxs[tid] = blosc2_create_cctx(cparams);
+    }
+  }
+  int batch = nthreads * SET_SLICE_BATCH;
+  const uint8_t **srcs = malloc(batch * sizeof(uint8_t*));
+  int32_t *nbytes = malloc(batch * sizeof(int32_t));
+  uint8_t **chunks = malloc(batch * sizeof(uint8_t*));
+  chunk_zonemaps **zonemaps = malloc(batch * sizeof(chunk_zonemaps*));
+  // Only the chunks at the edges of the slice need their previous contents
+  uint8_t *edges[2] = {NULL, NULL};
+
+  for (int batch_first = first; batch_first <= last && rc >= 0; batch_first += batch) {
+    int n = last - batch_first + 1;
+    if (n > batch) {
+      n = batch;
+    }
+    for (int i = 0; i < n; i++) {
+      int nchunk = batch_first + i;
+      int64_t chunk_start = chunk_first_item(schunk, nchunk);
+      int64_t chunk_stop = chunk_first_item(schunk, nchunk + 1);
+      nbytes[i] = (int32_t)((chunk_stop - chunk_start) * typesize);
+      chunks[i] = NULL;
+      zonemaps[i] = NULL;
+      if (start <= chunk_start && chunk_stop <= stop) {
+        srcs[i] = src + (chunk_start - start) * typesize;
+        continue;
+      }
+      int64_t start_ = start > chunk_start ? start : chunk_start;
+      int64_t stop_ = stop < chunk_stop ? stop : chunk_stop;
+      uint8_t *edge = patch_chunk(schunk, nchunk, chunk_start, nbytes[i], start_, stop_,
+                                  src + (start_ - start) * typesize);
+      if (edge == NULL) {
+        rc = -1;
+        n = i;
+        break;
+      }
+      edges[nchunk == first ? 0 : 1] = edge;
+      srcs[i] = edge;
+    }
+
+    if (rc >= 0) {
+      rc = compress_chunks(cctxs, nthreads, n, srcs, nbytes, chunks, zonemaps);
+    }
+    for (int i = 0; i < n; i++) {
+      if (rc >= 0) {
+        rc = update_chunk(schunk, batch_first + i, chunks[i], false, zonemaps[i]);
+        if (rc >= 0) {
+          continue;
+        }
+      }
+      else {
+        free(zonemaps[i]);
+      }
+      free(chunks[i]);
+    }
+  }
+
+  free(edges[0]);
+  free(edges[1]);
+  free(srcs);
+  free(nbytes);
+  free(chunks);
+  free(zonemaps);
+  if (nthreads > 1) {
+    for (int tid = 0; tid < nthreads; tid++) {
+      blosc2_free_ctx(cctxs[tid]);
+    }
+  }
+  free(cctxs);
+
+  return rc < 0 ? rc : (stop - start) * typesize;
+}
+
+
+/* Set the items [start, stop) of a super-chunk. */
+int64_t blosc2_schunk_set_slice(blosc2_schunk *schunk, int64_t start, int64_t stop, const void *src) {
+  int rc = schunk_lock(schunk, true);
+  if (rc < 0) {
+    return rc;
+  }
+  int64_t nbytes = set_slice(schunk, start, stop, src);
+  schunk_unlock(schunk);
+  return nbytes;
+}
+
+
+/* The number of chunks that are moved in a go while concatenating super-chunks */
+#define CONCAT_BATCH 64
+
+
+/* Append `n` chunks (and their zone maps) to a super-chunk, which takes them over (even if
+ * there is an error).  In frames, the chunks are written in a row and the offsets are updated
+ * just once. */
+static int append_chunks(blosc2_schunk *schunk, uint8_t **chunks, chunk_zonemaps **zonemaps,
+                         int n) {
+  if (schunk->frame == NULL) {
+    for (int i = 0; i < n; i++) {
+      int rc = append_chunk(schunk, chunks[i], false, zonemaps[i]);
+      if (rc < 0) {
+        for (int j = i; j < n; j++) {
+          free(chunks[j]);
+          if (j > i) {
+            free(zonemaps[j]);
+          }
+        }
+        return rc;
+      }
+    }
+    return schunk->nchunks;
+  }
+
+  int32_t nchunks = schunk->nchunks;
+  int64_t nbytes = schunk->nbytes;
+  int64_t cbytes = schunk->cbytes;
+  int32_t chunksize = schunk->chunksize;
+  for (int i = 0; i < n; i++) {
+    int32_t chunk_nbytes = sw32_(chunks[i] + BLOSC2_CHUNK_NBYTES);
+    int32_t chunk_cbytes = sw32_(chunks[i] + BLOSC2_CHUNK_CBYTES);
+    update_chunksize(schunk, schunk->nchunks, chunk_nbytes, true);
+    index_append(schunk);
+    // The checksums and zone maps have to be there before the frame is updated
+    if (schunk->checksums != NULL) {
+      grow_checksums(schunk, schunk->nchunks);
+      set_checksum(schunk, schunk->nchunks, chunks[i], chunk_cbytes);
+    }
+    zonemaps_insert(schunk, schunk->nchunks, zonemaps[i]);
+    schunk->nchunks++;
+    schunk->nbytes += chunk_nbytes;
+    schunk->cbytes += chunk_cbytes;
+  }
+  int rc = schunk->nchunks;
+  if (frame_append_chunks(schunk->frame, chunks, n, schunk) == NULL) {
+    BLOSC_TRACE_ERROR("Problems appending the chunks.");
+    // The frame has not been modified (e.g. it is full), so the super-chunk should not either
+    schunk->nchunks = nchunks;
+    schunk->nbytes = nbytes;
+    schunk->cbytes = cbytes;
+    schunk->chunksize = chunksize;
+    index_invalidate(schunk, nchunks - 1);
+    zonemaps_truncate(schunk, nchunks);
+    rc = -1;
+  }
+  for (int i = 0; i < n; i++) {
+    free(chunks[i]);
+  }
+  return rc;
+}
+
+
+/* Whether `chunk` is compressed in the same way that `schunk` would do it.  The clevel is not in
+ * the header, so the callers have to check it at the super-chunk level. */
+static bool chunk_matches(blosc2_schunk *schunk, const uint8_t *chunk) {
+  uint8_t flags = chunk[BLOSC2_CHUNK_FLAGS];
+  uint8_t version;
+  if (chunk[BLOSC2_CHUNK_TYPESIZE] != schunk->typesize ||
+      (flags >> 5u) != compcode_to_compformat(schunk->compcode, &version)) {
+    return false;
+  }
+  // The blocks (and how they are split in streams) should be the same too
+  int32_t blocksize;
+  bool split;
+  compression_layout(schunk->cctx, sw32_(chunk + BLOSC2_CHUNK_NBYTES), &blocksize, &split);
+  if (sw32_(chunk + BLOSC2_CHUNK_BLOCKSIZE) != blocksize) {
+    return false;
+  }
+  if (!(flags & BLOSC_MEMCPYED) && ((flags & 0x10u) == 0) != split) {
+    return false;
+  }
+  // Only the extended header has the filter pipeline in it
+  if ((flags & (BLOSC_DOSHUFFLE | BLOSC_DOBITSHUFFLE)) != (BLOSC_DOSHUFFLE | BLOSC_DOBITSHUFFLE)) {
+    return false;
+  }
+  if (((chunk[BLOSC2_CHUNK_BLOSC2_FLAGS] & BLOSC2_USEDICT) != 0) != (schunk->cctx->use_dict != 0)) {
+    return false;
+  }
+  if ((chunk[BLOSC2_CHUNK_BLOSC2_FLAGS] & BLOSC2_SHAREDDICT) && !(flags & BLOSC_MEMCPYED)) {
+    // The chunk can only be taken if it has been compressed with the very same dict
+    int32_t nbytes = sw32_(chunk + BLOSC2_CHUNK_NBYTES);
+    int32_t blocksize = sw32_(chunk + BLOSC2_CHUNK_BLOCKSIZE);
+    if (blocksize <= 0) {
+      return false;
+    }
+    int32_t nblocks = nbytes / blocksize + (nbytes % blocksize > 0);
+    uint32_t dict_id = (uint32_t)sw32_(chunk + BLOSC_EXTENDED_HEADER_LENGTH + nblocks * sizeof(int32_t));
+    if (schunk->dict == NULL || schunk->dict_id != dict_id) {
+      return false;
+    }
+  }
+  for (int i = 0; i < BLOSC2_MAX_FILTERS; i++) {
+    if (chunk[BLOSC2_CHUNK_FILTER_CODES + i] != schunk->filters[i] ||
+        chunk[BLOSC2_CHUNK_FILTER_META + i] != schunk->filters_meta[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+struct transcode_job {
+  blosc2_context *cctx;
+  blosc2_context *dctx;
+  int first;
+  int n;
+  int step;
+  uint8_t **chunks;
+  uint8_t **new_chunks;
+  chunk_zonemaps **zonemaps;
+  int rc;
+};
+
+
+static void* transcode_worker(void* arg) {
+  struct transcode_job *job = (struct transcode_job*)arg;
+  uint8_t *buffer = NULL;
+  int32_t buffer_nbytes = 0;
+  for (int i = job->first; i < job->n && job->rc >= 0; i += job->step) {
+    if (job->new_chunks[i] != NULL) {
+      // Already taken as-is
+      continue;
+    }
+    int32_t nbytes = sw32_(job->chunks[i] + BLOSC2_CHUNK_NBYTES);
+    int32_t cbytes = sw32_(job->chunks[i] + BLOSC2_CHUNK_CBYTES);
+    if (nbytes > buffer_nbytes) {
+      free(buffer);
+      buffer = malloc((size_t)nbytes);
+      buffer_nbytes = nbytes;
+    }
+    int dsize = blosc2_decompress_ctx(job->dctx, job->chunks[i], cbytes, buffer, nbytes);
+    if (dsize != nbytes) {
+      job->rc = dsize < 0 ? dsize : -1;
+      break;
+    }
+    uint8_t *chunk = malloc((size_t)nbytes + BLOSC_MAX_OVERHEAD);
+    int new_cbytes = blosc2_compress_ctx(job->cctx, buffer, nbytes, chunk,
+                                         nbytes + BLOSC_MAX_OVERHEAD);
+    if (new_cbytes < 0) {
+      free(chunk);
+      job->rc = new_cbytes;
+      break;
+    }
+    job->new_chunks[i] = chunk;
+    job->zonemaps[i] = zonemaps_capture(job->cctx);
+  }
+  free(buffer);
+  return NULL;
+}
+
+
+/* Decompress and compress again the `n` chunks in `chunks` whose `new_chunks` entry is NULL
+ * (getting their `zonemaps` too) using the contexts in `cctxs` and `dctxs` in parallel (each
+ * chunk goes through one thread). */
+static int transcode_chunks(blosc2_context **cctxs, blosc2_context **dctxs, int nthreads, int n,
+                            uint8_t **chunks, uint8_t **new_chunks, chunk_zonemaps **zonemaps) {
+  if (nthreads > n) {
+    nthreads = n;
+  }
+  struct transcode_job *jobs = malloc(nthreads * sizeof(struct transcode_job));
+  for (int tid = 0; tid < nthreads; tid++) {
+    struct transcode_job job = {cctxs[tid], dctxs[tid], tid, n, nthreads, chunks, new_chunks,
+                                zonemaps, 0};
+    jobs[tid] = job;
+  }
+  int nstarted = 0;
+  pthread_t *threads = NULL;
+  if (nthreads > 1) {
+    threads = malloc(nthreads * sizeof(pthread_t));
+    for (int tid = 0; tid < nthreads; tid++) {
+      if (pthread_create(&threads[tid], NULL, transcode_worker, &jobs[tid]) != 0) {
+        BLOSC_TRACE_WARNING("Cannot create thread; recompressing the rest of the chunks serially.");
+        break;
+      }
+      nstarted++;
+    }
+  }
+  for (int tid = nstarted; tid < nthreads; tid++) {
+    transcode_worker(&jobs[tid]);
+  }
+  int rc = 0;
+  for (int tid = 0; tid < nthreads; tid++) {
+    if (tid < nstarted) {
+      pthread_join(threads[tid], NULL);
+    }
+    if (jobs[tid].rc < 0) {
+      rc = jobs[tid].rc;
+    }
+  }
+  free(threads);
+  free(jobs);
+  return rc;
+}
+
+
+static int concat(blosc2_schunk *dest, blosc2_schunk *src) {
+  int32_t nchunks = src->nchunks;
+  // Chunks are taken as-is when their header says that `dest` would compress them in the same way
+  bool reusable = dest->compcode == src->compcode && dest->clevel == src->clevel;
+  // The rest are recompressed in parallel with one (serial) pair of contexts per thread
+  int nthreads = dest->cctx->nthreads;
+  blosc2_context **cctxs = malloc(nthreads * sizeof(blosc2_context*));
+  blosc2_context **dctxs = malloc(nthreads * sizeof(blosc2_context*));
+  bool own_ctxs = false;
+  uint8_t **chunks = malloc(CONCAT_BATCH * sizeof(uint8_t*));
+  bool *needs_free = malloc(CONCAT_BATCH * sizeof(bool));
+  uint8_t **new_chunks = malloc(CONCAT_BATCH * sizeof(uint8_t*));
+  chunk_zonemaps **zonemaps = malloc(CONCAT_BATCH * sizeof(chunk_zonemaps*));
+  uint8_t zonemap_type = schunk_zonemap_type(dest);
+
+  int rc = dest->nchunks;
+  for (int first = 0; first < nchunks && rc >= 0; first += CONCAT_BATCH) {
+    int n = nchunks - first < CONCAT_BATCH ? nchunks - first : CONCAT_BATCH;
+    if (src->frame != NULL) {
+      rc = frame_get_chunks(src->frame, first, n, chunks, needs_free);
+    }
+    else {
+      for (int i = 0; i < n; i++) {
+        chunks[i] = src->data[first + i];
+        needs_free[i] = false;
+      }
+      rc = 0;
+    }
+    if (rc < 0) {
+      BLOSC_TRACE_ERROR("Cannot get the chunks out of the source super-chunk.");
+      break;
+    }
+    for (int i = 0; i < n && rc >= 0; i++) {
+      if (chunks[i] == NULL) {
+        BLOSC_TRACE_ERROR("Non-initialized chunks cannot be concatenated.");
+        rc = -1;
+      }
+      else if (src->checksums != NULL && !src->checksums_verified[first + i]) {
+        rc = check_chunk(src, first + i, chunks[i], sw32_(chunks[i] + BLOSC2_CHUNK_CBYTES));
+      }
+    }
+
+    int ntranscode = 0;
+    for (int i = 0; i < n; i++) {
+      new_chunks[i] = NULL;
+      zonemaps[i] = NULL;
+      if (rc < 0) {
+        continue;
+      }
+      if (!reusable || !chunk_matches(dest, chunks[i])) {
+        ntranscode++;
+        continue;
+      }
+      // The zone maps of the chunks taken as-is are taken as well
+      zonemaps[i] = zonemaps_copy(src, first + i, zonemap_type);
+      if (needs_free[i]) {
+        new_chunks[i] = chunks[i];
+        needs_free[i] = false;
+      }
+      else {
+        int32_t cbytes = sw32_(chunks[i] + BLOSC2_CHUNK_CBYTES);
+        new_chunks[i] = malloc((size_t)cbytes);
+        memcpy(new_chunks[i], chunks[i], (size_t)cbytes);
+      }
+    }
+    if (ntranscode > 0) {
+      if (nthreads == 1 && src->dctx->postfilter == NULL) {
+        cctxs[0] = dest->cctx;
+        dctxs[0] = src->dctx;
+      }
+      else if (!own_ctxs) {
+        blosc2_cparams cparams = *dest->storage->cparams;
+        cparams.nthreads = 1;
+        cparams.schunk = dest;
+        // The postfilter (if any) is not meant for the chunks that are recompressed
+        blosc2_dparams dparams = {.nthreads=1, .schunk=src};
+        for (int tid = 0; tid < nthreads; tid++) {
+          cctxs[tid] = blosc2_create_cctx(cparams);
+          dctxs[tid] = blosc2_create_dctx(dparams);
+        }
+        own_ctxs = true;
+      }
+      rc = transcode_chunks(cctxs, dctxs, nthreads, n, chunks, new_chunks, zonemaps);
+      if (rc < 0) {
+        BLOSC_TRACE_ERROR("Cannot recompress the chunks of the source super-chunk.");
+      }
+    }
+    if (rc >= 0) {
+      rc = append_chunks(dest, new_chunks, zonemaps, n);
+    }
+    else {
+      for (int i = 0; i < n; i++) {
+        free(new_chunks[i]);
+        free(zonemaps[i]);
+      }
+    }
+
+    for (int i = 0; i < n; i++) {
+      if (needs_free[i]) {
+        free(chunks[i]);
+      }
+    }
+  }
+
+  free(chunks);
+  free(needs_free);
+  free(new_chunks);
+  free(zonemaps);
+  if (own_ctxs) {
+    for (int tid = 0; tid < nthreads; tid++) {
+      blosc2_free_ctx(cctxs[tid]);
+      blosc2_free_ctx(dctxs[tid]);
+    }
+  }
+  free(cctxs);
+  free(dctxs);
+
+  return rc < 0 ? rc : dest->nchunks;
+}
+
+
+/* Append the chunks of `src` at the end of `dest`. */
+int blosc2_schunk_concat(blosc2_schunk *dest, blosc2_schunk *src) {
+  if (dest == src) {
+    BLOSC_TRACE_ERROR("A super-chunk cannot be concatenated to itself.");
+    return -1;
+  }
+  int rc = schunk_lock(src, false);
+  if (rc < 0) {
+    return rc;
+  }
+  rc = schunk_lock(dest, true);
+  if (rc < 0) {
+    schunk_unlock(src);
+    return rc;
+  }
+  rc = concat(dest, src);
+  schunk_unlock(dest);
+  schunk_unlock(src);
+  return rc;
+}
+
+
+/* Create a new super-chunk out of `src` with its chunks compressed with `cparams`. */
+blosc2_schunk* blosc2_schunk_recompress(blosc2_schunk *src, blosc2_cparams cparams,
+                                        blosc2_storage storage) {
+  storage.cparams = &cparams;
+  blosc2_schunk* dest = blosc2_schunk_new(storage);
+  if (dest == NULL) {
+    BLOSC_TRACE_ERROR("Cannot create the new super-chunk.");
+    return NULL;
+  }
+
+  int rc = 0;
+  for (int nmetalayer = 0; nmetalayer < src->nmetalayers && rc >= 0; nmetalayer++) {
+    blosc2_metalayer *metalayer = src->metalayers[nmetalayer];
+    rc = blosc2_add_metalayer(dest, metalayer->name, metalayer->content,
+                              (uint32_t)metalayer->content_len);
+  }
+  if (rc >= 0 && src->usermeta_len > 0) {
+    // The usermeta chunk is self-contained, so it can be copied as-is
+    dest->usermeta = malloc((size_t)src->usermeta_len);
+    memcpy(dest->usermeta, src->usermeta, (size_t)src->usermeta_len);
+    dest->usermeta_len = src->usermeta_len;
+    rc = metalayer_flush(dest);
+  }
+  if (rc >= 0) {
+    rc = blosc2_schunk_concat(dest, src);
+  }
+  if (rc < 0) {
+    BLOSC_TRACE_ERROR("Cannot recompress the super-chunk.");
+    blosc2_schunk_free(dest);
+    if (storage.sequential && storage.path != NULL) {
+      remove(storage.path);
+    }
+    return NULL;
+  }
+
+  return dest;
+}
+
+
+/* An item requested out of a super-chunk, and its position in the destination */
+struct item_ref {
+  int64_t index;
+  int64_t pos;
+};
+
+
+static int compare_item_refs(const void* a, const void* b) {
+  int64_t index_a = ((const struct item_ref*)a)->index;
+  int64_t index_b = ((const struct item_ref*)b)->index;
+  return (index_a > index_b) - (index_a < index_b);
+}
+
+
+/* Gather the (sorted) items in `refs` out of chunk `nchunk`.  Every block with some of the
+ * items is decompressed just once. */
+static int gather_chunk_items(blosc2_schunk *schunk, blosc2_context *dctx, int nchunk,
+                              const struct item_ref *refs, int64_t nrefs, uint8_t *dest) {
+  int32_t typesize = schunk->typesize;
+  int64_t chunk_start = chunk_first_item(schunk, nchunk);
+  uint8_t* chunk;
+  bool needs_free;
+  // Only some blocks are read, so the checksum cannot be verified
+  int cbytes = get_lazychunk(schunk, nchunk, &chunk, &needs_free);
+  if (cbytes < 0) {
+    return cbytes;
+  }
+  if (cbytes == 0) {
+    // Non-initialized chunks are made of zeros
+    for (int64_t i = 0; i < nrefs; i++) {
+      memset(dest + refs[i].pos * typesize, 0, (size_t)typesize);
+    }
+    return 0;
+  }
+
+  int32_t blocksize = sw32_(chunk + BLOSC2_CHUNK_BLOCKSIZE);
+  int32_t block_nitems = blocksize / typesize > 0 ? blocksize / typesize : 1;
+  uint8_t *block = malloc((size_t)block_nitems * typesize);
+  if (block == NULL) {
+    BLOSC_TRACE_ERROR("Cannot allocate the block for the items of chunk %d.", nchunk);
+    if (needs_free) {
+      free(chunk);
+    }
+    return BLOSC2_ERROR_MEMORY_ALLOC;
+  }
+  int rc = 0;
+  for (int64_t i = 0, j; i < nrefs; i = j) {
+    // The items in the same block as the i-th one
+    int64_t first = refs[i].index - chunk_start;
+    int64_t nblock = first / block_nitems;
+    j = i + 1;
+    while (j < nrefs && (refs[j].index - chunk_start) / block_nitems == nblock) {
+      j++;
+    }
+    int nitems = (int)(refs[j - 1].index - chunk_start - first + 1);
+    rc = blosc2_getitem_ctx(dctx, chunk, cbytes, (int)first, nitems, block);
+    if (rc != nitems * typesize) {
+      BLOSC_TRACE_ERROR("Cannot get the items out of chunk %d.", nchunk);
+      rc = rc < 0 ? rc : -1;
+      break;
+    }
+    for (int64_t k = i; k < j; k++) {
+      memcpy(dest + refs[k].pos * typesize,
+             block + (refs[k].index - chunk_start - first) * typesize, (size_t)typesize);
+    }
+  }
+  free(block);
+  if (needs_free) {
+    free(chunk);
+  }
+  return rc < 0 ? rc : 0;
+}
+
+
+struct gather_job {
+  blosc2_schunk *schunk;
+  blosc2_context *dctx;
+  const struct item_ref *refs;
+  const int64_t *groups;  // where the items of every chunk start in refs (plus the end)
+  int64_t first;          // the first group for this job
+  int64_t ngroups;
+  int64_t step;
+  uint8_t *dest;
+  int rc;
+};
+
+
+static void* gather_worker(void* arg) {
+  struct gather_job *job = (struct gather_job*)arg;
+  for (int64_t g = job->first; g < job->ngroups && job->rc >= 0; g += job->step) {
+    const struct item_ref *refs = job->refs + job->groups[g];
+    int nchunk = item_chunk(job->schunk, refs[0].index);
+    int rc = gather_chunk_items(job->schunk, job->dctx, nchunk, refs,
+                                job->groups[g + 1] - job->groups[g], job->dest);
+    if (rc < 0) {
+      job->rc = rc;
+    }
+  }
+  return NULL;
+}
+
+
+static int64_t get_items(blosc2_schunk *schunk, const int64_t *indices, int64_t n,
+                         uint8_t *dest) {
+  int32_t typesize = schunk->typesize;
+  int rc = check_slice(schunk, 0, 0);
+  if (rc < 0 || n <= 0) {
+    return n < 0 ? -1 : rc;
+  }
+  int64_t nitems = schunk->nbytes / typesize;
+
+  // Sort the items, so that the ones in the same chunk (and block) are together
+  struct item_ref *refs = malloc(n * sizeof(struct item_ref));
+  if (refs == NULL) {
+    BLOSC_TRACE_ERROR("Cannot allocate the references to the items.");
+    return BLOSC2_ERROR_MEMORY_ALLOC;
+  }
+  for (int64_t i = 0; i < n; i++) {
+    if (indices[i] < 0 || indices[i] >= nitems) {
+      BLOSC_TRACE_ERROR("The index %lld is out of bounds (%lld items).",
+                        (long long)indices[i], (long long)nitems);
+      free(refs);
+      return -1;
+    }
+    refs[i].index = indices[i];
+    refs[i].pos = i;
+  }
+  qsort(refs, (size_t)n, sizeof(struct item_ref), compare_item_refs);
+  int64_t *groups = malloc((n + 1) * sizeof(int64_t));
+  if (groups == NULL) {
+    BLOSC_TRACE_ERROR("Cannot allocate the groups of items.");
+    free(refs);
+    return BLOSC2_ERROR_MEMORY_ALLOC;
+  }
+  int64_t ngroups = 0;
+  int64_t chunk_stop = 0;
+  for (int64_t i = 0; i < n; i++) {
+    if (refs[i].index >= chunk_stop) {
+      groups[ngroups++] = i;
+      chunk_stop = chunk_first_item(schunk, item_chunk(schunk, refs[i].index) + 1);
+    }
+  }
+  groups[ngroups] = n;
+
+  // The first chunk is done in this thread, which also populates the cache for the frame
+  // offsets (if any) before the workers start sharing it
+  struct gather_job first_job = {schunk, schunk->dctx, refs, groups, 0, 1, 1, dest, 0};
+  gather_worker(&first_job);
+  rc = first_job.rc;
+
+  // The rest of the chunks are distributed among workers with their own (serial) contexts
+  int nthreads = schunk->dctx->nthreads;
+  if (nthreads > ngroups - 1) {
+    nthreads = (int)(ngroups - 1);
+  }
+  if (rc >= 0 && nthreads == 1) {
+    struct gather_job job = {schunk, schunk->dctx, refs, groups, 1, ngroups, 1, dest, 0};
+    gather_worker(&job);
+    rc = job.rc;
+  }
+  else if (rc >= 0 && nthreads > 1) {
+    pthread_t *threads = malloc(nthreads * sizeof(pthread_t));
+    struct gather_job *jobs = calloc(nthreads, sizeof(struct gather_job));
+    if (threads == NULL || jobs == NULL) {
+      BLOSC_TRACE_ERROR("Cannot allocate the jobs for getting the items.");
+      free(threads);
+      free(jobs);
+      free(groups);
+      free(refs);
+      return BLOSC2_ERROR_MEMORY_ALLOC;
+    }
+    blosc2_dparams dparams = {.nthreads=1, .schunk=schunk};
+    for (int tid = 0; tid < nthreads; tid++) {
+      struct gather_job job = {schunk, blosc2_create_dctx(dparams), refs, groups,
+                               1 + tid, ngroups, nthreads, dest, 0};
+      jobs[tid] = job;
+      if (job.dctx == NULL) {
+        BLOSC_TRACE_ERROR("Cannot create the decompression contexts for getting the items.");
+        for (int i = 0; i < tid; i++) {
+          blosc2_free_ctx(jobs[i].dctx);
+        }
+        free(threads);
+        free(jobs);
+        free(groups);
+        free(refs);
+        return BLOSC2_ERROR_MEMORY_ALLOC;
+      }
+    }
+    int nstarted = 0;
+    for (int tid = 0; tid < nthreads; tid++) {
+      if (pthread_create(&threads[tid], NULL, gather_worker, &jobs[tid]) != 0) {
+        BLOSC_TRACE_WARNING("Cannot create thread; getting the rest of the items serially.");
+        break;
+      }
+      nstarted++;
+    }
+    for (int tid = nstarted; tid < nthreads; tid++) {
+      gather_worker(&jobs[tid]);
+    }
+    for (int tid = 0; tid < nthreads; tid++) {
+      if (tid < nstarted) {
+        pthread_join(threads[tid], NULL);
+      }
+      if (jobs[tid].rc < 0) {
+        rc = jobs[tid].rc;
+      }
+      blosc2_free_ctx(jobs[tid].dctx);
+    }
+    free(threads);
+    free(jobs);
+  }
+
+  free(groups);
+  free(refs);
+  return rc < 0 ? rc : n * typesize;
+}
+
+
+/* Get the items in `indices` out of a super-chunk. */
+int64_t blosc2_schunk_get_items(blosc2_schunk *schunk, const int64_t *indices, int64_t n,
+                                void *dest) {
+  int rc = schunk_lock(schunk, false);
+  if (rc < 0) {
+    return rc;
+  }
+  int64_t nbytes = get_items(schunk, indices, n, dest);
+  schunk_unlock(schunk);
+  return nbytes;
+}
+
+
+/* A slot for a chunk that has been read in advance */
+typedef struct {
+  uint8_t* chunk;
+  int32_t alloc;       // the size of the `chunk` buffer
+  int32_t cbytes;      // the size of the chunk read, or a negative code in case of error
+} iter_slot;
+
+struct blosc2_schunk_iter_s {
+  blosc2_schunk* schunk;
+  int32_t nchunks;
+  int32_t nchunk;      // the next chunk to be returned
+  int prefetch;        // the number of slots; 0 means no background reads
+  // The fields below are only used when prefetching chunks out of a file frame
+  iter_slot* slots;
+  int32_t nread;       // the number of chunks that have been read so far
+  int error;           // the code of the read that made the I/O thread give up (0 if none)
+  bool stop;
+  FILE* fp;
+  int64_t* offsets;
+  int32_t header_len;
+  pthread_t io_thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cv_read;   // signaled when a new chunk has been read
+  pthread_cond_t cv_free;   // signaled when a slot has been consumed
+};
+
+
+/* Read the chunk `nchunk` of the file frame into `slot` */
+static int32_t iter_read_chunk(blosc2_schunk_iter *iter, int nchunk, iter_slot *slot) {
+  int64_t offset = iter->header_len + iter->offsets[nchunk];
+  uint8_t header[BLOSC_EXTENDED_HEADER_LENGTH];
+  if (fseek(iter->fp, offset, SEEK_SET) != 0 ||
+      fread(header, 1, BLOSC_MIN_HEADER_LENGTH, iter->fp) != BLOSC_MIN_HEADER_LENGTH) {
+    BLOSC_TRACE_ERROR("Cannot read the header for chunk %d in the fileframe.", nchunk);
+    return -5;
+  }
+  int32_t cbytes = sw32_(header + BLOSC2_CHUNK_CBYTES);
+  if (cbytes < BLOSC_MIN_HEADER_LENGTH) {
+    BLOSC_TRACE_ERROR("Wrong cbytes (%d) for chunk %d in the fileframe.", cbytes, nchunk);
+    return -5;
+  }
+  if (slot->alloc < cbytes) {
+    free(slot->chunk);
+    slot->chunk = malloc((size_t)cbytes);
+    slot->alloc = cbytes;
+  }
+  memcpy(slot->chunk, header, BLOSC_MIN_HEADER_LENGTH);
+  size_t rbytes = fread(slot->chunk + BLOSC_MIN_HEADER_LENGTH, 1,
+                        (size_t)(cbytes - BLOSC_MIN_HEADER_LENGTH), iter->fp);
+  if (rbytes != (size_t)(cbytes - BLOSC_MIN_HEADER_LENGTH)) {
+    BLOSC_TRACE_ERROR("Cannot read chunk %d out of the fileframe.", nchunk);
+    return -6;
+  }
+  return cbytes;
+}
+
+
+/* Keep the slots filled with the chunks that come next */
+static void* iter_io_worker(void* arg) {
+  blosc2_schunk_iter *iter = (blosc2_schunk_iter*)arg;
+  for (int32_t nchunk = 0; nchunk < iter->nchunks; nchunk++) {
+    pthread_mutex_lock(&iter->mutex);
+    while (!iter->stop && nchunk - iter->nchunk >= iter->prefetch) {
+      pthread_cond_wait(&iter->cv_free, &iter->mutex);
+    }
+    bool stop = iter->stop;
+    pthread_mutex_unlock(&iter->mutex);
+    if (stop) {
+      break;
+    }
+
+    // The slot is not visible to the consumer until `nread` is bumped
+    iter_slot *slot = &iter->slots[nchunk % iter->prefetch];
+    slot->cbytes = iter_read_chunk(iter, nchunk, slot);
+
+    pthread_mutex_lock(&iter->mutex);
+    iter->nread = nchunk + 1;
+    if (slot->cbytes < 0) {
+      // No more chunks will be read, so the consumer should not wait for them
+      iter->error = slot->cbytes;
+    }
+    pthread_cond_broadcast(&iter->cv_read);
+    pthread_mutex_unlock(&iter->mutex);
+    if (slot->cbytes < 0) {
+      break;
+    }
+  }
+  return NULL;
+}
+
+
+/* Create an iterator over the chunks of a super-chunk */
+blosc2_schunk_iter* blosc2_schunk_iter_new(blosc2_schunk *schunk, int prefetch) {
+  blosc2_schunk_iter *iter = calloc(1, sizeof(blosc2_schunk_iter));
+  iter->schunk = schunk;
+  iter->nchunks = schunk->nchunks;
+  // Only file frames do benefit from reading in advance
+  if (schunk->frame == NULL || schunk->frame->sdata != NULL || prefetch <= 0 || iter->nchunks == 0) {
+    return iter;
+  }
+
+  // Chunks are never overwritten in frames, so a snapshot of the offsets is all that we need
+  int32_t nchunks;
+  if (schunk_lock(schunk, false) < 0) {
+    free(iter);
+    return NULL;
+  }
+  iter->offsets = frame_get_offsets(schunk->frame, &iter->header_len, &nchunks);
+  schunk_unlock(schunk);
+  iter->nchunks = nchunks;
+  if (iter->offsets == NULL) {
+    free(iter);
+    return NULL;
+  }
+  iter->fp = fopen(schunk->frame->fname, "rb");
+  if (iter->fp == NULL) {
+    BLOSC_TRACE_ERROR("Cannot open the fileframe %s.", schunk->frame->fname);
+    free(iter->offsets);
+    free(iter);
+    return NULL;
+  }
+#if !defined(_WIN32) && defined(POSIX_FADV_SEQUENTIAL)
+  // Let the kernel know that it can read ahead aggressively
+  posix_fadvise(fileno(iter->fp), iter->header_len, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+  iter->prefetch = prefetch < iter->nchunks ? prefetch : iter->nchunks;
+  iter->slots = calloc((size_t)iter->prefetch, sizeof(iter_slot));
+  pthread_mutex_init(&iter->mutex, NULL);
+  pthread_cond_init(&iter->cv_read, NULL);
+  pthread_cond_init(&iter->cv_free, NULL);
+  if (pthread_create(&iter->io_thread, NULL, iter_io_worker, iter) != 0) {
+    BLOSC_TRACE_WARNING("Cannot create the I/O thread; chunks will be read synchronously.");
+    pthread_mutex_destroy(&iter->mutex);
+    pthread_cond_destroy(&iter->cv_read);
+    pthread_cond_destroy(&iter->cv_free);
+    free(iter->slots);
+    iter->slots = NULL;
+    fclose(iter->fp);
+    iter->fp = NULL;
+    iter->prefetch = 0;
+  }
+
+  return iter;
+}
+
+
+/* Decompress the next chunk of the iteration */
+int blosc2_schunk_iter_next(blosc2_schunk_iter *iter, int *nchunk, void *dest, int32_t nbytes) {
+  if (iter->nchunk >= iter->nchunks) {
+    *nchunk = -1;
+    return 0;
+  }
+  *nchunk = iter->nchunk;
+  if (iter->prefetch == 0) {
+    iter->nchunk++;
+    return blosc2_schunk_decompress_chunk(iter->schunk, *nchunk, dest, nbytes);
+  }
+
+  pthread_mutex_lock(&iter->mutex);
+  while (iter->nread <= iter->nchunk && iter->error == 0) {
+    pthread_cond_wait(&iter->cv_read, &iter->mutex);
+  }
+  bool available = iter->nread > iter->nchunk;
+  int error = iter->error;
+  pthread_mutex_unlock(&iter->mutex);
+  if (!available) {
+    // The I/O thread gave up before reading this chunk
+    return error;
+  }
+
+  blosc2_schunk *schunk = iter->schunk;
+  iter_slot *slot = &iter->slots[*nchunk % iter->prefetch];
+  int rc = slot->cbytes;
+  if (rc >= 0 && schunk->checksums != NULL && !schunk->checksums_verified[*nchunk]) {
+    rc = check_chunk(schunk, *nchunk, slot->chunk, slot->cbytes);
+  }
+  if (rc >= 0) {
+    int nbytes_ = sw32_(slot->chunk + BLOSC2_CHUNK_NBYTES);
+    if (nbytes < nbytes_) {
+      BLOSC_TRACE_ERROR("Buffer size is too small for the decompressed buffer "
+                        "('%d' bytes, but '%d' are needed).", nbytes, nbytes_);
+      rc = -11;
+    }
+    else {
+      rc = blosc2_decompress_ctx(schunk->dctx, slot->chunk, slot->cbytes, dest, nbytes);
+      if (rc < 0) {
+        BLOSC_TRACE_ERROR("Error in decompressing chunk.");
+        rc = -10;
+      }
+    }
+  }
+
+  // Hand the slot back to the I/O thread
+  pthread_mutex_lock(&iter->mutex);
+  iter->nchunk++;
+  pthread_cond_signal(&iter->cv_free);
+  pthread_mutex_unlock(&iter->mutex);
+
+  return rc;
+}
+
+
+/* Release the resources of an iterator */
+int blosc2_schunk_iter_free(blosc2_schunk_iter *iter) {
+  if (iter->prefetch > 0) {
+    pthread_mutex_lock(&iter->mutex);
+    iter->stop = true;
+    pthread_cond_signal(&iter->cv_free);
+    pthread_mutex_unlock(&iter->mutex);
+    pthread_join(iter->io_thread, NULL);
+    pthread_mutex_destroy(&iter->mutex);
+    pthread_cond_destroy(&iter->cv_read);
+    pthread_cond_destroy(&iter->cv_free);
+    for (int i = 0; i < iter->prefetch; i++) {
+      free(iter->slots[i].chunk);
+    }
+    free(iter->slots);
+  }
+  if (iter->fp != NULL) {
+    fclose(iter->fp);
+  }
+  free(iter->offsets);
+  free(iter);
+  return 0;
+}
+
+
+/* A slot for a buffer that is waiting to be compressed and appended */
+typedef struct {
+  uint8_t* src;        // a copy of the buffer handed in
+  int32_t alloc;       // the size of the `src` buffer
+  int32_t nbytes;
+  uint8_t* chunk;      // the compressed buffer, once `done`
+  chunk_zonemaps* zonemaps;  // and its zone maps (if known)
+  int cbytes;          // the size of the compressed buffer, or a negative code in case of error
+  bool done;
+} appender_slot;
+
+/* A compressor thread, with its own (serial) compression context */
+typedef struct {
+  blosc2_schunk_appender* appender;
+  blosc2_context* cctx;
+  pthread_t thread;
+} appender_compressor;
+
+struct blosc2_schunk_appender_s {
+  blosc2_schunk* schunk;
+  int nthreads;        // the number of compressor threads; 0 means synchronous appends
+  int nqueued;         // the number of slots
+  appender_slot* slots;
+  appender_compressor* compressors;
+  int nchunks;         // the number of chunks in the super-chunk when the appender was created
+  int64_t npushed;     // the number of buffers handed in so far
+  int64_t ncompress;   // the next buffer to be compressed
+  int64_t ncommitted;  // the number of buffers appended so far
+  int rc;              // the first error found, if any
+  bool stop;
+  pthread_t committer;
+  pthread_mutex_t mutex;
+  pthread_cond_t cv_pushed;      // signaled when a new buffer has been handed in
+  pthread_cond_t cv_compressed;  // signaled when a buffer has been compressed
+  pthread_cond_t cv_committed;   // signaled when a chunk has been appended
+};
+
+
+/* Compress the buffers handed in, in whatever order the threads get them */
+static void* appender_compress_worker(void* arg) {
+  appender_compressor *compressor = (appender_compressor*)arg;
+  blosc2_schunk_appender *appender = compressor->appender;
+  pthread_mutex_lock(&appender->mutex);
+  while (true) {
+    while (!appender->stop && appender->ncompress == appender->npushed) {
+      pthread_cond_wait(&appender->cv_pushed, &appender->mutex);
+    }
+    if (appender->stop) {
+      break;
+    }
+    appender_slot *slot = &appender->slots[appender->ncompress % appender->nqueued];
+    appender->ncompress++;
+    pthread_mutex_unlock(&appender->mutex);
+
+    uint8_t* chunk = malloc((size_t)slot->nbytes + BLOSC_MAX_OVERHEAD);
+    int cbytes = blosc2_compress_ctx(compressor->cctx, slot->src, slot->nbytes, chunk,
+                                     slot->nbytes + BLOSC_MAX_OVERHEAD);
+    chunk_zonemaps* zonemaps = NULL;
+    if (cbytes < 0) {
+      free(chunk);
+      chunk = NULL;
+    }
+    else {
+      zonemaps = zonemaps_capture(compressor->cctx);
+    }
+
+    pthread_mutex_lock(&appender->mutex);
+    slot->chunk = chunk;
+    slot->zonemaps = zonemaps;
+    slot->cbytes = cbytes;
+    slot->done = true;
+    pthread_cond_signal(&appender->cv_compressed);
+  }
+  pthread_mutex_unlock(&appender->mutex);
+  return NULL;
+}
+
+
+/* Append the compressed buffers to the super-chunk, in the order they were handed in */
+static void* appender_commit_worker(void* arg) {
+  blosc2_schunk_appender *appender = (blosc2_schunk_appender*)arg;
+  pthread_mutex_lock(&appender->mutex);
+  while (true) {
+    appender_slot *slot = &appender->slots[appender->ncommitted % appender->nqueued];
+    while (!appender->stop && !(appender->ncommitted < appender->npushed && slot->done)) {
+      pthread_cond_wait(&appender->cv_compressed, &appender->mutex);
+    }
+    if (appender->stop) {
+      break;
+    }
+    bool failed = appender->rc < 0;
+    pthread_mutex_unlock(&appender->mutex);
+
+    // After an error the chunks that come next are discarded, so that there are no holes
+    int rc = slot->cbytes;
+    if (rc >= 0 && !failed) {
+      rc = locked_append_chunk(appender->schunk, slot->chunk, false, slot->zonemaps);
+    }
+    else {
+      free(slot->zonemaps);
+    }
+    if (rc < 0 || failed) {
+      free(slot->chunk);
+    }
+
+    pthread_mutex_lock(&appender->mutex);
+    if (rc < 0 && appender->rc == 0) {
+      appender->rc = rc;
+    }
+    slot->chunk = NULL;
+    slot->zonemaps = NULL;
+    slot->done = false;
+    appender->ncommitted++;
+    pthread_cond_broadcast(&appender->cv_committed);
+  }
+  pthread_mutex_unlock(&appender->mutex);
+  return NULL;
+}
+
+
+/* Stop the threads of an appender (the `nstarted` first compressors, and maybe the committer) */
+static void appender_stop(blosc2_schunk_appender *appender, int nstarted, bool committer) {
+  pthread_mutex_lock(&appender->mutex);
+  appender->stop = true;
+  pthread_cond_broadcast(&appender->cv_pushed);
+  pthread_cond_broadcast(&appender->cv_compressed);
+  pthread_mutex_unlock(&appender->mutex);
+  for (int tid = 0; tid < nstarted; tid++) {
+    pthread_join(appender->compressors[tid].thread, NULL);
+  }
+  if (committer) {
+    pthread_join(appender->committer, NULL);
+  }
+  for (int tid = 0; tid < appender->nthreads; tid++) {
+    blosc2_free_ctx(appender->compressors[tid].cctx);
+  }
+  free(appender->compressors);
+  appender->compressors = NULL;
+  for (int i = 0; i < appender->nqueued; i++) {
+    free(appender->slots[i].src);
+    free(appender->slots[i].chunk);
+    free(appender->slots[i].zonemaps);
+  }
+  free(appender->slots);
+  appender->slots = NULL;
+  pthread_mutex_destroy(&appender->mutex);
+  pthread_cond_destroy(&appender->cv_pushed);
+  pthread_cond_destroy(&appender->cv_compressed);
+  pthread_cond_destroy(&appender->cv_committed);
+  appender->nthreads = 0;
+}
+
+
+/* Create an appender that compresses buffers in the background */
+blosc2_schunk_appender* blosc2_schunk_appender_new(blosc2_schunk *schunk, int nthreads, int nqueued) {
+  blosc2_schunk_appender *appender = calloc(1, sizeof(blosc2_schunk_appender));
+  appender->schunk = schunk;
+  appender->nchunks = schunk->nchunks;
+  if (nthreads <= 0) {
+    nthreads = schunk->cctx->nthreads;
+  }
+  if (nqueued < nthreads) {
+    // Every thread should have something to compress
+    nqueued = 2 * nthreads;
+  }
+  appender->nthreads = nthreads;
+  appender->nqueued = nqueued;
+  appender->slots = calloc((size_t)nqueued, sizeof(appender_slot));
+  appender->compressors = calloc((size_t)nthreads, sizeof(appender_compressor));
+  blosc2_cparams cparams = *schunk->storage->cparams;
+  cparams.nthreads = 1;
+  cparams.schunk = schunk;
+  for (int tid = 0; tid < nthreads; tid++) {
+    appender->compressors[tid].appender = appender;
+    appender->compressors[tid].cctx = blosc2_create_cctx(cparams);
+  }
+  pthread_mutex_init(&appender->mutex, NULL);
+  pthread_cond_init(&appender->cv_pushed, NULL);
+  pthread_cond_init(&appender->cv_compressed, NULL);
+  pthread_cond_init(&appender->cv_committed, NULL);
+
+  if (pthread_create(&appender->committer, NULL, appender_commit_worker, appender) != 0) {
+    BLOSC_TRACE_WARNING("Cannot create the committer thread; buffers will be appended synchronously.");
+    appender_stop(appender, 0, false);
+    return appender;
+  }
+  for (int tid = 0; tid < nthreads; tid++) {
+    appender_compressor *compressor = &appender->compressors[tid];
+    if (pthread_create(&compressor->thread, NULL, appender_compress_worker, compressor) != 0) {
+      if (tid == 0) {
+        BLOSC_TRACE_WARNING("Cannot create the compressor threads; buffers will be appended "
+                            "synchronously.");
+        appender_stop(appender, 0, true);
+        return appender;
+      }
+      BLOSC_TRACE_WARNING("Cannot create thread; using %d compressor threads.", tid);
+      // The contexts of the threads that have not been started are not needed
+      for (int i = tid; i < nthreads; i++) {
+        blosc2_free_ctx(appender->compressors[i].cctx);
+      }
+      appender->nthreads = tid;
+      break;
+    }
+  }
+
+  return appender;
+}
+
+
+/* Hand a buffer in to be compressed and appended */
+int blosc2_schunk_appender_push(blosc2_schunk_appender *appender, const void *src, int32_t nbytes) {
+  if (appender->nthreads == 0) {
+    if (appender->rc < 0) {
+      return appender->rc;
+    }
+    int rc = blosc2_schunk_append_buffer(appender->schunk, (void*)src, nbytes);
+    if (rc < 0) {
+      appender->rc = rc;
+    }
+    return rc;
+  }
+  if (nbytes < 0) {
+    BLOSC_TRACE_ERROR("nbytes ('%d') cannot be negative.", nbytes);
+    return -1;
+  }
+
+  // Wait until there is a free slot
+  pthread_mutex_lock(&appender->mutex);
+  while (appender->rc == 0 && appender->npushed - appender->ncommitted >= appender->nqueued) {
+    pthread_cond_wait(&appender->cv_committed, &appender->mutex);
+  }
+  int rc = appender->rc;
+  appender_slot *slot = &appender->slots[appender->npushed % appender->nqueued];
+  pthread_mutex_unlock(&appender->mutex);
+  if (rc < 0) {
+    return rc;
+  }
+
+  // The slot is not visible to the threads until `npushed` is bumped
+  if (slot->alloc < nbytes) {
+    free(slot->src);
+    slot->src = malloc((size_t)nbytes);
+    slot->alloc = nbytes;
+  }
+  memcpy(slot->src, src, (size_t)nbytes);
+  slot->nbytes = nbytes;
+
+  pthread_mutex_lock(&appender->mutex);
+  appender->npushed++;
+  int nchunks = appender->nchunks + (int)appender->npushed;
+  pthread_cond_signal(&appender->cv_pushed);
+  pthread_mutex_unlock(&appender->mutex);
+
+  return nchunks;
+}
+
+
+/* Wait until all the buffers handed in have been appended */
+int blosc2_schunk_appender_flush(blosc2_schunk_appender *appender) {
+  if (appender->nthreads > 0) {
+    pthread_mutex_lock(&appender->mutex);
+    while (appender->ncommitted < appender->npushed) {
+      pthread_cond_wait(&appender->cv_committed, &appender->mutex);
+    }
+    pthread_mutex_unlock(&appender->mutex);
+  }
+  return appender->rc < 0 ? appender->rc : appender->schunk->nchunks;
+}
+
+
+/* Append the buffers that are still queued, and release the resources of an appender */
+int blosc2_schunk_appender_free(blosc2_schunk_appender *appender) {
+  int rc = blosc2_schunk_appender_flush(appender);
+  if (appender->nthreads > 0) {
+    appender_stop(appender, appender->nthreads, true);
+  }
+  free(appender);
+  return rc;
+}
+
+
+/* Return a compressed chunk that is part of a super-chunk in the `chunk` parameter.
+ * If the super-chunk is backed by a frame that is disk-based, a buffer is allocated for the
+ * (compressed) chunk, and hence a free is needed.  You can check if the chunk requires a free
+ * with the `needs_free` parameter.
+ * If the chunk does not need a free, it means that a pointer to the location in the super-chunk
+ * (or the backing in-memory frame) is returned in the `chunk` parameter.
+ *
+ * The size of the (compressed) chunk is returned.  If some problem is detected, a negative code
+ * is returned instead.
+*/
+static int get_chunk(blosc2_schunk *schunk, int nchunk, uint8_t **chunk, bool *needs_free) {
+  if (schunk->frame != NULL) {
+    return frame_get_chunk(schunk->frame, nchunk, chunk, needs_free);
+  }
+
+  if (nchunk >= schunk->nchunks) {
+    BLOSC_TRACE_ERROR("nchunk ('%d') exceeds the number of chunks "
+                      "('%d') in schunk.", nchunk, schunk->nchunks);
+    return -2;
+  }
+
+  *chunk = schunk->data[nchunk];
+  if (*chunk == 0) {
+    *needs_free = 0;
+    return 0;
+  }
+
+  *needs_free = false;
+  return sw32_(*chunk + BLOSC2_CHUNK_CBYTES);
+}
+
+
+int blosc2_schunk_get_chunk(blosc2_schunk *schunk, int nchunk, uint8_t **chunk, bool *needs_free) {
+  int rc = schunk_lock(schunk, false);
+  if (rc < 0) {
+    return rc;
+  }
+  rc = get_chunk(schunk, nchunk, chunk, needs_free);
+  schunk_unlock(schunk);
+  return rc;
+}
+
+
+/* Return a compressed chunk that is part of a super-chunk in the `chunk` parameter.
+ * If the super-chunk is backed by a frame that is disk-based, a buffer is allocated for the
+ * (compressed) chunk, and hence a free is needed.  You can check if the chunk requires a free
+ * with the `needs_free` parameter.
+ * If the chunk does not need a free, it means that a pointer to the location in the super-chunk
+ * (or the backing in-memory frame) is returned in the `chunk` parameter.
+ *
+ * The size of the (compressed) chunk is returned.  If some problem is detected, a negative code
+ * is returned instead.
+*/
+static int get_lazychunk(blosc2_schunk *schunk, int nchunk, uint8_t **chunk, bool *needs_free) {
+  if (schunk->frame != NULL) {
+    return frame_get_lazychunk(schunk->frame, nchunk, chunk, needs_free);
+  }
+
+  if (nchunk >= schunk->nchunks) {
+    BLOSC_TRACE_ERROR("nchunk ('%d') exceeds the number of chunks "
+                      "('%d') in schunk.", nchunk, schunk->nchunks);
+    return -2;
+  }
+
+  *chunk = schunk->data[nchunk];
+  if (*chunk == 0) {
+    *needs_free = 0;
+    return 0;
+  }
+
+  *needs_free = false;
+  return sw32_(*chunk + BLOSC2_CHUNK_CBYTES);
+}
+
+
+int blosc2_schunk_get_lazychunk(blosc2_schunk *schunk, int nchunk, uint8_t **chunk, bool *needs_free) {
+  int rc = schunk_lock(schunk, false);
+  if (rc < 0) {
+    return rc;
+  }
+  rc = get_lazychunk(schunk, nchunk, chunk, needs_free);
+  schunk_unlock(schunk);
+  return rc;
+}
+
+
+/* Find whether the schunk has a metalayer or not.
+ *
+ * If successful, return the index of the metalayer.  Else, return a negative value.
+ */
+int blosc2_has_metalayer(blosc2_schunk *schunk, const char *name) {
+  if (strlen(name) > BLOSC2_METALAYER_NAME_MAXLEN) {
+    BLOSC_TRACE_ERROR("Metalayers cannot be larger than %d chars.", BLOSC2_METALAYER_NAME_MAXLEN);
+    return -1;
+  }
+
+  for (int nmetalayer = 0; nmetalayer < schunk->nmetalayers; nmetalayer++) {
+    if (strcmp(name, schunk->metalayers[nmetalayer]->name) == 0) {
+      return nmetalayer;  // Found
+    }
   }
-  else {
-    if (frame_append_chunk(schunk->frame, chunk, schunk) == NULL) {
-      BLOSC_TRACE_ERROR("Problems appending a chunk.");
+  return -1;  // Not found
+}
+
+static int reorder_offsets(blosc2_schunk *schunk, int *offsets_order) {
+  // Check that the offsets order are correct
+  bool *index_check = (bool *) calloc(schunk->nchunks, sizeof(bool));
+  for (int i = 0; i < schunk->nchunks; ++i) {
+    int index = offsets_order[i];
+    if (index >= schunk->nchunks) {
+      BLOSC_TRACE_ERROR("Index is bigger than the number of chunks.");
+      return -1;
+    }
+    if (index_check[index] == false) {
+      index_check[index] = true;
+    } else {
+      BLOSC_TRACE_ERROR("Index is yet used.");
       return -1;
     }
   }
+  free(index_check);
 
-  /* printf("Compression chunk #%lld: %d -> %d (%.1fx)\n", */
-  /*         nchunks, nbytes, cbytes, (1.*nbytes) / cbytes); */
-  return schunk->nchunks;
+  int32_t nchunks = schunk->nchunks;
+  if (schunk->chunksize > 0 && nchunks > 0 && offsets_order[nchunks - 1] != nchunks - 1 &&
+      schunk->nbytes != (int64_t)nchunks * schunk->chunksize) {
+    // The last chunk is shorter than the rest and will not be the last one anymore
+    schunk->chunksize = 0;
+  }
+
+  if (schunk->checksums != NULL) {
+    uint64_t *checksums_copy = malloc(schunk->nchunks * sizeof(uint64_t));
+    bool *verified_copy = malloc(schunk->nchunks * sizeof(bool));
+    memcpy(checksums_copy, schunk->checksums, schunk->nchunks * sizeof(uint64_t));
+    memcpy(verified_copy, schunk->checksums_verified, schunk->nchunks * sizeof(bool));
+    for (int i = 0; i < schunk->nchunks; ++i) {
+      schunk->checksums[i] = checksums_copy[offsets_order[i]];
+      schunk->checksums_verified[i] = verified_copy[offsets_order[i]];
+    }
+    free(checksums_copy);
+    free(verified_copy);
+  }
+
+  zonemap_index *zonemaps = schunk->zonemaps;
+  if (zonemaps != NULL) {
+    zonemaps_resize(zonemaps, nchunks);
+    chunk_zonemaps **chunks_copy = malloc(nchunks * sizeof(chunk_zonemaps*));
+    memcpy(chunks_copy, zonemaps->chunks, nchunks * sizeof(chunk_zonemaps*));
+    for (int i = 0; i < nchunks; ++i) {
+      zonemaps->chunks[i] = chunks_copy[offsets_order[i]];
+    }
+    free(chunks_copy);
+  }
+
+  if (schunk->frame != NULL) {
+    return frame_reorder_offsets(schunk->frame, offsets_order, schunk);
+  }
+  uint8_t **offsets = schunk->data;
+
+  // Make a copy of the chunk offsets and reorder it
+  uint8_t **offsets_copy = malloc(schunk->data_len);
+  memcpy(offsets_copy, offsets, schunk->data_len);
+
+  for (int i = 0; i < schunk->nchunks; ++i) {
+    offsets[i] = offsets_copy[offsets_order[i]];
+  }
+  free(offsets_copy);
+
+  return 0;
 }
 
 
-/* Insert an existing @p chunk in a specified position on a super-chunk */
-int blosc2_schunk_insert_chunk(blosc2_schunk *schunk, int nchunk, uint8_t *chunk, bool copy) {
-  int32_t nchunks = schunk->nchunks;
-  int32_t nbytes = sw32_(chunk + BLOSC2_CHUNK_NBYTES);
-  int32_t cbytes = sw32_(chunk + BLOSC2_CHUNK_CBYTES);
+/* Reorder the chunk offsets of an existing super-chunk. */
+int blosc2_schunk_reorder_offsets(blosc2_schunk *schunk, int *offsets_order) {
+  int rc = schunk_lock(schunk, true);
+  if (rc < 0) {
+    return rc;
+  }
+  rc = reorder_offsets(schunk, offsets_order);
+  cache_invalidate(schunk, -1);
+  index_invalidate(schunk, 0);
+  schunk_unlock(schunk);
+  return rc;
+}
 
-  if (schunk->chunksize == -1) {
-    schunk->chunksize = nbytes;  // The super-chunk is initialized now
+
+struct verify_job {
+  blosc2_schunk *schunk;
+  int start;
+  int stop;
+  int step;
+  int nfailed;
+};
+
+
+/* Hash the chunks assigned to a worker and compare them against their checksums */
+static void* verify_worker(void* arg) {
+  struct verify_job *job = (struct verify_job*)arg;
+  blosc2_schunk *schunk = job->schunk;
+  for (int nchunk = job->start; nchunk < job->stop; nchunk += job->step) {
+    uint8_t* chunk;
+    bool needs_free;
+    // The frame is already locked by blosc2_schunk_verify()
+    int cbytes = get_chunk(schunk, nchunk, &chunk, &needs_free);
+    if (cbytes < 0) {
+      job->nfailed++;
+      continue;
+    }
+    uint64_t checksum = (cbytes == 0) ? 0 : xxh64(chunk, (size_t)cbytes, 0);
+    if (needs_free) {
+      free(chunk);
+    }
+    schunk->checksums_verified[nchunk] = (checksum == schunk->checksums[nchunk]);
+    if (!schunk->checksums_verified[nchunk]) {
+      BLOSC_TRACE_ERROR("Checksum mismatch in chunk %d.", nchunk);
+      job->nfailed++;
+    }
   }
+  return NULL;
+}
+
 
-  if (nbytes > schunk->chunksize) {
-    BLOSC_TRACE_ERROR("Inserting chunks that have different lengths in the same schunk "
-                      "is not supported yet: %d > %d.", nbytes, schunk->chunksize);
+static int verify_schunk(blosc2_schunk *schunk) {
+  if (schunk->checksums == NULL) {
+    BLOSC_TRACE_ERROR("The super-chunk does not keep checksums.");
     return -1;
   }
+  if (schunk->frame != NULL) {
+    int rc = frame_verify_fingerprint(schunk->frame, schunk);
+    if (rc < 0) {
+      return -2;
+    }
+  }
+  if (schunk->nchunks == 0) {
+    return 0;
+  }
 
-  /* Update counters */
-  schunk->nchunks = nchunks + 1;
-  schunk->nbytes += nbytes;
-  schunk->cbytes += cbytes;
+  // The first chunk is checked in this thread; this also populates the cache
+  // for the frame offsets (if any) before the workers start sharing it
+  struct verify_job first_job = {schunk, 0, 1, 1, 0};
+  verify_worker(&first_job);
+  int nfailed = first_job.nfailed;
 
-  // Update super-chunk or frame
-  if (schunk->frame == NULL) {
-    // Check that we are not appending a small chunk after another small chunk
-    if ((schunk->nchunks > 0) && (nbytes < schunk->chunksize)) {
-      uint8_t* last_chunk = schunk->data[nchunks - 1];
-      int32_t last_nbytes = sw32_(last_chunk + BLOSC2_CHUNK_NBYTES);
-      if ((last_nbytes < schunk->chunksize) && (nbytes < schunk->chunksize)) {
-        BLOSC_TRACE_ERROR("Appending two consecutive chunks with a chunksize smaller "
-                          "than the schunk chunksize is not allowed yet:  %d != %d",
-                          nbytes, schunk->chunksize);
-        return -1;
-      }
+  int nthreads = schunk->dctx->nthreads;
+  if (nthreads > schunk->nchunks - 1) {
+    nthreads = schunk->nchunks - 1;
+  }
+  if (nthreads <= 1) {
+    struct verify_job job = {schunk, 1, schunk->nchunks, 1, 0};
+    verify_worker(&job);
+    return nfailed + job.nfailed;
+  }
+
+  pthread_t *threads = malloc(nthreads * sizeof(pthread_t));
+  struct verify_job *jobs = malloc(nthreads * sizeof(struct verify_job));
+  int nstarted = 0;
+  for (int tid = 0; tid < nthreads; tid++) {
+    jobs[tid].schunk = schunk;
+    jobs[tid].start = 1 + tid;
+    jobs[tid].stop = schunk->nchunks;
+    jobs[tid].step = nthreads;
+    jobs[tid].nfailed = 0;
+  }
+  for (int tid = 0; tid < nthreads; tid++) {
+    if (pthread_create(&threads[tid], NULL, verify_worker, &jobs[tid]) != 0) {
+      BLOSC_TRACE_WARNING("Cannot create thread; verifying the remaining chunks serially.");
+      break;
     }
+    nstarted++;
+  }
+  for (int tid = nstarted; tid < nthreads; tid++) {
+    verify_worker(&jobs[tid]);
+  }
+  for (int tid = 0; tid < nthreads; tid++) {
+    if (tid < nstarted) {
+      pthread_join(threads[tid], NULL);
+    }
+    nfailed += jobs[tid].nfailed;
+  }
+  free(threads);
+  free(jobs);
 
-    if (copy) {
-      // Make a copy of the chunk
-      uint8_t *chunk_copy = malloc(cbytes);
-      memcpy(chunk_copy, chunk, cbytes);
-      chunk = chunk_copy;
+  return nfailed;
+}
+
+
+/* Verify the checksums of all the chunks in a super-chunk. */
+int blosc2_schunk_verify(blosc2_schunk *schunk) {
+  int rc = schunk_lock(schunk, false);
+  if (rc < 0) {
+    return rc;
+  }
+  rc = verify_schunk(schunk);
+  schunk_unlock(schunk);
+  return rc;
+}
+
+
+static int get_zonemaps(blosc2_schunk *schunk, int nchunk, chunk_zonemaps **zonemaps) {
+  zonemap_index *index = schunk->zonemaps;
+  if (index == NULL) {
+    BLOSC_TRACE_ERROR("The super-chunk does not keep zone maps.");
+    return -1;
+  }
+  if (nchunk < 0 || nchunk >= schunk->nchunks) {
+    BLOSC_TRACE_ERROR("The chunk %d is not in the super-chunk (%d chunks).", nchunk, schunk->nchunks);
+    return -1;
+  }
+  *zonemaps = nchunk < index->nchunks ? index->chunks[nchunk] : NULL;
+  return 0;
+}
+
+
+/* Get the zone map of a whole chunk. */
+int blosc2_schunk_get_zonemap(blosc2_schunk *schunk, int nchunk, blosc2_zonemap *zonemap) {
+  int rc = schunk_lock(schunk, false);
+  if (rc < 0) {
+    return rc;
+  }
+  chunk_zonemaps *zonemaps;
+  rc = get_zonemaps(schunk, nchunk, &zonemaps);
+  if (rc == 0) {
+    if (zonemaps != NULL) {
+      *zonemap = zonemaps->maps[0];
     }
-    else if (cbytes < nbytes) {
-      // We still want to do a shrink of the chunk
-      chunk = realloc(chunk, cbytes);
+    else {
+      memset(zonemap, 0, sizeof(blosc2_zonemap));
+      zonemap->nitems = -1;
     }
+  }
+  schunk_unlock(schunk);
+  return rc;
+}
 
-    // Make space for appending the copy of the chunk and do it
-    if ((nchunks + 1) * sizeof(void *) > schunk->data_len) {
-      // Extend the data pointer by one memory page (4k)
-      schunk->data_len += 4096;  // must be a multiple of sizeof(void*)
-      schunk->data = realloc(schunk->data, schunk->data_len);
+
+/* Get a copy of the zone maps of the blocks of a chunk. */
+int blosc2_schunk_get_block_zonemaps(blosc2_schunk *schunk, int nchunk, blosc2_zonemap **zonemaps) {
+  *zonemaps = NULL;
+  int rc = schunk_lock(schunk, false);
+  if (rc < 0) {
+    return rc;
+  }
+  chunk_zonemaps *zonemaps_;
+  rc = get_zonemaps(schunk, nchunk, &zonemaps_);
+  if (rc == 0 && zonemaps_ != NULL) {
+    rc = zonemaps_->nblocks;
+    *zonemaps = malloc(rc * sizeof(blosc2_zonemap));
+    memcpy(*zonemaps, zonemaps_->maps + 1, rc * sizeof(blosc2_zonemap));
+  }
+  schunk_unlock(schunk);
+  return rc;
+}
+
+
+/* Whether the items summarized by a zone map may be in [low, high]. */
+static bool zonemap_overlaps(const blosc2_zonemap *zonemap, uint8_t type, blosc2_zonemap_value low,
+                             blosc2_zonemap_value high) {
+  if (zonemap->nitems < 0) {
+    return true;
+  }
+  if (zonemap->nnulls == zonemap->nitems) {
+    // Null items are never in the range
+    return false;
+  }
+  if (type >= BLOSC2_ZONEMAP_FLOAT32) {
+    return zonemap->max.f >= low.f && zonemap->min.f <= high.f;
+  }
+  return zonemap->max.i >= low.i && zonemap->min.i <= high.i;
+}
+
+
+/* Get a mask of the blocks of a chunk that cannot have items in [low, high]. */
+static int zonemap_maskout(blosc2_schunk *schunk, int nchunk, blosc2_zonemap_value low,
+                           blosc2_zonemap_value high, bool **maskout, int32_t *nblocks) {
+  *maskout = NULL;
+  *nblocks = 0;
+  chunk_zonemaps *zonemaps;
+  int rc = get_zonemaps(schunk, nchunk, &zonemaps);
+  if (rc < 0) {
+    return rc;
+  }
+
+  if (zonemaps == NULL) {
+    // Every block may match
+    uint8_t *chunk;
+    bool needs_free = false;
+    rc = get_lazychunk(schunk, nchunk, &chunk, &needs_free);
+    if (rc > 0) {
+      int32_t chunk_nbytes = sw32_(chunk + BLOSC2_CHUNK_NBYTES);
+      int32_t blocksize = sw32_(chunk + BLOSC2_CHUNK_BLOCKSIZE);
+      *nblocks = blocksize > 0 ? (chunk_nbytes + blocksize - 1) / blocksize : 0;
+      rc = *nblocks;
+    }
+    if (needs_free) {
+      free(chunk);
+    }
+    return rc;
+  }
+
+  uint8_t type = ((zonemap_index*)schunk->zonemaps)->type;
+  *nblocks = zonemaps->nblocks;
+  rc = 0;
+  if (zonemap_overlaps(&zonemaps->maps[0], type, low, high)) {
+    *maskout = malloc(zonemaps->nblocks * sizeof(bool));
+    for (int32_t i = 0; i < zonemaps->nblocks; i++) {
+      bool overlaps = zonemap_overlaps(&zonemaps->maps[1 + i], type, low, high);
+      (*maskout)[i] = !overlaps;
+      rc += overlaps;
+    }
+    if (rc == zonemaps->nblocks) {
+      // Nothing to mask out
+      free(*maskout);
+      *maskout = NULL;
+    }
+  }
+  return rc;
+}
+
+
+int blosc2_schunk_zonemap_maskout(blosc2_schunk *schunk, int nchunk, blosc2_zonemap_value low,
+                                  blosc2_zonemap_value high, bool **maskout, int32_t *nblocks) {
+  *maskout = NULL;
+  *nblocks = 0;
+  int rc = schunk_lock(schunk, false);
+  if (rc < 0) {
+    return rc;
+  }
+  rc = zonemap_maskout(schunk, nchunk, low, high, maskout, nblocks);
+  schunk_unlock(schunk);
+  return rc;
+}
+
+
+/* The size of the items of a zone map (or predicate) type, or 0 if it is not valid. */
+static int32_t zonemap_typesize(uint8_t type) {
+  switch (type) {
+    case BLOSC2_ZONEMAP_INT8:
+      return 1;
+    case BLOSC2_ZONEMAP_INT16:
+      return 2;
+    case BLOSC2_ZONEMAP_INT32:
+    case BLOSC2_ZONEMAP_FLOAT32:
+      return 4;
+    case BLOSC2_ZONEMAP_INT64:
+    case BLOSC2_ZONEMAP_FLOAT64:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+
+/* The next double after `value` (which is finite) upwards or downwards. */
+static double next_double(double value, bool up) {
+  if (value == 0) {
+    // The smallest denormal
+    return up ? 4.9406564584124654e-324 : -4.9406564584124654e-324;
+  }
+  int64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  bits += (value > 0) == up ? 1 : -1;
+  memcpy(&value, &bits, sizeof(bits));
+  return value;
+}
+
+
+/* Get the range [low, high] of the values that match a predicate.  Returns 1 if the range is
+ * not empty, 0 if nothing can match, and a negative value if the predicate is not valid. */
+static int predicate_range(const blosc2_predicate *predicate, blosc2_zonemap_value *low,
+                           blosc2_zonemap_value *high) {
+  bool is_float = predicate->type >= BLOSC2_ZONEMAP_FLOAT32;
+  blosc2_zonemap_value value = predicate->value;
+  if (is_float) {
+    low->f = -INFINITY;
+    high->f = INFINITY;
+  }
+  else {
+    low->i = INT64_MIN;
+    high->i = INT64_MAX;
+  }
+  switch (predicate->op) {
+    case BLOSC2_SCAN_LT:
+      if (is_float) {
+        if (!(value.f > -INFINITY)) {
+          return 0;
+        }
+        high->f = value.f == INFINITY ? DBL_MAX : next_double(value.f, false);
+      }
+      else if (value.i == INT64_MIN) {
+        return 0;
+      }
+      else {
+        high->i = value.i - 1;
+      }
+      break;
+    case BLOSC2_SCAN_LE:
+      *high = value;
+      break;
+    case BLOSC2_SCAN_GT:
+      if (is_float) {
+        if (!(value.f < INFINITY)) {
+          return 0;
+        }
+        low->f = value.f == -INFINITY ? -DBL_MAX : next_double(value.f, true);
+      }
+      else if (value.i == INT64_MAX) {
+        return 0;
+      }
+      else {
+        low->i = value.i + 1;
+      }
+      break;
+    case BLOSC2_SCAN_GE:
+      *low = value;
+      break;
+    case BLOSC2_SCAN_EQ:
+      *low = value;
+      *high = value;
+      break;
+    case BLOSC2_SCAN_BETWEEN:
+      *low = value;
+      *high = predicate->high;
+      break;
+    default:
+      BLOSC_TRACE_ERROR("Unknown comparison (%d) in the predicate.", predicate->op);
+      return -1;
+  }
+  if (is_float) {
+    // NaN bounds never match
+    return low->f <= high->f;
+  }
+  return low->i <= high->i;
+}
+
+
+/* Run the postfilter of `dctx` over the blocks of chunk `nchunk` that are not in `maskout` (which
+ * may be NULL), using `dest` (with room for the `nbytes` of the chunk) as the destination.
+ * The blocks of delta chunks refer to the first one in the destination, so these cannot go
+ * through the postfilter while decompressing; they are decompressed with `plain_dctx` (which is
+ * created on first use) instead, and the postfilter is run on their blocks afterwards. */
+static int postfilter_chunk(blosc2_schunk *schunk, blosc2_context *dctx, blosc2_context **plain_dctx,
+                            int nchunk, const bool *maskout, int32_t nblocks, uint8_t *dest,
+                            int32_t nbytes) {
+  uint8_t *chunk;
+  bool needs_free;
+  // The checksum can only be verified when all the blocks are read
+  int cbytes = maskout == NULL ? get_verified_chunk(schunk, nchunk, &chunk, &needs_free) :
+               get_lazychunk(schunk, nchunk, &chunk, &needs_free);
+  if (cbytes <= 0) {
+    // Non-initialized chunks (or errors)
+    return cbytes;
+  }
+
+  int rc;
+  if (!chunk_uses_delta(chunk, cbytes)) {
+    if (maskout != NULL) {
+      blosc2_set_maskout(dctx, (bool*)maskout, nblocks);
+    }
+    rc = blosc2_decompress_ctx(dctx, chunk, cbytes, dest, nbytes);
+  }
+  else {
+    if (*plain_dctx == NULL) {
+      blosc2_dparams dparams = {.nthreads=dctx->nthreads, .schunk=schunk};
+      *plain_dctx = blosc2_create_dctx(dparams);
+    }
+    rc = *plain_dctx == NULL ? BLOSC2_ERROR_MEMORY_ALLOC :
+         blosc2_decompress_ctx(*plain_dctx, chunk, cbytes, dest, nbytes);
+    int32_t blocksize = sw32_(chunk + BLOSC2_CHUNK_BLOCKSIZE);
+    int32_t chunk_nbytes = rc;
+    for (int32_t nblock = 0; rc >= 0 && nblock * blocksize < chunk_nbytes; nblock++) {
+      if (maskout != NULL && nblock < nblocks && maskout[nblock]) {
+        continue;
+      }
+      int32_t offset = nblock * blocksize;
+      blosc2_postfilter_params postparams;
+      memcpy(&postparams, dctx->postparams, sizeof(postparams));
+      postparams.in = dest + offset;
+      postparams.out = dest + offset;
+      postparams.size = chunk_nbytes - offset < blocksize ? chunk_nbytes - offset : blocksize;
+      postparams.typesize = schunk->typesize;
+      postparams.offset = offset;
+      postparams.nblock = nblock;
+      postparams.tid = 0;
+      postparams.ttmp = NULL;
+      postparams.ttmp_nbytes = 0;
+      postparams.ctx = dctx;
+      if (dctx->postfilter(&postparams) != 0) {
+        rc = -1;
+      }
+    }
+  }
+  if (needs_free) {
+    free(chunk);
+  }
+  return rc;
+}
+
+
+struct scan_state {
+  blosc2_zonemap_value low;
+  blosc2_zonemap_value high;
+  uint8_t type;
+  int32_t typesize;
+  blosc2_scan_fn callback;
+  void *user_data;
+  int64_t chunk_start;   // the first item of the chunk being decompressed
+  int64_t *nmatches;     // one per thread
+  int *rcs;              // one per thread
+};
+
+
+/* Pack the flags (0 or 1) of 64 items into a word of the bitmap, and return how many are set. */
+static inline int32_t pack_matches(const uint8_t* match, uint64_t* word) {
+  // The multiplications gather 8 flags in the top byte, either as bits or added up
+  const uint64_t gather = is_little_endian() ? 0x0102040810204080ULL : 0x8040201008040201ULL;
+  int32_t count = 0;
+  *word = 0;
+  for (int i = 0; i < 8; i++) {
+    uint64_t flags;
+    memcpy(&flags, match + i * 8, sizeof(flags));
+    *word |= ((flags * gather) >> 56) << (i * 8);
+    count += (int32_t)((flags * 0x0101010101010101ULL) >> 56);
+  }
+  return count;
+}
+
+/* Set the bits of the items in [low, high].  The compare loop over a full word has a fixed trip
+ * count and no branches, so that the compiler can vectorize it; the tail is handled apart. */
+#define SCAN_ITEMS(type, low_, high_)                                  \
+  {                                                                    \
+    const type* items = (const type*)block;                            \
+    uint8_t match[64];                                                 \
+    for (int32_t i = 0; i < nitems; i += 64) {                         \
+      const type* group = items + i;                                   \
+      if (nitems - i >= 64) {                                          \
+        for (int j = 0; j < 64; j++) {                                 \
+          match[j] = (uint8_t)((group[j] >= (low_)) & (group[j] <= (high_)));  \
+        }                                                              \
+      }                                                                \
+      else {                                                           \
+        memset(match, 0, sizeof(match));                               \
+        for (int32_t j = 0; j < nitems - i; j++) {                     \
+          match[j] = (uint8_t)((group[j] >= (low_)) & (group[j] <= (high_)));  \
+        }                                                              \
+      }                                                                \
+      nmatches += pack_matches(match, &bitmap[i / 64]);                \
+    }                                                                  \
+  }
+
+/* Clamp the integer range to the one of the type; nothing can match if they do not overlap. */
+#define SCAN_INT_ITEMS(type, type_min, type_max)                       \
+  {                                                                    \
+    if (state->high.i < (type_min) || state->low.i > (type_max)) {     \
+      break;                                                           \
+    }                                                                  \
+    type low = state->low.i < (type_min) ? (type_min) : (type)state->low.i;     \
+    type high = state->high.i > (type_max) ? (type_max) : (type)state->high.i;  \
+    SCAN_ITEMS(type, low, high);                                       \
+  }
+
+/* Evaluate the predicate on a decompressed block (the destination is never written). */
+static int scan_postfilter(blosc2_postfilter_params *postparams) {
+  struct scan_state *state = postparams->user_data;
+  const uint8_t *block = postparams->in;
+  int32_t nitems = postparams->size / state->typesize;
+  // The bitmap (1 bit per item) fits in the temporary for a block, except for tiny blocks
+  size_t bitmap_nbytes = (size_t)(nitems + 63) / 64 * sizeof(uint64_t);
+  uint64_t *bitmap = (uint64_t*)postparams->ttmp;
+  if (bitmap_nbytes > postparams->ttmp_nbytes) {
+    bitmap = malloc(bitmap_nbytes);
+  }
+  int32_t nmatches = 0;
+  switch (state->type) {
+    case BLOSC2_ZONEMAP_INT8:
+      SCAN_INT_ITEMS(int8_t, INT8_MIN, INT8_MAX);
+      break;
+    case BLOSC2_ZONEMAP_INT16:
+      SCAN_INT_ITEMS(int16_t, INT16_MIN, INT16_MAX);
+      break;
+    case BLOSC2_ZONEMAP_INT32:
+      SCAN_INT_ITEMS(int32_t, INT32_MIN, INT32_MAX);
+      break;
+    case BLOSC2_ZONEMAP_INT64:
+      SCAN_ITEMS(int64_t, state->low.i, state->high.i);
+      break;
+    case BLOSC2_ZONEMAP_FLOAT32:
+      // Compare in double precision, which holds every float exactly
+      SCAN_ITEMS(float, state->low.f, state->high.f);
+      break;
+    case BLOSC2_ZONEMAP_FLOAT64:
+      SCAN_ITEMS(double, state->low.f, state->high.f);
+      break;
+    default:
+      break;
+  }
+  int rc = 0;
+  state->nmatches[postparams->tid] += nmatches;
+  if (nmatches > 0 && state->callback != NULL) {
+    int64_t start = state->chunk_start + postparams->offset / state->typesize;
+    rc = state->callback(state->user_data, start, nitems, bitmap, nmatches, postparams->tid);
+    if (rc < 0) {
+      state->rcs[postparams->tid] = rc;
+    }
+  }
+  if (bitmap != (uint64_t*)postparams->ttmp) {
+    free(bitmap);
+  }
+  return rc < 0 ? rc : 0;
+}
+
+
+/* Find the items that match a predicate, chunk by chunk, skipping what the zone maps rule out. */
+static int64_t scan_schunk(blosc2_schunk *schunk, const blosc2_predicate *predicate,
+                           blosc2_scan_fn callback, void *user_data) {
+  int32_t typesize = zonemap_typesize(predicate->type);
+  if (typesize == 0) {
+    BLOSC_TRACE_ERROR("Unknown type (%d) in the predicate.", predicate->type);
+    return -1;
+  }
+  if (typesize != schunk->typesize) {
+    BLOSC_TRACE_ERROR("The type of the predicate does not match the typesize (%d) of the "
+                      "super-chunk.", schunk->typesize);
+    return -1;
+  }
+  struct scan_state state = {.type=predicate->type, .typesize=typesize, .callback=callback,
+                             .user_data=user_data};
+  int rc = predicate_range(predicate, &state.low, &state.high);
+  if (rc <= 0) {
+    return rc;
+  }
+  int64_t nitems = schunk->nbytes / typesize;
+  rc = check_slice(schunk, 0, nitems);
+  if (rc < 0) {
+    return rc;
+  }
+  bool use_zonemaps = schunk_zonemap_type(schunk) == predicate->type;
+
+  int nthreads = schunk->dctx->nthreads;
+  state.nmatches = calloc(nthreads, sizeof(int64_t));
+  state.rcs = calloc(nthreads, sizeof(int));
+  blosc2_postfilter_params postparams = {.user_data=&state};
+  blosc2_dparams dparams = {.nthreads=nthreads, .schunk=schunk,
+                            .postfilter=scan_postfilter, .postparams=&postparams};
+  blosc2_context *dctx = blosc2_create_dctx(dparams);
+  if (dctx == NULL) {
+    free(state.nmatches);
+    free(state.rcs);
+    return BLOSC2_ERROR_MEMORY_ALLOC;
+  }
+  // Delta chunks are decompressed with a context without the postfilter
+  blosc2_context *plain_dctx = NULL;
+  // The postfilter does not write the destination, but delta chunks are decompressed there
+  uint8_t *dest = NULL;
+  int32_t dest_nbytes = 0;
+
+  for (int nchunk = 0; nchunk < schunk->nchunks && rc >= 0; nchunk++) {
+    bool *maskout = NULL;
+    int32_t nblocks = 0;
+    if (use_zonemaps) {
+      rc = zonemap_maskout(schunk, nchunk, state.low, state.high, &maskout, &nblocks);
+      if (rc <= 0) {
+        // Nothing can match in this chunk (or an error)
+        continue;
+      }
+    }
+    state.chunk_start = chunk_first_item(schunk, nchunk);
+    int32_t nbytes = (int32_t)((chunk_first_item(schunk, nchunk + 1) - state.chunk_start) * typesize);
+    if (nbytes > dest_nbytes) {
+      free(dest);
+      dest = malloc((size_t)nbytes);
+      dest_nbytes = dest == NULL ? 0 : nbytes;
     }
+    rc = dest == NULL ? BLOSC2_ERROR_MEMORY_ALLOC :
+         postfilter_chunk(schunk, dctx, &plain_dctx, nchunk, maskout, nblocks, dest, nbytes);
+    free(maskout);
+    for (int tid = 0; tid < nthreads; tid++) {
+      if (state.rcs[tid] < 0) {
+        // Stopped by the callback
+        rc = state.rcs[tid];
+      }
+    }
+  }
+
+  int64_t nmatches = 0;
+  for (int tid = 0; tid < nthreads; tid++) {
+    nmatches += state.nmatches[tid];
+  }
+  blosc2_free_ctx(dctx);
+  if (plain_dctx != NULL) {
+    blosc2_free_ctx(plain_dctx);
+  }
+  free(dest);
+  free(state.nmatches);
+  free(state.rcs);
+  return rc < 0 ? rc : nmatches;
+}
+
+
+/* Find the items of a super-chunk that match a predicate. */
+int64_t blosc2_schunk_scan(blosc2_schunk *schunk, const blosc2_predicate *predicate,
+                           blosc2_scan_fn callback, void *user_data) {
+  int rc = schunk_lock(schunk, false);
+  if (rc < 0) {
+    return rc;
+  }
+  int64_t nmatches = scan_schunk(schunk, predicate, callback, user_data);
+  schunk_unlock(schunk);
+  return nmatches;
+}
+
+
+struct reduce_state {
+  uint8_t op;
+  bool is_float;
+  int32_t typesize;
+  blosc2_zonemap_value *values;   // one accumulator per thread
+  int64_t *nitems;                // the items reduced by each thread
+};
 
-    // Reorder the offsets and insert the new chunk
-    for (int i = nchunks; i > nchunk; --i) {
-      schunk->data[i] = schunk->data[i-1];
-    }
-    schunk->data[nchunk] = chunk;
+
+/* The value of a reduction over no items. */
+static blosc2_zonemap_value reduce_identity(uint8_t op, bool is_float) {
+  blosc2_zonemap_value value;
+  switch (op) {
+    case BLOSC2_REDUCE_MIN:
+      if (is_float) {
+        value.f = INFINITY;
+      }
+      else {
+        value.i = INT64_MAX;
+      }
+      break;
+    case BLOSC2_REDUCE_MAX:
+      if (is_float) {
+        value.f = -INFINITY;
+      }
+      else {
+        value.i = INT64_MIN;
+      }
+      break;
+    default:
+      if (is_float) {
+        value.f = 0;
+      }
+      else {
+        value.i = 0;
+      }
   }
+  return value;
+}
 
-  else {
-    BLOSC_TRACE_ERROR("Frames are not allowed yet.");
-    return -1;
+
+/* Merge the reduction `value` into the accumulator `acc`. */
+static void reduce_merge(uint8_t op, bool is_float, blosc2_zonemap_value *acc,
+                         blosc2_zonemap_value value) {
+  switch (op) {
+    case BLOSC2_REDUCE_SUM:
+      if (is_float) {
+        acc->f += value.f;
+      }
+      else {
+        // Wrap around (instead of overflowing) as unsigned integers do
+        acc->i = (int64_t)((uint64_t)acc->i + (uint64_t)value.i);
+      }
+      break;
+    case BLOSC2_REDUCE_MIN:
+      if (is_float ? value.f < acc->f : value.i < acc->i) {
+        *acc = value;
+      }
+      break;
+    case BLOSC2_REDUCE_MAX:
+      if (is_float ? value.f > acc->f : value.i > acc->i) {
+        *acc = value;
+      }
+      break;
+    default:
+      break;
   }
-  return schunk->nchunks;
 }
 
 
-int blosc2_schunk_update_chunk(blosc2_schunk *schunk, int nchunk, uint8_t *chunk, bool copy) {
-  int32_t nchunks = schunk->nchunks;
-  int32_t nbytes = sw32_(chunk + BLOSC2_CHUNK_NBYTES);
-  int32_t cbytes = sw32_(chunk + BLOSC2_CHUNK_CBYTES);
+/* Reduce the integer items of a block.  The loops use a local accumulator and no branches,
+ * so that the compiler can vectorize them. */
+#define REDUCE_INT_ITEMS(type)                                         \
+  {                                                                    \
+    const type* items = (const type*)block;                            \
+    switch (state->op) {                                               \
+      case BLOSC2_REDUCE_SUM: {                                        \
+        uint64_t sum = 0;                                              \
+        for (int32_t i = 0; i < nitems; i++) {                         \
+          sum += (uint64_t)items[i];                                   \
+        }                                                              \
+        value.i = (int64_t)sum;                                        \
+        break;                                                         \
+      }                                                                \
+      case BLOSC2_REDUCE_MIN: {                                        \
+        int64_t min = INT64_MAX;                                       \
+        for (int32_t i = 0; i < nitems; i++) {                         \
+          min = items[i] < min ? items[i] : min;                       \
+        }                                                              \
+        value.i = min;                                                 \
+        break;                                                         \
+      }                                                                \
+      case BLOSC2_REDUCE_MAX: {                                        \
+        int64_t max = INT64_MIN;                                       \
+        for (int32_t i = 0; i < nitems; i++) {                         \
+          max = items[i] > max ? items[i] : max;                       \
+        }                                                              \
+        value.i = max;                                                 \
+        break;                                                         \
+      }                                                                \
+      default:                                                         \
+        break;                                                         \
+    }                                                                  \
+  }
 
-  if (schunk->chunksize == -1) {
-    schunk->chunksize = nbytes;  // The super-chunk is initialized now
+/* Reduce the floating point items of a block, skipping the null (NaN) ones.  The comparisons
+ * for the minimum and maximum are false for NaNs, so these are skipped naturally. */
+#define REDUCE_FLOAT_ITEMS(type)                                       \
+  {                                                                    \
+    const type* items = (const type*)block;                            \
+    int32_t nnulls = 0;                                                \
+    switch (state->op) {                                               \
+      case BLOSC2_REDUCE_SUM: {                                        \
+        double sum = 0;                                                \
+        for (int32_t i = 0; i < nitems; i++) {                         \
+          int null = isnan(items[i]) != 0;                             \
+          sum += null ? 0 : items[i];                                  \
+          nnulls += null;                                              \
+        }                                                              \
+        value.f = sum;                                                 \
+        break;                                                         \
+      }                                                                \
+      case BLOSC2_REDUCE_MIN: {                                        \
+        double min = INFINITY;                                         \
+        for (int32_t i = 0; i < nitems; i++) {                         \
+          min = items[i] < min ? items[i] : min;                       \
+          nnulls += isnan(items[i]) != 0;                              \
+        }                                                              \
+        value.f = min;                                                 \
+        break;                                                         \
+      }                                                                \
+      case BLOSC2_REDUCE_MAX: {                                        \
+        double max = -INFINITY;                                        \
+        for (int32_t i = 0; i < nitems; i++) {                         \
+          max = items[i] > max ? items[i] : max;                       \
+          nnulls += isnan(items[i]) != 0;                              \
+        }                                                              \
+        value.f = max;                                                 \
+        break;                                                         \
+      }                                                                \
+      default:                                                         \
+        for (int32_t i = 0; i < nitems; i++) {                         \
+          nnulls += isnan(items[i]) != 0;                              \
+        }                                                              \
+    }                                                                  \
+    nitems -= nnulls;                                                  \
   }
 
-  if ((schunk->chunksize != 0) && (nbytes > schunk->chunksize)) {
-    BLOSC_TRACE_ERROR("Inserting chunks that have different lengths in the same schunk "
-                      "is not supported yet: %d > %d.", nbytes, schunk->chunksize);
-    return -1;
+/* Reduce a decompressed block into the accumulator of the thread (the destination is never
+ * written). */
+static int reduce_postfilter(blosc2_postfilter_params *postparams) {
+  struct reduce_state *state = postparams->user_data;
+  const uint8_t *block = postparams->in;
+  int32_t nitems = postparams->size / state->typesize;
+  blosc2_zonemap_value value = reduce_identity(state->op, state->is_float);
+  switch (state->typesize) {
+    case 1:
+      REDUCE_INT_ITEMS(int8_t);
+      break;
+    case 2:
+      REDUCE_INT_ITEMS(int16_t);
+      break;
+    case 4:
+      if (state->is_float) {
+        REDUCE_FLOAT_ITEMS(float);
+      }
+      else {
+        REDUCE_INT_ITEMS(int32_t);
+      }
+      break;
+    case 8:
+      if (state->is_float) {
+        REDUCE_FLOAT_ITEMS(double);
+      }
+      else {
+        REDUCE_INT_ITEMS(int64_t);
+      }
+      break;
+    default:
+      return -1;
   }
+  reduce_merge(state->op, state->is_float, &state->values[postparams->tid], value);
+  state->nitems[postparams->tid] += nitems;
+  return 0;
+}
 
-  // Update super-chunk or frame
-  if (schunk->frame == NULL) {
-    uint8_t *chunk_old = schunk->data[nchunk];
-    int32_t cbytes_old;
-    int32_t nbytes_old;
 
-    if (chunk_old == 0) {
-      nbytes_old = 0;
-      cbytes_old = 0;
-    } else {
-      nbytes_old = sw32_(chunk_old + BLOSC2_CHUNK_NBYTES);
-      cbytes_old = sw32_(chunk_old + BLOSC2_CHUNK_CBYTES);
-    }
+/* Reduce the items of a super-chunk, chunk by chunk, taking what the zone maps know already. */
+static int64_t reduce_schunk(blosc2_schunk *schunk, uint8_t op, uint8_t type,
+                             blosc2_zonemap_value *result) {
+  int32_t typesize = zonemap_typesize(type);
+  if (typesize == 0) {
+    BLOSC_TRACE_ERROR("Unknown type (%d) for the reduction.", type);
+    return -1;
+  }
+  if (typesize != schunk->typesize) {
+    BLOSC_TRACE_ERROR("The type of the reduction does not match the typesize (%d) of the "
+                      "super-chunk.", schunk->typesize);
+    return -1;
+  }
+  if (op > BLOSC2_REDUCE_COUNT) {
+    BLOSC_TRACE_ERROR("Unknown reduction (%d).", op);
+    return -1;
+  }
+  bool is_float = type >= BLOSC2_ZONEMAP_FLOAT32 && op != BLOSC2_REDUCE_COUNT;
+  *result = reduce_identity(op, is_float);
+  int rc = check_slice(schunk, 0, schunk->nbytes / typesize);
+  if (rc < 0) {
+    return rc;
+  }
+  if (op == BLOSC2_REDUCE_COUNT && type < BLOSC2_ZONEMAP_FLOAT32) {
+    // Integers are never null
+    result->i = schunk->nbytes / typesize;
+    return result->i;
+  }
+  // The sum cannot be found in the zone maps
+  bool use_zonemaps = schunk_zonemap_type(schunk) == type && op != BLOSC2_REDUCE_SUM;
 
-    /* Update counters */
-    schunk->nbytes += nbytes;
-    schunk->nbytes -= nbytes_old;
-    schunk->cbytes += cbytes;
-    schunk->cbytes -= cbytes_old;
+  int nthreads = schunk->dctx->nthreads;
+  struct reduce_state state = {.op=op, .is_float=type >= BLOSC2_ZONEMAP_FLOAT32,
+                               .typesize=typesize};
+  state.values = malloc(nthreads * sizeof(blosc2_zonemap_value));
+  state.nitems = calloc(nthreads, sizeof(int64_t));
+  for (int tid = 0; tid < nthreads; tid++) {
+    state.values[tid] = reduce_identity(op, is_float);
+  }
+  blosc2_postfilter_params postparams = {.user_data=&state};
+  blosc2_dparams dparams = {.nthreads=nthreads, .schunk=schunk,
+                            .postfilter=reduce_postfilter, .postparams=&postparams};
+  blosc2_context *dctx = blosc2_create_dctx(dparams);
+  if (dctx == NULL) {
+    free(state.values);
+    free(state.nitems);
+    return BLOSC2_ERROR_MEMORY_ALLOC;
+  }
+  // Delta chunks are decompressed with a context without the postfilter
+  blosc2_context *plain_dctx = NULL;
+  // The postfilter does not write the destination, but delta chunks are decompressed there
+  uint8_t *dest = NULL;
+  int32_t dest_nbytes = 0;
 
-    // Check that we are not appending a small chunk after another small chunk
-    if ((schunk->nchunks > 0) && (nbytes < schunk->chunksize) && (nchunk == nchunks - 1)) {
-      uint8_t* last_chunk = schunk->data[nchunks - 1];
-      int32_t last_nbytes;
-      if (last_chunk == 0) {
-        last_nbytes = 0;
-      } else {
-        last_nbytes = sw32_(last_chunk + BLOSC2_CHUNK_NBYTES);
-      }
-      if ((last_nbytes < schunk->chunksize) && (nbytes < schunk->chunksize)) {
-        BLOSC_TRACE_ERROR("Appending two consecutive chunks with a chunksize smaller "
-                          "than the schunk chunksize is not allowed yet: %d != %d.",
-                          nbytes, schunk->chunksize);
-        return -1;
+  int64_t nitems = 0;
+  for (int nchunk = 0; nchunk < schunk->nchunks && rc >= 0; nchunk++) {
+    if (use_zonemaps) {
+      chunk_zonemaps *zonemaps;
+      rc = get_zonemaps(schunk, nchunk, &zonemaps);
+      if (rc == 0 && zonemaps != NULL && zonemaps->maps[0].nitems >= 0) {
+        blosc2_zonemap *zonemap = &zonemaps->maps[0];
+        reduce_merge(op, is_float, result, op == BLOSC2_REDUCE_MIN ? zonemap->min : zonemap->max);
+        nitems += zonemap->nitems - zonemap->nnulls;
+        continue;
       }
     }
-
-    if (copy) {
-      // Make a copy of the chunk
-      uint8_t *chunk_copy = malloc(cbytes);
-      memcpy(chunk_copy, chunk, cbytes);
-      chunk = chunk_copy;
-    }
-    else if (cbytes < nbytes) {
-      // We still want to do a shrink of the chunk
-      chunk = realloc(chunk, cbytes);
+    int32_t nbytes = (int32_t)((chunk_first_item(schunk, nchunk + 1) -
+                                chunk_first_item(schunk, nchunk)) * typesize);
+    if (nbytes > dest_nbytes) {
+      free(dest);
+      dest = malloc((size_t)nbytes);
+      dest_nbytes = dest == NULL ? 0 : nbytes;
     }
+    rc = dest == NULL ? BLOSC2_ERROR_MEMORY_ALLOC :
+         postfilter_chunk(schunk, dctx, &plain_dctx, nchunk, NULL, 0, dest, nbytes);
+  }
 
-    // Free old chunk and add reference to new chunk
-    if (schunk->data[nchunk] != 0) {
-      free(schunk->data[nchunk]);
-    }
-    schunk->data[nchunk] = chunk;
+  for (int tid = 0; tid < nthreads; tid++) {
+    reduce_merge(op, is_float, result, state.values[tid]);
+    nitems += state.nitems[tid];
   }
-  else {
-    BLOSC_TRACE_ERROR("Updating chunks in a frame is not allowed yet.");
-    return -1;
+  if (op == BLOSC2_REDUCE_COUNT) {
+    result->i = nitems;
   }
-
-  return schunk->nchunks;
+  blosc2_free_ctx(dctx);
+  if (plain_dctx != NULL) {
+    blosc2_free_ctx(plain_dctx);
+  }
+  free(dest);
+  free(state.values);
+  free(state.nitems);
+  return rc < 0 ? rc : nitems;
 }
 
 
-/* Append a data buffer to a super-chunk. */
-int blosc2_schunk_append_buffer(blosc2_schunk *schunk, void *src, int32_t nbytes) {
-  uint8_t* chunk = malloc(nbytes + BLOSC_MAX_OVERHEAD);
-
-  /* Compress the src buffer using super-chunk context */
-  int cbytes = blosc2_compress_ctx(schunk->cctx, src, nbytes, chunk,
-                                   nbytes + BLOSC_MAX_OVERHEAD);
-  if (cbytes < 0) {
-    free(chunk);
-    return cbytes;
+/* Reduce the items of a super-chunk to a single value. */
+int64_t blosc2_schunk_reduce(blosc2_schunk *schunk, uint8_t op, uint8_t type,
+                             blosc2_zonemap_value *result) {
+  int rc = schunk_lock(schunk, false);
+  if (rc < 0) {
+    return rc;
   }
+  int64_t nitems = reduce_schunk(schunk, op, type, result);
+  schunk_unlock(schunk);
+  return nitems;
+}
 
-  // We don't need a copy of the chunk, as it will be shrinked if necessary
-  int nchunks = blosc2_schunk_append_chunk(schunk, chunk, false);
 
-  return nchunks;
+/* Move index to the next one in the box [lo, hi) in C order.  Return false after the last one. */
+static bool next_index(int8_t ndim, int64_t *index, const int64_t *lo, const int64_t *hi) {
+  for (int i = ndim - 1; i >= 0; i--) {
+    if (++index[i] < hi[i]) {
+      return true;
+    }
+    index[i] = lo[i];
+  }
+  return false;
 }
 
-/* Decompress and return a chunk that is part of a super-chunk. */
-int blosc2_schunk_decompress_chunk(blosc2_schunk *schunk, int nchunk,
-                                   void *dest, int32_t nbytes) {
 
-  uint8_t* src;
-  int chunksize;
-  if (schunk->frame == NULL) {
-    if (nchunk >= schunk->nchunks) {
-      BLOSC_TRACE_ERROR("nchunk ('%d') exceeds the number of chunks "
-                        "('%d') in super-chunk.", nchunk, schunk->nchunks);
-      return -11;
-    }
+/* The C-order strides (in bytes) of an array with shape. */
+static void ndim_strides(int8_t ndim, int32_t typesize, const int64_t *shape, int64_t *strides) {
+  strides[ndim - 1] = typesize;
+  for (int i = ndim - 2; i >= 0; i--) {
+    strides[i] = strides[i + 1] * shape[i + 1];
+  }
+}
 
-    src = schunk->data[nchunk];
-    if (src == 0) {
-      return 0;
-    }
 
-    int nbytes_ = sw32_(src + BLOSC2_CHUNK_NBYTES);
-    if (nbytes < nbytes_) {
-      BLOSC_TRACE_ERROR("Buffer size is too small for the decompressed buffer "
-                        "('%d' bytes, but '%d' are needed).", nbytes, nbytes_);
-      return -11;
+/* Copy a box with size items from/to an array (where it starts at a) to/from a block (where it
+ * starts at b).  Both of them are in C order, so the items in the last dimension are contiguous.
+ */
+static void copy_box(int8_t ndim, int32_t typesize, const int64_t *size, uint8_t *a,
+                     const int64_t *a_strides, uint8_t *b, const int64_t *b_strides, bool to_block) {
+  int64_t lo[BLOSC2_MAX_DIM] = {0};
+  int64_t hi[BLOSC2_MAX_DIM];
+  int64_t index[BLOSC2_MAX_DIM] = {0};
+  for (int i = 0; i < ndim - 1; i++) {
+    hi[i] = size[i];
+  }
+  size_t row_nbytes = (size_t)(size[ndim - 1] * typesize);
+  do {
+    int64_t a_offset = 0;
+    int64_t b_offset = 0;
+    for (int i = 0; i < ndim - 1; i++) {
+      a_offset += index[i] * a_strides[i];
+      b_offset += index[i] * b_strides[i];
     }
-    int cbytes = sw32_(src + BLOSC2_CHUNK_CBYTES);
-    chunksize = blosc2_decompress_ctx(schunk->dctx, src, cbytes, dest, nbytes);
-    if (chunksize < 0 || chunksize != nbytes_) {
-      BLOSC_TRACE_ERROR("Error in decompressing chunk.");
-      return -11;
+    if (to_block) {
+      memcpy(b + b_offset, a + a_offset, row_nbytes);
     }
-  } else {
-    chunksize = frame_decompress_chunk(schunk->dctx, schunk->frame, nchunk, dest, nbytes);
-    if (chunksize < 0) {
-      return -10;
+    else {
+      memcpy(a + a_offset, b + b_offset, row_nbytes);
     }
-  }
-  return chunksize;
+  } while (next_index((int8_t)(ndim - 1), index, lo, hi));
 }
 
-/* Return a compressed chunk that is part of a super-chunk in the `chunk` parameter.
- * If the super-chunk is backed by a frame that is disk-based, a buffer is allocated for the
- * (compressed) chunk, and hence a free is needed.  You can check if the chunk requires a free
- * with the `needs_free` parameter.
- * If the chunk does not need a free, it means that a pointer to the location in the super-chunk
- * (or the backing in-memory frame) is returned in the `chunk` parameter.
- *
- * The size of the (compressed) chunk is returned.  If some problem is detected, a negative code
- * is returned instead.
-*/
-int blosc2_schunk_get_chunk(blosc2_schunk *schunk, int nchunk, uint8_t **chunk, bool *needs_free) {
-  if (schunk->frame != NULL) {
-    return frame_get_chunk(schunk->frame, nchunk, chunk, needs_free);
-  }
-
-  if (nchunk >= schunk->nchunks) {
-    BLOSC_TRACE_ERROR("nchunk ('%d') exceeds the number of chunks "
-                      "('%d') in schunk.", nchunk, schunk->nchunks);
-    return -2;
-  }
 
-  *chunk = schunk->data[nchunk];
-  if (*chunk == 0) {
-    *needs_free = 0;
-    return 0;
+/* The box of the array [lo, hi) kept in a block of a chunk (it is empty for padding blocks). */
+static bool block_box(const ndim_layout *layout, const int64_t *chunk_index,
+                      const int64_t *block_index, int64_t *lo, int64_t *hi) {
+  bool empty = false;
+  for (int i = 0; i < layout->ndim; i++) {
+    int64_t chunk_start = chunk_index[i] * layout->chunkshape[i];
+    lo[i] = chunk_start + block_index[i] * layout->blockshape[i];
+    hi[i] = lo[i] + layout->blockshape[i];
+    // Padding is neither part of the next chunk nor of the array
+    int64_t chunk_stop = chunk_start + layout->chunkshape[i];
+    hi[i] = hi[i] < chunk_stop ? hi[i] : chunk_stop;
+    hi[i] = hi[i] < layout->shape[i] ? hi[i] : layout->shape[i];
+    empty |= lo[i] >= hi[i];
   }
-
-  *needs_free = false;
-  return sw32_(*chunk + BLOSC2_CHUNK_CBYTES);
+  return !empty;
 }
 
 
-/* Return a compressed chunk that is part of a super-chunk in the `chunk` parameter.
- * If the super-chunk is backed by a frame that is disk-based, a buffer is allocated for the
- * (compressed) chunk, and hence a free is needed.  You can check if the chunk requires a free
- * with the `needs_free` parameter.
- * If the chunk does not need a free, it means that a pointer to the location in the super-chunk
- * (or the backing in-memory frame) is returned in the `chunk` parameter.
- *
- * The size of the (compressed) chunk is returned.  If some problem is detected, a negative code
- * is returned instead.
-*/
-int blosc2_schunk_get_lazychunk(blosc2_schunk *schunk, int nchunk, uint8_t **chunk, bool *needs_free) {
-  if (schunk->frame != NULL) {
-    return frame_get_lazychunk(schunk->frame, nchunk, chunk, needs_free);
+/* Fill an empty n-dimensional super-chunk with an array. */
+int blosc2_schunk_set_ndarray(blosc2_schunk *schunk, const void *src, int64_t srcsize) {
+  ndim_layout layout;
+  if (schunk_ndim_layout(schunk, &layout) < 0) {
+    return -1;
+  }
+  if (schunk->nchunks > 0) {
+    BLOSC_TRACE_ERROR("The super-chunk is not empty.");
+    return -1;
+  }
+  int8_t ndim = layout.ndim;
+  int64_t nitems = 1;
+  for (int i = 0; i < ndim; i++) {
+    nitems *= layout.shape[i];
+  }
+  if (srcsize != nitems * layout.typesize) {
+    BLOSC_TRACE_ERROR("The size of the source (%lld bytes) does not match the shape of the "
+                      "super-chunk (%lld bytes).", (long long)srcsize,
+                      (long long)(nitems * layout.typesize));
+    return -1;
   }
+  // Make sure that the blocks of the new chunks hold a blockshape of items
+  blosc2_context *cctx = schunk->cctx;
+  cctx->ndim = ndim;
+  for (int i = 0; i < ndim; i++) {
+    cctx->blockshape[i] = layout.blockshape[i];
+  }
+  cctx->blocksize = layout.blocksize;
+  cctx->user_blocksize = layout.blocksize;
 
-  if (nchunk >= schunk->nchunks) {
-    BLOSC_TRACE_ERROR("nchunk ('%d') exceeds the number of chunks "
-                      "('%d') in schunk.", nchunk, schunk->nchunks);
-    return -2;
+  int64_t array_strides[BLOSC2_MAX_DIM];
+  int64_t block_strides[BLOSC2_MAX_DIM];
+  int64_t blockshape[BLOSC2_MAX_DIM];
+  for (int i = 0; i < ndim; i++) {
+    blockshape[i] = layout.blockshape[i];
   }
+  ndim_strides(ndim, layout.typesize, layout.shape, array_strides);
+  ndim_strides(ndim, layout.typesize, blockshape, block_strides);
 
-  *chunk = schunk->data[nchunk];
-  if (*chunk == 0) {
-    *needs_free = 0;
-    return 0;
+  uint8_t *chunk = malloc((size_t)layout.chunk_nbytes);
+  int64_t zeros[BLOSC2_MAX_DIM] = {0};
+  int64_t chunk_index[BLOSC2_MAX_DIM] = {0};
+  int rc = 0;
+  for (int64_t nchunk = 0; nchunk < layout.nchunks && rc >= 0; nchunk++) {
+    memset(chunk, 0, (size_t)layout.chunk_nbytes);
+    int64_t block_index[BLOSC2_MAX_DIM] = {0};
+    int32_t nblock = 0;
+    do {
+      int64_t lo[BLOSC2_MAX_DIM];
+      int64_t hi[BLOSC2_MAX_DIM];
+      if (block_box(&layout, chunk_index, block_index, lo, hi)) {
+        int64_t size[BLOSC2_MAX_DIM];
+        int64_t a_offset = 0;
+        for (int i = 0; i < ndim; i++) {
+          size[i] = hi[i] - lo[i];
+          a_offset += lo[i] * array_strides[i];
+        }
+        copy_box(ndim, layout.typesize, size, (uint8_t*)src + a_offset, array_strides,
+                 chunk + (int64_t)nblock * layout.blocksize, block_strides, true);
+      }
+      nblock++;
+    } while (next_index(ndim, block_index, zeros, layout.blocks_in_chunk));
+    next_index(ndim, chunk_index, zeros, layout.chunks_in_array);
+    rc = blosc2_schunk_append_buffer(schunk, chunk, layout.chunk_nbytes);
   }
+  free(chunk);
 
-  *needs_free = false;
-  return sw32_(*chunk + BLOSC2_CHUNK_CBYTES);
+  return rc < 0 ? rc : schunk->nchunks;
 }
 
 
-/* Find whether the schunk has a metalayer or not.
- *
- * If successful, return the index of the metalayer.  Else, return a negative value.
- */
-int blosc2_has_metalayer(blosc2_schunk *schunk, const char *name) {
-  if (strlen(name) > BLOSC2_METALAYER_NAME_MAXLEN) {
-    BLOSC_TRACE_ERROR("Metalayers cannot be larger than %d chars.", BLOSC2_METALAYER_NAME_MAXLEN);
+/* Get the hyperslab [start, stop) of an n-dimensional super-chunk. */
+static int64_t get_hyperslab(blosc2_schunk *schunk, const int64_t *start, const int64_t *stop,
+                             void *dest) {
+  ndim_layout layout;
+  if (schunk_ndim_layout(schunk, &layout) < 0) {
     return -1;
   }
-
-  for (int nmetalayer = 0; nmetalayer < schunk->nmetalayers; nmetalayer++) {
-    if (strcmp(name, schunk->metalayers[nmetalayer]->name) == 0) {
-      return nmetalayer;  // Found
+  int8_t ndim = layout.ndim;
+  int64_t slab_shape[BLOSC2_MAX_DIM];
+  int64_t first_chunk[BLOSC2_MAX_DIM];
+  int64_t last_chunk[BLOSC2_MAX_DIM];
+  int64_t nitems = 1;
+  for (int i = 0; i < ndim; i++) {
+    if (start[i] < 0 || start[i] > stop[i] || stop[i] > layout.shape[i]) {
+      BLOSC_TRACE_ERROR("The hyperslab [%lld, %lld) is out of the shape (%lld) in dimension %d.",
+                        (long long)start[i], (long long)stop[i], (long long)layout.shape[i], i);
+      return -1;
     }
+    slab_shape[i] = stop[i] - start[i];
+    first_chunk[i] = start[i] / layout.chunkshape[i];
+    last_chunk[i] = (stop[i] + layout.chunkshape[i] - 1) / layout.chunkshape[i];
+    nitems *= slab_shape[i];
+  }
+  if (nitems == 0) {
+    return 0;
+  }
+  if (schunk->nchunks != layout.nchunks) {
+    BLOSC_TRACE_ERROR("The super-chunk has %d chunks, but its shape needs %lld.",
+                      schunk->nchunks, (long long)layout.nchunks);
+    return -1;
   }
-  return -1;  // Not found
-}
 
-/* Reorder the chunk offsets of an existing super-chunk. */
-int blosc2_schunk_reorder_offsets(blosc2_schunk *schunk, int *offsets_order) {
-  // Check that the offsets order are correct
-  bool *index_check = (bool *) calloc(schunk->nchunks, sizeof(bool));
-  for (int i = 0; i < schunk->nchunks; ++i) {
-    int index = offsets_order[i];
-    if (index >= schunk->nchunks) {
-      BLOSC_TRACE_ERROR("Index is bigger than the number of chunks.");
-      return -1;
-    }
-    if (index_check[index] == false) {
-      index_check[index] = true;
-    } else {
-      BLOSC_TRACE_ERROR("Index is yet used.");
-      return -1;
-    }
+  int64_t slab_strides[BLOSC2_MAX_DIM];
+  int64_t block_strides[BLOSC2_MAX_DIM];
+  int64_t blockshape[BLOSC2_MAX_DIM];
+  for (int i = 0; i < ndim; i++) {
+    blockshape[i] = layout.blockshape[i];
   }
-  free(index_check);
+  ndim_strides(ndim, layout.typesize, slab_shape, slab_strides);
+  ndim_strides(ndim, layout.typesize, blockshape, block_strides);
 
-  if (schunk->frame != NULL) {
-    return frame_reorder_offsets(schunk->frame, offsets_order, schunk);
+  blosc2_dparams dparams = {.nthreads=schunk->dctx->nthreads, .schunk=schunk};
+  blosc2_context *dctx = blosc2_create_dctx(dparams);
+  if (dctx == NULL) {
+    return BLOSC2_ERROR_MEMORY_ALLOC;
   }
-  uint8_t **offsets = schunk->data;
+  uint8_t *chunk = malloc((size_t)layout.chunk_nbytes);
+  bool *maskout = malloc((size_t)layout.nblocks);
+  int64_t zeros[BLOSC2_MAX_DIM] = {0};
+  int64_t chunk_index[BLOSC2_MAX_DIM];
+  memcpy(chunk_index, first_chunk, sizeof(chunk_index));
+  int rc = 0;
+  do {
+    int64_t nchunk = 0;
+    for (int i = 0; i < ndim; i++) {
+      nchunk = nchunk * layout.chunks_in_array[i] + chunk_index[i];
+    }
+    // Just the blocks that intersect the hyperslab are decompressed
+    int64_t block_index[BLOSC2_MAX_DIM] = {0};
+    int32_t nblock = 0;
+    do {
+      int64_t lo[BLOSC2_MAX_DIM];
+      int64_t hi[BLOSC2_MAX_DIM];
+      bool intersects = block_box(&layout, chunk_index, block_index, lo, hi);
+      for (int i = 0; i < ndim; i++) {
+        intersects &= lo[i] < stop[i] && hi[i] > start[i];
+      }
+      maskout[nblock++] = !intersects;
+    } while (next_index(ndim, block_index, zeros, layout.blocks_in_chunk));
+    blosc2_set_maskout(dctx, maskout, layout.nblocks);
+    rc = decompress_chunk(schunk, dctx, (int)nchunk, chunk, layout.chunk_nbytes);
+    if (rc < 0) {
+      break;
+    }
+    if (rc == 0) {
+      // A non-initialized chunk is made of zeros
+      memset(chunk, 0, (size_t)layout.chunk_nbytes);
+    }
+    else if (rc != layout.chunk_nbytes) {
+      BLOSC_TRACE_ERROR("The chunk %lld does not match the shape of the super-chunk.",
+                        (long long)nchunk);
+      rc = -1;
+      break;
+    }
 
-  // Make a copy of the chunk offsets and reorder it
-  uint8_t **offsets_copy = malloc(schunk->data_len);
-  memcpy(offsets_copy, offsets, schunk->data_len);
+    nblock = 0;
+    do {
+      if (!maskout[nblock]) {
+        int64_t lo[BLOSC2_MAX_DIM];
+        int64_t hi[BLOSC2_MAX_DIM];
+        block_box(&layout, chunk_index, block_index, lo, hi);
+        int64_t size[BLOSC2_MAX_DIM];
+        int64_t slab_offset = 0;
+        int64_t block_offset = (int64_t)nblock * layout.blocksize;
+        for (int i = 0; i < ndim; i++) {
+          int64_t block_start = lo[i];
+          lo[i] = lo[i] > start[i] ? lo[i] : start[i];
+          hi[i] = hi[i] < stop[i] ? hi[i] : stop[i];
+          size[i] = hi[i] - lo[i];
+          slab_offset += (lo[i] - start[i]) * slab_strides[i];
+          block_offset += (lo[i] - block_start) * block_strides[i];
+        }
+        copy_box(ndim, layout.typesize, size, (uint8_t*)dest + slab_offset, slab_strides,
+                 chunk + block_offset, block_strides, false);
+      }
+      nblock++;
+    } while (next_index(ndim, block_index, zeros, layout.blocks_in_chunk));
+  } while (next_index(ndim, chunk_index, first_chunk, last_chunk));
 
-  for (int i = 0; i < schunk->nchunks; ++i) {
-    offsets[i] = offsets_copy[offsets_order[i]];
-  }
-  free(offsets_copy);
+  free(maskout);
+  free(chunk);
+  blosc2_free_ctx(dctx);
+  return rc < 0 ? rc : nitems * layout.typesize;
+}
 
-  return 0;
+
+/* Get the hyperslab [start, stop) of an n-dimensional super-chunk. */
+int64_t blosc2_schunk_get_hyperslab(blosc2_schunk *schunk, const int64_t *start,
+                                    const int64_t *stop, void *dest) {
+  int rc = schunk_lock(schunk, false);
+  if (rc < 0) {
+    return rc;
+  }
+  int64_t nbytes = get_hyperslab(schunk, start, stop, dest);
+  schunk_unlock(schunk);
+  return nbytes;
 }
 
 
@@ -679,12 +4705,17 @@ int metalayer_flush(blosc2_schunk* schunk) {
   if (schunk->frame == NULL) {
     return rc;
   }
+  if (schunk_lock(schunk, true) < 0) {
+    return -1;
+  }
   rc = frame_update_header(schunk->frame, schunk, true);
   if (rc < 0) {
     BLOSC_TRACE_ERROR("Unable to update metalayers into frame.");
+    schunk_unlock(schunk);
     return -1;
   }
   rc = frame_update_trailer(schunk->frame, schunk);
+  schunk_unlock(schunk);
   if (rc < 0) {
     BLOSC_TRACE_ERROR("Unable to update trailer into frame.");
     return -2;
@@ -747,7 +4778,11 @@ int blosc2_update_metalayer(blosc2_schunk *schunk, const char *name, uint8_t *co
 
   // Update the metalayers in frame (as size has not changed, we don't need to update the trailer)
   if (schunk->frame != NULL) {
-    int rc = frame_update_header(schunk->frame, schunk, false);
+    int rc = schunk_lock(schunk, true);
+    if (rc >= 0) {
+      rc = frame_update_header(schunk->frame, schunk, false);
+      schunk_unlock(schunk);
+    }
     if (rc < 0) {
       BLOSC_TRACE_ERROR("Unable to update meta info from frame.");
       return -1;
@@ -807,7 +4842,11 @@ int blosc2_update_usermeta(blosc2_schunk *schunk, uint8_t *content, int32_t cont
   schunk->usermeta_len = usermeta_cbytes;
 
   if (schunk->frame != NULL) {
-    int rc = frame_update_trailer(schunk->frame, schunk);
+    int rc = schunk_lock(schunk, true);
+    if (rc >= 0) {
+      rc = frame_update_trailer(schunk->frame, schunk);
+      schunk_unlock(schunk);
+    }
     if (rc < 0) {
       return rc;
     }
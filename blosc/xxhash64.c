@@ -0,0 +1,119 @@
+/*********************************************************************
+  Blosc - Blocked Shuffling and Compression Library
+
+  Author: The Blosc Developers <blosc@blosc.org>
+
+  See LICENSE.txt for details about copyright and rights to use.
+**********************************************************************/
+
+/* A self-contained implementation of the XXH64 hash.  The xxHash copies that
+ * come with the internal codecs are optional (and namespaced differently),
+ * so we cannot rely on them for checksumming super-chunks. */
+
+#include <string.h>
+#include "blosc2.h"
+#include "blosc-private.h"
+#include "xxhash64.h"
+
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read64(const uint8_t* p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  if (!is_little_endian()) {
+#if defined (__GNUC__)
+    v = __builtin_bswap64(v);
+#else
+    v = ((uint64_t)p[0]) | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) |
+        ((uint64_t)p[3] << 24) | ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) |
+        ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+#endif
+  }
+  return v;
+}
+
+static inline uint32_t read32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t round64(uint64_t acc, uint64_t input) {
+  acc += input * PRIME64_2;
+  acc = rotl64(acc, 31);
+  acc *= PRIME64_1;
+  return acc;
+}
+
+static inline uint64_t merge_round64(uint64_t acc, uint64_t val) {
+  val = round64(0, val);
+  acc ^= val;
+  acc = acc * PRIME64_1 + PRIME64_4;
+  return acc;
+}
+
+
+uint64_t xxh64(const void* input, size_t len, uint64_t seed) {
+  const uint8_t* p = (const uint8_t*)input;
+  const uint8_t* const end = p + len;
+  uint64_t h64;
+
+  if (len >= 32) {
+    const uint8_t* const limit = end - 32;
+    uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+    uint64_t v2 = seed + PRIME64_2;
+    uint64_t v3 = seed + 0;
+    uint64_t v4 = seed - PRIME64_1;
+
+    do {
+      v1 = round64(v1, read64(p));
+      v2 = round64(v2, read64(p + 8));
+      v3 = round64(v3, read64(p + 16));
+      v4 = round64(v4, read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+
+    h64 = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+    h64 = merge_round64(h64, v1);
+    h64 = merge_round64(h64, v2);
+    h64 = merge_round64(h64, v3);
+    h64 = merge_round64(h64, v4);
+  }
+  else {
+    h64 = seed + PRIME64_5;
+  }
+
+  h64 += (uint64_t)len;
+
+  while (p + 8 <= end) {
+    uint64_t k1 = round64(0, read64(p));
+    h64 ^= k1;
+    h64 = rotl64(h64, 27) * PRIME64_1 + PRIME64_4;
+    p += 8;
+  }
+  if (p + 4 <= end) {
+    h64 ^= (uint64_t)read32(p) * PRIME64_1;
+    h64 = rotl64(h64, 23) * PRIME64_2 + PRIME64_3;
+    p += 4;
+  }
+  while (p < end) {
+    h64 ^= (*p) * PRIME64_5;
+    h64 = rotl64(h64, 11) * PRIME64_1;
+    p++;
+  }
+
+  h64 ^= h64 >> 33;
+  h64 *= PRIME64_2;
+  h64 ^= h64 >> 29;
+  h64 *= PRIME64_3;
+  h64 ^= h64 >> 32;
+
+  return h64;
+}
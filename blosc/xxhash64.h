@@ -0,0 +1,19 @@
+/*********************************************************************
+  Blosc - Blocked Shuffling and Compression Library
+
+  Author: The Blosc Developers <blosc@blosc.org>
+
+  See LICENSE.txt for details about copyright and rights to use.
+**********************************************************************/
+
+#ifndef BLOSC_XXHASH64_H
+#define BLOSC_XXHASH64_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* XXH64 digest of `len` bytes in `input` (see https://github.com/Cyan4973/xxHash).
+ * The result does not depend on the endianness of the platform. */
+uint64_t xxh64(const void* input, size_t len, uint64_t seed);
+
+#endif //BLOSC_XXHASH64_H
@@ -0,0 +1,211 @@
+/*
+  Copyright (C) 2020- The Blosc Development Team <blosc@blosc.org>
+  http://blosc.org
+  License: BSD (see LICENSE.txt)
+
+  See LICENSE.txt for details about copyright and rights to use.
+*/
+
+#include <stdio.h>
+#include "test_common.h"
+
+#define CHUNKSIZE (200 * 1000)
+#define NTHREADS (2)
+#define BADCHUNK (3)
+
+/* Global vars */
+int tests_run = 0;
+int nchunks;
+bool sequential;
+char* filename;
+
+int32_t *data;
+int32_t *data_dest;
+
+
+// Flip the last byte of a chunk, wherever it is stored
+static int corrupt_chunk(blosc2_schunk* schunk, int nchunk) {
+  uint8_t* chunk;
+  bool needs_free;
+  int cbytes = blosc2_schunk_get_chunk(schunk, nchunk, &chunk, &needs_free);
+  if (cbytes <= 0) {
+    return -1;
+  }
+  if (!needs_free) {
+    // In-memory chunk (either in a sparse super-chunk or in a frame)
+    chunk[cbytes - 1] ^= 0xffU;
+    return 0;
+  }
+
+  // Look for the chunk in the file and corrupt it there
+  FILE* fp = fopen(filename, "rb+");
+  fseek(fp, 0, SEEK_END);
+  long flen = ftell(fp);
+  uint8_t* fdata = malloc(flen);
+  fseek(fp, 0, SEEK_SET);
+  size_t rbytes = fread(fdata, 1, flen, fp);
+  int rc = -1;
+  for (long pos = 0; rbytes == (size_t)flen && pos + cbytes <= flen; pos++) {
+    if (memcmp(fdata + pos, chunk, cbytes) == 0) {
+      uint8_t last = (uint8_t)(chunk[cbytes - 1] ^ 0xffU);
+      fseek(fp, pos + cbytes - 1, SEEK_SET);
+      fwrite(&last, 1, 1, fp);
+      rc = 0;
+      break;
+    }
+  }
+  fclose(fp);
+  free(fdata);
+  free(chunk);
+  return rc;
+}
+
+
+static char* test_checksums(void) {
+  size_t isize = CHUNKSIZE * sizeof(int32_t);
+  int dsize;
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  blosc2_dparams dparams = BLOSC2_DPARAMS_DEFAULTS;
+  blosc2_schunk* schunk;
+
+  /* Initialize the Blosc compressor */
+  blosc_init();
+
+  /* Create a super-chunk container */
+  cparams.typesize = sizeof(int32_t);
+  cparams.nthreads = NTHREADS;
+  dparams.nthreads = NTHREADS;
+  blosc2_storage storage = {.sequential=sequential, .path=filename, .cparams=&cparams,
+                            .dparams=&dparams, .checksums=true};
+  schunk = blosc2_schunk_new(storage);
+  mu_assert("ERROR: checksums are not kept", schunk->checksums != NULL);
+
+  // Feed it with data
+  for (int nchunk = 0; nchunk < nchunks; nchunk++) {
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      data[i] = i + nchunk * CHUNKSIZE;
+    }
+    int nchunks_ = blosc2_schunk_append_buffer(schunk, data, isize);
+    mu_assert("ERROR: bad append", nchunks_ > 0);
+  }
+  mu_assert("ERROR: a fresh super-chunk does not verify", blosc2_schunk_verify(schunk) == 0);
+
+  // Checksums must follow the chunks when these are reordered
+  int *offsets_order = malloc(sizeof(int) * nchunks);
+  for (int i = 0; i < nchunks; ++i) {
+    offsets_order[i] = (i + 3) % nchunks;
+  }
+  int err = blosc2_schunk_reorder_offsets(schunk, offsets_order);
+  mu_assert("ERROR: can not reorder chunks", err >= 0);
+  free(offsets_order);
+  mu_assert("ERROR: a reordered super-chunk does not verify", blosc2_schunk_verify(schunk) == 0);
+
+  // Checksums must survive a round trip through a serialized frame
+  if (filename == NULL) {
+    uint8_t* sframe;
+    int64_t sframe_len = blosc2_schunk_to_sframe(schunk, &sframe);
+    mu_assert("ERROR: cannot serialize the super-chunk", sframe_len > 0);
+    blosc2_schunk* schunk2 = blosc2_schunk_open_sframe(sframe, sframe_len);
+    mu_assert("ERROR: checksums are lost in the serialized frame", schunk2->checksums != NULL);
+    mu_assert("ERROR: the serialized frame does not verify", blosc2_schunk_verify(schunk2) == 0);
+    blosc2_schunk_free(schunk2);  // this frees sframe too
+  }
+
+  // Re-open the super-chunk when it lives on disk
+  if (filename != NULL) {
+    blosc2_schunk_free(schunk);
+    schunk = blosc2_schunk_open(storage);
+    mu_assert("ERROR: checksums are lost in the file frame", schunk->checksums != NULL);
+    mu_assert("ERROR: the file frame does not verify", blosc2_schunk_verify(schunk) == 0);
+  }
+
+  // Corrupt a chunk and check that this is detected, both eagerly and lazily
+  mu_assert("ERROR: cannot corrupt chunk", corrupt_chunk(schunk, BADCHUNK) == 0);
+  if (filename != NULL) {
+    blosc2_schunk_free(schunk);
+    schunk = blosc2_schunk_open(storage);
+  }
+  mu_assert("ERROR: corruption not detected", blosc2_schunk_verify(schunk) == 1);
+  for (int nchunk = 0; nchunk < nchunks; nchunk++) {
+    dsize = blosc2_schunk_decompress_chunk(schunk, nchunk, (void *) data_dest, isize);
+    if (nchunk == BADCHUNK) {
+      mu_assert("ERROR: corrupted chunk has been decompressed", dsize < 0);
+      continue;
+    }
+    mu_assert("ERROR: chunk cannot be decompressed correctly.", dsize >= 0);
+    int nchunk_ = (nchunk + 3) % nchunks;  // reordered above
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      mu_assert("ERROR: bad roundtrip", data_dest[i] == i + nchunk_ * CHUNKSIZE);
+    }
+  }
+
+  // Chunks are verified only when read as a whole, as that needs all their bytes
+  if (filename != NULL) {
+    blosc2_schunk_free(schunk);
+    schunk = blosc2_schunk_open(storage);
+    int32_t item;
+    int64_t start = BADCHUNK * CHUNKSIZE;
+    mu_assert("ERROR: cannot get the first item of a chunk",
+              blosc2_schunk_get_slice(schunk, start, start + 1, &item) == sizeof(item));
+    mu_assert("ERROR: bad item", item == ((BADCHUNK + 3) % nchunks) * CHUNKSIZE);
+    mu_assert("ERROR: a partially read chunk has been verified",
+              !schunk->checksums_verified[BADCHUNK]);
+    dsize = blosc2_schunk_decompress_chunk(schunk, BADCHUNK, (void *) data_dest, isize);
+    mu_assert("ERROR: corrupted chunk has been decompressed", dsize < 0);
+  }
+
+  /* Free resources */
+  blosc2_schunk_free(schunk);
+  /* Destroy the Blosc environment */
+  blosc_destroy();
+
+  return EXIT_SUCCESS;
+}
+
+
+static char *all_tests(void) {
+  nchunks = 10;
+
+  sequential = false;
+  filename = NULL;
+  mu_run_test(test_checksums);
+
+  sequential = true;
+  filename = NULL;
+  mu_run_test(test_checksums);
+
+  sequential = true;
+  filename = "test_checksums.b2frame";
+  mu_run_test(test_checksums);
+
+  return EXIT_SUCCESS;
+}
+
+
+#define BUFFER_ALIGN_SIZE   32
+
+int main(void) {
+  char *result;
+
+  data = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(int32_t));
+  data_dest = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(int32_t));
+
+  install_blosc_callback_test(); /* optionally install callback test */
+  blosc_init();
+
+  /* Run all the suite */
+  result = all_tests();
+  if (result != EXIT_SUCCESS) {
+    printf(" (%s)\n", result);
+  }
+  else {
+    printf(" ALL TESTS PASSED");
+  }
+  printf("\tTests run: %d\n", tests_run);
+
+  blosc_test_free(data);
+  blosc_test_free(data_dest);
+  blosc_destroy();
+
+  return result != EXIT_SUCCESS;
+}
@@ -119,6 +119,47 @@ inline static void blosc_test_fill_random(void* const ptr, const size_t size) {
   }
 }
 
+/*
+  Super-chunks.
+*/
+
+/** Create a super-chunk in `storage` with `cparams`, using `nthreads` for both
+    compressing and decompressing. */
+inline static blosc2_schunk* blosc_test_new_schunk(blosc2_storage storage, blosc2_cparams cparams,
+                                                   int nthreads) {
+  blosc2_dparams dparams = BLOSC2_DPARAMS_DEFAULTS;
+  cparams.nthreads = (int16_t)nthreads;
+  dparams.nthreads = (int16_t)nthreads;
+  storage.cparams = &cparams;
+  storage.dparams = &dparams;
+  return blosc2_schunk_new(storage);
+}
+
+/** Fill an empty super-chunk with `nchunks` chunks of `chunk_nitems` int32_t items (`last_nitems`
+    for the last one), whose values are `start` plus their index, using `data` as the buffer. */
+inline static int blosc_test_append_seq(blosc2_schunk* schunk, int32_t* data, int64_t start,
+                                        int nchunks, int32_t chunk_nitems, int32_t last_nitems) {
+  for (int nchunk = 0; nchunk < nchunks; nchunk++) {
+    int32_t nitems = nchunk < nchunks - 1 ? chunk_nitems : last_nitems;
+    for (int32_t i = 0; i < nitems; i++) {
+      data[i] = (int32_t)(start + (int64_t)nchunk * chunk_nitems + i);
+    }
+    if (blosc2_schunk_append_buffer(schunk, data, nitems * sizeof(int32_t)) != nchunk + 1) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/** Free a super-chunk on-disk at `path` and open it again, so that its chunks are read lazily. */
+inline static blosc2_schunk* blosc_test_reopen_schunk(blosc2_schunk* schunk, char* path, int nthreads) {
+  blosc2_dparams dparams = BLOSC2_DPARAMS_DEFAULTS;
+  dparams.nthreads = (int16_t)nthreads;
+  blosc2_storage storage = {.sequential=true, .path=path, .dparams=&dparams};
+  blosc2_schunk_free(schunk);
+  return blosc2_schunk_open(storage);
+}
+
 /*
   Argument parsing.
 */
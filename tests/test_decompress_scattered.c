@@ -0,0 +1,222 @@
+/*
+  Copyright (C) 2020  The Blosc Developers
+  http://blosc.org
+  License: BSD (see LICENSE.txt)
+
+  Test for decompressing into scattered (iov) and strided destinations.
+*/
+
+#include "test_common.h"
+
+int tests_run = 0;
+
+#define SIZE (100 * 1000)
+#define NCOLS 5
+#define COLUMN 3
+#define NPIECES 100
+#define SENTINEL (-7)
+
+// Global vars
+blosc2_cparams cparams;
+blosc2_dparams dparams;
+static int32_t data[SIZE];
+static int32_t data_out[SIZE + BLOSC_MAX_OVERHEAD / sizeof(int32_t)];
+static int32_t matrix[SIZE * NCOLS];
+static int32_t ring[SIZE + 1000];
+int csize;
+
+
+static char *compress(void) {
+  blosc2_context *cctx = blosc2_create_cctx(cparams);
+  csize = blosc2_compress_ctx(cctx, data, sizeof(data), data_out, sizeof(data_out));
+  blosc2_free_ctx(cctx);
+  mu_assert("Compression error", csize > 0);
+  return 0;
+}
+
+
+static char *test_iov(void) {
+  char *result = compress();
+  if (result != 0) {
+    return result;
+  }
+  blosc2_context *dctx = blosc2_create_dctx(dparams);
+
+  // The end and the start of a ring buffer, with the split in the middle of an item
+  for (int i = 0; i < SIZE + 1000; i++) {
+    ring[i] = SENTINEL;
+  }
+  int32_t tail = 1000 * sizeof(int32_t) + 2;
+  blosc2_iov iov[2] = {{(uint8_t*)ring + sizeof(ring) - tail, tail},
+                       {ring, (int32_t)sizeof(data) - tail}};
+  int dsize = blosc2_decompress_ctx_iov(dctx, data_out, csize, iov, 2);
+  mu_assert("Decompression error", dsize == sizeof(data));
+  mu_assert("Bad tail", memcmp(iov[0].base, data, (size_t)tail) == 0);
+  mu_assert("Bad head", memcmp(ring, (uint8_t*)data + tail, sizeof(data) - tail) == 0);
+  mu_assert("Written out of the pieces",
+            ring[SIZE - 1000] == SENTINEL && ring[SIZE - 2] == SENTINEL);
+
+  // Many pieces of different sizes (some of them empty), which scatter the blocks
+  blosc2_iov pieces[NPIECES];
+  int32_t start = 0;
+  for (int i = 0; i < NPIECES; i++) {
+    int32_t len = (i % 7 == 0) ? 0 : (int32_t)(sizeof(data) / NPIECES) * 2 - 13 * (i % 10);
+    if (i == NPIECES - 1 || start + len > (int32_t)sizeof(data)) {
+      len = (int32_t)sizeof(data) - start;
+    }
+    pieces[i].base = (uint8_t*)matrix + start;
+    pieces[i].len = len;
+    start += len;
+  }
+  memset(matrix, 0, sizeof(data));
+  dsize = blosc2_decompress_ctx_iov(dctx, data_out, csize, pieces, NPIECES);
+  mu_assert("Decompression error", dsize == sizeof(data));
+  mu_assert("Bad scattered data", memcmp(matrix, data, sizeof(data)) == 0);
+
+  // Not enough room
+  pieces[NPIECES - 1].len--;
+  mu_assert("The destination is too small",
+            blosc2_decompress_ctx_iov(dctx, data_out, csize, pieces, NPIECES) < 0);
+
+  blosc2_free_ctx(dctx);
+  return 0;
+}
+
+
+static char *test_strided(void) {
+  char *result = compress();
+  if (result != 0) {
+    return result;
+  }
+  blosc2_context *dctx = blosc2_create_dctx(dparams);
+
+  // A column of a row-major matrix
+  for (int i = 0; i < SIZE * NCOLS; i++) {
+    matrix[i] = SENTINEL;
+  }
+  int dsize = blosc2_decompress_ctx_strided(dctx, data_out, csize, matrix + COLUMN,
+                                            sizeof(int32_t), NCOLS * sizeof(int32_t), SIZE);
+  mu_assert("Decompression error", dsize == sizeof(data));
+  for (int i = 0; i < SIZE; i++) {
+    for (int j = 0; j < NCOLS; j++) {
+      mu_assert("Bad matrix", matrix[i * NCOLS + j] == (j == COLUMN ? data[i] : SENTINEL));
+    }
+  }
+
+  // Not enough room
+  mu_assert("The destination is too small",
+            blosc2_decompress_ctx_strided(dctx, data_out, csize, matrix + COLUMN,
+                                          sizeof(int32_t), NCOLS * sizeof(int32_t), SIZE - 1) < 0);
+
+  blosc2_free_ctx(dctx);
+  return 0;
+}
+
+
+static char *test_maskout(void) {
+  char *result = compress();
+  if (result != 0) {
+    return result;
+  }
+  blosc2_context *dctx = blosc2_create_dctx(dparams);
+
+  size_t nbytes, cbytes, blocksize;
+  blosc_cbuffer_sizes(data_out, &nbytes, &cbytes, &blocksize);
+  int nblocks = (int)((nbytes + blocksize - 1) / blocksize);
+  bool *maskout = malloc(nblocks);
+  for (int i = 0; i < nblocks; i++) {
+    maskout[i] = i % 2 == 1;
+  }
+  for (int i = 0; i < SIZE * NCOLS; i++) {
+    matrix[i] = SENTINEL;
+  }
+  blosc2_set_maskout(dctx, maskout, nblocks);
+  int dsize = blosc2_decompress_ctx_strided(dctx, data_out, csize, matrix,
+                                            sizeof(int32_t), NCOLS * sizeof(int32_t), SIZE);
+  mu_assert("Decompression error", dsize > 0);
+  for (int i = 0; i < SIZE; i++) {
+    bool masked = maskout[i * sizeof(int32_t) / blocksize];
+    mu_assert("Bad masked data", matrix[i * NCOLS] == (masked ? SENTINEL : data[i]));
+  }
+  free(maskout);
+
+  blosc2_free_ctx(dctx);
+  return 0;
+}
+
+
+static int copy_func(blosc2_postfilter_params *postparams) {
+  memcpy(postparams->out, postparams->in, (size_t)postparams->size);
+  return 0;
+}
+
+
+static char *test_postfilter(void) {
+  char *result = compress();
+  if (result != 0) {
+    return result;
+  }
+  blosc2_postfilter_params postparams = {0};
+  blosc2_dparams dparams_ = dparams;
+  dparams_.postfilter = (blosc2_postfilter_fn)copy_func;
+  dparams_.postparams = &postparams;
+  blosc2_context *dctx = blosc2_create_dctx(dparams_);
+
+  // Both of them would be in charge of the destination
+  blosc2_iov iov = {matrix, (int32_t)sizeof(data)};
+  mu_assert("The postfilter is accepted", blosc2_decompress_ctx_iov(dctx, data_out, csize, &iov, 1) < 0);
+
+  blosc2_free_ctx(dctx);
+  return 0;
+}
+
+
+static char *all_tests(void) {
+  // Check with an assortment of clevels (0 gives memcpyed chunks), filters and nthreads
+  int clevels[] = {0, 5};
+  uint8_t filters[] = {BLOSC_NOFILTER, BLOSC_DELTA};
+  for (int i = 0; i < 2; i++) {
+    cparams.clevel = (uint8_t)clevels[i];
+    for (int j = 0; j < 2; j++) {
+      cparams.filters[0] = filters[j];
+      for (int nthreads = 1; nthreads <= 4; nthreads *= 2) {
+        cparams.nthreads = (int16_t)nthreads;
+        dparams.nthreads = nthreads;
+        mu_run_test(test_iov);
+        mu_run_test(test_strided);
+        mu_run_test(test_maskout);
+      }
+    }
+  }
+  mu_run_test(test_postfilter);
+
+  return 0;
+}
+
+
+int main(void) {
+  /* Initialize inputs */
+  for (int i = 0; i < SIZE; i++) {
+    data[i] = i * 3 - (i % 11);
+  }
+
+  install_blosc_callback_test(); /* optionally install callback test */
+
+  cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  cparams.compcode = BLOSC_BLOSCLZ;
+  cparams.blocksize = 16 * 1024;
+  dparams = BLOSC2_DPARAMS_DEFAULTS;
+
+  /* Run all the suite */
+  char* result = all_tests();
+  if (result != 0) {
+    printf(" (%s)\n", result);
+  }
+  else {
+    printf(" ALL TESTS PASSED");
+  }
+  printf("\tTests run: %d\n", tests_run);
+
+  return result != 0;
+}
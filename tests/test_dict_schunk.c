@@ -17,8 +17,11 @@
 
 /* Global vars */
 int tests_run = 0;
+int nchunks;
 int blocksize;
 int use_dict;
+int compcode;
+float cratio_nodict;  // of the last run without a dict
 
 static char* test_dict(void) {
   static int32_t data[CHUNKSIZE];
@@ -29,7 +32,7 @@ static char* test_dict(void) {
   blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
   blosc2_dparams dparams = BLOSC2_DPARAMS_DEFAULTS;
   blosc2_schunk* schunk;
-  int32_t nchunks;
+  int32_t nchunks_;
   blosc_timestamp_t last, current;
   double cttotal, dttotal;
 
@@ -38,7 +41,7 @@ static char* test_dict(void) {
 
   /* Create a super-chunk container */
   cparams.typesize = sizeof(int32_t);
-  cparams.compcode = BLOSC_ZSTD;
+  cparams.compcode = (uint8_t)compcode;
   cparams.use_dict = use_dict;
   cparams.clevel = 5;
   cparams.nthreads = NTHREADS;
@@ -49,19 +52,19 @@ static char* test_dict(void) {
 
   // Feed it with data
   blosc_set_timestamp(&last);
-  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+  for (int nchunk = 0; nchunk < nchunks; nchunk++) {
     for (int i = 0; i < CHUNKSIZE; i++) {
       data[i] = i + nchunk * CHUNKSIZE;
     }
-    nchunks = blosc2_schunk_append_buffer(schunk, data, isize);
-    mu_assert("ERROR: incorrect nchunks value", nchunks == (nchunk + 1));
+    nchunks_ = blosc2_schunk_append_buffer(schunk, data, isize);
+    mu_assert("ERROR: incorrect nchunks value", nchunks_ == (nchunk + 1));
   }
   blosc_set_timestamp(&current);
   cttotal = blosc_elapsed_secs(last, current);
 
   /* Retrieve and decompress the chunks */
   blosc_set_timestamp(&last);
-  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+  for (int nchunk = 0; nchunk < nchunks; nchunk++) {
     dsize = blosc2_schunk_decompress_chunk(schunk, nchunk, (void *) data_dest, isize);
     mu_assert("ERROR: Decompression error.", dsize > 0);
   }
@@ -75,12 +78,30 @@ static char* test_dict(void) {
   float cspeed = nbytes / ((float)cttotal * MB);
   float dspeed = nbytes / ((float)dttotal * MB);
   if (tests_run == 0) printf("\n");
+  const char* compname;
+  blosc_compcode_to_compname(compcode, &compname);
+  printf("[%s] ", compname);
   if (blocksize > 0) {
     printf("[blocksize: %d KB] ", blocksize / 1024);
   } else {
     printf("[blocksize: automatic] ");
   }
-  if (!use_dict) {
+  if (compcode != BLOSC_ZSTD) {
+    // The expected ratios are for ZSTD
+    printf("cratio %s dict: %.1fx (compr @ %.1f MB/s, decompr @ %.1f MB/s)\n",
+           use_dict ? "with" : "w/o", cratio, cspeed, dspeed);
+    if (!use_dict) {
+      cratio_nodict = cratio;
+    }
+    else {
+      mu_assert("ERROR: Dict does not improve the compression ratio", cratio > cratio_nodict);
+      if (blocksize == 1 * KB) {
+        // Tiny blocks are where dicts make the largest difference
+        mu_assert("ERROR: Dict does not reach expected compression ratio", cratio > 8 * 1.);
+      }
+    }
+  }
+  else if (!use_dict) {
     printf("cratio w/o dict: %.1fx (compr @ %.1f MB/s, decompr @ %.1f MB/s)\n",
             cratio, cspeed, dspeed);
     switch (blocksize) {
@@ -131,7 +152,7 @@ static char* test_dict(void) {
   }
 
   // Check that the chunks have been decompressed correctly
-  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+  for (int nchunk = 0; nchunk < nchunks; nchunk++) {
     dsize = blosc2_schunk_decompress_chunk(schunk, nchunk, (void *) data_dest, isize);
     mu_assert("ERROR: chunk cannot be decompressed correctly.", dsize >= 0);
     for (int i = 0; i < CHUNKSIZE; i++) {
@@ -150,35 +171,26 @@ static char* test_dict(void) {
 
 
 static char *all_tests(void) {
-  blocksize = 1 * KB;    // really tiny
-  use_dict = 0;
-  mu_run_test(test_dict);
-  use_dict = 1;
-  mu_run_test(test_dict);
-
-  blocksize = 4 * KB;    // page size
-  use_dict = 0;
-  mu_run_test(test_dict);
-  use_dict = 1;
-  mu_run_test(test_dict);
-
-  blocksize = 32 * KB;   // L1 cache size
-  use_dict = 0;
-  mu_run_test(test_dict);
-  use_dict = 1;
-  mu_run_test(test_dict);
-
-  blocksize = 256 * KB;   // L2 cache size
-  use_dict = 0;
-  mu_run_test(test_dict);
-  use_dict = 1;
-  mu_run_test(test_dict);
-
-  blocksize = 0;         // automatic size
-  use_dict = 0;
-  mu_run_test(test_dict);
-  use_dict = 1;
-  mu_run_test(test_dict);
+  int compcodes[] = {BLOSC_ZSTD, BLOSC_LZ4, BLOSC_LZ4HC, BLOSC_BLOSCLZ};
+  int blocksizes[] = {1 * KB,     // really tiny
+                      4 * KB,     // page size
+                      32 * KB,    // L1 cache size
+                      256 * KB,   // L2 cache size
+                      0};         // automatic size
+  for (int i = 0; i < 4; i++) {
+    compcode = compcodes[i];
+    // Dicts for the other codecs matter for small blocks only, so do not spend time on the rest
+    // (nor on many chunks, as the ratios are the same for all of them)
+    int nblocksizes = compcode == BLOSC_ZSTD ? 5 : 2;
+    nchunks = compcode == BLOSC_ZSTD ? NCHUNKS : NCHUNKS / 4;
+    for (int j = 0; j < nblocksizes; j++) {
+      blocksize = blocksizes[j];
+      use_dict = 0;
+      mu_run_test(test_dict);
+      use_dict = 1;
+      mu_run_test(test_dict);
+    }
+  }
 
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,196 @@
+/*
+  Copyright (C) 2020 The Blosc Developers
+  http://blosc.org
+  License: BSD (see LICENSE.txt)
+
+  See LICENSE.txt for details about copyright and rights to use.
+
+  Test for a dict shared by all the chunks of a super-chunk.
+*/
+
+#include <stdio.h>
+#include "test_common.h"
+
+#define CHUNKSIZE (50 * 1000)
+#define NCHUNKS 10
+#define NTHREADS 4
+
+/* Global vars */
+int tests_run = 0;
+int compcode;
+bool sequential;
+char* filename = "test_dict_shared.b2frame";
+
+static int32_t data[CHUNKSIZE];
+static int32_t data_dest[CHUNKSIZE * 2];
+
+
+static void fill_chunk(int nchunk) {
+  for (int i = 0; i < CHUNKSIZE; i++) {
+    data[i] = i + nchunk * CHUNKSIZE;
+  }
+}
+
+
+static blosc2_schunk* new_schunk(int use_dict) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  cparams.compcode = (uint8_t)compcode;
+  cparams.use_dict = use_dict;
+  cparams.blocksize = 4 * KB;
+  blosc2_storage storage = {.sequential=sequential, .path=sequential ? filename : NULL};
+  return blosc_test_new_schunk(storage, cparams, NTHREADS);
+}
+
+
+static int check_schunk(blosc2_schunk* schunk, int nchunks) {
+  for (int nchunk = 0; nchunk < nchunks; nchunk++) {
+    int dsize = blosc2_schunk_decompress_chunk(schunk, nchunk, data_dest, CHUNKSIZE * sizeof(int32_t));
+    if (dsize != CHUNKSIZE * sizeof(int32_t)) {
+      return -1;
+    }
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      if (data_dest[i] != i + nchunk * CHUNKSIZE) {
+        return -2;
+      }
+    }
+  }
+  // A slice across two chunks
+  int64_t start = CHUNKSIZE / 2;
+  int64_t stop = start + CHUNKSIZE;
+  if (blosc2_schunk_get_slice(schunk, start, stop, data_dest) != CHUNKSIZE * (int64_t)sizeof(int32_t)) {
+    return -3;
+  }
+  for (int i = 0; i < CHUNKSIZE; i++) {
+    if (data_dest[i] != start + i) {
+      return -4;
+    }
+  }
+  return 0;
+}
+
+
+static char* test_shared_dict(void) {
+  // The reference: a dict per chunk
+  blosc2_schunk* schunk = new_schunk(BLOSC2_DICT_CHUNK);
+  mu_assert("ERROR: cannot create the super-chunk", schunk != NULL);
+  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+    fill_chunk(nchunk);
+    int nchunks = blosc2_schunk_append_buffer(schunk, data, CHUNKSIZE * sizeof(int32_t));
+    mu_assert("ERROR: incorrect nchunks value", nchunks == nchunk + 1);
+  }
+  int64_t chunk_cbytes = schunk->cbytes;
+  blosc2_schunk_free(schunk);
+
+  schunk = new_schunk(BLOSC2_DICT_SCHUNK);
+  mu_assert("ERROR: cannot create the super-chunk", schunk != NULL);
+  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+    fill_chunk(nchunk);
+    int nchunks = blosc2_schunk_append_buffer(schunk, data, CHUNKSIZE * sizeof(int32_t));
+    mu_assert("ERROR: incorrect nchunks value", nchunks == nchunk + 1);
+  }
+  mu_assert("ERROR: the super-chunk has no dict", schunk->dict != NULL && schunk->dict_size > 0);
+  mu_assert("ERROR: the shared dict does not save space", schunk->cbytes < chunk_cbytes);
+  mu_assert("ERROR: bad roundtrip", check_schunk(schunk, NCHUNKS) == 0);
+  mu_assert("ERROR: the dict cannot be trained twice",
+            blosc2_schunk_train_dict(schunk, data, CHUNKSIZE * sizeof(int32_t)) == -2);
+  blosc2_schunk_free(schunk);
+
+  if (sequential) {
+    // The dict is in the frame, and new chunks are compressed with it too
+    blosc2_storage storage = {.sequential=true, .path=filename};
+    schunk = blosc2_schunk_open(storage);
+    mu_assert("ERROR: cannot open the frame", schunk != NULL);
+    mu_assert("ERROR: the frame has no dict", schunk->dict != NULL);
+    mu_assert("ERROR: bad roundtrip after reopening", check_schunk(schunk, NCHUNKS) == 0);
+    int32_t dict_size = schunk->dict_size;
+    fill_chunk(NCHUNKS);
+    int nchunks = blosc2_schunk_append_buffer(schunk, data, CHUNKSIZE * sizeof(int32_t));
+    mu_assert("ERROR: cannot append to the frame", nchunks == NCHUNKS + 1);
+    mu_assert("ERROR: the dict has changed", schunk->dict_size == dict_size);
+    mu_assert("ERROR: bad roundtrip after appending", check_schunk(schunk, NCHUNKS + 1) == 0);
+    blosc2_schunk_free(schunk);
+    remove(filename);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+static char* test_train_dict(void) {
+  blosc2_schunk* schunk = new_schunk(BLOSC2_DICT_SCHUNK);
+  mu_assert("ERROR: cannot create the super-chunk", schunk != NULL);
+
+  // Train the dict out of a sample of the data before appending anything
+  fill_chunk(NCHUNKS / 2);
+  int dict_size = blosc2_schunk_train_dict(schunk, data, CHUNKSIZE * sizeof(int32_t));
+  mu_assert("ERROR: cannot train the dict", dict_size > 0 && dict_size == schunk->dict_size);
+
+  // Several threads compressing at once use the same dict
+  blosc2_schunk_appender* appender = blosc2_schunk_appender_new(schunk, NTHREADS, 0);
+  mu_assert("ERROR: cannot create the appender", appender != NULL);
+  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+    fill_chunk(nchunk);
+    int nchunks = blosc2_schunk_appender_push(appender, data, CHUNKSIZE * sizeof(int32_t));
+    mu_assert("ERROR: bad number of chunks", nchunks == nchunk + 1);
+  }
+  mu_assert("ERROR: cannot free the appender", blosc2_schunk_appender_free(appender) == NCHUNKS);
+  mu_assert("ERROR: the dict has changed", schunk->dict_size == dict_size);
+  mu_assert("ERROR: bad roundtrip", check_schunk(schunk, NCHUNKS) == 0);
+
+  // Single items can be read without decompressing the whole chunk
+  int32_t item;
+  mu_assert("ERROR: cannot get the item", blosc2_schunk_get_slice(schunk, 3 * CHUNKSIZE + 7,
+                                                                  3 * CHUNKSIZE + 8, &item) == sizeof(int32_t));
+  mu_assert("ERROR: bad item", item == 3 * CHUNKSIZE + 7);
+  blosc2_schunk_free(schunk);
+
+  if (sequential) {
+    blosc2_storage storage = {.sequential=true, .path=filename};
+    schunk = blosc2_schunk_open(storage);
+    mu_assert("ERROR: cannot open the frame", schunk != NULL);
+    mu_assert("ERROR: the frame has a different dict", schunk->dict_size == dict_size);
+    mu_assert("ERROR: bad roundtrip after reopening", check_schunk(schunk, NCHUNKS) == 0);
+    blosc2_schunk_free(schunk);
+    remove(filename);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+static char *all_tests(void) {
+  int compcodes[] = {BLOSC_ZSTD, BLOSC_LZ4, BLOSC_BLOSCLZ};
+  for (int i = 0; i < 3; i++) {
+    compcode = compcodes[i];
+    for (int j = 0; j < 2; j++) {
+      sequential = (j == 1);
+      mu_run_test(test_shared_dict);
+      mu_run_test(test_train_dict);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+int main(void) {
+  char *result;
+
+  install_blosc_callback_test(); /* optionally install callback test */
+  blosc_init();
+
+  /* Run all the suite */
+  result = all_tests();
+  if (result != EXIT_SUCCESS) {
+    printf(" (%s)\n", result);
+  }
+  else {
+    printf(" ALL TESTS PASSED");
+  }
+  printf("\tTests run: %d\n", tests_run);
+
+  blosc_destroy();
+
+  return result != EXIT_SUCCESS;
+}
@@ -0,0 +1,250 @@
+/*
+  Copyright (C) 2020- The Blosc Development Team <blosc@blosc.org>
+  http://blosc.org
+  License: BSD (see LICENSE.txt)
+
+  See LICENSE.txt for details about copyright and rights to use.
+
+  Test for accessing a frame on-disk from several super-chunks (and processes, and threads)
+  at the same time.
+*/
+
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "test_common.h"
+
+#define CHUNKSIZE (50 * 1000)
+#define NCHUNKS (10)
+#define NCHUNKS_CHILD (50)
+
+/* Global vars */
+int tests_run = 0;
+bool checksums;
+char* filename = "test_frame_lock.b2frame";
+
+int32_t *data;
+int32_t *data_dest;
+
+
+static blosc2_schunk* open_schunk(void) {
+  blosc2_storage storage = {.sequential=true, .path=filename};
+  return blosc2_schunk_open(storage);
+}
+
+
+static int append_chunks(blosc2_schunk* schunk, int start, int stop) {
+  for (int nchunk = start; nchunk < stop; nchunk++) {
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      data[i] = i + nchunk * CHUNKSIZE;
+    }
+    int nchunks_ = blosc2_schunk_append_buffer(schunk, data, CHUNKSIZE * sizeof(int32_t));
+    if (nchunks_ != nchunk + 1) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+
+static bool check_chunk(blosc2_schunk* schunk, int nchunk, int expected) {
+  int dsize = blosc2_schunk_decompress_chunk(schunk, nchunk, data_dest, CHUNKSIZE * sizeof(int32_t));
+  if (dsize != CHUNKSIZE * sizeof(int32_t)) {
+    return false;
+  }
+  for (int i = 0; i < CHUNKSIZE; i++) {
+    if (data_dest[i] != i + expected * CHUNKSIZE) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+static char* test_two_schunks(void) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  blosc2_storage storage = {.sequential=true, .path=filename, .checksums=checksums};
+  blosc2_schunk* writer = blosc_test_new_schunk(storage, cparams, 1);
+  mu_assert("ERROR: cannot create the frame", writer != NULL);
+  mu_assert("ERROR: bad append", append_chunks(writer, 0, NCHUNKS) == 0);
+
+  blosc2_schunk* reader = open_schunk();
+  mu_assert("ERROR: cannot open the frame", reader != NULL);
+  mu_assert("ERROR: bad number of chunks", reader->nchunks == NCHUNKS);
+  // Populate the cache of offsets in the reader
+  mu_assert("ERROR: bad roundtrip", check_chunk(reader, NCHUNKS - 1, NCHUNKS - 1));
+
+  // The reader should notice the new chunks as soon as it accesses the frame
+  mu_assert("ERROR: bad append", append_chunks(writer, NCHUNKS, 2 * NCHUNKS) == 0);
+  mu_assert("ERROR: bad roundtrip", check_chunk(reader, 0, 0));
+  mu_assert("ERROR: new chunks are not seen", reader->nchunks == 2 * NCHUNKS);
+  mu_assert("ERROR: bad nbytes", reader->nbytes == writer->nbytes);
+  for (int nchunk = 0; nchunk < 2 * NCHUNKS; nchunk++) {
+    mu_assert("ERROR: bad roundtrip", check_chunk(reader, nchunk, nchunk));
+  }
+  if (checksums) {
+    mu_assert("ERROR: the frame does not verify", blosc2_schunk_verify(reader) == 0);
+  }
+
+  // Changes that do not alter the frame length must be noticed too
+  int offsets_order[2 * NCHUNKS];
+  for (int i = 0; i < 2 * NCHUNKS; ++i) {
+    offsets_order[i] = (i + 3) % (2 * NCHUNKS);
+  }
+  mu_assert("ERROR: cannot reorder chunks", blosc2_schunk_reorder_offsets(writer, offsets_order) >= 0);
+  for (int nchunk = 0; nchunk < 2 * NCHUNKS; nchunk++) {
+    mu_assert("ERROR: reordered chunks are not seen", check_chunk(reader, nchunk, offsets_order[nchunk]));
+  }
+
+  // Roles can be exchanged
+  mu_assert("ERROR: bad append", append_chunks(reader, 2 * NCHUNKS, 3 * NCHUNKS) == 0);
+  mu_assert("ERROR: bad roundtrip", check_chunk(writer, 3 * NCHUNKS - 1, 3 * NCHUNKS - 1));
+  mu_assert("ERROR: new chunks are not seen", writer->nchunks == 3 * NCHUNKS);
+
+  blosc2_schunk_free(reader);
+  blosc2_schunk_free(writer);
+
+  return EXIT_SUCCESS;
+}
+
+
+static char* test_two_processes(void) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  blosc2_storage storage = {.sequential=true, .path=filename, .checksums=checksums};
+  blosc2_schunk* writer = blosc_test_new_schunk(storage, cparams, 1);
+  mu_assert("ERROR: cannot create the frame", writer != NULL);
+  mu_assert("ERROR: bad append", append_chunks(writer, 0, 1) == 0);
+
+  fflush(stdout);
+  pid_t pid = fork();
+  mu_assert("ERROR: cannot fork", pid >= 0);
+  if (pid == 0) {
+    // The child keeps appending while the parent is reading
+    int rc = append_chunks(writer, 1, NCHUNKS_CHILD);
+    blosc2_schunk_free(writer);
+    _exit(rc == 0 ? 0 : 1);
+  }
+  blosc2_schunk_free(writer);
+
+  blosc2_schunk* reader = open_schunk();
+  mu_assert("ERROR: cannot open the frame", reader != NULL);
+  int nchunks = 0;
+  while (nchunks < NCHUNKS_CHILD) {
+    // Every access sees a consistent frame, and chunks that are there keep being valid
+    mu_assert("ERROR: bad roundtrip", check_chunk(reader, 0, 0));
+    nchunks = reader->nchunks;
+    mu_assert("ERROR: bad roundtrip", check_chunk(reader, nchunks - 1, nchunks - 1));
+  }
+
+  int status;
+  waitpid(pid, &status, 0);
+  mu_assert("ERROR: the child process failed", WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  if (checksums) {
+    mu_assert("ERROR: the frame does not verify", blosc2_schunk_verify(reader) == 0);
+  }
+  blosc2_schunk_free(reader);
+
+  return EXIT_SUCCESS;
+}
+
+
+static void* reader_worker(void* arg) {
+  blosc2_schunk* schunk = (blosc2_schunk*)arg;
+  for (int nchunk = 0; nchunk < NCHUNKS_CHILD; ) {
+    // Chunks that have not been appended yet cannot be read
+    int dsize = blosc2_schunk_decompress_chunk(schunk, nchunk, data_dest, CHUNKSIZE * sizeof(int32_t));
+    if (dsize < 0) {
+      continue;
+    }
+    if (dsize != CHUNKSIZE * sizeof(int32_t)) {
+      return "ERROR: bad chunk size";
+    }
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      if (data_dest[i] != i + nchunk * CHUNKSIZE) {
+        return "ERROR: bad roundtrip";
+      }
+    }
+    nchunk++;
+  }
+  return NULL;
+}
+
+
+static char* test_reader_thread(void) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  blosc2_storage storage = {.sequential=true, .path=filename, .checksums=checksums};
+  blosc2_schunk* schunk = blosc_test_new_schunk(storage, cparams, 1);
+  mu_assert("ERROR: cannot create the frame", schunk != NULL);
+  mu_assert("ERROR: bad append", append_chunks(schunk, 0, 1) == 0);
+
+  // The committer thread of the appender writes the frame while another thread is reading it
+  blosc2_schunk_appender* appender = blosc2_schunk_appender_new(schunk, 2, 0);
+  mu_assert("ERROR: cannot create the appender", appender != NULL);
+  pthread_t reader;
+  mu_assert("ERROR: cannot create the reader", pthread_create(&reader, NULL, reader_worker, schunk) == 0);
+  for (int nchunk = 1; nchunk < NCHUNKS_CHILD; nchunk++) {
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      data[i] = i + nchunk * CHUNKSIZE;
+    }
+    mu_assert("ERROR: bad push",
+              blosc2_schunk_appender_push(appender, data, CHUNKSIZE * sizeof(int32_t)) == nchunk + 1);
+  }
+  void* result;
+  pthread_join(reader, &result);
+  mu_assert("ERROR: cannot free the appender", blosc2_schunk_appender_free(appender) == NCHUNKS_CHILD);
+  mu_assert((char*)result, result == NULL);
+  if (checksums) {
+    mu_assert("ERROR: the frame does not verify", blosc2_schunk_verify(schunk) == 0);
+  }
+  blosc2_schunk_free(schunk);
+
+  return EXIT_SUCCESS;
+}
+
+
+static char *all_tests(void) {
+  checksums = false;
+  mu_run_test(test_two_schunks);
+  mu_run_test(test_two_processes);
+  mu_run_test(test_reader_thread);
+
+  checksums = true;
+  mu_run_test(test_two_schunks);
+  mu_run_test(test_two_processes);
+  mu_run_test(test_reader_thread);
+
+  return EXIT_SUCCESS;
+}
+
+
+#define BUFFER_ALIGN_SIZE   32
+
+int main(void) {
+  char *result;
+
+  data = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(int32_t));
+  data_dest = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(int32_t));
+
+  install_blosc_callback_test(); /* optionally install callback test */
+  blosc_init();
+
+  /* Run all the suite */
+  result = all_tests();
+  if (result != EXIT_SUCCESS) {
+    printf(" (%s)\n", result);
+  }
+  else {
+    printf(" ALL TESTS PASSED");
+  }
+  printf("\tTests run: %d\n", tests_run);
+
+  blosc_test_free(data);
+  blosc_test_free(data_dest);
+  blosc_destroy();
+
+  return result != EXIT_SUCCESS;
+}
@@ -0,0 +1,250 @@
+/*
+  Copyright (C) 2020- The Blosc Development Team <blosc@blosc.org>
+  http://blosc.org
+  License: BSD (see LICENSE.txt)
+
+  See LICENSE.txt for details about copyright and rights to use.
+
+  Test for sharing a frame in shared memory between several super-chunks (and processes).
+*/
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "test_common.h"
+
+#define CHUNKSIZE (50 * 1000)
+#define NCHUNKS (10)
+#define NCHUNKS_CHILD (50)
+#define MAXLEN (16 * 1024 * 1024)
+
+/* Global vars */
+int tests_run = 0;
+bool checksums;
+char shm_name[64];
+
+int32_t *data;
+int32_t *data_dest;
+
+
+static int append_chunks(blosc2_schunk* schunk, int start, int stop) {
+  for (int nchunk = start; nchunk < stop; nchunk++) {
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      data[i] = i + nchunk * CHUNKSIZE;
+    }
+    int nchunks_ = blosc2_schunk_append_buffer(schunk, data, CHUNKSIZE * sizeof(int32_t));
+    if (nchunks_ != nchunk + 1) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+
+static bool check_chunk(blosc2_schunk* schunk, int nchunk, int expected) {
+  int dsize = blosc2_schunk_decompress_chunk(schunk, nchunk, data_dest, CHUNKSIZE * sizeof(int32_t));
+  if (dsize != CHUNKSIZE * sizeof(int32_t)) {
+    return false;
+  }
+  for (int i = 0; i < CHUNKSIZE; i++) {
+    if (data_dest[i] != i + expected * CHUNKSIZE) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+static char* test_two_schunks(void) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  blosc2_storage storage = {.cparams=&cparams, .checksums=checksums};
+  blosc2_schunk* writer = blosc2_schunk_new_shm(shm_name, MAXLEN, storage);
+  mu_assert("ERROR: cannot create the frame", writer != NULL);
+  mu_assert("ERROR: the segment can be created twice",
+            blosc2_schunk_new_shm(shm_name, MAXLEN, storage) == NULL);
+  mu_assert("ERROR: bad append", append_chunks(writer, 0, NCHUNKS) == 0);
+
+  // The reader can have its own storage properties
+  blosc2_dparams reader_dparams = {.nthreads=2};
+  blosc2_storage reader_storage = {.dparams=&reader_dparams, .cache_size=2};
+  blosc2_schunk* reader = blosc2_schunk_open_shm(shm_name, &reader_storage);
+  mu_assert("ERROR: cannot open the frame", reader != NULL);
+  mu_assert("ERROR: the storage is not honored",
+            reader->storage->dparams->nthreads == 2 && reader->storage->cache_size == 2);
+  mu_assert("ERROR: bad number of chunks", reader->nchunks == NCHUNKS);
+  mu_assert("ERROR: bad roundtrip", check_chunk(reader, NCHUNKS - 1, NCHUNKS - 1));
+
+  // Chunks are not copied out of the segment
+  uint8_t* chunk;
+  bool needs_free;
+  int cbytes = blosc2_schunk_get_chunk(reader, 0, &chunk, &needs_free);
+  mu_assert("ERROR: cannot get a chunk", cbytes > 0);
+  mu_assert("ERROR: the chunk has been copied", !needs_free);
+  mu_assert("ERROR: the chunk is not in the segment",
+            chunk > reader->frame->sdata && chunk < reader->frame->sdata + reader->frame->len);
+
+  // The reader should notice the new chunks as soon as it accesses the frame
+  mu_assert("ERROR: bad append", append_chunks(writer, NCHUNKS, 2 * NCHUNKS) == 0);
+  mu_assert("ERROR: bad roundtrip", check_chunk(reader, 0, 0));
+  mu_assert("ERROR: new chunks are not seen", reader->nchunks == 2 * NCHUNKS);
+  mu_assert("ERROR: bad nbytes", reader->nbytes == writer->nbytes);
+  for (int nchunk = 0; nchunk < 2 * NCHUNKS; nchunk++) {
+    mu_assert("ERROR: bad roundtrip", check_chunk(reader, nchunk, nchunk));
+  }
+  if (checksums) {
+    mu_assert("ERROR: the frame does not verify", blosc2_schunk_verify(reader) == 0);
+  }
+
+  // Changes that do not alter the frame length must be noticed too
+  int offsets_order[2 * NCHUNKS];
+  for (int i = 0; i < 2 * NCHUNKS; ++i) {
+    offsets_order[i] = (i + 3) % (2 * NCHUNKS);
+  }
+  mu_assert("ERROR: cannot reorder chunks", blosc2_schunk_reorder_offsets(writer, offsets_order) >= 0);
+  for (int nchunk = 0; nchunk < 2 * NCHUNKS; nchunk++) {
+    mu_assert("ERROR: reordered chunks are not seen", check_chunk(reader, nchunk, offsets_order[nchunk]));
+  }
+
+  // Readers cannot modify the frame
+  mu_assert("ERROR: a reader can append", append_chunks(reader, 2 * NCHUNKS, 2 * NCHUNKS + 1) < 0);
+  mu_assert("ERROR: a reader can reorder", blosc2_schunk_reorder_offsets(reader, offsets_order) < 0);
+  mu_assert("ERROR: bad number of chunks", writer->nchunks == 2 * NCHUNKS);
+
+  blosc2_schunk_free(reader);
+  blosc2_schunk_free(writer);
+  mu_assert("ERROR: cannot remove the segment", blosc2_unlink_shm(shm_name) == 0);
+  mu_assert("ERROR: the segment has not been removed", blosc2_schunk_open_shm(shm_name, NULL) == NULL);
+
+  return EXIT_SUCCESS;
+}
+
+
+static char* test_maxlen(void) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  blosc2_storage storage = {.cparams=&cparams, .checksums=checksums};
+  // Room for the frame and a few chunks only
+  blosc2_schunk* writer = blosc2_schunk_new_shm(shm_name, 64 * 1024, storage);
+  mu_assert("ERROR: cannot create the frame", writer != NULL);
+  blosc2_schunk* reader = blosc2_schunk_open_shm(shm_name, NULL);
+  mu_assert("ERROR: cannot open the frame", reader != NULL);
+
+  // Use data that does not compress well
+  int nchunks = 0;
+  int rc = 0;
+  while (rc >= 0) {
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      data[i] = (int32_t)((i + nchunks) * 2654435761U);
+    }
+    rc = blosc2_schunk_append_buffer(writer, data, CHUNKSIZE * sizeof(int32_t));
+    if (rc >= 0) {
+      nchunks++;
+    }
+    mu_assert("ERROR: the maximum length has not been honored", nchunks < 100);
+  }
+  mu_assert("ERROR: bad number of chunks", writer->nchunks == nchunks);
+  // The frame should still be usable after a failed append
+  mu_assert("ERROR: no chunks have been appended", nchunks > 0);
+  mu_assert("ERROR: bad roundtrip", blosc2_schunk_decompress_chunk(
+    reader, 0, data_dest, CHUNKSIZE * sizeof(int32_t)) == CHUNKSIZE * sizeof(int32_t));
+  mu_assert("ERROR: new chunks are not seen", reader->nchunks == writer->nchunks);
+  if (checksums) {
+    mu_assert("ERROR: the frame does not verify", blosc2_schunk_verify(reader) == 0);
+  }
+
+  blosc2_schunk_free(reader);
+  blosc2_schunk_free(writer);
+  blosc2_unlink_shm(shm_name);
+
+  return EXIT_SUCCESS;
+}
+
+
+static char* test_two_processes(void) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  blosc2_storage storage = {.cparams=&cparams, .checksums=checksums};
+  blosc2_schunk* writer = blosc2_schunk_new_shm(shm_name, MAXLEN, storage);
+  mu_assert("ERROR: cannot create the frame", writer != NULL);
+  mu_assert("ERROR: bad append", append_chunks(writer, 0, 1) == 0);
+
+  fflush(stdout);
+  pid_t pid = fork();
+  mu_assert("ERROR: cannot fork", pid >= 0);
+  if (pid == 0) {
+    // The child keeps appending while the parent is reading
+    int rc = append_chunks(writer, 1, NCHUNKS_CHILD);
+    blosc2_schunk_free(writer);
+    _exit(rc == 0 ? 0 : 1);
+  }
+  blosc2_schunk_free(writer);
+
+  blosc2_schunk* reader = blosc2_schunk_open_shm(shm_name, NULL);
+  mu_assert("ERROR: cannot open the frame", reader != NULL);
+  int nchunks = 0;
+  while (nchunks < NCHUNKS_CHILD) {
+    // Every access sees a consistent frame, and chunks that are there keep being valid
+    mu_assert("ERROR: bad roundtrip", check_chunk(reader, 0, 0));
+    nchunks = reader->nchunks;
+    mu_assert("ERROR: bad roundtrip", check_chunk(reader, nchunks - 1, nchunks - 1));
+  }
+
+  int status;
+  waitpid(pid, &status, 0);
+  mu_assert("ERROR: the child process failed", WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  if (checksums) {
+    mu_assert("ERROR: the frame does not verify", blosc2_schunk_verify(reader) == 0);
+  }
+  blosc2_schunk_free(reader);
+  blosc2_unlink_shm(shm_name);
+
+  return EXIT_SUCCESS;
+}
+
+
+static char *all_tests(void) {
+  checksums = false;
+  mu_run_test(test_two_schunks);
+  mu_run_test(test_maxlen);
+  mu_run_test(test_two_processes);
+
+  checksums = true;
+  mu_run_test(test_two_schunks);
+  mu_run_test(test_maxlen);
+  mu_run_test(test_two_processes);
+
+  return EXIT_SUCCESS;
+}
+
+
+#define BUFFER_ALIGN_SIZE   32
+
+int main(void) {
+  char *result;
+
+  // Tests may run in parallel
+  snprintf(shm_name, sizeof(shm_name), "/test_frame_shm.%d", (int)getpid());
+
+  data = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(int32_t));
+  data_dest = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(int32_t));
+
+  install_blosc_callback_test(); /* optionally install callback test */
+  blosc_init();
+
+  /* Run all the suite */
+  result = all_tests();
+  if (result != EXIT_SUCCESS) {
+    printf(" (%s)\n", result);
+  }
+  else {
+    printf(" ALL TESTS PASSED");
+  }
+  printf("\tTests run: %d\n", tests_run);
+
+  blosc_test_free(data);
+  blosc_test_free(data_dest);
+  blosc_destroy();
+
+  return result != EXIT_SUCCESS;
+}
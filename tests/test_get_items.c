@@ -0,0 +1,144 @@
+/*
+  Copyright (C) 2020- The Blosc Development Team <blosc@blosc.org>
+  http://blosc.org
+  License: BSD (see LICENSE.txt)
+
+  See LICENSE.txt for details about copyright and rights to use.
+
+  Test for gathering items at scattered positions out of super-chunks.
+*/
+
+#include <stdio.h>
+#include "test_common.h"
+
+#define CHUNKSIZE (5 * 1000)
+#define BLOCKSIZE (1000 * sizeof(int32_t))
+#define NCHUNKS (10)
+#define NITEMS (NCHUNKS * CHUNKSIZE - 123)  // the last chunk is not full
+#define NINDICES (2000)
+
+/* Global vars */
+int tests_run = 0;
+bool sequential;
+bool checksums;
+int nthreads;
+char* filename;
+
+int32_t *data;
+int32_t *data_dest;
+int64_t *indices;
+
+
+static bool check_items(blosc2_schunk* schunk, int64_t n) {
+  int64_t nbytes = blosc2_schunk_get_items(schunk, indices, n, data_dest);
+  if (nbytes != n * (int64_t)sizeof(int32_t)) {
+    return false;
+  }
+  for (int64_t i = 0; i < n; i++) {
+    if (data_dest[i] != indices[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+static char* test_get_items(void) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  cparams.blocksize = BLOCKSIZE;
+  blosc2_storage storage = {.sequential=sequential, .path=filename, .checksums=checksums};
+  blosc2_schunk* schunk = blosc_test_new_schunk(storage, cparams, nthreads);
+  mu_assert("ERROR: cannot create the super-chunk", schunk != NULL);
+  mu_assert("ERROR: cannot append the chunks", blosc_test_append_seq(
+    schunk, data, 0, NCHUNKS, CHUNKSIZE, NITEMS - (NCHUNKS - 1) * CHUNKSIZE) == 0);
+  if (filename != NULL) {
+    // Exercise the lazy chunks of frames on-disk
+    schunk = blosc_test_reopen_schunk(schunk, filename, nthreads);
+    mu_assert("ERROR: cannot open the frame", schunk != NULL);
+  }
+
+  // Scattered (and repeated) positions in no particular order
+  uint32_t seed = 1;
+  for (int i = 0; i < NINDICES; i++) {
+    seed = seed * 1103515245U + 12345U;
+    indices[i] = (seed >> 8U) % NITEMS;
+  }
+  indices[0] = 0;
+  indices[1] = NITEMS - 1;
+  indices[2] = indices[3];
+  mu_assert("ERROR: bad scattered items", check_items(schunk, NINDICES));
+
+  // Items in a single chunk and block, in descending order
+  for (int i = 0; i < 10; i++) {
+    indices[i] = 3 * CHUNKSIZE + 100 - i;
+  }
+  mu_assert("ERROR: bad items in a block", check_items(schunk, 10));
+  mu_assert("ERROR: bad empty request", blosc2_schunk_get_items(schunk, indices, 0, data_dest) == 0);
+
+  // Out of bounds
+  indices[5] = NITEMS;
+  mu_assert("ERROR: an index past the end is accepted",
+            blosc2_schunk_get_items(schunk, indices, 10, data_dest) < 0);
+  indices[5] = -1;
+  mu_assert("ERROR: a negative index is accepted",
+            blosc2_schunk_get_items(schunk, indices, 10, data_dest) < 0);
+
+  blosc2_schunk_free(schunk);
+  if (filename != NULL) {
+    remove(filename);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+static char *all_tests(void) {
+  char* filenames[] = {NULL, NULL, "test_get_items.b2frame"};
+  bool sequentials[] = {false, true, true};
+  for (int i = 0; i < 3; i++) {
+    sequential = sequentials[i];
+    filename = filenames[i];
+    for (nthreads = 1; nthreads <= 4; nthreads *= 4) {
+      checksums = false;
+      mu_run_test(test_get_items);
+      if (sequential) {
+        checksums = true;
+        mu_run_test(test_get_items);
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+#define BUFFER_ALIGN_SIZE   32
+
+int main(void) {
+  char *result;
+
+  data = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(int32_t));
+  data_dest = blosc_test_malloc(BUFFER_ALIGN_SIZE, NINDICES * sizeof(int32_t));
+  indices = blosc_test_malloc(BUFFER_ALIGN_SIZE, NINDICES * sizeof(int64_t));
+
+  install_blosc_callback_test(); /* optionally install callback test */
+  blosc_init();
+
+  /* Run all the suite */
+  result = all_tests();
+  if (result != EXIT_SUCCESS) {
+    printf(" (%s)\n", result);
+  }
+  else {
+    printf(" ALL TESTS PASSED");
+  }
+  printf("\tTests run: %d\n", tests_run);
+
+  blosc_test_free(data);
+  blosc_test_free(data_dest);
+  blosc_test_free(indices);
+  blosc_destroy();
+
+  return result != EXIT_SUCCESS;
+}
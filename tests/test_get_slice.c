@@ -0,0 +1,136 @@
+/*
+  Copyright (C) 2020- The Blosc Development Team <blosc@blosc.org>
+  http://blosc.org
+  License: BSD (see LICENSE.txt)
+
+  See LICENSE.txt for details about copyright and rights to use.
+
+  Test for getting slices of items out of super-chunks.
+*/
+
+#include <stdio.h>
+#include "test_common.h"
+
+#define CHUNKSIZE (5 * 1000)
+#define BLOCKSIZE (1000 * sizeof(int32_t))
+#define NCHUNKS (10)
+#define NITEMS (NCHUNKS * CHUNKSIZE)
+
+/* Global vars */
+int tests_run = 0;
+bool sequential;
+bool checksums;
+int nthreads;
+char* filename;
+
+int32_t *data;
+int32_t *data_dest;
+
+
+static bool check_slice(blosc2_schunk* schunk, int64_t start, int64_t stop) {
+  // Poison the destination so that items not copied are noticed
+  memset(data_dest, 0xff, (size_t)(stop - start + 1) * sizeof(int32_t));
+  int64_t nbytes = blosc2_schunk_get_slice(schunk, start, stop, data_dest);
+  if (nbytes != (stop - start) * (int64_t)sizeof(int32_t)) {
+    return false;
+  }
+  for (int64_t i = 0; i < stop - start; i++) {
+    if (data_dest[i] != start + i) {
+      return false;
+    }
+  }
+  // Nothing past the slice must be touched
+  return data_dest[stop - start] == -1;
+}
+
+
+static char* test_get_slice(void) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  cparams.blocksize = BLOCKSIZE;
+  blosc2_storage storage = {.sequential=sequential, .path=filename, .checksums=checksums};
+  blosc2_schunk* schunk = blosc_test_new_schunk(storage, cparams, nthreads);
+  mu_assert("ERROR: cannot create the super-chunk", schunk != NULL);
+  mu_assert("ERROR: cannot append the chunks",
+            blosc_test_append_seq(schunk, data, 0, NCHUNKS, CHUNKSIZE, CHUNKSIZE) == 0);
+  if (filename != NULL) {
+    // Exercise the lazy chunks of frames on-disk
+    schunk = blosc_test_reopen_schunk(schunk, filename, nthreads);
+    mu_assert("ERROR: cannot open the frame", schunk != NULL);
+  }
+
+  // Inside a single block, several blocks and a whole chunk
+  mu_assert("ERROR: bad slice in a block", check_slice(schunk, 10, 20));
+  mu_assert("ERROR: bad slice in a chunk", check_slice(schunk, 900, 3100));
+  mu_assert("ERROR: bad slice of a chunk", check_slice(schunk, CHUNKSIZE, 2 * CHUNKSIZE));
+  // Across chunks, with partial and full chunks
+  mu_assert("ERROR: bad slice across chunks", check_slice(schunk, CHUNKSIZE - 1, CHUNKSIZE + 1));
+  mu_assert("ERROR: bad slice across chunks", check_slice(schunk, 1234, 7 * CHUNKSIZE + 567));
+  mu_assert("ERROR: bad full slice", check_slice(schunk, 0, NITEMS));
+  mu_assert("ERROR: bad slice at the end", check_slice(schunk, NITEMS - 1, NITEMS));
+
+  // Empty and out of bounds slices
+  mu_assert("ERROR: bad empty slice", blosc2_schunk_get_slice(schunk, 5, 5, data_dest) == 0);
+  mu_assert("ERROR: a slice past the end is accepted",
+            blosc2_schunk_get_slice(schunk, 0, NITEMS + 1, data_dest) < 0);
+  mu_assert("ERROR: a negative start is accepted",
+            blosc2_schunk_get_slice(schunk, -1, 10, data_dest) < 0);
+  mu_assert("ERROR: a reversed slice is accepted",
+            blosc2_schunk_get_slice(schunk, 10, 5, data_dest) < 0);
+
+  blosc2_schunk_free(schunk);
+  if (filename != NULL) {
+    remove(filename);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+static char *all_tests(void) {
+  char* filenames[] = {NULL, NULL, "test_get_slice.b2frame"};
+  bool sequentials[] = {false, true, true};
+  for (int i = 0; i < 3; i++) {
+    sequential = sequentials[i];
+    filename = filenames[i];
+    for (nthreads = 1; nthreads <= 4; nthreads *= 4) {
+      checksums = false;
+      mu_run_test(test_get_slice);
+      if (sequential) {
+        checksums = true;
+        mu_run_test(test_get_slice);
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+#define BUFFER_ALIGN_SIZE   32
+
+int main(void) {
+  char *result;
+
+  data = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(int32_t));
+  data_dest = blosc_test_malloc(BUFFER_ALIGN_SIZE, (NITEMS + 1) * sizeof(int32_t));
+
+  install_blosc_callback_test(); /* optionally install callback test */
+  blosc_init();
+
+  /* Run all the suite */
+  result = all_tests();
+  if (result != EXIT_SUCCESS) {
+    printf(" (%s)\n", result);
+  }
+  else {
+    printf(" ALL TESTS PASSED");
+  }
+  printf("\tTests run: %d\n", tests_run);
+
+  blosc_test_free(data);
+  blosc_test_free(data_dest);
+  blosc_destroy();
+
+  return result != EXIT_SUCCESS;
+}
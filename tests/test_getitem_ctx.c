@@ -0,0 +1,146 @@
+/*
+  Copyright (C) 2020- The Blosc Development Team <blosc@blosc.org>
+  http://blosc.org
+  License: BSD (see LICENSE.txt)
+
+  See LICENSE.txt for details about copyright and rights to use.
+
+  Test for getting items out of chunks with blosc2_getitem_ctx, both serially and with threads,
+  and out of lazy chunks in frames on-disk.
+*/
+
+#include <stdio.h>
+#include "test_common.h"
+
+#define NITEMS (100 * 1000)
+#define BLOCKSIZE (4 * 1024)
+#define FILENAME "test_getitem_ctx.b2frame"
+
+/* Global vars */
+int tests_run = 0;
+int nthreads;
+int clevel;
+uint8_t filter;
+bool with_runs;
+bool lazy;
+
+int32_t *data;
+int32_t *items;
+uint8_t *chunk;
+
+
+static char* test_getitem_ctx(void) {
+  for (int i = 0; i < NITEMS; i++) {
+    // Some blocks are made of runs of the same byte
+    data[i] = (with_runs && (i / 3000) % 2 == 0) ? 0x01010101 : i * 7;
+  }
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  cparams.blocksize = BLOCKSIZE;
+  cparams.clevel = clevel;
+  cparams.filters[BLOSC2_MAX_FILTERS - 1] = filter;
+  // Several threads store the blocks out of order
+  cparams.nthreads = (int16_t)nthreads;
+  blosc2_context *cctx = blosc2_create_cctx(cparams);
+  uint8_t *src = chunk;
+  int cbytes = blosc2_compress_ctx(cctx, data, NITEMS * sizeof(int32_t), chunk,
+                                   NITEMS * sizeof(int32_t) + BLOSC_MAX_OVERHEAD);
+  blosc2_free_ctx(cctx);
+  mu_assert("ERROR: cannot compress", cbytes > 0);
+
+  blosc2_dparams dparams = BLOSC2_DPARAMS_DEFAULTS;
+  dparams.nthreads = (int16_t)nthreads;
+  blosc2_schunk *schunk = NULL;
+  bool needs_free = false;
+  if (lazy) {
+    // Only the blocks with the items are read from the frame
+    blosc2_storage storage = {.sequential=true, .path=FILENAME, .cparams=&cparams};
+    schunk = blosc2_schunk_new(storage);
+    mu_assert("ERROR: cannot append the chunk", blosc2_schunk_append_chunk(schunk, chunk, true) == 1);
+    cbytes = blosc2_schunk_get_lazychunk(schunk, 0, &src, &needs_free);
+    mu_assert("ERROR: cannot get the lazy chunk", cbytes > 0 && needs_free);
+    dparams.schunk = schunk;
+  }
+  blosc2_context *dctx = blosc2_create_dctx(dparams);
+  // Within a block, across blocks, aligned to blocks, and up to the end of the chunk
+  int ranges[][2] = {{0, 1}, {5, 17}, {1000, 1100}, {1000, 9000}, {1024, 3072},
+                     {2999, 3001}, {12345, 54321}, {0, NITEMS}, {NITEMS - 3, NITEMS}};
+  for (size_t n = 0; n < sizeof(ranges) / sizeof(ranges[0]); n++) {
+    int start = ranges[n][0];
+    int nitems = ranges[n][1] - start;
+    memset(items, 0xff, (size_t)(nitems + 1) * sizeof(int32_t));
+    int nbytes = blosc2_getitem_ctx(dctx, src, cbytes, start, nitems, items);
+    mu_assert("ERROR: bad number of bytes", nbytes == nitems * (int)sizeof(int32_t));
+    mu_assert("ERROR: bad items", memcmp(items, data + start, (size_t)nbytes) == 0);
+    mu_assert("ERROR: items past the range are set", items[nitems] == -1);
+  }
+  // Out of bounds
+  mu_assert("ERROR: a range past the end is accepted",
+            blosc2_getitem_ctx(dctx, src, cbytes, NITEMS - 10, 11, items) < 0);
+  mu_assert("ERROR: a negative start is accepted",
+            blosc2_getitem_ctx(dctx, src, cbytes, -1, 10, items) < 0);
+  // The context should still be good for regular decompression
+  int nbytes = blosc2_decompress_ctx(dctx, src, cbytes, items, NITEMS * sizeof(int32_t));
+  mu_assert("ERROR: cannot decompress", nbytes == NITEMS * sizeof(int32_t));
+  mu_assert("ERROR: bad decompression", memcmp(items, data, (size_t)nbytes) == 0);
+  blosc2_free_ctx(dctx);
+  if (lazy) {
+    free(src);
+    blosc2_schunk_free(schunk);
+    remove(FILENAME);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+static char *all_tests(void) {
+  uint8_t filters[] = {BLOSC_NOFILTER, BLOSC_SHUFFLE, BLOSC_BITSHUFFLE, BLOSC_DELTA};
+  for (nthreads = 1; nthreads <= 4; nthreads *= 4) {
+    for (int i = 0; i < 4; i++) {
+      filter = filters[i];
+      for (clevel = 0; clevel <= 5; clevel += 5) {
+        lazy = false;
+        with_runs = false;
+        mu_run_test(test_getitem_ctx);
+        with_runs = true;
+        mu_run_test(test_getitem_ctx);
+        lazy = true;
+        mu_run_test(test_getitem_ctx);
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+#define BUFFER_ALIGN_SIZE   32
+
+int main(void) {
+  char *result;
+
+  data = blosc_test_malloc(BUFFER_ALIGN_SIZE, NITEMS * sizeof(int32_t));
+  items = blosc_test_malloc(BUFFER_ALIGN_SIZE, (NITEMS + 1) * sizeof(int32_t));
+  chunk = blosc_test_malloc(BUFFER_ALIGN_SIZE, NITEMS * sizeof(int32_t) + BLOSC_MAX_OVERHEAD);
+
+  install_blosc_callback_test(); /* optionally install callback test */
+  blosc_init();
+
+  /* Run all the suite */
+  result = all_tests();
+  if (result != EXIT_SUCCESS) {
+    printf(" (%s)\n", result);
+  }
+  else {
+    printf(" ALL TESTS PASSED");
+  }
+  printf("\tTests run: %d\n", tests_run);
+
+  blosc_test_free(data);
+  blosc_test_free(items);
+  blosc_test_free(chunk);
+  blosc_destroy();
+
+  return result != EXIT_SUCCESS;
+}
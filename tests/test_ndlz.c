@@ -0,0 +1,227 @@
+/*
+  Copyright (C) 2020- The Blosc Development Team <blosc@blosc.org>
+  http://blosc.org
+  License: BSD (see LICENSE.txt)
+
+  See LICENSE.txt for details about copyright and rights to use.
+
+  Test for the NDLZ codec on 2-dim and 3-dim data.
+*/
+
+#include <stdio.h>
+#include "test_common.h"
+
+#define MAX_ITEMS (60 * 45 * 30)
+#define LEFTOVER_ITEMS (3 * 32 * 32 + 250)
+
+typedef struct {
+  int8_t ndim;
+  int64_t shape[3];
+  int32_t chunkshape[3];
+  int32_t blockshape[3];
+} test_shapes;
+
+/* Global vars */
+int tests_run = 0;
+int nthreads;
+int typesize;
+uint8_t filter;
+test_shapes shapes;
+
+uint8_t *data;
+uint8_t *data_dest;
+uint8_t *data_out;
+
+
+/* Items with patches of repeated values, some noise, and some runs */
+static void fill_data(int64_t nitems, int64_t ncols) {
+  for (int64_t i = 0; i < nitems; i++) {
+    int64_t row = i / ncols;
+    int64_t col = i % ncols;
+    int64_t value = (row / 8 % 5) * 1000 + (col / 4 % 7) * 10;
+    if (row % 11 == 3) {
+      value += (i * 7919) % 13;
+    }
+    if (col > ncols / 2) {
+      value = 42;
+    }
+    switch (typesize) {
+      case 1:
+        data[i] = (uint8_t)value;
+        break;
+      case 2:
+        ((int16_t*)data)[i] = (int16_t)value;
+        break;
+      default:
+        ((int32_t*)data)[i] = (int32_t)value;
+    }
+  }
+}
+
+
+static char* test_ndarray(void) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.compcode = BLOSC_NDLZ;
+  cparams.typesize = typesize;
+  cparams.filters[BLOSC2_MAX_FILTERS - 1] = filter;
+  cparams.nthreads = (int16_t)nthreads;
+  cparams.ndim = shapes.ndim;
+  int64_t nitems = 1;
+  for (int i = 0; i < shapes.ndim; i++) {
+    cparams.shape[i] = shapes.shape[i];
+    cparams.chunkshape[i] = shapes.chunkshape[i];
+    cparams.blockshape[i] = shapes.blockshape[i];
+    nitems *= shapes.shape[i];
+  }
+  blosc2_dparams dparams = BLOSC2_DPARAMS_DEFAULTS;
+  dparams.nthreads = nthreads;
+  blosc2_storage storage = {.cparams=&cparams, .dparams=&dparams};
+  blosc2_schunk* schunk = blosc2_schunk_new(storage);
+  mu_assert("ERROR: cannot create the super-chunk", schunk != NULL);
+
+  fill_data(nitems, shapes.shape[shapes.ndim - 1]);
+  int nchunks = blosc2_schunk_set_ndarray(schunk, data, nitems * typesize);
+  mu_assert("ERROR: cannot fill the super-chunk", nchunks > 0);
+  mu_assert("ERROR: the data is not compressed", schunk->cbytes < schunk->nbytes / 2);
+
+  uint8_t* chunk;
+  bool needs_free;
+  blosc2_schunk_get_chunk(schunk, 0, &chunk, &needs_free);
+  mu_assert("ERROR: the chunk is not compressed with NDLZ",
+            blosc_cbuffer_complib(chunk) != NULL &&
+            strcmp(blosc_cbuffer_complib(chunk), BLOSC_NDLZ_LIBNAME) == 0);
+  if (needs_free) {
+    free(chunk);
+  }
+
+  int64_t start[3] = {0, 0, 0};
+  int64_t stop[3];
+  for (int i = 0; i < shapes.ndim; i++) {
+    stop[i] = shapes.shape[i];
+  }
+  int64_t nbytes = blosc2_schunk_get_hyperslab(schunk, start, stop, data_dest);
+  mu_assert("ERROR: cannot get the array", nbytes == nitems * typesize);
+  mu_assert("ERROR: bad roundtrip", memcmp(data, data_dest, (size_t)nbytes) == 0);
+
+  blosc2_schunk_free(schunk);
+  return EXIT_SUCCESS;
+}
+
+
+static char* test_leftover(void) {
+  // Blocks of 32x32 items, plus a leftover block
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.compcode = BLOSC_NDLZ;
+  cparams.typesize = typesize;
+  cparams.filters[BLOSC2_MAX_FILTERS - 1] = filter;
+  cparams.nthreads = (int16_t)nthreads;
+  cparams.ndim = 2;
+  cparams.blockshape[0] = 32;
+  cparams.blockshape[1] = 32;
+  blosc2_dparams dparams = BLOSC2_DPARAMS_DEFAULTS;
+  dparams.nthreads = nthreads;
+  int32_t srcsize = LEFTOVER_ITEMS * typesize;
+  int32_t destsize = srcsize + BLOSC_MAX_OVERHEAD;
+
+  fill_data(LEFTOVER_ITEMS, 32);
+  blosc2_context* cctx = blosc2_create_cctx(cparams);
+  int csize = blosc2_compress_ctx(cctx, data, srcsize, data_out, destsize);
+  blosc2_free_ctx(cctx);
+  mu_assert("ERROR: cannot compress", csize > 0 && csize < srcsize);
+  size_t blocksize;
+  blosc_cbuffer_sizes(data_out, &(size_t){0}, &(size_t){0}, &blocksize);
+  mu_assert("ERROR: bad blocksize", blocksize == (size_t)(32 * 32 * typesize));
+
+  blosc2_context* dctx = blosc2_create_dctx(dparams);
+  int dsize = blosc2_decompress_ctx(dctx, data_out, csize, data_dest, srcsize);
+  mu_assert("ERROR: cannot decompress", dsize == srcsize);
+  mu_assert("ERROR: bad roundtrip", memcmp(data, data_dest, (size_t)srcsize) == 0);
+
+  // The codec does not need a shape
+  cparams.ndim = 0;
+  cparams.blocksize = 3000;
+  cctx = blosc2_create_cctx(cparams);
+  csize = blosc2_compress_ctx(cctx, data, srcsize, data_out, destsize);
+  blosc2_free_ctx(cctx);
+  mu_assert("ERROR: cannot compress", csize > 0);
+  dsize = blosc2_decompress_ctx(dctx, data_out, csize, data_dest, srcsize);
+  mu_assert("ERROR: cannot decompress", dsize == srcsize);
+  mu_assert("ERROR: bad roundtrip", memcmp(data, data_dest, (size_t)srcsize) == 0);
+
+  blosc2_free_ctx(dctx);
+  return EXIT_SUCCESS;
+}
+
+
+static char* test_compname(void) {
+  const char* compname;
+  mu_assert("ERROR: bad compname", blosc_compcode_to_compname(BLOSC_NDLZ, &compname) == BLOSC_NDLZ &&
+            strcmp(compname, BLOSC_NDLZ_COMPNAME) == 0);
+  mu_assert("ERROR: bad compcode", blosc_compname_to_compcode(BLOSC_NDLZ_COMPNAME) == BLOSC_NDLZ);
+  mu_assert("ERROR: NDLZ is not listed", strstr(blosc_list_compressors(), BLOSC_NDLZ_COMPNAME) != NULL);
+  char* complib;
+  char* version;
+  mu_assert("ERROR: bad complib", blosc_get_complib_info(BLOSC_NDLZ_COMPNAME, &complib, &version) ==
+            BLOSC_NDLZ_LIB);
+  mu_assert("ERROR: bad complib name", strcmp(complib, BLOSC_NDLZ_LIBNAME) == 0);
+  free(complib);
+  free(version);
+  return EXIT_SUCCESS;
+}
+
+
+static char *all_tests(void) {
+  test_shapes all_shapes[] = {
+    {2, {60, 45}, {40, 45}, {20, 16}},
+    {3, {60, 45, 30}, {30, 20, 30}, {10, 9, 12}},
+  };
+  int typesizes[] = {1, 2, 4};
+  uint8_t filters[] = {BLOSC_NOFILTER, BLOSC_SHUFFLE};
+  for (int i = 0; i < 3; i++) {
+    typesize = typesizes[i];
+    for (int j = 0; j < 2; j++) {
+      filter = filters[j];
+      for (nthreads = 1; nthreads <= 4; nthreads += 3) {
+        for (int n = 0; n < 2; n++) {
+          shapes = all_shapes[n];
+          mu_run_test(test_ndarray);
+        }
+        mu_run_test(test_leftover);
+      }
+    }
+  }
+  mu_run_test(test_compname);
+
+  return EXIT_SUCCESS;
+}
+
+
+#define BUFFER_ALIGN_SIZE   32
+
+int main(void) {
+  char *result;
+
+  data = blosc_test_malloc(BUFFER_ALIGN_SIZE, MAX_ITEMS * sizeof(int32_t));
+  data_dest = blosc_test_malloc(BUFFER_ALIGN_SIZE, MAX_ITEMS * sizeof(int32_t));
+  data_out = blosc_test_malloc(BUFFER_ALIGN_SIZE, MAX_ITEMS * sizeof(int32_t) + BLOSC_MAX_OVERHEAD);
+
+  install_blosc_callback_test(); /* optionally install callback test */
+  blosc_init();
+
+  /* Run all the suite */
+  result = all_tests();
+  if (result != EXIT_SUCCESS) {
+    printf(" (%s)\n", result);
+  }
+  else {
+    printf(" ALL TESTS PASSED");
+  }
+  printf("\tTests run: %d\n", tests_run);
+
+  blosc_test_free(data);
+  blosc_test_free(data_dest);
+  blosc_test_free(data_out);
+  blosc_destroy();
+
+  return result != EXIT_SUCCESS;
+}
@@ -0,0 +1,192 @@
+/*
+  Copyright (C) 2020  The Blosc Developers
+  http://blosc.org
+  License: BSD (see LICENSE.txt)
+
+*/
+
+#include "test_common.h"
+
+int tests_run = 0;
+
+#define SIZE 500 * 1000
+#define NTHREADS 2
+
+typedef struct {
+    int32_t factor;
+    int64_t sums[NTHREADS];  // one per thread
+    int nblocks;
+} test_postparams;
+
+// Global vars
+blosc2_cparams cparams;
+blosc2_dparams dparams;
+blosc2_context *cctx, *dctx;
+static int32_t data[SIZE];
+static int32_t data_out[SIZE + BLOSC_MAX_OVERHEAD / sizeof(int32_t)];
+static int32_t data_dest[SIZE];
+size_t isize = SIZE * sizeof(int32_t);
+size_t osize = SIZE * sizeof(int32_t) + BLOSC_MAX_OVERHEAD;
+int dsize = SIZE * sizeof(int32_t);
+int csize;
+
+
+int scale_func(blosc2_postfilter_params *postparams) {
+  test_postparams *tpostparams = postparams->user_data;
+  int nelems = postparams->size / postparams->typesize;
+  const int32_t *in = (const int32_t*)postparams->in;
+  int32_t *out = (int32_t*)postparams->out;
+  for (int i = 0; i < nelems; i++) {
+    out[i] = in[i] * tpostparams->factor;
+  }
+  return 0;
+}
+
+
+int sum_func(blosc2_postfilter_params *postparams) {
+  test_postparams *tpostparams = postparams->user_data;
+  int nelems = postparams->size / postparams->typesize;
+  const int32_t *in = (const int32_t*)postparams->in;
+  int64_t sum = 0;
+  for (int i = 0; i < nelems; i++) {
+    sum += in[i];
+  }
+  // Nothing is written into the destination
+  tpostparams->sums[postparams->tid] += sum;
+  return 0;
+}
+
+
+static char *test_scale(void) {
+  cctx = blosc2_create_cctx(cparams);
+  csize = blosc2_compress_ctx(cctx, data, isize, data_out, osize);
+  mu_assert("Compression error", csize > 0);
+
+  // We need to zero the contents of the postparams
+  blosc2_postfilter_params postparams = {0};
+  test_postparams tpostparams = {0};
+  tpostparams.factor = 3;
+  postparams.user_data = (void*)&tpostparams;
+  dparams.postfilter = (blosc2_postfilter_fn)scale_func;
+  dparams.postparams = &postparams;
+  dctx = blosc2_create_dctx(dparams);
+
+  dsize = blosc2_decompress_ctx(dctx, data_out, csize, data_dest, (size_t)dsize);
+  mu_assert("Decompression error", dsize == (int)isize);
+  for (int i = 0; i < SIZE; i++) {
+    mu_assert("Postfiltered data differs from expected!", data_dest[i] == data[i] * 3);
+  }
+
+  /* Free resources */
+  blosc2_free_ctx(cctx);
+  blosc2_free_ctx(dctx);
+
+  return 0;
+}
+
+
+static char *test_sum(void) {
+  cctx = blosc2_create_cctx(cparams);
+  csize = blosc2_compress_ctx(cctx, data, isize, data_out, osize);
+  mu_assert("Compression error", csize > 0);
+
+  blosc2_postfilter_params postparams = {0};
+  test_postparams tpostparams = {0};
+  postparams.user_data = (void*)&tpostparams;
+  dparams.postfilter = (blosc2_postfilter_fn)sum_func;
+  dparams.postparams = &postparams;
+  dctx = blosc2_create_dctx(dparams);
+
+  for (int i = 0; i < SIZE; i++) {
+    data_dest[i] = -1;
+  }
+  dsize = blosc2_decompress_ctx(dctx, data_out, csize, data_dest, (size_t)dsize);
+  mu_assert("Decompression error", dsize == (int)isize);
+  int64_t sum = 0;
+  for (int tid = 0; tid < NTHREADS; tid++) {
+    sum += tpostparams.sums[tid];
+  }
+  mu_assert("Bad sum", sum == (int64_t)SIZE * (SIZE - 1) / 2);
+  for (int i = 0; i < SIZE; i++) {
+    mu_assert("The destination has been written", data_dest[i] == -1);
+  }
+
+  /* Free resources */
+  blosc2_free_ctx(cctx);
+  blosc2_free_ctx(dctx);
+
+  return 0;
+}
+
+
+static char *test_delta(void) {
+  blosc2_cparams cparams_delta = cparams;
+  cparams_delta.filters[0] = BLOSC_DELTA;
+  cctx = blosc2_create_cctx(cparams_delta);
+  csize = blosc2_compress_ctx(cctx, data, isize, data_out, osize);
+  mu_assert("Compression error", csize > 0);
+
+  blosc2_postfilter_params postparams = {0};
+  test_postparams tpostparams = {0};
+  tpostparams.factor = 1;
+  postparams.user_data = (void*)&tpostparams;
+  dparams.postfilter = (blosc2_postfilter_fn)scale_func;
+  dparams.postparams = &postparams;
+  dctx = blosc2_create_dctx(dparams);
+
+  int rc = blosc2_decompress_ctx(dctx, data_out, csize, data_dest, (size_t)dsize);
+  mu_assert("The postfilter is accepted with the delta filter", rc < 0);
+
+  /* Free resources */
+  blosc2_free_ctx(cctx);
+  blosc2_free_ctx(dctx);
+
+  return 0;
+}
+
+
+static char *all_tests(void) {
+  // Check with an assortment of clevels and nthreads (clevel 0 gives memcpyed chunks)
+  int clevels[] = {0, 5, 9};
+  for (int i = 0; i < 3; i++) {
+    cparams.clevel = (uint8_t)clevels[i];
+    for (int nthreads = 1; nthreads <= NTHREADS; nthreads++) {
+      cparams.nthreads = (int16_t)nthreads;
+      dparams.nthreads = nthreads;
+      mu_run_test(test_scale);
+      mu_run_test(test_sum);
+    }
+  }
+  mu_run_test(test_delta);
+
+  return 0;
+}
+
+
+int main(void) {
+  /* Initialize inputs */
+  for (int i = 0; i < SIZE; i++) {
+    data[i] = i;
+  }
+
+  install_blosc_callback_test(); /* optionally install callback test */
+
+  /* Create a context for compression */
+  cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  cparams.compcode = BLOSC_BLOSCLZ;
+  cparams.filters[BLOSC2_MAX_FILTERS - 1] = BLOSC_SHUFFLE;
+  dparams = BLOSC2_DPARAMS_DEFAULTS;
+
+  /* Run all the suite */
+  char* result = all_tests();
+  if (result != 0) {
+    printf(" (%s)\n", result);
+  }
+  else {
+    printf(" ALL TESTS PASSED");
+  }
+  printf("\tTests run: %d\n", tests_run);
+
+  return result != 0;
+}
@@ -0,0 +1,164 @@
+/*
+  Copyright (C) 2020- The Blosc Development Team <blosc@blosc.org>
+  http://blosc.org
+  License: BSD (see LICENSE.txt)
+
+  See LICENSE.txt for details about copyright and rights to use.
+
+  Test for appending chunks to super-chunks with background compression.
+*/
+
+#include <stdio.h>
+#include <unistd.h>
+#include "test_common.h"
+
+#define CHUNKSIZE (5 * 1000)
+#define NCHUNKS (200)
+
+/* Global vars */
+int tests_run = 0;
+bool sequential;
+bool checksums;
+int nthreads;
+int nqueued;
+char* filename;
+char shm_name[64];
+
+int32_t *data;
+int32_t *data_dest;
+
+
+static char* test_appender(void) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  blosc2_storage storage = {.sequential=sequential, .path=filename, .checksums=checksums};
+  blosc2_schunk* schunk = blosc_test_new_schunk(storage, cparams, 1);
+  mu_assert("ERROR: cannot create the super-chunk", schunk != NULL);
+  blosc2_schunk_appender* appender = blosc2_schunk_appender_new(schunk, nthreads, nqueued);
+  mu_assert("ERROR: cannot create the appender", appender != NULL);
+
+  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+    // The buffer is reused right away
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      data[i] = i + nchunk * CHUNKSIZE;
+    }
+    int nchunks = blosc2_schunk_appender_push(appender, data, CHUNKSIZE * sizeof(int32_t));
+    mu_assert("ERROR: bad number of chunks", nchunks == nchunk + 1);
+    if (nchunk == NCHUNKS / 2) {
+      mu_assert("ERROR: cannot flush", blosc2_schunk_appender_flush(appender) == nchunk + 1);
+      mu_assert("ERROR: the chunks are not there after a flush", schunk->nchunks == nchunk + 1);
+    }
+  }
+  mu_assert("ERROR: cannot free the appender", blosc2_schunk_appender_free(appender) == NCHUNKS);
+
+  // The chunks should be in order
+  mu_assert("ERROR: bad number of chunks", schunk->nchunks == NCHUNKS);
+  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+    int dsize = blosc2_schunk_decompress_chunk(schunk, nchunk, data_dest, CHUNKSIZE * sizeof(int32_t));
+    mu_assert("ERROR: cannot decompress", dsize == CHUNKSIZE * sizeof(int32_t));
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      mu_assert("ERROR: bad roundtrip", data_dest[i] == i + nchunk * CHUNKSIZE);
+    }
+  }
+  if (checksums) {
+    mu_assert("ERROR: the frame does not verify", blosc2_schunk_verify(schunk) == 0);
+  }
+
+  blosc2_schunk_free(schunk);
+  if (filename != NULL) {
+    remove(filename);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+static char* test_errors(void) {
+  // A frame in a small shared memory segment runs out of room after a few chunks
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  blosc2_storage storage = {.cparams=&cparams, .checksums=checksums};
+  blosc2_schunk* schunk = blosc2_schunk_new_shm(shm_name, 64 * 1024, storage);
+  mu_assert("ERROR: cannot create the super-chunk", schunk != NULL);
+  blosc2_schunk_appender* appender = blosc2_schunk_appender_new(schunk, nthreads, nqueued);
+  for (int nchunk = 0; nchunk < 100; nchunk++) {
+    // Use data that does not compress well
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      data[i] = (int32_t)((i + nchunk) * 2654435761U);
+    }
+    blosc2_schunk_appender_push(appender, data, CHUNKSIZE * sizeof(int32_t));
+  }
+  mu_assert("ERROR: the error is not reported", blosc2_schunk_appender_flush(appender) < 0);
+  mu_assert("ERROR: the error is not sticky",
+            blosc2_schunk_appender_push(appender, data, CHUNKSIZE * sizeof(int32_t)) < 0);
+  mu_assert("ERROR: the error is not reported", blosc2_schunk_appender_free(appender) < 0);
+
+  // There are no holes
+  int nchunks = schunk->nchunks;
+  mu_assert("ERROR: bad number of chunks", nchunks > 0 && nchunks < 100);
+  for (int nchunk = 0; nchunk < nchunks; nchunk++) {
+    int dsize = blosc2_schunk_decompress_chunk(schunk, nchunk, data_dest, CHUNKSIZE * sizeof(int32_t));
+    mu_assert("ERROR: cannot decompress a chunk", dsize == CHUNKSIZE * sizeof(int32_t));
+    mu_assert("ERROR: bad roundtrip", data_dest[0] == (int32_t)(nchunk * 2654435761U));
+  }
+
+  blosc2_schunk_free(schunk);
+  blosc2_unlink_shm(shm_name);
+
+  return EXIT_SUCCESS;
+}
+
+
+static char *all_tests(void) {
+  char* filenames[] = {NULL, NULL, "test_schunk_appender.b2frame"};
+  bool sequentials[] = {false, true, true};
+  int nthreads_[] = {1, 4};
+  int nqueued_[] = {1, 16};
+  for (int i = 0; i < 3; i++) {
+    sequential = sequentials[i];
+    filename = filenames[i];
+    checksums = sequential;
+    for (int j = 0; j < 2; j++) {
+      nthreads = nthreads_[j];
+      for (int k = 0; k < 2; k++) {
+        nqueued = nqueued_[k];
+        mu_run_test(test_appender);
+      }
+      mu_run_test(test_errors);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+#define BUFFER_ALIGN_SIZE   32
+
+int main(void) {
+  char *result;
+
+  // Tests may run in parallel
+  snprintf(shm_name, sizeof(shm_name), "/test_schunk_appender.%d", (int)getpid());
+
+  data = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(int32_t));
+  data_dest = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(int32_t));
+
+  install_blosc_callback_test(); /* optionally install callback test */
+  blosc_init();
+
+  /* Run all the suite */
+  result = all_tests();
+  if (result != EXIT_SUCCESS) {
+    printf(" (%s)\n", result);
+  }
+  else {
+    printf(" ALL TESTS PASSED");
+  }
+  printf("\tTests run: %d\n", tests_run);
+
+  blosc_test_free(data);
+  blosc_test_free(data_dest);
+  blosc_destroy();
+
+  return result != EXIT_SUCCESS;
+}
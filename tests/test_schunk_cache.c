@@ -0,0 +1,219 @@
+/*
+  Copyright (C) 2020- The Blosc Development Team <blosc@blosc.org>
+  http://blosc.org
+  License: BSD (see LICENSE.txt)
+
+  See LICENSE.txt for details about copyright and rights to use.
+
+  Test for the cache of decompressed chunks in super-chunks.
+*/
+
+#include <stdio.h>
+#include "test_common.h"
+#include "config.h"
+
+#define CHUNKSIZE (20 * 1000)
+#define NCHUNKS (10)
+#define CACHED_CHUNKS (3)
+
+/* Global vars */
+int tests_run = 0;
+bool sequential;
+char* filename;
+
+int32_t *data;
+int32_t *data_dest;
+
+
+static blosc2_schunk* new_schunk(int64_t cache_size) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  blosc2_storage storage = {.sequential=sequential, .path=filename, .cache_size=cache_size};
+  blosc2_schunk* schunk = blosc_test_new_schunk(storage, cparams, 1);
+  if (schunk == NULL || blosc_test_append_seq(schunk, data, 0, NCHUNKS, CHUNKSIZE, CHUNKSIZE) < 0) {
+    return NULL;
+  }
+  return schunk;
+}
+
+
+static bool check_chunk(blosc2_schunk* schunk, int nchunk, int expected) {
+  int dsize = blosc2_schunk_decompress_chunk(schunk, nchunk, data_dest, CHUNKSIZE * sizeof(int32_t));
+  if (dsize != CHUNKSIZE * sizeof(int32_t)) {
+    return false;
+  }
+  for (int i = 0; i < CHUNKSIZE; i++) {
+    if (data_dest[i] != i + expected * CHUNKSIZE) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+static char* test_lru(void) {
+  int64_t hits, misses;
+  blosc2_schunk* schunk = new_schunk(CACHED_CHUNKS * CHUNKSIZE * sizeof(int32_t));
+  mu_assert("ERROR: cannot get the stats", blosc2_schunk_cache_stats(schunk, &hits, &misses) == 0);
+  mu_assert("ERROR: bad initial stats", hits == 0 && misses == 0);
+
+  // A working set that fits in the cache only misses the first time
+  for (int round = 0; round < 4; round++) {
+    for (int nchunk = 0; nchunk < CACHED_CHUNKS; nchunk++) {
+      mu_assert("ERROR: bad roundtrip", check_chunk(schunk, nchunk, nchunk));
+    }
+  }
+  blosc2_schunk_cache_stats(schunk, &hits, &misses);
+  mu_assert("ERROR: bad misses", misses == CACHED_CHUNKS);
+  mu_assert("ERROR: bad hits", hits == 3 * CACHED_CHUNKS);
+
+  // Using chunk 0 makes 1 the least recently used one, so it is evicted by chunk 3
+  mu_assert("ERROR: bad roundtrip", check_chunk(schunk, 0, 0));
+  mu_assert("ERROR: bad roundtrip", check_chunk(schunk, 3, 3));
+  mu_assert("ERROR: bad roundtrip", check_chunk(schunk, 0, 0));
+  mu_assert("ERROR: bad roundtrip", check_chunk(schunk, 2, 2));
+  blosc2_schunk_cache_stats(schunk, &hits, &misses);
+  mu_assert("ERROR: bad misses after eviction", misses == CACHED_CHUNKS + 1);
+  mu_assert("ERROR: bad roundtrip", check_chunk(schunk, 1, 1));
+  blosc2_schunk_cache_stats(schunk, &hits, &misses);
+  mu_assert("ERROR: the least recently used chunk is not evicted", misses == CACHED_CHUNKS + 2);
+
+  // A buffer that is too small should fail even if the chunk is cached
+  int dsize = blosc2_schunk_decompress_chunk(schunk, 1, data_dest, CHUNKSIZE);
+  mu_assert("ERROR: a small buffer is accepted", dsize < 0);
+
+  blosc2_schunk_free(schunk);
+
+  // Super-chunks do not have a cache by default
+  schunk = new_schunk(0);
+  mu_assert("ERROR: there is a cache", blosc2_schunk_cache_stats(schunk, &hits, &misses) < 0);
+  mu_assert("ERROR: bad roundtrip", check_chunk(schunk, 1, 1));
+  blosc2_schunk_free(schunk);
+
+  return EXIT_SUCCESS;
+}
+
+
+static char* test_invalidation(void) {
+  if (sequential) {
+    // Chunks cannot be updated or inserted in frames yet
+    return EXIT_SUCCESS;
+  }
+  blosc2_schunk* schunk = new_schunk(NCHUNKS * CHUNKSIZE * sizeof(int32_t));
+  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+    mu_assert("ERROR: bad roundtrip", check_chunk(schunk, nchunk, nchunk));
+  }
+
+  // Replace chunk 2 with the contents of chunk 7
+  for (int i = 0; i < CHUNKSIZE; i++) {
+    data[i] = i + 7 * CHUNKSIZE;
+  }
+  uint8_t* chunk = malloc(CHUNKSIZE * sizeof(int32_t) + BLOSC_MAX_OVERHEAD);
+  int cbytes = blosc2_compress_ctx(schunk->cctx, data, CHUNKSIZE * sizeof(int32_t), chunk,
+                                   CHUNKSIZE * sizeof(int32_t) + BLOSC_MAX_OVERHEAD);
+  mu_assert("ERROR: cannot compress", cbytes > 0);
+  mu_assert("ERROR: cannot update", blosc2_schunk_update_chunk(schunk, 2, chunk, true) == NCHUNKS);
+  mu_assert("ERROR: the updated chunk is not seen", check_chunk(schunk, 2, 7));
+  mu_assert("ERROR: bad roundtrip", check_chunk(schunk, 3, 3));
+
+  // Insert it in position 0, so that the rest of the chunks are shifted
+  mu_assert("ERROR: cannot insert", blosc2_schunk_insert_chunk(schunk, 0, chunk, true) == NCHUNKS + 1);
+  mu_assert("ERROR: the inserted chunk is not seen", check_chunk(schunk, 0, 7));
+  mu_assert("ERROR: the shifted chunks are not seen", check_chunk(schunk, 1, 0));
+  mu_assert("ERROR: the shifted chunks are not seen", check_chunk(schunk, 4, 3));
+  free(chunk);
+
+  // Reordering the chunks invalidates the cache too
+  int offsets_order[NCHUNKS + 1];
+  for (int i = 0; i < NCHUNKS + 1; ++i) {
+    offsets_order[i] = (i + 1) % (NCHUNKS + 1);
+  }
+  mu_assert("ERROR: cannot reorder", blosc2_schunk_reorder_offsets(schunk, offsets_order) >= 0);
+  mu_assert("ERROR: the reordered chunks are not seen", check_chunk(schunk, 0, 0));
+
+  blosc2_schunk_free(schunk);
+
+  return EXIT_SUCCESS;
+}
+
+
+static char* test_frame_changes(void) {
+  if (filename == NULL) {
+    return EXIT_SUCCESS;
+  }
+  blosc2_schunk* writer = new_schunk(0);
+  blosc2_storage storage = {.sequential=true, .path=filename,
+                            .cache_size=NCHUNKS * CHUNKSIZE * sizeof(int32_t)};
+  blosc2_schunk* reader = blosc2_schunk_open(storage);
+  mu_assert("ERROR: cannot open the frame", reader != NULL);
+  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+    mu_assert("ERROR: bad roundtrip", check_chunk(reader, nchunk, nchunk));
+  }
+
+  // Changes made through another super-chunk invalidate the cache
+  int offsets_order[NCHUNKS];
+  for (int i = 0; i < NCHUNKS; ++i) {
+    offsets_order[i] = (i + 3) % NCHUNKS;
+  }
+  mu_assert("ERROR: cannot reorder", blosc2_schunk_reorder_offsets(writer, offsets_order) >= 0);
+  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+    mu_assert("ERROR: the reordered chunks are not seen",
+              check_chunk(reader, nchunk, offsets_order[nchunk]));
+  }
+
+  blosc2_schunk_free(reader);
+  blosc2_schunk_free(writer);
+
+  return EXIT_SUCCESS;
+}
+
+
+static char *all_tests(void) {
+  sequential = false;
+  filename = NULL;
+  mu_run_test(test_lru);
+  mu_run_test(test_invalidation);
+
+  sequential = true;
+  filename = NULL;
+  mu_run_test(test_lru);
+
+  sequential = true;
+  filename = "test_schunk_cache.b2frame";
+  mu_run_test(test_lru);
+#if defined(HAVE_FRAME_LOCKS)
+  // Changes from other super-chunks are only noticed when frames are locked
+  mu_run_test(test_frame_changes);
+#endif
+
+  return EXIT_SUCCESS;
+}
+
+
+#define BUFFER_ALIGN_SIZE   32
+
+int main(void) {
+  char *result;
+
+  data = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(int32_t));
+  data_dest = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(int32_t));
+
+  install_blosc_callback_test(); /* optionally install callback test */
+  blosc_init();
+
+  /* Run all the suite */
+  result = all_tests();
+  if (result != EXIT_SUCCESS) {
+    printf(" (%s)\n", result);
+  }
+  else {
+    printf(" ALL TESTS PASSED");
+  }
+  printf("\tTests run: %d\n", tests_run);
+
+  blosc_test_free(data);
+  blosc_test_free(data_dest);
+  blosc_destroy();
+
+  return result != EXIT_SUCCESS;
+}
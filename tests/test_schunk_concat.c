@@ -0,0 +1,203 @@
+/*
+  Copyright (C) 2020- The Blosc Development Team <blosc@blosc.org>
+  http://blosc.org
+  License: BSD (see LICENSE.txt)
+
+  See LICENSE.txt for details about copyright and rights to use.
+
+  Test for concatenating super-chunks.
+*/
+
+#include <stdio.h>
+#include "test_common.h"
+
+#define CHUNKSIZE (5 * 1000)
+#define NCHUNKS_DEST (10)
+#define NCHUNKS_SRC (100)   // more than a batch of chunks
+
+/* Global vars */
+int tests_run = 0;
+bool dest_sequential;
+char* dest_filename;
+bool src_sequential;
+char* src_filename;
+bool checksums;
+int nthreads;
+
+int32_t *data;
+int32_t *data_dest;
+
+
+static blosc2_schunk* new_schunk(bool sequential, char* filename, int compcode, int32_t blocksize,
+                                 int start, int nchunks, int32_t last_nitems) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  cparams.compcode = (uint8_t)compcode;
+  cparams.blocksize = blocksize;
+  blosc2_storage storage = {.sequential=sequential, .path=filename, .checksums=checksums};
+  blosc2_schunk* schunk = blosc_test_new_schunk(storage, cparams, nthreads);
+  if (schunk == NULL ||
+      blosc_test_append_seq(schunk, data, (int64_t)start * CHUNKSIZE, nchunks, CHUNKSIZE, last_nitems) < 0) {
+    return NULL;
+  }
+  return schunk;
+}
+
+
+static bool check_chunk(blosc2_schunk* schunk, int nchunk, int expected, int32_t nitems) {
+  int dsize = blosc2_schunk_decompress_chunk(schunk, nchunk, data_dest, CHUNKSIZE * sizeof(int32_t));
+  if (dsize != nitems * (int)sizeof(int32_t)) {
+    return false;
+  }
+  for (int i = 0; i < nitems; i++) {
+    if (data_dest[i] != expected * CHUNKSIZE + i) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+static char* test_concat(int src_compcode, int32_t src_blocksize) {
+  blosc2_schunk* dest = new_schunk(dest_sequential, dest_filename, BLOSC_BLOSCLZ, 0, 0,
+                                   NCHUNKS_DEST, CHUNKSIZE);
+  mu_assert("ERROR: cannot create the destination", dest != NULL);
+  blosc2_schunk* src = new_schunk(src_sequential, src_filename, src_compcode, src_blocksize,
+                                  NCHUNKS_DEST, NCHUNKS_SRC, CHUNKSIZE / 2);
+  mu_assert("ERROR: cannot create the source", src != NULL);
+  int64_t nbytes = dest->nbytes + src->nbytes;
+
+  int nchunks = blosc2_schunk_concat(dest, src);
+  mu_assert("ERROR: cannot concatenate", nchunks == NCHUNKS_DEST + NCHUNKS_SRC);
+  mu_assert("ERROR: bad number of chunks", dest->nchunks == nchunks);
+  mu_assert("ERROR: bad nbytes", dest->nbytes == nbytes);
+  // Only the last chunk is shorter
+  mu_assert("ERROR: bad chunksize", dest->chunksize == CHUNKSIZE * sizeof(int32_t));
+  mu_assert("ERROR: the source has been modified", src->nchunks == NCHUNKS_SRC);
+
+  for (int nchunk = 0; nchunk < NCHUNKS_SRC; nchunk++) {
+    int32_t nitems = nchunk < NCHUNKS_SRC - 1 ? CHUNKSIZE : CHUNKSIZE / 2;
+    mu_assert("ERROR: bad roundtrip",
+              check_chunk(dest, NCHUNKS_DEST + nchunk, NCHUNKS_DEST + nchunk, nitems));
+    // Chunks with the same compression parameters are copied as-is
+    uint8_t *chunk1, *chunk2;
+    bool needs_free1, needs_free2;
+    int cbytes1 = blosc2_schunk_get_chunk(src, nchunk, &chunk1, &needs_free1);
+    int cbytes2 = blosc2_schunk_get_chunk(dest, NCHUNKS_DEST + nchunk, &chunk2, &needs_free2);
+    bool same = cbytes1 == cbytes2 && memcmp(chunk1, chunk2, (size_t)cbytes1) == 0;
+    if (needs_free1) {
+      free(chunk1);
+    }
+    if (needs_free2) {
+      free(chunk2);
+    }
+    mu_assert("ERROR: chunks are not copied as-is",
+              same == (src_compcode == BLOSC_BLOSCLZ && src_blocksize == 0));
+  }
+  mu_assert("ERROR: bad roundtrip", check_chunk(dest, 0, 0, CHUNKSIZE));
+  if (checksums) {
+    mu_assert("ERROR: the destination does not verify", blosc2_schunk_verify(dest) == 0);
+  }
+
+  if (dest_filename != NULL) {
+    blosc2_schunk_free(dest);
+    blosc2_storage storage = {.sequential=true, .path=dest_filename};
+    dest = blosc2_schunk_open(storage);
+    mu_assert("ERROR: cannot open the frame", dest != NULL);
+    mu_assert("ERROR: bad number of chunks", dest->nchunks == NCHUNKS_DEST + NCHUNKS_SRC);
+    mu_assert("ERROR: bad roundtrip",
+              check_chunk(dest, NCHUNKS_DEST + NCHUNKS_SRC - 1, NCHUNKS_DEST + NCHUNKS_SRC - 1,
+                          CHUNKSIZE / 2));
+  }
+
+  // A short chunk that is not the last one anymore makes the chunks variable-length
+  mu_assert("ERROR: cannot concatenate", blosc2_schunk_concat(dest, src) == NCHUNKS_DEST + 2 * NCHUNKS_SRC);
+  mu_assert("ERROR: bad chunksize", dest->chunksize == 0);
+  int64_t start = (NCHUNKS_DEST + NCHUNKS_SRC) * (int64_t)CHUNKSIZE - CHUNKSIZE / 2 - 10;
+  int64_t nbytes_slice = blosc2_schunk_get_slice(dest, start, start + 20, data_dest);
+  mu_assert("ERROR: cannot get a slice", nbytes_slice == 20 * sizeof(int32_t));
+  mu_assert("ERROR: bad slice", data_dest[9] == (NCHUNKS_DEST + NCHUNKS_SRC - 1) * CHUNKSIZE + CHUNKSIZE / 2 - 1);
+  mu_assert("ERROR: bad slice", data_dest[10] == NCHUNKS_DEST * CHUNKSIZE);
+
+  mu_assert("ERROR: a super-chunk is concatenated to itself", blosc2_schunk_concat(dest, dest) < 0);
+
+  blosc2_schunk_free(dest);
+  blosc2_schunk_free(src);
+  if (dest_filename != NULL) {
+    remove(dest_filename);
+  }
+  if (src_filename != NULL) {
+    remove(src_filename);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+static char* test_transplant(void) {
+  return test_concat(BLOSC_BLOSCLZ, 0);
+}
+
+
+static char* test_recompress(void) {
+  return test_concat(BLOSC_LZ4, 0);
+}
+
+
+static char* test_reblock(void) {
+  // Chunks with other blocks are recompressed too
+  return test_concat(BLOSC_BLOSCLZ, 1024);
+}
+
+
+static char *all_tests(void) {
+  bool sequentials[] = {false, true, true};
+  char* filenames[] = {NULL, NULL, "test_schunk_concat_dest.b2frame"};
+  int nthreads_[] = {1, 4};
+  for (int i = 0; i < 3; i++) {
+    dest_sequential = sequentials[i];
+    dest_filename = filenames[i];
+    for (int j = 0; j < 3; j += 2) {
+      src_sequential = sequentials[j];
+      src_filename = j == 2 ? "test_schunk_concat_src.b2frame" : NULL;
+      for (int k = 0; k < 2; k++) {
+        nthreads = nthreads_[k];
+        checksums = k == 1;
+        mu_run_test(test_transplant);
+        mu_run_test(test_recompress);
+        mu_run_test(test_reblock);
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+#define BUFFER_ALIGN_SIZE   32
+
+int main(void) {
+  char *result;
+
+  data = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(int32_t));
+  data_dest = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(int32_t));
+
+  install_blosc_callback_test(); /* optionally install callback test */
+  blosc_init();
+
+  /* Run all the suite */
+  result = all_tests();
+  if (result != EXIT_SUCCESS) {
+    printf(" (%s)\n", result);
+  }
+  else {
+    printf(" ALL TESTS PASSED");
+  }
+  printf("\tTests run: %d\n", tests_run);
+
+  blosc_test_free(data);
+  blosc_test_free(data_dest);
+  blosc_destroy();
+
+  return result != EXIT_SUCCESS;
+}
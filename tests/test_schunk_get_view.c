@@ -0,0 +1,120 @@
+/*
+  Copyright (C) 2020- The Blosc Development Team <blosc@blosc.org>
+  http://blosc.org
+  License: BSD (see LICENSE.txt)
+
+  See LICENSE.txt for details about copyright and rights to use.
+
+  Test for getting (zero-copy) views of the chunks of super-chunks.
+*/
+
+#include <stdio.h>
+#include "test_common.h"
+
+#define CHUNKSIZE (50 * 1000)
+#define NCHUNKS (5)
+
+/* Global vars */
+int tests_run = 0;
+bool sequential;
+char* filename;
+int clevel;
+bool checksums;
+
+int32_t *data;
+
+
+static char* test_get_view(void) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  cparams.clevel = (uint8_t)clevel;
+  blosc2_storage storage = {.sequential=sequential, .path=filename, .cparams=&cparams,
+                            .checksums=checksums};
+  blosc2_schunk* schunk = blosc2_schunk_new(storage);
+  mu_assert("ERROR: cannot create the super-chunk", schunk != NULL);
+  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      data[i] = nchunk * CHUNKSIZE + i;
+    }
+    int rc = blosc2_schunk_append_buffer(schunk, data, CHUNKSIZE * sizeof(int32_t));
+    mu_assert("ERROR: cannot append a chunk", rc == nchunk + 1);
+  }
+
+  // Only memcpyed chunks in memory can be viewed in place
+  bool in_place = clevel == 0 && filename == NULL;
+  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+    uint8_t *view;
+    bool needs_free;
+    int nbytes = blosc2_schunk_get_view(schunk, nchunk, &view, &needs_free);
+    mu_assert("ERROR: cannot get a view", nbytes == CHUNKSIZE * sizeof(int32_t));
+    mu_assert("ERROR: the view is not in place", needs_free != in_place);
+    int32_t *items = (int32_t*)view;
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      mu_assert("ERROR: bad view", items[i] == nchunk * CHUNKSIZE + i);
+    }
+    if (in_place) {
+      uint8_t *chunk;
+      bool chunk_needs_free;
+      blosc2_schunk_get_chunk(schunk, nchunk, &chunk, &chunk_needs_free);
+      mu_assert("ERROR: the view is not in the chunk", view == chunk + BLOSC_MAX_OVERHEAD);
+    }
+    if (needs_free) {
+      free(view);
+    }
+  }
+
+  uint8_t *view;
+  bool needs_free;
+  mu_assert("ERROR: a chunk out of the super-chunk is viewed",
+            blosc2_schunk_get_view(schunk, NCHUNKS, &view, &needs_free) < 0);
+
+  blosc2_schunk_free(schunk);
+  if (filename != NULL) {
+    remove(filename);
+  }
+  return EXIT_SUCCESS;
+}
+
+
+static char *all_tests(void) {
+  bool sequentials[] = {false, true, true};
+  for (int i = 0; i < 3; i++) {
+    sequential = sequentials[i];
+    filename = i == 2 ? "test_schunk_get_view.b2frame" : NULL;
+    for (clevel = 0; clevel <= 5; clevel += 5) {
+      for (int j = 0; j < 2; j++) {
+        checksums = j == 1;
+        mu_run_test(test_get_view);
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+#define BUFFER_ALIGN_SIZE   32
+
+int main(void) {
+  char *result;
+
+  data = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(int32_t));
+
+  install_blosc_callback_test(); /* optionally install callback test */
+  blosc_init();
+
+  /* Run all the suite */
+  result = all_tests();
+  if (result != EXIT_SUCCESS) {
+    printf(" (%s)\n", result);
+  }
+  else {
+    printf(" ALL TESTS PASSED");
+  }
+  printf("\tTests run: %d\n", tests_run);
+
+  blosc_test_free(data);
+  blosc_destroy();
+
+  return result != EXIT_SUCCESS;
+}
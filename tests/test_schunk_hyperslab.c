@@ -0,0 +1,274 @@
+/*
+  Copyright (C) 2020- The Blosc Development Team <blosc@blosc.org>
+  http://blosc.org
+  License: BSD (see LICENSE.txt)
+
+  See LICENSE.txt for details about copyright and rights to use.
+
+  Test for n-dimensional super-chunks and their hyperslabs.
+*/
+
+#include <stdio.h>
+#include "test_common.h"
+
+#define MAX_ITEMS (50 * 37 * 23)
+
+typedef struct {
+  int8_t ndim;
+  int64_t shape[BLOSC2_MAX_DIM];
+  int32_t chunkshape[BLOSC2_MAX_DIM];
+  int32_t blockshape[BLOSC2_MAX_DIM];
+} test_shapes;
+
+/* Global vars */
+int tests_run = 0;
+bool sequential;
+char* filename;
+int nthreads;
+test_shapes shapes;
+
+int32_t *data;
+int32_t *slab;
+
+
+static blosc2_schunk* new_schunk(void) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  cparams.ndim = shapes.ndim;
+  for (int i = 0; i < shapes.ndim && i < BLOSC2_MAX_DIM; i++) {
+    cparams.shape[i] = shapes.shape[i];
+    cparams.chunkshape[i] = shapes.chunkshape[i];
+    cparams.blockshape[i] = shapes.blockshape[i];
+  }
+  blosc2_storage storage = {.sequential=sequential, .path=filename};
+  return blosc_test_new_schunk(storage, cparams, nthreads);
+}
+
+
+/* Check a hyperslab against the items of the array (which are their C-order indices) */
+static char* check_hyperslab(blosc2_schunk* schunk, const int64_t* start, const int64_t* stop) {
+  int64_t nitems = 1;
+  for (int i = 0; i < shapes.ndim; i++) {
+    nitems *= stop[i] - start[i];
+  }
+  int64_t nbytes = blosc2_schunk_get_hyperslab(schunk, start, stop, slab);
+  mu_assert("ERROR: cannot get the hyperslab", nbytes == nitems * (int64_t)sizeof(int32_t));
+
+  int64_t index[BLOSC2_MAX_DIM];
+  for (int i = 0; i < shapes.ndim; i++) {
+    index[i] = start[i];
+  }
+  for (int64_t n = 0; n < nitems; n++) {
+    int64_t item = 0;
+    for (int i = 0; i < shapes.ndim; i++) {
+      item = item * shapes.shape[i] + index[i];
+    }
+    mu_assert("ERROR: bad item in the hyperslab", slab[n] == data[item]);
+    for (int i = shapes.ndim - 1; i >= 0; i--) {
+      if (++index[i] < stop[i]) {
+        break;
+      }
+      index[i] = start[i];
+    }
+  }
+  return EXIT_SUCCESS;
+}
+
+
+static char* check_hyperslabs(blosc2_schunk* schunk) {
+  int8_t ndim = shapes.ndim;
+  int64_t start[BLOSC2_MAX_DIM];
+  int64_t stop[BLOSC2_MAX_DIM];
+  char* result;
+
+  // The whole array
+  for (int i = 0; i < ndim; i++) {
+    start[i] = 0;
+    stop[i] = shapes.shape[i];
+  }
+  result = check_hyperslab(schunk, start, stop);
+  if (result != EXIT_SUCCESS) {
+    return result;
+  }
+  // Thin slices across every dimension
+  for (int dim = 0; dim < ndim; dim++) {
+    for (int i = 0; i < ndim; i++) {
+      start[i] = i == dim ? shapes.shape[i] / 2 + 1 : 0;
+      stop[i] = i == dim ? start[i] + 1 : shapes.shape[i];
+    }
+    result = check_hyperslab(schunk, start, stop);
+    if (result != EXIT_SUCCESS) {
+      return result;
+    }
+  }
+  // Boxes that cross chunks and blocks, up to the (padded) edges
+  for (int i = 0; i < ndim; i++) {
+    start[i] = shapes.blockshape[i] - 1;
+    stop[i] = shapes.shape[i] - 1;
+  }
+  result = check_hyperslab(schunk, start, stop);
+  if (result != EXIT_SUCCESS) {
+    return result;
+  }
+  for (int i = 0; i < ndim; i++) {
+    start[i] = shapes.shape[i] - 3;
+    stop[i] = shapes.shape[i];
+  }
+  result = check_hyperslab(schunk, start, stop);
+  if (result != EXIT_SUCCESS) {
+    return result;
+  }
+  // A single item, and no item at all
+  for (int i = 0; i < ndim; i++) {
+    start[i] = shapes.chunkshape[i];
+    stop[i] = start[i] + 1;
+  }
+  result = check_hyperslab(schunk, start, stop);
+  if (result != EXIT_SUCCESS) {
+    return result;
+  }
+  stop[0] = start[0];
+  mu_assert("ERROR: an empty hyperslab has items",
+            blosc2_schunk_get_hyperslab(schunk, start, stop, slab) == 0);
+
+  // Out of the shape
+  stop[0] = shapes.shape[0] + 1;
+  mu_assert("ERROR: a hyperslab out of the shape is accepted",
+            blosc2_schunk_get_hyperslab(schunk, start, stop, slab) < 0);
+  return EXIT_SUCCESS;
+}
+
+
+static char* test_hyperslab(void) {
+  int64_t nitems = 1;
+  for (int i = 0; i < shapes.ndim; i++) {
+    nitems *= shapes.shape[i];
+  }
+  for (int64_t i = 0; i < nitems; i++) {
+    data[i] = (int32_t)i;
+  }
+  blosc2_schunk* schunk = new_schunk();
+  mu_assert("ERROR: cannot create the super-chunk", schunk != NULL);
+  mu_assert("ERROR: the metalayer is missing",
+            blosc2_has_metalayer(schunk, BLOSC2_NDIM_METALAYER) >= 0);
+  mu_assert("ERROR: a bad size is accepted",
+            blosc2_schunk_set_ndarray(schunk, data, (nitems - 1) * sizeof(int32_t)) < 0);
+  int nchunks = blosc2_schunk_set_ndarray(schunk, data, nitems * sizeof(int32_t));
+  int64_t expected = 1;
+  for (int i = 0; i < shapes.ndim; i++) {
+    expected *= (shapes.shape[i] + shapes.chunkshape[i] - 1) / shapes.chunkshape[i];
+  }
+  mu_assert("ERROR: bad number of chunks", nchunks == expected);
+  mu_assert("ERROR: a non-empty super-chunk is filled",
+            blosc2_schunk_set_ndarray(schunk, data, nitems * sizeof(int32_t)) < 0);
+
+  char* result = check_hyperslabs(schunk);
+  if (result != EXIT_SUCCESS) {
+    return result;
+  }
+
+  if (filename != NULL) {
+    // The shapes are recovered from the metalayer of the frame
+    blosc2_schunk_free(schunk);
+    blosc2_storage storage = {.sequential=true, .path=filename};
+    schunk = blosc2_schunk_open(storage);
+    mu_assert("ERROR: cannot open the frame", schunk != NULL);
+    blosc2_cparams* cparams;
+    blosc2_schunk_get_cparams(schunk, &cparams);
+    mu_assert("ERROR: bad ndim", cparams->ndim == shapes.ndim);
+    for (int i = 0; i < shapes.ndim; i++) {
+      mu_assert("ERROR: bad shapes", cparams->shape[i] == shapes.shape[i] &&
+                cparams->chunkshape[i] == shapes.chunkshape[i] &&
+                cparams->blockshape[i] == shapes.blockshape[i]);
+    }
+    free(cparams);
+    result = check_hyperslabs(schunk);
+    if (result != EXIT_SUCCESS) {
+      return result;
+    }
+  }
+
+  blosc2_schunk_free(schunk);
+  if (filename != NULL) {
+    remove(filename);
+  }
+  return EXIT_SUCCESS;
+}
+
+
+static char* test_bad_shapes(void) {
+  // Blocks cannot be larger than chunks
+  test_shapes good = shapes;
+  shapes.blockshape[0] = shapes.chunkshape[0] + 1;
+  mu_assert("ERROR: a bad blockshape is accepted", new_schunk() == NULL);
+  shapes = good;
+  shapes.ndim = BLOSC2_MAX_DIM + 1;
+  mu_assert("ERROR: a bad ndim is accepted", new_schunk() == NULL);
+  shapes = good;
+
+  // Plain super-chunks have no shape
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  blosc2_storage storage = {.cparams=&cparams};
+  blosc2_schunk* schunk = blosc2_schunk_new(storage);
+  int64_t start[1] = {0};
+  int64_t stop[1] = {1};
+  mu_assert("ERROR: a plain super-chunk has a hyperslab",
+            blosc2_schunk_get_hyperslab(schunk, start, stop, slab) < 0);
+  blosc2_schunk_free(schunk);
+  return EXIT_SUCCESS;
+}
+
+
+static char *all_tests(void) {
+  test_shapes all_shapes[] = {
+    {1, {1000}, {300}, {64}},
+    {2, {50, 37}, {20, 16}, {20, 5}},
+    {3, {50, 37, 23}, {20, 16, 10}, {7, 8, 5}},
+  };
+  for (int n = 0; n < 3; n++) {
+    shapes = all_shapes[n];
+    bool sequentials[] = {false, true, true};
+    for (int i = 0; i < 3; i++) {
+      sequential = sequentials[i];
+      filename = i == 2 ? "test_schunk_hyperslab.b2frame" : NULL;
+      for (nthreads = 1; nthreads <= 4; nthreads += 3) {
+        mu_run_test(test_hyperslab);
+      }
+    }
+  }
+  filename = NULL;
+  sequential = false;
+  mu_run_test(test_bad_shapes);
+
+  return EXIT_SUCCESS;
+}
+
+
+#define BUFFER_ALIGN_SIZE   32
+
+int main(void) {
+  char *result;
+
+  data = blosc_test_malloc(BUFFER_ALIGN_SIZE, MAX_ITEMS * sizeof(int32_t));
+  slab = blosc_test_malloc(BUFFER_ALIGN_SIZE, MAX_ITEMS * sizeof(int32_t));
+
+  install_blosc_callback_test(); /* optionally install callback test */
+  blosc_init();
+
+  /* Run all the suite */
+  result = all_tests();
+  if (result != EXIT_SUCCESS) {
+    printf(" (%s)\n", result);
+  }
+  else {
+    printf(" ALL TESTS PASSED");
+  }
+  printf("\tTests run: %d\n", tests_run);
+
+  blosc_test_free(data);
+  blosc_test_free(slab);
+  blosc_destroy();
+
+  return result != EXIT_SUCCESS;
+}
@@ -0,0 +1,220 @@
+/*
+  Copyright (C) 2020- The Blosc Development Team <blosc@blosc.org>
+  http://blosc.org
+  License: BSD (see LICENSE.txt)
+
+  See LICENSE.txt for details about copyright and rights to use.
+*/
+
+#include <stdio.h>
+#include "test_common.h"
+
+#define CHUNKSIZE (50 * 1000)
+#define NTHREADS (2)
+
+/* Global vars */
+int tests_run = 0;
+int nchunks;
+int prefetch;
+bool sequential;
+bool checksums;
+char* filename;
+
+int32_t *data;
+int32_t *data_dest;
+
+
+static char* test_schunk_iter(void) {
+  size_t isize = CHUNKSIZE * sizeof(int32_t);
+  int dsize;
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  blosc2_dparams dparams = BLOSC2_DPARAMS_DEFAULTS;
+  blosc2_schunk* schunk;
+
+  /* Initialize the Blosc compressor */
+  blosc_init();
+
+  /* Create a super-chunk container */
+  cparams.typesize = sizeof(int32_t);
+  cparams.nthreads = NTHREADS;
+  dparams.nthreads = NTHREADS;
+  blosc2_storage storage = {.sequential=sequential, .path=filename, .cparams=&cparams,
+                            .dparams=&dparams, .checksums=checksums};
+  schunk = blosc2_schunk_new(storage);
+
+  // Feed it with data
+  for (int nchunk = 0; nchunk < nchunks; nchunk++) {
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      data[i] = i + nchunk * CHUNKSIZE;
+    }
+    int nchunks_ = blosc2_schunk_append_buffer(schunk, data, isize);
+    mu_assert("ERROR: bad append", nchunks_ > 0);
+  }
+  if (filename != NULL) {
+    blosc2_schunk_free(schunk);
+    schunk = blosc2_schunk_open(storage);
+  }
+
+  // Iterate over the whole super-chunk
+  blosc2_schunk_iter* iter = blosc2_schunk_iter_new(schunk, prefetch);
+  mu_assert("ERROR: cannot create the iterator", iter != NULL);
+  int nchunk;
+  for (int n = 0; n < nchunks; n++) {
+    dsize = blosc2_schunk_iter_next(iter, &nchunk, data_dest, isize);
+    mu_assert("ERROR: chunk cannot be decompressed correctly", dsize == (int)isize);
+    mu_assert("ERROR: chunks are not returned in order", nchunk == n);
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      mu_assert("ERROR: bad roundtrip", data_dest[i] == i + nchunk * CHUNKSIZE);
+    }
+  }
+  dsize = blosc2_schunk_iter_next(iter, &nchunk, data_dest, isize);
+  mu_assert("ERROR: iteration is not exhausted", dsize == 0 && nchunk == -1);
+  blosc2_schunk_iter_free(iter);
+
+  // Stop an iteration before reaching the end
+  iter = blosc2_schunk_iter_new(schunk, prefetch);
+  mu_assert("ERROR: cannot create the iterator", iter != NULL);
+  dsize = blosc2_schunk_iter_next(iter, &nchunk, data_dest, isize);
+  mu_assert("ERROR: chunk cannot be decompressed correctly", dsize == (int)isize);
+  mu_assert("ERROR: bad roundtrip", data_dest[1] == 1);
+  blosc2_schunk_iter_free(iter);
+
+  // A too small destination should be detected
+  iter = blosc2_schunk_iter_new(schunk, prefetch);
+  dsize = blosc2_schunk_iter_next(iter, &nchunk, data_dest, isize - 1);
+  mu_assert("ERROR: a too small buffer is not detected", dsize < 0);
+  blosc2_schunk_iter_free(iter);
+
+  /* Free resources */
+  blosc2_schunk_free(schunk);
+  /* Destroy the Blosc environment */
+  blosc_destroy();
+
+  return EXIT_SUCCESS;
+}
+
+
+static char* test_schunk_iter_corrupt(void) {
+  size_t isize = CHUNKSIZE * sizeof(int32_t);
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  blosc2_dparams dparams = BLOSC2_DPARAMS_DEFAULTS;
+  char* fname = "test_schunk_iter_corrupt.b2frame";
+
+  blosc_init();
+
+  /* Create a file frame with 3 chunks */
+  cparams.typesize = sizeof(int32_t);
+  blosc2_storage storage = {.sequential=true, .path=fname, .cparams=&cparams, .dparams=&dparams};
+  blosc2_schunk* schunk = blosc2_schunk_new(storage);
+  for (int nchunk = 0; nchunk < 3; nchunk++) {
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      data[i] = i + nchunk * CHUNKSIZE;
+    }
+    mu_assert("ERROR: bad append", blosc2_schunk_append_buffer(schunk, data, isize) == nchunk + 1);
+  }
+  uint8_t* chunk;
+  bool needs_free;
+  int cbytes = blosc2_schunk_get_chunk(schunk, 1, &chunk, &needs_free);
+  mu_assert("ERROR: cannot get the chunk", cbytes > 0);
+  blosc2_schunk_free(schunk);
+
+  /* Zero the cbytes of the second chunk in the file */
+  FILE* fp = fopen(fname, "rb+");
+  fseek(fp, 0, SEEK_END);
+  long flen = ftell(fp);
+  uint8_t* fdata = malloc((size_t)flen);
+  fseek(fp, 0, SEEK_SET);
+  mu_assert("ERROR: cannot read the frame", fread(fdata, 1, (size_t)flen, fp) == (size_t)flen);
+  long offset = -1;
+  for (long i = 0; i + cbytes <= flen; i++) {
+    if (memcmp(fdata + i, chunk, (size_t)cbytes) == 0) {
+      offset = i;
+      break;
+    }
+  }
+  free(fdata);
+  if (needs_free) {
+    free(chunk);
+  }
+  mu_assert("ERROR: cannot find the chunk in the frame", offset >= 0);
+  int32_t zero = 0;
+  fseek(fp, offset + BLOSC2_CHUNK_CBYTES, SEEK_SET);
+  fwrite(&zero, 1, sizeof(zero), fp);
+  fclose(fp);
+
+  /* The error is reported, and the iteration does not hang afterwards */
+  schunk = blosc2_schunk_open(storage);
+  mu_assert("ERROR: cannot open the frame", schunk != NULL);
+  blosc2_schunk_iter* iter = blosc2_schunk_iter_new(schunk, 2);
+  mu_assert("ERROR: cannot create the iterator", iter != NULL);
+  int nchunk;
+  int dsize = blosc2_schunk_iter_next(iter, &nchunk, data_dest, isize);
+  mu_assert("ERROR: chunk cannot be decompressed correctly", dsize == (int)isize && nchunk == 0);
+  dsize = blosc2_schunk_iter_next(iter, &nchunk, data_dest, isize);
+  mu_assert("ERROR: the corrupt chunk is not detected", dsize < 0 && nchunk == 1);
+  dsize = blosc2_schunk_iter_next(iter, &nchunk, data_dest, isize);
+  mu_assert("ERROR: the iteration goes on after an error", dsize < 0);
+  blosc2_schunk_iter_free(iter);
+
+  blosc2_schunk_free(schunk);
+  remove(fname);
+  blosc_destroy();
+
+  return EXIT_SUCCESS;
+}
+
+
+static char *all_tests(void) {
+  int prefetches[] = {0, 1, 3, 100};
+  nchunks = 10;
+
+  for (int i = 0; i < (int)(sizeof(prefetches) / sizeof(int)); i++) {
+    prefetch = prefetches[i];
+    checksums = (i % 2 == 1);
+
+    sequential = false;
+    filename = NULL;
+    mu_run_test(test_schunk_iter);
+
+    sequential = true;
+    filename = NULL;
+    mu_run_test(test_schunk_iter);
+
+    sequential = true;
+    filename = "test_schunk_iter.b2frame";
+    mu_run_test(test_schunk_iter);
+  }
+
+  mu_run_test(test_schunk_iter_corrupt);
+
+  return EXIT_SUCCESS;
+}
+
+
+#define BUFFER_ALIGN_SIZE   32
+
+int main(void) {
+  char *result;
+
+  data = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(int32_t));
+  data_dest = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(int32_t));
+
+  install_blosc_callback_test(); /* optionally install callback test */
+  blosc_init();
+
+  /* Run all the suite */
+  result = all_tests();
+  if (result != EXIT_SUCCESS) {
+    printf(" (%s)\n", result);
+  }
+  else {
+    printf(" ALL TESTS PASSED");
+  }
+  printf("\tTests run: %d\n", tests_run);
+
+  blosc_test_free(data);
+  blosc_test_free(data_dest);
+  blosc_destroy();
+
+  return result != EXIT_SUCCESS;
+}
@@ -0,0 +1,230 @@
+/*
+  Copyright (C) 2020- The Blosc Development Team <blosc@blosc.org>
+  http://blosc.org
+  License: BSD (see LICENSE.txt)
+
+  See LICENSE.txt for details about copyright and rights to use.
+
+  Test for recompressing super-chunks with different compression parameters.
+*/
+
+#include <stdio.h>
+#include "test_common.h"
+
+#define CHUNKSIZE (5 * 1000)
+#define NCHUNKS (100)
+#define ODD_CHUNK (7)   // compressed with a different codec
+
+/* Global vars */
+int tests_run = 0;
+bool src_sequential;
+char* src_filename;
+bool dest_sequential;
+char* dest_filename;
+int nthreads;
+
+int32_t *data;
+int32_t *data_dest;
+uint8_t metalayer[] = {1, 2, 3, 4, 5};
+char usermeta[] = "{\"name\": \"temperature\"}";
+
+
+static blosc2_schunk* new_schunk(void) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  cparams.compcode = BLOSC_BLOSCLZ;
+  cparams.clevel = 5;
+  blosc2_storage storage = {.sequential=src_sequential, .path=src_filename};
+  blosc2_schunk* schunk = blosc_test_new_schunk(storage, cparams, 1);
+  if (schunk == NULL || blosc2_add_metalayer(schunk, "layer", metalayer, sizeof(metalayer)) < 0) {
+    return NULL;
+  }
+
+  // A chunk compressed elsewhere, with other parameters
+  cparams.compcode = BLOSC_LZ4;
+  blosc2_context *cctx = blosc2_create_cctx(cparams);
+  uint8_t *chunk = malloc(CHUNKSIZE * sizeof(int32_t) + BLOSC_MAX_OVERHEAD);
+  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      data[i] = nchunk * CHUNKSIZE + i;
+    }
+    int rc;
+    if (nchunk == ODD_CHUNK) {
+      int cbytes = blosc2_compress_ctx(cctx, data, CHUNKSIZE * sizeof(int32_t), chunk,
+                                       CHUNKSIZE * sizeof(int32_t) + BLOSC_MAX_OVERHEAD);
+      rc = cbytes < 0 ? cbytes : blosc2_schunk_append_chunk(schunk, chunk, true);
+    }
+    else {
+      rc = blosc2_schunk_append_buffer(schunk, data, CHUNKSIZE * sizeof(int32_t));
+    }
+    if (rc != nchunk + 1) {
+      return NULL;
+    }
+  }
+  free(chunk);
+  blosc2_free_ctx(cctx);
+
+  if (blosc2_update_usermeta(schunk, (uint8_t*)usermeta, sizeof(usermeta), BLOSC2_CPARAMS_DEFAULTS) < 0) {
+    return NULL;
+  }
+  return schunk;
+}
+
+
+static bool same_chunk(blosc2_schunk* schunk1, blosc2_schunk* schunk2, int nchunk) {
+  uint8_t *chunk1, *chunk2;
+  bool needs_free1, needs_free2;
+  int cbytes1 = blosc2_schunk_get_chunk(schunk1, nchunk, &chunk1, &needs_free1);
+  int cbytes2 = blosc2_schunk_get_chunk(schunk2, nchunk, &chunk2, &needs_free2);
+  bool same = cbytes1 == cbytes2 && memcmp(chunk1, chunk2, (size_t)cbytes1) == 0;
+  if (needs_free1) {
+    free(chunk1);
+  }
+  if (needs_free2) {
+    free(chunk2);
+  }
+  return same;
+}
+
+
+static char* check_schunk(blosc2_schunk* schunk, int compcode) {
+  mu_assert("ERROR: bad number of chunks", schunk->nchunks == NCHUNKS);
+  mu_assert("ERROR: bad nbytes", schunk->nbytes == NCHUNKS * CHUNKSIZE * sizeof(int32_t));
+  mu_assert("ERROR: bad codec", schunk->compcode == compcode);
+  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+    int dsize = blosc2_schunk_decompress_chunk(schunk, nchunk, data_dest, CHUNKSIZE * sizeof(int32_t));
+    mu_assert("ERROR: cannot decompress", dsize == CHUNKSIZE * sizeof(int32_t));
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      mu_assert("ERROR: bad roundtrip", data_dest[i] == nchunk * CHUNKSIZE + i);
+    }
+  }
+
+  uint8_t* content;
+  uint32_t content_len;
+  mu_assert("ERROR: the metalayer is missing",
+            blosc2_get_metalayer(schunk, "layer", &content, &content_len) >= 0);
+  mu_assert("ERROR: bad metalayer",
+            content_len == sizeof(metalayer) && memcmp(content, metalayer, sizeof(metalayer)) == 0);
+  free(content);
+  int32_t usermeta_len = blosc2_get_usermeta(schunk, &content);
+  mu_assert("ERROR: bad usermeta",
+            usermeta_len == sizeof(usermeta) && memcmp(content, usermeta, sizeof(usermeta)) == 0);
+  free(content);
+
+  return EXIT_SUCCESS;
+}
+
+
+static char* test_recompress(void) {
+  blosc2_schunk* src = new_schunk();
+  mu_assert("ERROR: cannot create the source", src != NULL);
+
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  cparams.compcode = BLOSC_ZSTD;
+  cparams.clevel = 7;
+  cparams.nthreads = (int16_t)nthreads;
+  blosc2_storage storage = {.sequential=dest_sequential, .path=dest_filename};
+  blosc2_schunk* dest = blosc2_schunk_recompress(src, cparams, storage);
+  mu_assert("ERROR: cannot recompress", dest != NULL);
+  char* result = check_schunk(dest, BLOSC_ZSTD);
+  if (result != EXIT_SUCCESS) {
+    return result;
+  }
+  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+    mu_assert("ERROR: a chunk has not been recompressed", !same_chunk(src, dest, nchunk));
+  }
+  if (dest_filename != NULL) {
+    blosc2_schunk_free(dest);
+    storage.sequential = true;
+    dest = blosc2_schunk_open(storage);
+    mu_assert("ERROR: cannot open the frame", dest != NULL);
+    result = check_schunk(dest, BLOSC_ZSTD);
+    if (result != EXIT_SUCCESS) {
+      return result;
+    }
+  }
+  blosc2_schunk_free(dest);
+
+  // Only the chunks that are not compressed with the target parameters are recompressed
+  cparams.compcode = BLOSC_BLOSCLZ;
+  cparams.clevel = 5;
+  dest = blosc2_schunk_recompress(src, cparams, storage);
+  mu_assert("ERROR: cannot recompress", dest != NULL);
+  result = check_schunk(dest, BLOSC_BLOSCLZ);
+  if (result != EXIT_SUCCESS) {
+    return result;
+  }
+  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+    mu_assert("ERROR: a chunk has been recompressed or not",
+              same_chunk(src, dest, nchunk) == (nchunk != ODD_CHUNK));
+  }
+  blosc2_schunk_free(dest);
+
+  // The compression level is not in the chunks, but it has to be honored as well
+  cparams.clevel = 9;
+  dest = blosc2_schunk_recompress(src, cparams, storage);
+  mu_assert("ERROR: cannot recompress", dest != NULL);
+  mu_assert("ERROR: bad clevel", dest->clevel == 9);
+  mu_assert("ERROR: a chunk has not been recompressed", !same_chunk(src, dest, 0));
+  blosc2_schunk_free(dest);
+
+  blosc2_schunk_free(src);
+  if (src_filename != NULL) {
+    remove(src_filename);
+  }
+  if (dest_filename != NULL) {
+    remove(dest_filename);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+static char *all_tests(void) {
+  bool sequentials[] = {false, true, true};
+  int nthreads_[] = {1, 4};
+  for (int i = 0; i < 3; i++) {
+    src_sequential = sequentials[i];
+    src_filename = i == 2 ? "test_schunk_recompress_src.b2frame" : NULL;
+    for (int j = 0; j < 3; j++) {
+      dest_sequential = sequentials[j];
+      dest_filename = j == 2 ? "test_schunk_recompress_dest.b2frame" : NULL;
+      for (int k = 0; k < 2; k++) {
+        nthreads = nthreads_[k];
+        mu_run_test(test_recompress);
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+#define BUFFER_ALIGN_SIZE   32
+
+int main(void) {
+  char *result;
+
+  data = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(int32_t));
+  data_dest = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(int32_t));
+
+  install_blosc_callback_test(); /* optionally install callback test */
+  blosc_init();
+
+  /* Run all the suite */
+  result = all_tests();
+  if (result != EXIT_SUCCESS) {
+    printf(" (%s)\n", result);
+  }
+  else {
+    printf(" ALL TESTS PASSED");
+  }
+  printf("\tTests run: %d\n", tests_run);
+
+  blosc_test_free(data);
+  blosc_test_free(data_dest);
+  blosc_destroy();
+
+  return result != EXIT_SUCCESS;
+}
@@ -0,0 +1,223 @@
+/*
+  Copyright (C) 2020- The Blosc Development Team <blosc@blosc.org>
+  http://blosc.org
+  License: BSD (see LICENSE.txt)
+
+  See LICENSE.txt for details about copyright and rights to use.
+
+  Test for reducing super-chunks (sum, min, max and count).
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include "test_common.h"
+
+#define CHUNKSIZE (30 * 1000)
+#define NCHUNKS (8)
+
+/* Global vars */
+int tests_run = 0;
+bool sequential;
+char* filename;
+int nthreads;
+bool zonemaps;
+bool delta;
+uint8_t type;
+
+uint8_t *data;
+
+
+static int32_t get_typesize(void) {
+  switch (type) {
+    case BLOSC2_ZONEMAP_INT8:
+      return 1;
+    case BLOSC2_ZONEMAP_INT16:
+      return 2;
+    case BLOSC2_ZONEMAP_INT32:
+    case BLOSC2_ZONEMAP_FLOAT32:
+      return 4;
+    default:
+      return 8;
+  }
+}
+
+
+/* The items are integers (so that the sums are exact), with a NaN every now and then */
+static double get_item(int64_t i) {
+  if (type >= BLOSC2_ZONEMAP_FLOAT32 && i % 97 == 0) {
+    return NAN;
+  }
+  if (type <= BLOSC2_ZONEMAP_INT16) {
+    return (double)(i % 200 - 100);
+  }
+  return (double)((i * 7) % 100003 - 20000);
+}
+
+
+static void set_item(uint8_t *buffer, int i, double value) {
+  switch (type) {
+    case BLOSC2_ZONEMAP_INT8:
+      ((int8_t*)buffer)[i] = (int8_t)value;
+      break;
+    case BLOSC2_ZONEMAP_INT16:
+      ((int16_t*)buffer)[i] = (int16_t)value;
+      break;
+    case BLOSC2_ZONEMAP_INT32:
+      ((int32_t*)buffer)[i] = (int32_t)value;
+      break;
+    case BLOSC2_ZONEMAP_INT64:
+      ((int64_t*)buffer)[i] = (int64_t)value;
+      break;
+    case BLOSC2_ZONEMAP_FLOAT32:
+      ((float*)buffer)[i] = (float)value;
+      break;
+    default:
+      ((double*)buffer)[i] = value;
+  }
+}
+
+
+static char* test_reduce(void) {
+  int32_t typesize = get_typesize();
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = typesize;
+  cparams.blocksize = 8 * 1024;
+  cparams.nthreads = (int16_t)nthreads;
+  cparams.zonemap_type = zonemaps ? type : (uint8_t)BLOSC2_ZONEMAP_NONE;
+  if (delta) {
+    cparams.filters[BLOSC2_MAX_FILTERS - 2] = BLOSC_DELTA;
+  }
+  blosc2_dparams dparams = BLOSC2_DPARAMS_DEFAULTS;
+  dparams.nthreads = nthreads;
+  blosc2_storage storage = {.sequential=sequential, .path=filename, .cparams=&cparams,
+                            .dparams=&dparams};
+  blosc2_schunk* schunk = blosc2_schunk_new(storage);
+  mu_assert("ERROR: cannot create the super-chunk", schunk != NULL);
+
+  double sum = 0, min = INFINITY, max = -INFINITY;
+  int64_t count = 0;
+  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      double value = get_item((int64_t)nchunk * CHUNKSIZE + i);
+      set_item(data, i, value);
+      if (!isnan(value)) {
+        sum += value;
+        min = value < min ? value : min;
+        max = value > max ? value : max;
+        count++;
+      }
+    }
+    int rc = blosc2_schunk_append_buffer(schunk, data, CHUNKSIZE * typesize);
+    mu_assert("ERROR: cannot append a chunk", rc == nchunk + 1);
+  }
+
+  bool is_float = type >= BLOSC2_ZONEMAP_FLOAT32;
+  blosc2_zonemap_value result;
+  int64_t nitems = blosc2_schunk_reduce(schunk, BLOSC2_REDUCE_SUM, type, &result);
+  mu_assert("ERROR: bad number of items", nitems == count);
+  mu_assert("ERROR: bad sum", is_float ? result.f == sum : result.i == (int64_t)sum);
+  nitems = blosc2_schunk_reduce(schunk, BLOSC2_REDUCE_MIN, type, &result);
+  mu_assert("ERROR: bad number of items", nitems == count);
+  mu_assert("ERROR: bad min", is_float ? result.f == min : result.i == (int64_t)min);
+  nitems = blosc2_schunk_reduce(schunk, BLOSC2_REDUCE_MAX, type, &result);
+  mu_assert("ERROR: bad number of items", nitems == count);
+  mu_assert("ERROR: bad max", is_float ? result.f == max : result.i == (int64_t)max);
+  nitems = blosc2_schunk_reduce(schunk, BLOSC2_REDUCE_COUNT, type, &result);
+  mu_assert("ERROR: bad count", nitems == count && result.i == count);
+
+  // Bad parameters
+  mu_assert("ERROR: a bad reduction is accepted",
+            blosc2_schunk_reduce(schunk, BLOSC2_REDUCE_COUNT + 1, type, &result) < 0);
+  uint8_t other_type = type == BLOSC2_ZONEMAP_INT8 ? BLOSC2_ZONEMAP_INT64 : BLOSC2_ZONEMAP_INT8;
+  mu_assert("ERROR: a bad type is accepted",
+            blosc2_schunk_reduce(schunk, BLOSC2_REDUCE_SUM, other_type, &result) < 0);
+
+  blosc2_schunk_free(schunk);
+  if (filename != NULL) {
+    remove(filename);
+  }
+  return EXIT_SUCCESS;
+}
+
+
+static char* test_empty(void) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(double);
+  blosc2_storage storage = {.cparams=&cparams};
+  blosc2_schunk* schunk = blosc2_schunk_new(storage);
+
+  blosc2_zonemap_value result;
+  mu_assert("ERROR: bad number of items",
+            blosc2_schunk_reduce(schunk, BLOSC2_REDUCE_MIN, BLOSC2_ZONEMAP_FLOAT64, &result) == 0);
+  mu_assert("ERROR: bad min", result.f == INFINITY);
+  mu_assert("ERROR: bad number of items",
+            blosc2_schunk_reduce(schunk, BLOSC2_REDUCE_MAX, BLOSC2_ZONEMAP_INT64, &result) == 0);
+  mu_assert("ERROR: bad max", result.i == INT64_MIN);
+
+  blosc2_schunk_free(schunk);
+  return EXIT_SUCCESS;
+}
+
+
+static char *all_tests(void) {
+  uint8_t types[] = {BLOSC2_ZONEMAP_INT8, BLOSC2_ZONEMAP_INT16, BLOSC2_ZONEMAP_INT32,
+                     BLOSC2_ZONEMAP_INT64, BLOSC2_ZONEMAP_FLOAT32, BLOSC2_ZONEMAP_FLOAT64};
+  for (int i = 0; i < 6; i++) {
+    type = types[i];
+    for (int j = 0; j < 2; j++) {
+      zonemaps = j == 1;
+      for (nthreads = 1; nthreads <= 4; nthreads += 3) {
+        sequential = false;
+        filename = NULL;
+        mu_run_test(test_reduce);
+      }
+    }
+  }
+  // Delta chunks cannot be reduced while decompressing
+  delta = true;
+  zonemaps = false;
+  nthreads = 4;
+  for (int i = 0; i < 6; i++) {
+    type = types[i];
+    mu_run_test(test_reduce);
+  }
+  delta = false;
+  // Frames, in memory and on disk
+  type = BLOSC2_ZONEMAP_FLOAT64;
+  zonemaps = true;
+  nthreads = 4;
+  sequential = true;
+  mu_run_test(test_reduce);
+  filename = "test_schunk_reduce.b2frame";
+  mu_run_test(test_reduce);
+  mu_run_test(test_empty);
+
+  return EXIT_SUCCESS;
+}
+
+
+#define BUFFER_ALIGN_SIZE   32
+
+int main(void) {
+  char *result;
+
+  data = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(double));
+
+  install_blosc_callback_test(); /* optionally install callback test */
+  blosc_init();
+
+  /* Run all the suite */
+  result = all_tests();
+  if (result != EXIT_SUCCESS) {
+    printf(" (%s)\n", result);
+  }
+  else {
+    printf(" ALL TESTS PASSED");
+  }
+  printf("\tTests run: %d\n", tests_run);
+
+  blosc_test_free(data);
+  blosc_destroy();
+
+  return result != EXIT_SUCCESS;
+}
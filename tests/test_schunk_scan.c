@@ -0,0 +1,335 @@
+/*
+  Copyright (C) 2020- The Blosc Development Team <blosc@blosc.org>
+  http://blosc.org
+  License: BSD (see LICENSE.txt)
+
+  See LICENSE.txt for details about copyright and rights to use.
+
+  Test for scanning super-chunks with predicates.
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include "test_common.h"
+
+#define CHUNKSIZE (20 * 1000)
+#define NCHUNKS (10)
+#define NITEMS (CHUNKSIZE * NCHUNKS)
+#define NTHREADS (4)
+#define ABORT_CODE (-42)
+
+/* Global vars */
+int tests_run = 0;
+bool sequential;
+char* filename;
+int nthreads;
+bool zonemaps;
+bool delta;
+int clevel;
+
+uint8_t *data;
+bool *matches;
+
+
+static double float_item(int64_t i) {
+  return i % 101 == 0 ? NAN : (double)i * 0.5;
+}
+
+
+static int32_t int_item(int64_t i) {
+  return (int32_t)(i / 3) - NITEMS / 6;
+}
+
+
+static blosc2_schunk* new_schunk(uint8_t type) {
+  int32_t typesize = type == BLOSC2_ZONEMAP_FLOAT64 ? sizeof(double) : sizeof(int32_t);
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = typesize;
+  cparams.blocksize = 16 * 1024;
+  cparams.clevel = (uint8_t)clevel;
+  if (delta) {
+    cparams.filters[BLOSC2_MAX_FILTERS - 2] = BLOSC_DELTA;
+  }
+  cparams.zonemap_type = zonemaps ? type : (uint8_t)BLOSC2_ZONEMAP_NONE;
+  blosc2_storage storage = {.sequential=sequential, .path=filename};
+  blosc2_schunk* schunk = blosc_test_new_schunk(storage, cparams, nthreads);
+  if (schunk == NULL) {
+    return NULL;
+  }
+
+  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      int64_t item = (int64_t)nchunk * CHUNKSIZE + i;
+      if (type == BLOSC2_ZONEMAP_FLOAT64) {
+        ((double*)data)[i] = float_item(item);
+      }
+      else {
+        ((int32_t*)data)[i] = int_item(item);
+      }
+    }
+    if (blosc2_schunk_append_buffer(schunk, data, CHUNKSIZE * typesize) != nchunk + 1) {
+      return NULL;
+    }
+  }
+  return schunk;
+}
+
+
+static int collect(void* user_data, int64_t start, int32_t nitems, const uint64_t* bitmap,
+                   int32_t nmatches, int tid) {
+  int64_t *ncalls = user_data;
+  int32_t count = 0;
+  for (int32_t i = 0; i < nitems; i++) {
+    if ((bitmap[i / 64] >> (i % 64)) & 1) {
+      // Every item is in a single block, so no other thread writes it
+      matches[start + i] = true;
+      count++;
+    }
+  }
+  if (count != nmatches || tid < 0 || tid >= nthreads) {
+    return -1;
+  }
+  ncalls[tid]++;
+  return 0;
+}
+
+
+static int stop(void* user_data, int64_t start, int32_t nitems, const uint64_t* bitmap,
+                int32_t nmatches, int tid) {
+  (void)user_data;
+  (void)start;
+  (void)nitems;
+  (void)bitmap;
+  (void)nmatches;
+  (void)tid;
+  return ABORT_CODE;
+}
+
+
+static char* check_scan(blosc2_schunk* schunk, blosc2_predicate* predicate, bool (*match)(int64_t)) {
+  memset(matches, 0, NITEMS);
+  int64_t ncalls[NTHREADS] = {0};
+  int64_t nmatches = blosc2_schunk_scan(schunk, predicate, collect, ncalls);
+  mu_assert("ERROR: cannot scan", nmatches >= 0);
+  int64_t expected = 0;
+  for (int64_t i = 0; i < NITEMS; i++) {
+    mu_assert("ERROR: bad match", matches[i] == match(i));
+    expected += matches[i];
+  }
+  mu_assert("ERROR: bad number of matches", nmatches == expected);
+  mu_assert("ERROR: bad count", blosc2_schunk_scan(schunk, predicate, NULL, NULL) == expected);
+  return EXIT_SUCCESS;
+}
+
+
+static bool int_gt(int64_t i) {
+  return int_item(i) > 1000;
+}
+
+
+static bool int_between(int64_t i) {
+  return int_item(i) >= -100 && int_item(i) <= 100;
+}
+
+
+static bool int_eq(int64_t i) {
+  return int_item(i) == 7;
+}
+
+
+static bool int_le_min(int64_t i) {
+  return int_item(i) <= INT32_MIN;
+}
+
+
+static bool float_lt(int64_t i) {
+  return float_item(i) < 12345.;
+}
+
+
+static bool float_ge(int64_t i) {
+  return float_item(i) >= 99999.5;
+}
+
+
+static bool float_between(int64_t i) {
+  return float_item(i) >= 1000. && float_item(i) <= 2000.;
+}
+
+
+static bool float_any(int64_t i) {
+  return !isnan(float_item(i));
+}
+
+
+static char* test_int32(void) {
+  blosc2_schunk* schunk = new_schunk(BLOSC2_ZONEMAP_INT32);
+  mu_assert("ERROR: cannot create the super-chunk", schunk != NULL);
+
+  blosc2_predicate predicate = {.type=BLOSC2_ZONEMAP_INT32, .op=BLOSC2_SCAN_GT};
+  predicate.value.i = 1000;
+  char* result = check_scan(schunk, &predicate, int_gt);
+  if (result != EXIT_SUCCESS) {
+    return result;
+  }
+  predicate.op = BLOSC2_SCAN_BETWEEN;
+  predicate.value.i = -100;
+  predicate.high.i = 100;
+  result = check_scan(schunk, &predicate, int_between);
+  if (result != EXIT_SUCCESS) {
+    return result;
+  }
+  predicate.op = BLOSC2_SCAN_EQ;
+  predicate.value.i = 7;
+  result = check_scan(schunk, &predicate, int_eq);
+  if (result != EXIT_SUCCESS) {
+    return result;
+  }
+  // Values out of the range of the type
+  predicate.op = BLOSC2_SCAN_LE;
+  predicate.value.i = INT64_MIN;
+  result = check_scan(schunk, &predicate, int_le_min);
+  if (result != EXIT_SUCCESS) {
+    return result;
+  }
+  predicate.op = BLOSC2_SCAN_LT;
+  predicate.value.i = INT64_MAX;
+  mu_assert("ERROR: bad number of matches", blosc2_schunk_scan(schunk, &predicate, NULL, NULL) == NITEMS);
+
+  // The callback can stop the scan
+  predicate.op = BLOSC2_SCAN_GE;
+  predicate.value.i = 0;
+  mu_assert("ERROR: the scan has not been stopped",
+            blosc2_schunk_scan(schunk, &predicate, stop, NULL) == ABORT_CODE);
+
+  // The type of the predicate has to match the typesize
+  predicate.type = BLOSC2_ZONEMAP_INT64;
+  mu_assert("ERROR: a bad type is accepted", blosc2_schunk_scan(schunk, &predicate, NULL, NULL) < 0);
+  predicate.type = BLOSC2_ZONEMAP_INT32;
+  predicate.op = 100;
+  mu_assert("ERROR: a bad comparison is accepted", blosc2_schunk_scan(schunk, &predicate, NULL, NULL) < 0);
+
+  blosc2_schunk_free(schunk);
+  if (filename != NULL) {
+    remove(filename);
+  }
+  return EXIT_SUCCESS;
+}
+
+
+static char* test_float64(void) {
+  blosc2_schunk* schunk = new_schunk(BLOSC2_ZONEMAP_FLOAT64);
+  mu_assert("ERROR: cannot create the super-chunk", schunk != NULL);
+
+  blosc2_predicate predicate = {.type=BLOSC2_ZONEMAP_FLOAT64, .op=BLOSC2_SCAN_LT};
+  predicate.value.f = 12345.;
+  char* result = check_scan(schunk, &predicate, float_lt);
+  if (result != EXIT_SUCCESS) {
+    return result;
+  }
+  predicate.op = BLOSC2_SCAN_GE;
+  predicate.value.f = 99999.5;
+  result = check_scan(schunk, &predicate, float_ge);
+  if (result != EXIT_SUCCESS) {
+    return result;
+  }
+  predicate.op = BLOSC2_SCAN_BETWEEN;
+  predicate.value.f = 1000.;
+  predicate.high.f = 2000.;
+  result = check_scan(schunk, &predicate, float_between);
+  if (result != EXIT_SUCCESS) {
+    return result;
+  }
+  // NaNs never match
+  predicate.value.f = -INFINITY;
+  predicate.high.f = INFINITY;
+  result = check_scan(schunk, &predicate, float_any);
+  if (result != EXIT_SUCCESS) {
+    return result;
+  }
+  predicate.op = BLOSC2_SCAN_EQ;
+  predicate.value.f = NAN;
+  mu_assert("ERROR: NaN matches", blosc2_schunk_scan(schunk, &predicate, NULL, NULL) == 0);
+
+  if (filename != NULL) {
+    // Scan the frame as opened from scratch
+    blosc2_schunk_free(schunk);
+    blosc2_storage storage = {.sequential=true, .path=filename};
+    schunk = blosc2_schunk_open(storage);
+    mu_assert("ERROR: cannot open the frame", schunk != NULL);
+    predicate.op = BLOSC2_SCAN_GE;
+    predicate.value.f = 99999.5;
+    result = check_scan(schunk, &predicate, float_ge);
+    if (result != EXIT_SUCCESS) {
+      return result;
+    }
+  }
+
+  blosc2_schunk_free(schunk);
+  if (filename != NULL) {
+    remove(filename);
+  }
+  return EXIT_SUCCESS;
+}
+
+
+static char *all_tests(void) {
+  bool sequentials[] = {false, true, true};
+  clevel = 5;
+  for (int i = 0; i < 3; i++) {
+    sequential = sequentials[i];
+    filename = i == 2 ? "test_schunk_scan.b2frame" : NULL;
+    for (nthreads = 1; nthreads <= NTHREADS; nthreads += NTHREADS - 1) {
+      for (int j = 0; j < 2; j++) {
+        zonemaps = j == 1;
+        mu_run_test(test_int32);
+        mu_run_test(test_float64);
+      }
+    }
+
+    // Delta chunks cannot be scanned while decompressing, and memcpyed chunks are not compressed
+    nthreads = NTHREADS;
+    for (int j = 0; j < 2; j++) {
+      zonemaps = j == 1;
+      delta = true;
+      mu_run_test(test_int32);
+      mu_run_test(test_float64);
+      delta = false;
+      clevel = 0;
+      mu_run_test(test_int32);
+      mu_run_test(test_float64);
+      clevel = 5;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+#define BUFFER_ALIGN_SIZE   32
+
+int main(void) {
+  char *result;
+
+  data = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(double));
+  matches = blosc_test_malloc(BUFFER_ALIGN_SIZE, NITEMS * sizeof(bool));
+
+  install_blosc_callback_test(); /* optionally install callback test */
+  blosc_init();
+
+  /* Run all the suite */
+  result = all_tests();
+  if (result != EXIT_SUCCESS) {
+    printf(" (%s)\n", result);
+  }
+  else {
+    printf(" ALL TESTS PASSED");
+  }
+  printf("\tTests run: %d\n", tests_run);
+
+  blosc_test_free(data);
+  blosc_test_free(matches);
+  blosc_destroy();
+
+  return result != EXIT_SUCCESS;
+}
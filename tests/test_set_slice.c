@@ -0,0 +1,171 @@
+/*
+  Copyright (C) 2020- The Blosc Development Team <blosc@blosc.org>
+  http://blosc.org
+  License: BSD (see LICENSE.txt)
+
+  See LICENSE.txt for details about copyright and rights to use.
+
+  Test for setting slices of items in super-chunks.
+*/
+
+#include <stdio.h>
+#include "test_common.h"
+
+#define CHUNKSIZE (5 * 1000)
+#define NCHUNKS (10)
+#define NITEMS (NCHUNKS * CHUNKSIZE - 1234)  // the last chunk is not full
+
+/* Global vars */
+int tests_run = 0;
+bool sequential;
+bool checksums;
+int nthreads;
+char* filename;
+
+int32_t *data;
+int32_t *data_dest;
+int32_t *expected;
+
+
+/* Set the items [start, stop) to their negated value (plus `shift`) */
+static bool set_slice(blosc2_schunk* schunk, int64_t start, int64_t stop, int32_t shift) {
+  for (int64_t i = start; i < stop; i++) {
+    data[i - start] = (int32_t)(-i + shift);
+    expected[i] = (int32_t)(-i + shift);
+  }
+  int64_t nbytes = blosc2_schunk_set_slice(schunk, start, stop, data);
+  return nbytes == (stop - start) * (int64_t)sizeof(int32_t);
+}
+
+
+static bool check_schunk(blosc2_schunk* schunk) {
+  if (schunk->nbytes != NITEMS * sizeof(int32_t)) {
+    return false;
+  }
+  int64_t nbytes = blosc2_schunk_get_slice(schunk, 0, NITEMS, data_dest);
+  if (nbytes != NITEMS * sizeof(int32_t)) {
+    return false;
+  }
+  for (int i = 0; i < NITEMS; i++) {
+    if (data_dest[i] != expected[i]) {
+      return false;
+    }
+  }
+  return checksums ? blosc2_schunk_verify(schunk) == 0 : true;
+}
+
+
+static char* test_set_slice(void) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  blosc2_storage storage = {.sequential=sequential, .path=filename, .checksums=checksums};
+  blosc2_schunk* schunk = blosc_test_new_schunk(storage, cparams, nthreads);
+  mu_assert("ERROR: cannot create the super-chunk", schunk != NULL);
+  for (int i = 0; i < NITEMS; i++) {
+    expected[i] = i;
+  }
+  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+    int32_t nitems = nchunk < NCHUNKS - 1 ? CHUNKSIZE : NITEMS - nchunk * CHUNKSIZE;
+    mu_assert("ERROR: cannot append a chunk", blosc2_schunk_append_buffer(
+      schunk, expected + nchunk * CHUNKSIZE, nitems * sizeof(int32_t)) == nchunk + 1);
+  }
+
+  // Inside a single chunk, across chunks, whole chunks and up to the end
+  mu_assert("ERROR: cannot set a slice in a chunk", set_slice(schunk, 10, 20, 1));
+  mu_assert("ERROR: bad slice in a chunk", check_schunk(schunk));
+  mu_assert("ERROR: cannot set a slice across chunks", set_slice(schunk, 4321, 3 * CHUNKSIZE + 9, 2));
+  mu_assert("ERROR: bad slice across chunks", check_schunk(schunk));
+  mu_assert("ERROR: cannot set whole chunks", set_slice(schunk, CHUNKSIZE, 3 * CHUNKSIZE, 3));
+  mu_assert("ERROR: bad whole chunks", check_schunk(schunk));
+  mu_assert("ERROR: cannot set the end", set_slice(schunk, NITEMS - 7, NITEMS, 4));
+  mu_assert("ERROR: bad end", check_schunk(schunk));
+  mu_assert("ERROR: cannot set everything", set_slice(schunk, 0, NITEMS, 5));
+  mu_assert("ERROR: bad full slice", check_schunk(schunk));
+
+  // Empty and out of bounds slices
+  mu_assert("ERROR: bad empty slice", blosc2_schunk_set_slice(schunk, 5, 5, data) == 0);
+  mu_assert("ERROR: a slice past the end is accepted",
+            blosc2_schunk_set_slice(schunk, NITEMS - 1, NITEMS + 1, data) < 0);
+  mu_assert("ERROR: a reversed slice is accepted",
+            blosc2_schunk_set_slice(schunk, 10, 5, data) < 0);
+  mu_assert("ERROR: a bad slice has changed something", check_schunk(schunk));
+
+  if (sequential && filename == NULL) {
+    // The frame should still be good after a roundtrip (and without the updated chunks)
+    uint8_t* sframe;
+    int64_t len = blosc2_schunk_to_sframe(schunk, &sframe);
+    mu_assert("ERROR: cannot serialize the frame", len > 0);
+    blosc2_schunk* schunk2 = blosc2_schunk_open_sframe(sframe, len);
+    mu_assert("ERROR: cannot open the frame", schunk2 != NULL);
+    mu_assert("ERROR: bad serialized frame", check_schunk(schunk2));
+    blosc2_schunk* schunk3 = blosc2_frame_to_schunk(schunk2->frame, true);
+    mu_assert("ERROR: cannot copy the frame", schunk3 != NULL);
+    mu_assert("ERROR: the space of updated chunks is kept", schunk3->cbytes < schunk2->cbytes);
+    mu_assert("ERROR: bad copy of the frame", check_schunk(schunk3));
+    blosc2_schunk_free(schunk3);
+    blosc2_schunk_free(schunk2);  // this frees sframe too
+  }
+  blosc2_schunk_free(schunk);
+
+  if (filename != NULL) {
+    blosc2_storage storage = {.sequential=true, .path=filename};
+    schunk = blosc2_schunk_open(storage);
+    mu_assert("ERROR: cannot open the frame", schunk != NULL);
+    mu_assert("ERROR: bad frame on-disk", check_schunk(schunk));
+    blosc2_schunk_free(schunk);
+    remove(filename);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+static char *all_tests(void) {
+  char* filenames[] = {NULL, NULL, "test_set_slice.b2frame"};
+  bool sequentials[] = {false, true, true};
+  for (int i = 0; i < 3; i++) {
+    sequential = sequentials[i];
+    filename = filenames[i];
+    for (nthreads = 1; nthreads <= 4; nthreads *= 4) {
+      checksums = false;
+      mu_run_test(test_set_slice);
+      if (sequential) {
+        checksums = true;
+        mu_run_test(test_set_slice);
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+#define BUFFER_ALIGN_SIZE   32
+
+int main(void) {
+  char *result;
+
+  data = blosc_test_malloc(BUFFER_ALIGN_SIZE, NITEMS * sizeof(int32_t));
+  data_dest = blosc_test_malloc(BUFFER_ALIGN_SIZE, NITEMS * sizeof(int32_t));
+  expected = blosc_test_malloc(BUFFER_ALIGN_SIZE, NITEMS * sizeof(int32_t));
+
+  install_blosc_callback_test(); /* optionally install callback test */
+  blosc_init();
+
+  /* Run all the suite */
+  result = all_tests();
+  if (result != EXIT_SUCCESS) {
+    printf(" (%s)\n", result);
+  }
+  else {
+    printf(" ALL TESTS PASSED");
+  }
+  printf("\tTests run: %d\n", tests_run);
+
+  blosc_test_free(data);
+  blosc_test_free(data_dest);
+  blosc_test_free(expected);
+  blosc_destroy();
+
+  return result != EXIT_SUCCESS;
+}
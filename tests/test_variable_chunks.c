@@ -0,0 +1,305 @@
+/*
+  Copyright (C) 2020- The Blosc Development Team <blosc@blosc.org>
+  http://blosc.org
+  License: BSD (see LICENSE.txt)
+
+  See LICENSE.txt for details about copyright and rights to use.
+
+  Test for super-chunks (and frames) made of chunks with different lengths.
+*/
+
+#include <stdio.h>
+#include "test_common.h"
+
+#define CHUNKSIZE (5 * 1000)
+#define BLOCKSIZE (1000 * sizeof(int32_t))
+#define NCHUNKS (20)
+#define NINDICES (2000)
+
+/* Global vars */
+int tests_run = 0;
+bool sequential;
+bool checksums;
+int nthreads;
+char* filename;
+
+int32_t *data;
+int32_t *data_dest;
+int64_t *indices;
+int64_t starts[NCHUNKS + 1];   // the first item of every chunk
+
+
+static int32_t chunk_nitems(int nchunk) {
+  // Some chunks are larger than the first one and some are smaller
+  return CHUNKSIZE / 2 + (nchunk * 7919) % CHUNKSIZE;
+}
+
+
+static blosc2_schunk* new_schunk(void) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  cparams.blocksize = BLOCKSIZE;
+  blosc2_storage storage = {.sequential=sequential, .path=filename, .checksums=checksums};
+  blosc2_schunk* schunk = blosc_test_new_schunk(storage, cparams, nthreads);
+  if (schunk == NULL) {
+    return NULL;
+  }
+  starts[0] = 0;
+  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+    int32_t nitems = chunk_nitems(nchunk);
+    for (int i = 0; i < nitems; i++) {
+      data[i] = (int32_t)(starts[nchunk] + i);
+    }
+    if (blosc2_schunk_append_buffer(schunk, data, nitems * sizeof(int32_t)) != nchunk + 1) {
+      return NULL;
+    }
+    starts[nchunk + 1] = starts[nchunk] + nitems;
+  }
+  if (filename != NULL) {
+    // The number of chunks cannot be derived from the chunksize anymore
+    schunk = blosc_test_reopen_schunk(schunk, filename, nthreads);
+  }
+  return schunk;
+}
+
+
+static bool check_slice(blosc2_schunk* schunk, int64_t start, int64_t stop, int32_t offset) {
+  int64_t nbytes = blosc2_schunk_get_slice(schunk, start, stop, data_dest);
+  if (nbytes != (stop - start) * (int64_t)sizeof(int32_t)) {
+    return false;
+  }
+  for (int64_t i = 0; i < stop - start; i++) {
+    if (data_dest[i] != (int32_t)(start + i) + offset) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+static char* test_append(void) {
+  blosc2_schunk* schunk = new_schunk();
+  mu_assert("ERROR: cannot create the super-chunk", schunk != NULL);
+  mu_assert("ERROR: the chunksize is fixed", schunk->chunksize == 0);
+  mu_assert("ERROR: bad number of chunks", schunk->nchunks == NCHUNKS);
+  mu_assert("ERROR: bad nbytes", schunk->nbytes == starts[NCHUNKS] * (int64_t)sizeof(int32_t));
+
+  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+    int dsize = blosc2_schunk_decompress_chunk(schunk, nchunk, data_dest, CHUNKSIZE * 2 * sizeof(int32_t));
+    mu_assert("ERROR: bad chunk size", dsize == chunk_nitems(nchunk) * (int)sizeof(int32_t));
+    mu_assert("ERROR: bad roundtrip", data_dest[0] == starts[nchunk]);
+  }
+
+  if (!sequential) {
+    // The header of the frame cannot tell the number of chunks out of the chunksize
+    uint8_t* sframe;
+    int64_t len = blosc2_schunk_to_sframe(schunk, &sframe);
+    mu_assert("ERROR: cannot serialize the super-chunk", len > 0);
+    blosc2_schunk* schunk2 = blosc2_schunk_open_sframe(sframe, len);
+    mu_assert("ERROR: cannot open the frame", schunk2 != NULL);
+    mu_assert("ERROR: bad number of chunks", schunk2->nchunks == NCHUNKS);
+    mu_assert("ERROR: bad roundtrip", check_slice(schunk2, 0, starts[NCHUNKS], 0));
+    blosc2_schunk_free(schunk2);  // this frees sframe too
+  }
+
+  blosc2_schunk_free(schunk);
+  if (filename != NULL) {
+    remove(filename);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+static char* test_slices(void) {
+  blosc2_schunk* schunk = new_schunk();
+  mu_assert("ERROR: cannot create the super-chunk", schunk != NULL);
+  int64_t nitems = starts[NCHUNKS];
+
+  // Slices at (and around) the boundaries of the chunks
+  mu_assert("ERROR: bad slice", check_slice(schunk, 0, nitems, 0));
+  for (int nchunk = 1; nchunk < NCHUNKS; nchunk++) {
+    mu_assert("ERROR: bad slice", check_slice(schunk, starts[nchunk] - 1, starts[nchunk] + 1, 0));
+    mu_assert("ERROR: bad slice", check_slice(schunk, starts[nchunk], starts[nchunk + 1], 0));
+  }
+  mu_assert("ERROR: bad slice", check_slice(schunk, 123, starts[5] + 456, 0));
+  mu_assert("ERROR: a slice out of bounds is accepted",
+            blosc2_schunk_get_slice(schunk, 0, nitems + 1, data_dest) < 0);
+
+  // Items at scattered positions
+  uint32_t seed = 1;
+  for (int i = 0; i < NINDICES; i++) {
+    seed = seed * 1103515245U + 12345U;
+    indices[i] = (int64_t)(seed >> 8U) % nitems;
+  }
+  indices[0] = 0;
+  indices[1] = nitems - 1;
+  mu_assert("ERROR: cannot get the items",
+            blosc2_schunk_get_items(schunk, indices, NINDICES, data_dest) == NINDICES * sizeof(int32_t));
+  for (int i = 0; i < NINDICES; i++) {
+    mu_assert("ERROR: bad item", data_dest[i] == indices[i]);
+  }
+
+  // Set a slice across several chunks, which keep their lengths
+  int64_t start = starts[3] + 10;
+  int64_t stop = starts[8] - 10;
+  for (int64_t i = 0; i < stop - start; i++) {
+    data[i] = (int32_t)(start + i) + 1;
+  }
+  mu_assert("ERROR: cannot set the slice",
+            blosc2_schunk_set_slice(schunk, start, stop, data) == (stop - start) * (int64_t)sizeof(int32_t));
+  mu_assert("ERROR: bad number of chunks", schunk->nchunks == NCHUNKS);
+  mu_assert("ERROR: bad slice after setting it", check_slice(schunk, start, stop, 1));
+  mu_assert("ERROR: the rest of the items have changed", check_slice(schunk, starts[3], start, 0));
+  mu_assert("ERROR: the rest of the items have changed", check_slice(schunk, stop, starts[8], 0));
+
+  blosc2_schunk_free(schunk);
+  if (filename != NULL) {
+    remove(filename);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+static char* test_update(void) {
+  blosc2_schunk* schunk = new_schunk();
+  mu_assert("ERROR: cannot create the super-chunk", schunk != NULL);
+  // Fill the index before the chunks change
+  mu_assert("ERROR: bad slice", check_slice(schunk, 0, starts[NCHUNKS], 0));
+
+  // Replace chunk 5 with a larger one that keeps the items in order
+  int nchunk = 5;
+  int32_t nitems = chunk_nitems(nchunk) + 1000;
+  for (int i = 0; i < nitems; i++) {
+    data[i] = (int32_t)(starts[nchunk] + i);
+  }
+  uint8_t* chunk = malloc(nitems * sizeof(int32_t) + BLOSC_MAX_OVERHEAD);
+  int cbytes = blosc2_compress_ctx(schunk->cctx, data, nitems * sizeof(int32_t), chunk,
+                                   nitems * sizeof(int32_t) + BLOSC_MAX_OVERHEAD);
+  mu_assert("ERROR: cannot compress", cbytes > 0);
+  mu_assert("ERROR: cannot update", blosc2_schunk_update_chunk(schunk, nchunk, chunk, true) == NCHUNKS);
+  free(chunk);
+  int64_t nitems_total = starts[NCHUNKS] + 1000;
+  mu_assert("ERROR: bad nbytes", schunk->nbytes == nitems_total * (int64_t)sizeof(int32_t));
+
+  // The items after the new chunk are shifted
+  mu_assert("ERROR: bad slice", check_slice(schunk, 0, starts[nchunk] + nitems, 0));
+  int64_t shifted_start = starts[nchunk + 1] + 1000;
+  int64_t nbytes = blosc2_schunk_get_slice(schunk, shifted_start, nitems_total, data_dest);
+  mu_assert("ERROR: cannot get the slice", nbytes == (nitems_total - shifted_start) * (int64_t)sizeof(int32_t));
+  mu_assert("ERROR: the shifted items are not seen",
+            data_dest[0] == starts[nchunk + 1] && data_dest[nitems_total - shifted_start - 1] == starts[NCHUNKS] - 1);
+
+  if (filename != NULL) {
+    // The new sizes are persisted too
+    blosc2_schunk_free(schunk);
+    blosc2_storage storage = {.sequential=true, .path=filename};
+    schunk = blosc2_schunk_open(storage);
+    mu_assert("ERROR: cannot open the frame", schunk != NULL);
+    mu_assert("ERROR: bad number of chunks", schunk->nchunks == NCHUNKS);
+    mu_assert("ERROR: bad nbytes", schunk->nbytes == nitems_total * (int64_t)sizeof(int32_t));
+    mu_assert("ERROR: bad slice", check_slice(schunk, 0, starts[nchunk] + nitems, 0));
+  }
+
+  blosc2_schunk_free(schunk);
+  if (filename != NULL) {
+    remove(filename);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+static char* test_fixed(void) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  blosc2_storage storage = {.sequential=sequential, .path=filename, .cparams=&cparams,
+                            .checksums=checksums};
+  blosc2_schunk* schunk = blosc2_schunk_new(storage);
+  for (int i = 0; i < CHUNKSIZE; i++) {
+    data[i] = i;
+  }
+  // The last chunk can be shorter and the chunksize is still fixed
+  for (int nchunk = 0; nchunk < 3; nchunk++) {
+    blosc2_schunk_append_buffer(schunk, data, CHUNKSIZE * sizeof(int32_t));
+  }
+  blosc2_schunk_append_buffer(schunk, data, CHUNKSIZE / 2 * sizeof(int32_t));
+  mu_assert("ERROR: the chunksize is not fixed", schunk->chunksize == CHUNKSIZE * sizeof(int32_t));
+
+  // But not if another chunk comes after it
+  mu_assert("ERROR: cannot append a chunk after a short one",
+            blosc2_schunk_append_buffer(schunk, data, CHUNKSIZE * sizeof(int32_t)) == 5);
+  mu_assert("ERROR: the chunksize is fixed", schunk->chunksize == 0);
+  int64_t start = 3 * CHUNKSIZE + CHUNKSIZE / 2 - 10;
+  mu_assert("ERROR: cannot get the slice",
+            blosc2_schunk_get_slice(schunk, start, start + 20, data_dest) == 20 * sizeof(int32_t));
+  for (int i = 0; i < 10; i++) {
+    mu_assert("ERROR: bad slice", data_dest[i] == CHUNKSIZE / 2 - 10 + i && data_dest[10 + i] == i);
+  }
+
+  // Chunks that do not start at item boundaries cannot be sliced
+  blosc2_schunk_append_buffer(schunk, data, 7);
+  blosc2_schunk_append_buffer(schunk, data, CHUNKSIZE * sizeof(int32_t));
+  mu_assert("ERROR: a partial item is accepted",
+            blosc2_schunk_get_slice(schunk, 0, 10, data_dest) < 0);
+
+  blosc2_schunk_free(schunk);
+  if (filename != NULL) {
+    remove(filename);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+static char *all_tests(void) {
+  char* filenames[] = {NULL, NULL, "test_variable_chunks.b2frame"};
+  bool sequentials[] = {false, true, true};
+  int nthreads_[] = {1, 4};
+  for (int i = 0; i < 3; i++) {
+    sequential = sequentials[i];
+    filename = filenames[i];
+    for (int j = 0; j < 2; j++) {
+      nthreads = nthreads_[j];
+      checksums = j == 1;
+      mu_run_test(test_append);
+      mu_run_test(test_slices);
+      mu_run_test(test_update);
+    }
+    mu_run_test(test_fixed);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+#define BUFFER_ALIGN_SIZE   32
+
+int main(void) {
+  char *result;
+
+  data = blosc_test_malloc(BUFFER_ALIGN_SIZE, NCHUNKS * CHUNKSIZE * 2 * sizeof(int32_t));
+  data_dest = blosc_test_malloc(BUFFER_ALIGN_SIZE, NCHUNKS * CHUNKSIZE * 2 * sizeof(int32_t));
+  indices = malloc(NINDICES * sizeof(int64_t));
+
+  install_blosc_callback_test(); /* optionally install callback test */
+  blosc_init();
+
+  /* Run all the suite */
+  result = all_tests();
+  if (result != EXIT_SUCCESS) {
+    printf(" (%s)\n", result);
+  }
+  else {
+    printf(" ALL TESTS PASSED");
+  }
+  printf("\tTests run: %d\n", tests_run);
+
+  blosc_test_free(data);
+  blosc_test_free(data_dest);
+  free(indices);
+  blosc_destroy();
+
+  return result != EXIT_SUCCESS;
+}
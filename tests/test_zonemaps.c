@@ -0,0 +1,301 @@
+/*
+  Copyright (C) 2020- The Blosc Development Team <blosc@blosc.org>
+  http://blosc.org
+  License: BSD (see LICENSE.txt)
+
+  See LICENSE.txt for details about copyright and rights to use.
+
+  Test for the zone maps of the chunks and blocks of super-chunks.
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include "test_common.h"
+
+#define CHUNKSIZE (50 * 1000)
+#define BLOCKSIZE (8 * 1000)   // in bytes, so that there are several blocks per chunk
+#define NCHUNKS (10)
+
+/* Global vars */
+int tests_run = 0;
+bool sequential;
+char* filename;
+int nthreads;
+int clevel;
+
+int32_t *data;
+int32_t *data_dest;
+double *fdata;
+
+
+static char* check_chunk_zonemaps(blosc2_schunk* schunk, int nchunk) {
+  blosc2_zonemap zonemap;
+  mu_assert("ERROR: cannot get the zone map", blosc2_schunk_get_zonemap(schunk, nchunk, &zonemap) == 0);
+  mu_assert("ERROR: bad nitems", zonemap.nitems == CHUNKSIZE);
+  mu_assert("ERROR: bad nnulls", zonemap.nnulls == 0);
+  mu_assert("ERROR: bad min", zonemap.min.i == nchunk * CHUNKSIZE);
+  mu_assert("ERROR: bad max", zonemap.max.i == (nchunk + 1) * CHUNKSIZE - 1);
+
+  blosc2_zonemap* zonemaps;
+  int nblocks = blosc2_schunk_get_block_zonemaps(schunk, nchunk, &zonemaps);
+  int32_t nitems_block = BLOCKSIZE / (int32_t)sizeof(int32_t);
+  mu_assert("ERROR: bad number of blocks",
+            nblocks == (CHUNKSIZE + nitems_block - 1) / nitems_block);
+  for (int i = 0; i < nblocks; i++) {
+    int64_t first = (int64_t)nchunk * CHUNKSIZE + i * nitems_block;
+    int32_t nitems = i < nblocks - 1 ? nitems_block : CHUNKSIZE - i * nitems_block;
+    mu_assert("ERROR: bad block nitems", zonemaps[i].nitems == nitems);
+    mu_assert("ERROR: bad block min", zonemaps[i].min.i == first);
+    mu_assert("ERROR: bad block max", zonemaps[i].max.i == first + nitems - 1);
+  }
+  free(zonemaps);
+
+  return EXIT_SUCCESS;
+}
+
+
+static char* test_zonemaps(void) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(int32_t);
+  cparams.clevel = (uint8_t)clevel;
+  cparams.blocksize = BLOCKSIZE;
+  cparams.zonemap_type = BLOSC2_ZONEMAP_INT32;
+  blosc2_storage storage = {.sequential=sequential, .path=filename};
+  blosc2_schunk* schunk = blosc_test_new_schunk(storage, cparams, nthreads);
+  mu_assert("ERROR: cannot create the super-chunk", schunk != NULL);
+  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      data[i] = nchunk * CHUNKSIZE + i;
+    }
+    mu_assert("ERROR: cannot append a chunk",
+              blosc2_schunk_append_buffer(schunk, data, CHUNKSIZE * sizeof(int32_t)) == nchunk + 1);
+  }
+  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+    char* result = check_chunk_zonemaps(schunk, nchunk);
+    if (result != EXIT_SUCCESS) {
+      return result;
+    }
+  }
+
+  // Only one block of chunk 3 may have items in the range
+  int32_t nitems_block = BLOCKSIZE / (int32_t)sizeof(int32_t);
+  blosc2_zonemap_value low = {.i = 3 * CHUNKSIZE + 2 * nitems_block + 10};
+  blosc2_zonemap_value high = {.i = 3 * CHUNKSIZE + 2 * nitems_block + 20};
+  bool* maskout;
+  int32_t nblocks;
+  for (int nchunk = 0; nchunk < NCHUNKS; nchunk++) {
+    int nmatches = blosc2_schunk_zonemap_maskout(schunk, nchunk, low, high, &maskout, &nblocks);
+    mu_assert("ERROR: bad number of blocks", nblocks > 0);
+    mu_assert("ERROR: bad number of matching blocks", nmatches == (nchunk == 3 ? 1 : 0));
+    mu_assert("ERROR: bad mask", (maskout != NULL) == (nchunk == 3));
+    if (nchunk != 3) {
+      continue;
+    }
+    for (int i = 0; i < nblocks; i++) {
+      mu_assert("ERROR: bad mask", maskout[i] == (i != 2));
+    }
+    // Only the matching block is decompressed
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      data_dest[i] = -1;
+    }
+    mu_assert("ERROR: cannot set the mask", blosc2_set_maskout(schunk->dctx, maskout, nblocks) == 0);
+    blosc2_schunk_decompress_chunk(schunk, nchunk, data_dest, CHUNKSIZE * sizeof(int32_t));
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      bool in_block = i / nitems_block == 2;
+      mu_assert("ERROR: bad masked out decompression",
+                data_dest[i] == (in_block ? nchunk * CHUNKSIZE + i : -1));
+    }
+    free(maskout);
+  }
+
+  // Setting a slice updates the zone maps
+  int64_t start = 5 * CHUNKSIZE + 100;
+  data[0] = -7;
+  data[1] = 1 << 30;
+  mu_assert("ERROR: cannot set a slice", blosc2_schunk_set_slice(schunk, start, start + 2, data) >= 0);
+  blosc2_zonemap zonemap;
+  blosc2_schunk_get_zonemap(schunk, 5, &zonemap);
+  mu_assert("ERROR: bad min after setting a slice", zonemap.min.i == -7);
+  mu_assert("ERROR: bad max after setting a slice", zonemap.max.i == 1 << 30);
+
+  // The zone maps of the chunks that come from elsewhere are not known
+  uint8_t* chunk;
+  bool needs_free;
+  int cbytes = blosc2_schunk_get_chunk(schunk, 0, &chunk, &needs_free);
+  mu_assert("ERROR: cannot get a chunk", cbytes > 0);
+  // The chunk may point into the frame, which can be moved while appending
+  uint8_t* chunk_copy = malloc((size_t)cbytes);
+  memcpy(chunk_copy, chunk, (size_t)cbytes);
+  if (needs_free) {
+    free(chunk);
+  }
+  mu_assert("ERROR: cannot append a chunk",
+            blosc2_schunk_append_chunk(schunk, chunk_copy, false) == NCHUNKS + 1);
+  blosc2_schunk_get_zonemap(schunk, NCHUNKS, &zonemap);
+  mu_assert("ERROR: the zone map should not be known", zonemap.nitems < 0);
+  int nmatches = blosc2_schunk_zonemap_maskout(schunk, NCHUNKS, low, high, &maskout, &nblocks);
+  mu_assert("ERROR: every block should match", maskout == NULL && nmatches == nblocks && nblocks > 0);
+
+  if (filename != NULL) {
+    blosc2_schunk_free(schunk);
+    blosc2_storage storage = {.sequential=true, .path=filename};
+    schunk = blosc2_schunk_open(storage);
+    mu_assert("ERROR: cannot open the frame", schunk != NULL);
+    char* result = check_chunk_zonemaps(schunk, 9);
+    if (result != EXIT_SUCCESS) {
+      return result;
+    }
+    blosc2_schunk_get_zonemap(schunk, NCHUNKS, &zonemap);
+    mu_assert("ERROR: the zone map should not be known", zonemap.nitems < 0);
+    // The new chunks get their zone maps too
+    for (int i = 0; i < CHUNKSIZE; i++) {
+      data[i] = (NCHUNKS + 1) * CHUNKSIZE + i;
+    }
+    blosc2_schunk_append_buffer(schunk, data, CHUNKSIZE * sizeof(int32_t));
+    blosc2_schunk_get_zonemap(schunk, NCHUNKS + 1, &zonemap);
+    mu_assert("ERROR: bad nitems", zonemap.nitems == CHUNKSIZE);
+    mu_assert("ERROR: bad min", zonemap.min.i == (NCHUNKS + 1) * CHUNKSIZE);
+    mu_assert("ERROR: bad max", zonemap.max.i == (NCHUNKS + 2) * CHUNKSIZE - 1);
+  }
+
+  // Recompressing keeps the zone maps
+  blosc2_cparams dest_cparams = BLOSC2_CPARAMS_DEFAULTS;
+  dest_cparams.typesize = sizeof(int32_t);
+  dest_cparams.compcode = BLOSC_LZ4;
+  dest_cparams.blocksize = BLOCKSIZE;
+  dest_cparams.nthreads = (int16_t)nthreads;
+  dest_cparams.zonemap_type = BLOSC2_ZONEMAP_INT32;
+  blosc2_storage dest_storage = {.sequential=sequential};
+  blosc2_schunk* dest = blosc2_schunk_recompress(schunk, dest_cparams, dest_storage);
+  mu_assert("ERROR: cannot recompress", dest != NULL);
+  char* result = check_chunk_zonemaps(dest, 2);
+  if (result != EXIT_SUCCESS) {
+    return result;
+  }
+  blosc2_schunk_free(dest);
+
+  blosc2_schunk_free(schunk);
+  if (filename != NULL) {
+    remove(filename);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+static char* test_nans(void) {
+  blosc2_cparams cparams = BLOSC2_CPARAMS_DEFAULTS;
+  cparams.typesize = sizeof(double);
+  cparams.clevel = (uint8_t)clevel;
+  cparams.blocksize = BLOCKSIZE;
+  cparams.zonemap_type = BLOSC2_ZONEMAP_FLOAT64;
+  blosc2_storage storage = {.sequential=sequential, .path=filename};
+  blosc2_schunk* schunk = blosc_test_new_schunk(storage, cparams, nthreads);
+  mu_assert("ERROR: cannot create the super-chunk", schunk != NULL);
+  int32_t nitems_block = BLOCKSIZE / (int32_t)sizeof(double);
+  for (int i = 0; i < CHUNKSIZE; i++) {
+    // The first block is all NaNs, and every other item is NaN in the second one
+    if (i < nitems_block || (i < 2 * nitems_block && i % 2 == 0)) {
+      fdata[i] = NAN;
+    }
+    else {
+      fdata[i] = i / 2.;
+    }
+  }
+  mu_assert("ERROR: cannot append a chunk",
+            blosc2_schunk_append_buffer(schunk, fdata, CHUNKSIZE * sizeof(double)) == 1);
+
+  blosc2_zonemap zonemap;
+  mu_assert("ERROR: cannot get the zone map", blosc2_schunk_get_zonemap(schunk, 0, &zonemap) == 0);
+  mu_assert("ERROR: bad nnulls", zonemap.nnulls == nitems_block + nitems_block / 2);
+  mu_assert("ERROR: bad min", zonemap.min.f == (nitems_block + 1) / 2.);
+  mu_assert("ERROR: bad max", zonemap.max.f == (CHUNKSIZE - 1) / 2.);
+
+  blosc2_zonemap* zonemaps;
+  int nblocks = blosc2_schunk_get_block_zonemaps(schunk, 0, &zonemaps);
+  mu_assert("ERROR: bad number of blocks", nblocks > 2);
+  mu_assert("ERROR: bad nnulls", zonemaps[0].nnulls == nitems_block);
+  mu_assert("ERROR: bad nnulls", zonemaps[1].nnulls == nitems_block / 2);
+  mu_assert("ERROR: bad nnulls", zonemaps[2].nnulls == 0);
+  free(zonemaps);
+
+  // The block of NaNs never matches
+  blosc2_zonemap_value low = {.f = -INFINITY};
+  blosc2_zonemap_value high = {.f = INFINITY};
+  bool* maskout;
+  int32_t nblocks_;
+  int nmatches = blosc2_schunk_zonemap_maskout(schunk, 0, low, high, &maskout, &nblocks_);
+  mu_assert("ERROR: bad number of matching blocks", nmatches == nblocks - 1);
+  mu_assert("ERROR: bad mask", maskout != NULL && maskout[0] && !maskout[1]);
+  free(maskout);
+
+  blosc2_schunk_free(schunk);
+  if (filename != NULL) {
+    remove(filename);
+  }
+
+  // Super-chunks that do not keep zone maps
+  cparams.zonemap_type = BLOSC2_ZONEMAP_NONE;
+  schunk = blosc_test_new_schunk(storage, cparams, nthreads);
+  blosc2_schunk_append_buffer(schunk, fdata, CHUNKSIZE * sizeof(double));
+  mu_assert("ERROR: there should be no zone maps", blosc2_schunk_get_zonemap(schunk, 0, &zonemap) < 0);
+  blosc2_schunk_free(schunk);
+  if (filename != NULL) {
+    remove(filename);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+static char *all_tests(void) {
+  bool sequentials[] = {false, true, true};
+  char* filenames[] = {NULL, NULL, "test_zonemaps.b2frame"};
+  int nthreads_[] = {1, 4};
+  int clevels[] = {0, 5};
+  for (int i = 0; i < 3; i++) {
+    sequential = sequentials[i];
+    filename = filenames[i];
+    for (int j = 0; j < 2; j++) {
+      nthreads = nthreads_[j];
+      for (int k = 0; k < 2; k++) {
+        clevel = clevels[k];
+        mu_run_test(test_zonemaps);
+        mu_run_test(test_nans);
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+#define BUFFER_ALIGN_SIZE   32
+
+int main(void) {
+  char *result;
+
+  data = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(int32_t));
+  data_dest = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(int32_t));
+  fdata = blosc_test_malloc(BUFFER_ALIGN_SIZE, CHUNKSIZE * sizeof(double));
+
+  install_blosc_callback_test(); /* optionally install callback test */
+  blosc_init();
+
+  /* Run all the suite */
+  result = all_tests();
+  if (result != EXIT_SUCCESS) {
+    printf(" (%s)\n", result);
+  }
+  else {
+    printf(" ALL TESTS PASSED");
+  }
+  printf("\tTests run: %d\n", tests_run);
+
+  blosc_test_free(data);
+  blosc_test_free(data_dest);
+  blosc_test_free(fdata);
+  blosc_destroy();
+
+  return result != EXIT_SUCCESS;
+}